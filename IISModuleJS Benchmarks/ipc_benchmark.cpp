@@ -0,0 +1,548 @@
+#define NOMINMAX
+#include <Windows.h>
+#include <intrin.h>
+#include <cstdio>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "../IISModuleJS/ipc_backend.h"
+
+/**
+ * Measures the ipc backends under contention from several worker processes,
+ * like the worker processes of a web garden bumping rate-limit counters.
+ *
+ * Every run fills a fresh store with its keys from every worker at once, which is where
+ * its table grows, and then reads and writes them with the given mix and distribution.
+ *
+ * Usage: ipc_benchmark.exe [--processes 8] [--operations 200000] [--keys 65536] [--writes 50]
+ *                          [--value-size 8] [--distribution uniform|zipf] [--skew 0.99] [--engine locked|lockfree]
+ */
+
+#define BENCHMARK_START_EVENT "IISModuleJS_Benchmark_Start"
+#define BENCHMARK_RESULTS "IISModuleJS_Benchmark_Results"
+#define BENCHMARK_MAX_PROCESSES 64
+
+// Latencies are counted in buckets of a sixteenth of a power of two of nanoseconds.
+#define BENCHMARK_HISTOGRAM_BUCKETS 1024
+
+// How many times the median an insert has to take for us to count it as a pause.
+#define BENCHMARK_PAUSE_FACTOR 10
+
+// How long a worker waits for the others to fill our store before it goes on without them.
+#define BENCHMARK_BARRIER_TIMEOUT 60000
+
+struct PhaseResult
+{
+	uint64_t operations;
+	uint64_t failures;
+	double elapsed;
+	double max_latency;
+	uint64_t histogram[BENCHMARK_HISTOGRAM_BUCKETS];
+};
+
+struct WorkerResult
+{
+	PhaseResult fill;
+	PhaseResult mixed;
+};
+
+/**
+ * The start of our results, the workers wait on each other between filling our
+ * store and their workload. Workers which fail count as filled, so nobody waits on them.
+ */
+struct BenchmarkHeader
+{
+	volatile LONG workers;
+	volatile LONG filled;
+};
+
+struct BenchmarkOptions
+{
+	int processes = 8;
+	int operations = 200000;
+	int keys = 65536;
+	int write_percentage = 50;
+	int value_size = 8;
+	bool zipf = false;
+	double skew = 0.99;
+	std::string engine;
+};
+
+static const size_t results_size = sizeof(BenchmarkHeader) + sizeof(WorkerResult) * BENCHMARK_MAX_PROCESSES;
+
+/**
+ * Draws keys with a Zipf distribution, the key of rank k is drawn in
+ * proportion to 1 / k^skew so that a few hot keys take most of the operations.
+ */
+class ZipfDistribution
+{
+public:
+	ZipfDistribution(int keys, double skew) : m_cumulative(keys)
+	{
+		double sum = 0;
+
+		for (int i = 0; i < keys; i++)
+		{
+			sum += 1 / std::pow(i + 1.0, skew);
+			m_cumulative[i] = sum;
+		}
+
+		for (auto & probability : m_cumulative)
+			probability /= sum;
+	}
+
+	int operator()(std::mt19937 & random)
+	{
+		auto point = std::uniform_real_distribution<double>(0, 1)(random);
+		auto rank = std::lower_bound(m_cumulative.begin(), m_cumulative.end(), point) - m_cumulative.begin();
+
+		return (int)std::min<ptrdiff_t>(rank, m_cumulative.size() - 1);
+	}
+
+private:
+	std::vector<double> m_cumulative;
+};
+
+////////////////////////////////////////////////////////
+
+static int get_bucket(uint64_t nanoseconds)
+{
+	if (nanoseconds < 16)
+		return (int)nanoseconds;
+
+	unsigned long position;
+	_BitScanReverse64(&position, nanoseconds);
+
+	return (int)((position - 3) * 16 + ((nanoseconds >> (position - 4)) & 15));
+}
+
+static double get_bucket_latency(int bucket)
+{
+	if (bucket < 16)
+		return bucket / 1000.0;
+
+	auto position = bucket / 16 + 3;
+
+	return (double)((16ull + bucket % 16) << (position - 4)) / 1000.0;
+}
+
+static void record_latency(PhaseResult & result, std::chrono::steady_clock::duration latency)
+{
+	auto nanoseconds = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+
+	result.histogram[get_bucket(nanoseconds)]++;
+	result.max_latency = std::max(result.max_latency, nanoseconds / 1000.0);
+}
+
+/**
+ * Returns the latency in microseconds that percentile of our operations stayed under.
+ */
+static double get_percentile(const PhaseResult & result, double percentile)
+{
+	auto rank = (uint64_t)std::ceil(result.operations * percentile / 100);
+	uint64_t seen = 0;
+
+	for (int i = 0; i < BENCHMARK_HISTOGRAM_BUCKETS; i++)
+	{
+		seen += result.histogram[i];
+
+		if (seen >= std::max<uint64_t>(rank, 1))
+			return get_bucket_latency(i);
+	}
+
+	return result.max_latency;
+}
+
+static void merge_result(PhaseResult & total, const PhaseResult & result)
+{
+	total.operations += result.operations;
+	total.failures += result.failures;
+	total.elapsed = std::max(total.elapsed, result.elapsed);
+	total.max_latency = std::max(total.max_latency, result.max_latency);
+
+	for (int i = 0; i < BENCHMARK_HISTOGRAM_BUCKETS; i++)
+		total.histogram[i] += result.histogram[i];
+}
+
+/**
+ * Waits for every worker to be done filling our store, returns false if
+ * some of them still weren't after our timeout, which means they're stuck or gone.
+ */
+static bool wait_for_fill(BenchmarkHeader* header, int workers)
+{
+	auto deadline = GetTickCount64() + BENCHMARK_BARRIER_TIMEOUT;
+
+	while (header->filled < workers)
+	{
+		if (GetTickCount64() > deadline)
+			return false;
+
+		Sleep(0);
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////
+
+/**
+ * Runs our workload in a worker process, every write is
+ * a read-modify-write of a counter just like a rate limiter.
+ */
+int run_worker(const std::string& name, int index, const BenchmarkOptions& options)
+{
+	// Without our results we can't tell anyone we failed, the others run into their timeout instead.
+	auto results_handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, BENCHMARK_RESULTS);
+
+	if (!results_handle)
+		return 1;
+
+	auto header = (BenchmarkHeader*)MapViewOfFile(results_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+	if (!header)
+	{
+		CloseHandle(results_handle);
+		return 1;
+	}
+
+	auto & result = ((WorkerResult*)(header + 1))[index];
+	auto start_event = OpenEventA(SYNCHRONIZE, FALSE, BENCHMARK_START_EVENT);
+
+	v8_wrapper::IPCOptions ipc_options;
+	ipc_options.engine = options.engine;
+
+	std::unique_ptr<v8_wrapper::IPCBackend> store;
+
+	try
+	{
+		if (start_event)
+			store = v8_wrapper::create_ipc_backend(name, ipc_options);
+	}
+	catch (std::exception& exception)
+	{
+		printf("worker %d: %s\n", index, exception.what());
+	}
+
+	if (!store)
+	{
+		InterlockedIncrement(&header->filled);
+
+		UnmapViewOfFile(header);
+		CloseHandle(results_handle);
+
+		if (start_event)
+			CloseHandle(start_event);
+
+		return 1;
+	}
+
+	std::vector<std::string> keys;
+	keys.reserve(options.keys);
+
+	for (int i = 0; i < options.keys; i++)
+		keys.push_back("counter:" + std::to_string(i));
+
+	std::mt19937 random(index);
+	std::uniform_int_distribution<int> key_distribution(0, options.keys - 1);
+	std::uniform_int_distribution<int> percentage_distribution(0, 99);
+	std::unique_ptr<ZipfDistribution> zipf_distribution;
+
+	if (options.zipf)
+		zipf_distribution.reset(new ZipfDistribution(options.keys, options.skew));
+
+	// Our values start with their counter, the rest of them is padding up to our value size.
+	std::vector<unsigned char> payload(std::max<size_t>(options.value_size, sizeof(uint64_t)));
+	std::vector<unsigned char> value;
+
+	////////////////////////////////////////////
+
+	WaitForSingleObject(start_event, INFINITE);
+
+	auto workers = (int)header->workers;
+	auto started = std::chrono::steady_clock::now();
+
+	// Every worker inserts its share of our keys, so our table grows while all of them are writing.
+	for (int i = index; i < options.keys; i += workers)
+	{
+		auto operation_started = std::chrono::steady_clock::now();
+
+		try
+		{
+			store->set(keys[i], payload.data(), payload.size());
+		}
+		catch (std::exception&)
+		{
+			result.fill.failures++;
+		}
+
+		record_latency(result.fill, std::chrono::steady_clock::now() - operation_started);
+		result.fill.operations++;
+	}
+
+	result.fill.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	InterlockedIncrement(&header->filled);
+
+	if (!wait_for_fill(header, workers))
+		printf("worker %d: gave up waiting for the others to fill our store.\n", index);
+
+	////////////////////////////////////////////
+
+	started = std::chrono::steady_clock::now();
+
+	for (int i = 0; i < options.operations; i++)
+	{
+		auto & key = keys[zipf_distribution ? (*zipf_distribution)(random) : key_distribution(random)];
+		auto operation_started = std::chrono::steady_clock::now();
+
+		if (percentage_distribution(random) < options.write_percentage)
+		{
+			uint64_t counter = 0;
+
+			if (store->get(key, value) && value.size() >= sizeof(counter))
+				memcpy(&counter, value.data(), sizeof(counter));
+
+			counter++;
+			memcpy(payload.data(), &counter, sizeof(counter));
+
+			try
+			{
+				store->set(key, payload.data(), payload.size());
+			}
+			catch (std::exception&)
+			{
+				result.mixed.failures++;
+			}
+		}
+		else
+		{
+			store->get(key, value);
+		}
+
+		record_latency(result.mixed, std::chrono::steady_clock::now() - operation_started);
+	}
+
+	result.mixed.operations = options.operations;
+	result.mixed.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+	UnmapViewOfFile(header);
+	CloseHandle(results_handle);
+	CloseHandle(start_event);
+
+	return 0;
+}
+
+/**
+ * Starts our worker processes for an engine, releases
+ * them all at once and prints their combined results.
+ */
+void run_benchmark(const std::string& engine, const BenchmarkOptions& options)
+{
+	auto results_handle = CreateFileMappingA(
+		INVALID_HANDLE_VALUE,
+		nullptr,
+		PAGE_READWRITE,
+		0,
+		(DWORD)results_size,
+		BENCHMARK_RESULTS
+	);
+
+	auto start_event = CreateEventA(nullptr, TRUE, FALSE, BENCHMARK_START_EVENT);
+	auto header = (BenchmarkHeader*)MapViewOfFile(results_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+	auto results = (WorkerResult*)(header + 1);
+
+	memset(header, 0, results_size);
+
+	////////////////////////////////////////////
+
+	char module_path[MAX_PATH];
+	GetModuleFileNameA(nullptr, module_path, MAX_PATH);
+
+	// Every run gets a store of its own, so that each of them fills it from empty.
+	auto name = "ipc_benchmark_" + engine + "_" + std::to_string(GetCurrentProcessId()) + "_" + std::to_string(options.processes);
+
+	// The parent keeps the store open so that it outlives the workers.
+	v8_wrapper::IPCOptions ipc_options;
+	ipc_options.engine = engine;
+
+	auto store = v8_wrapper::create_ipc_backend(name, ipc_options);
+
+	std::vector<PROCESS_INFORMATION> workers;
+
+	for (int i = 0; i < options.processes; i++)
+	{
+		auto command_line = "\"" + std::string(module_path) + "\" --worker " + engine + " " + name + " " +
+			std::to_string(i) + " " +
+			std::to_string(options.operations) + " " +
+			std::to_string(options.keys) + " " +
+			std::to_string(options.write_percentage) + " " +
+			std::to_string(options.value_size) + " " +
+			std::to_string(options.zipf ? options.skew : 0);
+
+		STARTUPINFOA startup_info = { sizeof(startup_info) };
+		PROCESS_INFORMATION process_information = {};
+
+		if (!CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup_info, &process_information))
+		{
+			printf("failed to start worker %d.\n", i);
+			continue;
+		}
+
+		workers.push_back(process_information);
+	}
+
+	header->workers = (LONG)workers.size();
+
+	// Give our workers a moment to open the store before releasing them.
+	Sleep(1000);
+	SetEvent(start_event);
+
+	////////////////////////////////////////////
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		DWORD exit_code = 0;
+
+		WaitForSingleObject(workers[i].hProcess, INFINITE);
+		GetExitCodeProcess(workers[i].hProcess, &exit_code);
+
+		if (exit_code != 0)
+			printf("worker %d failed, its results are missing.\n", (int)i);
+
+		CloseHandle(workers[i].hProcess);
+		CloseHandle(workers[i].hThread);
+	}
+
+	std::unique_ptr<WorkerResult> total(new WorkerResult());
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		merge_result(total->fill, results[i].fill);
+		merge_result(total->mixed, results[i].mixed);
+	}
+
+	// Our table only stalls writers while it starts a resize, which shows up as inserts far slower than the rest.
+	// How long they took is summed up from their buckets, which undercounts each of them by less than a sixteenth.
+	auto pause_threshold = get_percentile(total->fill, 50) * BENCHMARK_PAUSE_FACTOR;
+	uint64_t pauses = 0;
+	double pause_time = 0;
+
+	for (int i = 0; i < BENCHMARK_HISTOGRAM_BUCKETS; i++)
+	{
+		if (get_bucket_latency(i) > pause_threshold)
+		{
+			pauses += total->fill.histogram[i];
+			pause_time += total->fill.histogram[i] * get_bucket_latency(i);
+		}
+	}
+
+	printf(
+		"%-10s %3d processes   fill  %12.0f ops/s   p50 %8.2f us   p99 %8.2f us   p99.9 %8.2f us   max %9.2f us   %llu pauses (%.2f ms), %llu failed writes\n",
+		engine.c_str(),
+		(int)workers.size(),
+		total->fill.elapsed ? total->fill.operations / total->fill.elapsed : 0,
+		get_percentile(total->fill, 50),
+		get_percentile(total->fill, 99),
+		get_percentile(total->fill, 99.9),
+		total->fill.max_latency,
+		pauses,
+		pause_time / 1000,
+		total->fill.failures
+	);
+
+	printf(
+		"%-10s %3d processes   mixed %12.0f ops/s   p50 %8.2f us   p99 %8.2f us   p99.9 %8.2f us   max %9.2f us   %llu failed writes\n",
+		engine.c_str(),
+		(int)workers.size(),
+		total->mixed.elapsed ? total->mixed.operations / total->mixed.elapsed : 0,
+		get_percentile(total->mixed, 50),
+		get_percentile(total->mixed, 99),
+		get_percentile(total->mixed, 99.9),
+		total->mixed.max_latency,
+		total->mixed.failures
+	);
+
+	////////////////////////////////////////////
+
+	store->close();
+
+	UnmapViewOfFile(header);
+	CloseHandle(results_handle);
+	CloseHandle(start_event);
+}
+
+/**
+ * Reads our options from --name value pairs, anything we don't know is ignored.
+ */
+void parse_options(int argc, char ** argv, BenchmarkOptions& options)
+{
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string option = argv[i];
+		std::string value = argv[i + 1];
+
+		if (option == "--processes") options.processes = std::min(std::max(atoi(value.c_str()), 1), BENCHMARK_MAX_PROCESSES);
+		else if (option == "--operations") options.operations = std::max(atoi(value.c_str()), 1);
+		else if (option == "--keys") options.keys = std::max(atoi(value.c_str()), 1);
+		else if (option == "--writes") options.write_percentage = std::min(std::max(atoi(value.c_str()), 0), 100);
+		else if (option == "--value-size") options.value_size = std::max(atoi(value.c_str()), 1);
+		else if (option == "--distribution") options.zipf = value == "zipf";
+		else if (option == "--skew") options.skew = std::max(atof(value.c_str()), 0.0);
+		else if (option == "--engine") options.engine = value;
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	BenchmarkOptions options;
+
+	if (argc > 1 && std::string(argv[1]) == "--worker")
+	{
+		if (argc < 10) return 1;
+
+		options.engine = argv[2];
+		options.operations = atoi(argv[5]);
+		options.keys = atoi(argv[6]);
+		options.write_percentage = atoi(argv[7]);
+		options.value_size = atoi(argv[8]);
+		options.skew = atof(argv[9]);
+		options.zipf = options.skew > 0;
+
+		return run_worker(argv[3], atoi(argv[4]), options);
+	}
+
+	parse_options(argc, argv, options);
+
+	printf(
+		"%d operations per process over %d keys (%s), %d byte values, %d%% writes.\n\n",
+		options.operations,
+		options.keys,
+		options.zipf ? ("zipf " + std::to_string(options.skew)).c_str() : "uniform",
+		options.value_size,
+		options.write_percentage
+	);
+
+	std::vector<std::string> engines = { IPC_BACKEND_LOCKED, IPC_BACKEND_LOCKFREE };
+
+	if (!options.engine.empty())
+		engines = { options.engine };
+
+	// We double our processes every step, and always finish on as many as we were asked for.
+	for (int processes = 1; ; processes = std::min(processes * 2, options.processes))
+	{
+		auto run_options = options;
+		run_options.processes = processes;
+
+		for (auto & engine : engines)
+			run_benchmark(engine, run_options);
+
+		if (processes == options.processes)
+			break;
+	}
+
+	return 0;
+}
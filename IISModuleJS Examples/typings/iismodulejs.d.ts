@@ -73,6 +73,19 @@ interface IISRequest {
      * This method can be used to get the connecting client's IP address.
      */
     getRemoteAddress(): string
+
+    /**
+     * Returns true if the request is a synthetic warm-up request.
+     * 
+     * This method can be used to skip side effects while the engine is warming up.
+     */
+    isWarmup(): boolean
+
+    /**
+     * Keeps track of ``promise`` without delaying the response.
+     * @param promise The promise to keep track of.
+     */
+    waitUntil(promise: Promise<any>): void
 }
 
 interface IISResponse {
@@ -89,6 +102,15 @@ interface IISResponse {
         contentEncoding?: string
     ): void
 
+    /**
+     * Writes the bytes of a key set with ``ipc.setRaw`` as the response, copying them 
+     * straight from the store. Returns false if the key does not exist.
+     * @param store The store the key is in.
+     * @param key The key to write.
+     * @param mimeType Sets the Content-Type header with the given value.
+     */
+    writeFromIpc(store: IPC, key: string, mimeType?: string): boolean
+
     /**
      * Sets or appends the value of a specified HTTP request header.
      * @param headerName Defines the name of the header, example: "Content-Type." 
@@ -206,13 +228,245 @@ interface HTTP {
  * The interprocess communication interface provides a key-value 
  * store where you can share JavaScript data across different processes/workers.
  */
+interface IPCOptions {
+    /**
+     * How the store handles concurrency, the default is "locked".
+     */
+    engine?: "locked" | "lockfree",
+
+    /**
+     * The size of a block in bytes for the lock-free store.
+     */
+    blockSize?: number,
+
+    /**
+     * The number of blocks for the lock-free store.
+     */
+    blockCount?: number,
+
+    /**
+     * The largest value in bytes for the locked store, the default is 1 MB.
+     */
+    maxValueSize?: number,
+
+    /**
+     * The most memory in bytes for the keys and values of the locked store,
+     * after which the entries which haven't been read recently are evicted.
+     */
+    maxMemory?: number,
+
+    /**
+     * The file the locked store is periodically written to and restored from when it's created.
+     */
+    persist?: string,
+
+    /**
+     * How many milliseconds apart snapshots are written, the default is 60000.
+     */
+    persistInterval?: number,
+
+    /**
+     * Keeps the values **get** deserializes, up to 1024 of them or as many as given, and hands
+     * the same object out again until its key is written. Only the locked engine can cache.
+     */
+    cache?: boolean | number
+}
+
+interface IPCSetOptions {
+    /**
+     * The number of milliseconds after which the key expires.
+     */
+    ttl?: number
+}
+
+interface IPCStats {
+    hits: number,
+    misses: number,
+    evictions: number,
+    expirations: number,
+    size: number,
+    memory: number
+}
+
+interface IPCScanResult {
+    /**
+     * Where the next scan picks up, which is 0 once every key has been visited.
+     */
+    cursor: number,
+    keys: string[]
+}
+
+interface IPCQueueOptions {
+    /**
+     * How many milliseconds a popped job has to be acknowledged in before it's handed out again, the default is 30000.
+     */
+    visibilityTimeout?: number
+}
+
+interface IPCJob {
+    id: number,
+    value: any,
+    attempts: number
+}
+
+interface IPCQueue {
+    /**
+     * Adds a job to the queue.
+     * @param value The job.
+     */
+    push(value: any): void
+
+    /**
+     * Takes a job from the queue, or returns **null** if there isn't any.
+     */
+    pop(): IPCJob | null
+
+    /**
+     * Acknowledges a job taken with **pop**, which returns **false** if it was already handed out again.
+     * @param id The id of the job.
+     */
+    ack(id: number): boolean
+
+    /**
+     * Returns the number of jobs which haven't been acknowledged yet.
+     */
+    size(): number
+
+    /**
+     * Calls **callback** with a job whenever this worker is free, the job is acknowledged 
+     * once the callback returns or its promise resolves.
+     * @param callback The function to call.
+     */
+    onJob(callback: (value: any, attempts: number) => any | Promise<any>): void
+}
+
+interface IPCHyperLogLog {
+    /**
+     * Adds one or many keys and returns whether that changed the count.
+     * @param key The key or keys to add.
+     */
+    add(key: string | string[]): boolean
+
+    /**
+     * Returns about how many distinct keys were added.
+     */
+    count(): number
+
+    clear(): void
+}
+
+interface IPCCountMin {
+    /**
+     * Adds **count** (1 by default) to a key and returns its new estimate.
+     * @param key The key to count.
+     * @param count The amount to add.
+     */
+    add(key: string, count?: number): number
+
+    /**
+     * Returns about how often a key was added, which is never less than it actually was.
+     * @param key The key to look up.
+     */
+    estimate(key: string): number
+
+    clear(): void
+}
+
+interface IPCBloomFilter {
+    /**
+     * Adds a key and returns whether it wasn't in the filter yet.
+     * @param key The key to add.
+     */
+    add(key: string): boolean
+
+    /**
+     * Returns whether a key could have been added, which is never **false** for one that was.
+     * @param key The key to look up.
+     */
+    has(key: string): boolean
+
+    clear(): void
+}
+
 interface IPC {
+    /**
+     * Opens the store called ``name``, which is shared by every worker process that opens the same name.
+     * @param name The name of the store.
+     * @param options The options of the store.
+     */
+    init(name: string, options?: IPCOptions): IPC
+
+    /**
+     * Returns a typed array which lives in shared memory and is shared by every worker process 
+     * that opens the same name, the ``Atomics`` functions work on it as well.
+     * @param name The name of the array.
+     * @param type The type of its elements.
+     * @param length The number of elements.
+     */
+    sharedArray(name: string, type: "int32", length: number): Int32Array
+    sharedArray(name: string, type: "float64", length: number): Float64Array
+    sharedArray(name: string, type: "bigint64", length: number): BigInt64Array
+    sharedArray(name: string, type: "int8" | "uint8" | "int16" | "uint16" | "uint32" | "float32" | "biguint64", length: number): ArrayBufferView
+
+    /**
+     * Sends **value** to every worker process which subscribed to **channel**.
+     * @param channel The name of the channel.
+     * @param value The value to send.
+     */
+    publish(channel: string, value: any): void
+
+    /**
+     * Calls **callback** with every value published to **channel** from now on.
+     * @param channel The name of the channel.
+     * @param callback The function to call.
+     */
+    subscribe(channel: string, callback: (value: any) => void): void
+
+    /**
+     * Opens the job queue called ``name``, which is shared by every worker process.
+     * @param name The name of the queue.
+     * @param options The options of the queue.
+     */
+    queue(name: string, options?: IPCQueueOptions): IPCQueue
+
+    /**
+     * Opens the HyperLogLog called ``name``, which counts distinct keys in 16 KB of shared memory.
+     * @param name The name of the HyperLogLog.
+     */
+    hll(name: string): IPCHyperLogLog
+
+    /**
+     * Opens the Count-Min sketch called ``name``, which counts keys in **depth** rows of **width** counters.
+     * @param name The name of the sketch.
+     * @param width The number of counters per row.
+     * @param depth The number of rows.
+     */
+    countMin(name: string, width: number, depth: number): IPCCountMin
+
+    /**
+     * Opens the bloom filter called ``name``, which sets **hashes** of its **bits** for every key.
+     * @param name The name of the filter.
+     * @param bits The number of bits.
+     * @param hashes The number of bits per key.
+     */
+    bloom(name: string, bits: number, hashes: number): IPCBloomFilter
+
     /**
      * Sets a **key** with a given **value**.
      * @param key The key to use.
      * @param value  The value to set the key with.
+     * @param options The options of the key.
      */
-    set(key: string, value: any): void
+    set(key: string, value: any, options?: IPCSetOptions): void
+
+    /**
+     * Sets a **key** to raw bytes, strings are stored as UTF-8. **get** returns them as a Uint8Array,
+     * and **response.writeFromIpc** writes them to a response without creating a string.
+     * @param key The key to use.
+     * @param bytes The bytes to set the key with.
+     * @param options The options of the key.
+     */
+    setRaw(key: string, bytes: string | Uint8Array, options?: IPCSetOptions): void
 
     /**
      * Returns a value with the corresponding key. 
@@ -221,6 +475,152 @@ interface IPC {
      * @param key The key containing the value.
      */
     get(key: string): any | null
+
+    /**
+     * Returns the values of **keys** in the same order while taking the lock only once,
+     * with **null** for every key which does not exist.
+     * @param keys The keys containing the values.
+     */
+    getMany(keys: string[]): (any | null)[]
+
+    /**
+     * Sets many keys while taking the lock only once.
+     * @param entries An object or an array of key and value pairs.
+     * @param options The options of the keys.
+     */
+    setMany(entries: { [key: string]: any } | [string, any][], options?: IPCSetOptions): void
+
+    /**
+     * Removes many keys while taking the lock only once and returns how many were removed.
+     * @param keys The keys to remove.
+     */
+    removeMany(keys: string[]): number
+
+    /**
+     * Returns up to **limit** keys starting with **prefix**, or all of them.
+     * @param prefix The start of the keys to return.
+     * @param limit The most keys to return.
+     */
+    keys(prefix?: string, limit?: number): string[]
+
+    /**
+     * Returns the keys of the next chunk of the store starting at **cursor**, start at 0 and
+     * keep passing the cursor that was returned until it's 0 again. A key could be returned more than once.
+     * @param cursor Where to pick up.
+     * @param count About how many keys to return, the default is 100.
+     * @param prefix The start of the keys to return.
+     */
+    scan(cursor: number, count?: number, prefix?: string): IPCScanResult
+
+    /**
+     * Returns the version of a key, which changes on every write to it, or 0 if it does not exist.
+     * @param key The key whose version to return.
+     */
+    version(key: string): number
+
+    /**
+     * Resolves with the version of a key once it's no longer **lastVersion**,
+     * or with **lastVersion** once **timeout** milliseconds have passed.
+     * @param key The key to wait on.
+     * @param lastVersion The version we last saw.
+     * @param timeout How many milliseconds to wait at most.
+     */
+    wait(key: string, lastVersion: number, timeout: number): Promise<number>
+
+    /**
+     * Atomically adds **delta** (1 by default) to the number of a key and returns it,
+     * a key which doesn't exist starts at zero.
+     * @param key The key of the number.
+     * @param delta The amount to add.
+     */
+    incr(key: string, delta?: number): number
+
+    /**
+     * Atomically subtracts **delta** (1 by default) from the number of a key and returns it.
+     * @param key The key of the number.
+     * @param delta The amount to subtract.
+     */
+    decr(key: string, delta?: number): number
+
+    /**
+     * Replaces the number of a key with **next** if it's still **expected**, 
+     * an **expected** of **null** only sets a key which doesn't exist yet.
+     * @param key The key of the number.
+     * @param expected The number we expect the key to have.
+     * @param next The number to replace it with.
+     */
+    compareAndSet(key: string, expected: number | null, next: number): boolean
+
+    /**
+     * Returns the number of a key, or **null** if the key does not exist.
+     * @param key The key of the number.
+     */
+    getNumber(key: string): number | null
+
+    /**
+     * Returns the hit, miss, eviction and expiration counters of the store.
+     */
+    stats(): IPCStats
+}
+
+interface RateLimiterOptions {
+    /**
+     * The tokens a bucket gains a second, or the requests a window allows with ``window``.
+     */
+    rate: number,
+
+    /**
+     * The most tokens a bucket holds, which defaults to ``rate``.
+     */
+    burst?: number,
+
+    /**
+     * The length of a sliding window in milliseconds, which makes this a sliding window limiter instead of a token bucket.
+     */
+    window?: number,
+
+    /**
+     * How many keys the limiter has room for, which defaults to 65536.
+     */
+    slots?: number
+}
+
+interface RequestLimitOptions {
+    status?: number,
+    reason?: string
+}
+
+interface RateLimiter {
+    /**
+     * Takes ``cost`` from the limit of ``key`` and returns whether it was allowed, a request which isn't allowed takes nothing.
+     * @param key The key to take from, such as a remote address.
+     * @param cost How much to take, which defaults to 1.
+     */
+    take(key: string, cost?: number): boolean
+
+    /**
+     * Gives ``key`` its whole limit back.
+     * @param key The key to reset.
+     */
+    reset(key: string): void
+
+    clear(): void
+
+    /**
+     * Takes every request from this limiter by its remote address before any callback runs, requests over 
+     * the limit are finished with a 429 without ever entering JavaScript.
+     * @param options The status and reason of a request that isn't allowed.
+     */
+    protect(options?: RequestLimitOptions): void
+}
+
+interface RateLimit {
+    /**
+     * Opens the rate limiter called ``name``, which lives in shared memory and is taken from by every worker process at once.
+     * @param name The name of the rate limiter.
+     * @param options The limits of the rate limiter, which have to be the same for everyone that opens it.
+     */
+    create(name: string, options: RateLimiterOptions): RateLimiter
 }
 
 /**
@@ -243,6 +643,11 @@ declare function register(
  */
 declare var ipc: IPC;
 
+/**
+ * Rate limiters in shared memory, which are shared by every worker process.
+ */
+declare var ratelimit: RateLimit;
+
 /**
  * The HTTP interface allowing to communicate with remote endpoints.
  */
@@ -254,6 +659,88 @@ declare var http: HTTP;
  */
 declare function load(...fileName: string[]): void;
 
+interface WarmupRequestInit {
+    method?: string,
+    url?: string,
+    headers?: Object<String, String>,
+    body?: string,
+    remoteAddress?: string
+}
+
+interface WarmupOptions {
+    iterations?: number,
+    budget?: number
+}
+
+/**
+ * Replays ``requests`` against the registered callbacks after the engine reloads, 
+ * the new scripts only start serving requests once every iteration was made 
+ * or the time budget runs out.
+ * @param requests The synthetic requests to replay.
+ * @param options The maximum number of iterations and the time budget in milliseconds.
+ */
+declare function warmup(requests: WarmupRequestInit[], options?: WarmupOptions): void;
+
+/**
+ * Queues ``callback`` to be called after the current request has been handed back to IIS.
+ * @param callback The function to call, it can also be asynchronous.
+ */
+declare function defer(callback: () => any | Promise<any>): void;
+
+interface TenantOptions {
+    /**
+     * The size of the tenant's heap in megabytes.
+     */
+    heapLimit?: number,
+
+    /**
+     * How many milliseconds a single callback can run before it's terminated.
+     */
+    cpuBudget?: number,
+
+    /**
+     * The tenant's share of the machine, the default is 1.
+     */
+    weight?: number
+}
+
+/**
+ * Serves every request for ``host`` from ``script`` in an isolate of its own, this can only be called by Main.js.
+ * @param host The host to serve, without its port.
+ * @param script The script to serve it with.
+ * @param options The quotas of the tenant.
+ */
+declare function tenant(host: string, script: string, options?: TenantOptions): void;
+
+interface Metrics {
+    calls: number,
+    cpuTime: number,
+    queueTime: number,
+    terminations: number,
+    heapLimitHits: number,
+    heapUsed: number,
+    heapLimit: number,
+    cpuBudget: number,
+    weight: number,
+    generation: number,
+    draining: number,
+    abandoned: number,
+    tenants?: { [host: string]: Metrics },
+    deferred: {
+        queued: number,
+        pending: number,
+        completed: number,
+        failed: number,
+        rejected: number,
+        limit: number
+    }
+}
+
+/**
+ * Returns the current state of the engine.
+ */
+declare function metrics(): Metrics;
+
 /**
  * Prints ``msg`` using OutputDebugstring. You can observe the print out using a debugger or DebugView.
  * @param msg The message to print. Each message component will be seperated by a space character.
@@ -2,6 +2,7 @@
 #include "helpers.h"
 #include <httplib/httplib.h>
 #include <rpc/client.h>
+#include <thread>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
@@ -78,4 +79,240 @@ public:
 			);
 		}
 	}
+
+	TEST_METHOD(Warmup)
+	{
+		// Warm-up only happens when there's a live engine to replace.
+		EXECUTE_SCRIPT(R"(
+		register(() => CONTINUE);
+		)");
+
+		EXECUTE_SCRIPT(R"(
+		let warmups = [];
+
+		register((response, request) => {
+			if (request.isWarmup()) 
+			{
+				warmups.push(`${request.getMethod()} ${request.getPath()} ${request.getHeader("X-Test")}`);
+				response.write("warmup");
+
+				return FINISH;
+			}
+
+			response.write(`${warmups[0]}, ${warmups.length > 0}, ${request.isWarmup()}`, "text/html");
+
+			return FINISH;
+		});
+
+		warmup([{ method: "POST", url: "/warmup?id=1", headers: { "x-test": "value" } }], { iterations: 20 });
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), "POST /warmup?id=1 value, true, false");
+		}
+	}
+
+	TEST_METHOD(Defer)
+	{
+		EXECUTE_SCRIPT(R"(
+		let deferred = 0;
+
+		register((response, request) => {
+			if (request.getAbsPath() == "/result") 
+			{
+				response.write(`${deferred}, ${metrics().deferred.completed >= 2}`, "text/html");
+
+				return FINISH;
+			}
+
+			defer(() => { deferred++; });
+			request.waitUntil(Promise.resolve().then(() => { deferred++; }));
+
+			response.write("ok", "text/html");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), "ok");
+		}
+
+		Sleep(500);
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/result");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), "2, true");
+		}
+	}
+
+	TEST_METHOD(Tenant)
+	{
+		EXECUTE_SCRIPT(R"(
+		tenant("Tenant.Example.com:8080", "Tenant.js", { heapLimit: 16, cpuBudget: 50, weight: 2 });
+
+		register((response, request) => {
+			const tenant = metrics().tenants["tenant.example.com"];
+
+			response.write(`${tenant.heapLimit}, ${tenant.cpuBudget}, ${tenant.weight}, ${typeof metrics().calls}`, "text/html");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), "16, 50, 2, number");
+		}
+	}
+
+	TEST_METHOD(TenantRetire)
+	{
+		// The tenant's script is written by the main script, which declares it right after.
+		const std::string main_script = R"(
+		fs.write("retire_tenant.js", `
+			const received = { messages: [], jobs: [] };
+			const jobs = ipc.queue("retire_job_tests");
+
+			ipc.subscribe("retire_tests", (message) => { received.messages.push(message); });
+			jobs.onJob((job) => { received.jobs.push(job); });
+
+			register((response, request) => {
+				if (request.getAbsPath() == "/result") 
+				{
+					response.write(JSON.stringify(received), "application/json");
+
+					return FINISH;
+				}
+
+				ipc.publish("retire_tests", "message");
+				jobs.push("job");
+
+				response.write("ok", "text/html");
+
+				return FINISH;
+			});
+		`);
+
+		tenant("retire.example.com", "retire_tenant.js");
+
+		register((response, request) => {
+			response.write("main", "text/html");
+
+			return FINISH;
+		});
+		)";
+
+		EXECUTE_SCRIPT(main_script);
+
+		// Retire our tenant, and declare it again while its engine is still around.
+		EXECUTE_SCRIPT(R"(
+		register((response, request) => {
+			response.write("main", "text/html");
+
+			return FINISH;
+		});
+		)");
+
+		EXECUTE_SCRIPT(main_script);
+
+		//////////////////////////////////////////////
+
+		httplib::Headers headers;
+		headers.emplace("Host", "retire.example.com");
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/", headers);
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), "ok");
+		}
+
+		Sleep(500);
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/result", headers);
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"({"messages":["message"],"jobs":["job"]})");
+		}
+	}
+
+	TEST_METHOD(Drain)
+	{
+		EXECUTE_SCRIPT(R"(
+		register(async (response, request) => {
+			await crypto.bcrypt.hash("drain", 12);
+
+			response.write("old", "text/html");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		// Start a request on the old generation and replace it while it's pending.
+		std::string old_body;
+
+		std::thread request_thread([&old_body]() {
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (response) old_body = response->body;
+		});
+
+		Sleep(50);
+
+		EXECUTE_SCRIPT(R"(
+		register((response, request) => {
+			response.write(`new, ${metrics().generation > 1}`, "text/html");
+
+			return FINISH;
+		});
+		)");
+
+		request_thread.join();
+
+		Assert::AreEqual(old_body.c_str(), "old");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), "new, true");
+		}
+	}
 };
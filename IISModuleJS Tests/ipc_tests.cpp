@@ -74,4 +74,789 @@ public:
 			);
 		}
 	}
+
+	TEST_METHOD(LockFree)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("lockfree_tests", { engine: "lockfree" });
+
+		register((response, request) => {
+			store.set("test", {
+				number: 3.14,
+				text: "sample text",
+				array: [ 3.14, "sample text" ]
+			});
+
+			store.set("large", "x".repeat(4096));
+
+			response.write(
+				JSON.stringify([ 
+					store.get("test"),
+					store.get("large").length,
+					store.get("missing")
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->body == R"([{"number":3.14,"text":"sample text","array":[3.14,"sample text"]},4096,null])",
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(LargeValues)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("large_value_tests", { maxValueSize: 256 * 1024 });
+
+		register((response, request) => {
+			store.set("small", 1);
+			store.set("large", "x".repeat(128 * 1024));
+
+			let result = [ store.get("small"), store.get("large").length ];
+
+			store.set("large", "y".repeat(16));
+			result.push(store.get("large"));
+
+			try
+			{
+				store.set("too_large", "z".repeat(512 * 1024));
+				result.push(false);
+			}
+			catch (e)
+			{
+				result.push(true);
+			}
+
+			response.write(JSON.stringify(result), "application/json");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->body == R"([1,131072,"yyyyyyyyyyyyyyyy",true])",
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(Resize)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("resize_tests");
+
+		register((response, request) => {
+			for (let i = 0; i < 20000; i++)
+			{
+				store.set("key:" + i, i);
+
+				if (i % 4 == 0) store.remove("key:" + (i / 2));
+			}
+
+			let found = 0, correct = 0;
+
+			for (let i = 0; i < 20000; i++)
+			{
+				const value = store.get("key:" + i);
+
+				if (value !== null) found++;
+				if (value === i) correct++;
+			}
+
+			response.write(JSON.stringify([ found, correct ]), "application/json");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->body == R"([15000,15000])",
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(Expiry)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("expiry_tests", { maxMemory: 64 * 1024 });
+
+		register((response, request) => {
+			store.set("short", 1, { ttl: 50 });
+			store.set("long", 2, { ttl: 60000 });
+
+			for (let i = 0; i < 5000; i++)
+			{
+				store.set("filler:" + i, "x".repeat(100));
+				store.get("long");
+			}
+
+			// Wait for our short key to expire.
+			const until = Date.now() + 200;
+			while (Date.now() < until);
+
+			const stats = store.stats();
+
+			response.write(
+				JSON.stringify([
+					store.get("short"),
+					store.get("long"),
+					stats.memory <= 64 * 1024,
+					stats.evictions > 0
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->body == R"([null,2,true,true])",
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(Numbers)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("number_tests");
+
+		register((response, request) => {
+			const result = [
+				store.incr("counter"),
+				store.incr("counter", 10),
+				store.decr("counter", 3),
+				store.incr("ratio", 0.5),
+				store.incr("ratio", 1),
+				store.compareAndSet("counter", 8, 20),
+				store.compareAndSet("counter", 8, 30),
+				store.compareAndSet("flag", null, 1),
+				store.compareAndSet("flag", null, 2),
+				store.getNumber("counter"),
+				store.get("ratio"),
+				store.getNumber("missing")
+			];
+
+			response.write(JSON.stringify(result), "application/json");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->body == R"([1,11,8,0.5,1.5,true,false,true,false,20,1.5,null])",
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(Batches)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("batch_tests");
+
+		register((response, request) => {
+			store.setMany({ a: 1, b: "two", c: [ 3 ] });
+			store.setMany([ [ "d", { four: 4 } ] ]);
+
+			const result = [
+				store.getMany([ "a", "b", "c", "d", "missing" ]),
+				store.removeMany([ "a", "b", "missing" ]),
+				store.getMany([ "a", "b", "c" ])
+			];
+
+			response.write(JSON.stringify(result), "application/json");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->body == R"([[1,"two",[3],{"four":4},null],2,[null,null,[3]]])",
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(Keys)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("key_tests");
+
+		register((response, request) => {
+			for (let i = 0; i < 1000; i++)
+				store.set("user:" + i, i);
+
+			store.set("other", true);
+
+			const scanned = new Set();
+			let cursor = 0;
+
+			do
+			{
+				const result = store.scan(cursor, 50, "user:");
+
+				result.keys.forEach(key => scanned.add(key));
+				cursor = result.cursor;
+			}
+			while (cursor !== 0);
+
+			response.write(
+				JSON.stringify([
+					store.keys("user:").length,
+					store.keys("user:", 10).length,
+					store.keys("oth"),
+					scanned.size
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([1000,10,["other"],1000])");
+		}
+	}
+
+	TEST_METHOD(Primitives)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("primitive_tests");
+
+		register((response, request) => {
+			const values = [true, false, null, 42, -7, 3.5, -0, 2 ** 40, "text", "\u00e9t\u00e9", "\u4f60\u597d", "", { nested: [1, "two"] }];
+
+			store.setMany(values.map((value, index) => [String(index), value]));
+			store.set("bytes", new Uint8Array([1, 2, 3]).subarray(1));
+
+			const read = store.getMany(values.map((value, index) => String(index)));
+			const bytes = store.get("bytes");
+
+			response.write(
+				JSON.stringify([
+					read.every((value, index) => JSON.stringify(value) === JSON.stringify(values[index])),
+					Object.is(read[6], -0),
+					bytes instanceof Uint8Array,
+					Array.from(bytes)
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([true,true,true,[2,3]])");
+		}
+	}
+
+	TEST_METHOD(WriteFromIpc)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("raw_tests");
+
+		register((response, request) => {
+			store.setRaw("fragment", "<p>caf\u00e9</p>");
+
+			const bytes = store.get("fragment");
+
+			if (!(bytes instanceof Uint8Array) || bytes.length !== 12 || response.writeFromIpc(store, "missing"))
+				return CONTINUE;
+
+			response.writeFromIpc(store, "fragment", "text/html; charset=utf-8");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->get_header_value("Content-Type").c_str(), "text/html; charset=utf-8");
+			Assert::AreEqual(response->body.c_str(), "<p>caf\xC3\xA9</p>");
+		}
+	}
+
+	TEST_METHOD(Waits)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("wait_tests");
+
+		register(async (response, request) => {
+			store.set("config", { mode: "a" });
+
+			const version = store.version("config");
+			const timedOut = await store.wait("config", version, 50);
+
+			// Our own write wakes our wait just like anyone else's.
+			const changed = store.wait("config", version, 5000);
+			store.set("config", { mode: "b" });
+
+			const next = await changed;
+
+			response.write(
+				JSON.stringify([
+					store.version("missing"),
+					timedOut === version,
+					next !== version,
+					next === store.version("config")
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([0,true,true,true])");
+		}
+	}
+
+	TEST_METHOD(SharedArray)
+	{
+		EXECUTE_SCRIPT(R"(
+		const counters = ipc.sharedArray("shared_array_tests", "int32", 16);
+		const totals = ipc.sharedArray("shared_array_totals", "bigint64", 4);
+
+		register((response, request) => {
+			// The arrays outlive our script, so only look at what this request changes.
+			const count = counters[3];
+			const total = totals[0];
+
+			Atomics.add(counters, 3, 5);
+			counters[4] = 7;
+			Atomics.add(totals, 0, 10n);
+
+			const again = ipc.sharedArray("shared_array_tests", "int32", 16);
+
+			let mismatch = false;
+
+			try
+			{
+				ipc.sharedArray("shared_array_tests", "float64", 16);
+			}
+			catch (e)
+			{
+				mismatch = true;
+			}
+
+			response.write(
+				JSON.stringify([
+					counters instanceof Int32Array,
+					counters.buffer instanceof SharedArrayBuffer,
+					again[3] - count,
+					Atomics.load(again, 4),
+					(totals[0] - total).toString(),
+					mismatch
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->body == R"([true,true,5,7,"10",true])",
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(Sketches)
+	{
+		EXECUTE_SCRIPT(R"(
+		const visitors = ipc.hll("sketch_tests");
+		const hitters = ipc.countMin("sketch_tests", 1024, 4);
+		const seen = ipc.bloom("sketch_tests", 100000, 7);
+
+		register((response, request) => {
+			const keys = [];
+
+			for (let i = 0; i < 10000; i++)
+				keys.push("visitor:" + i);
+
+			visitors.add(keys);
+			visitors.add(keys.slice(0, 100));
+
+			hitters.add("heavy", 500);
+
+			for (let i = 0; i < 1000; i++)
+				hitters.add("light:" + (i % 100));
+
+			const count = visitors.count();
+
+			response.write(
+				JSON.stringify([
+					Math.abs(count - 10000) < 300,
+					hitters.estimate("heavy") >= 500,
+					hitters.estimate("light:1") >= 10,
+					seen.add("request:1"),
+					seen.add("request:1"),
+					seen.has("request:1")
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([true,true,true,true,false,true])");
+		}
+	}
+
+	TEST_METHOD(RateLimits)
+	{
+		EXECUTE_SCRIPT(R"(
+		const bucket = ratelimit.create("ratelimit_tests", { rate: 1, burst: 3 });
+		const window = ratelimit.create("ratelimit_window_tests", { rate: 2, window: 60000 });
+		const requests = ratelimit.create("ratelimit_request_tests", { rate: 1, burst: 2 });
+
+		requests.protect({ status: 503, reason: "Slow Down" });
+
+		register((response, request) => {
+			bucket.clear();
+			window.clear();
+
+			const taken = [bucket.take("a"), bucket.take("a", 2), bucket.take("a"), bucket.take("b")];
+
+			bucket.reset("a");
+
+			response.write(
+				JSON.stringify([
+					taken,
+					bucket.take("a", 3),
+					[window.take("a"), window.take("a"), window.take("a")]
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		httplib::Client http_client(HOST);
+
+		for (int i = 0; i < 2; i++)
+		{
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([[true,true,false,true],true,[true,true,false]])");
+		}
+
+		{
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(
+				response->status == 503,
+				true
+			);
+		}
+	}
+
+	TEST_METHOD(PublishAndSubscribe)
+	{
+		EXECUTE_SCRIPT(R"(
+		let received = [];
+
+		ipc.subscribe("publish_tests", (message) => { received.push(message); });
+
+		register((response, request) => {
+			if (request.getAbsPath() == "/result") 
+			{
+				response.write(JSON.stringify(received), "application/json");
+
+				return FINISH;
+			}
+
+			ipc.publish("publish_tests", { invalidate: "users" });
+			ipc.publish("publish_tests", 42);
+
+			response.write("ok", "text/html");
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), "ok");
+		}
+
+		Sleep(500);
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/result");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([{"invalidate":"users"},42])");
+		}
+	}
+
+	TEST_METHOD(Queue)
+	{
+		EXECUTE_SCRIPT(R"(
+		const queue = ipc.queue("queue_tests", { visibilityTimeout: 100 });
+		const jobs = ipc.queue("queue_job_tests");
+
+		let processed = [];
+
+		jobs.onJob((job, attempts) => { processed.push([ job, attempts ]); });
+
+		register((response, request) => {
+			if (request.getAbsPath() == "/result") 
+			{
+				response.write(JSON.stringify(processed), "application/json");
+
+				return FINISH;
+			}
+
+			jobs.push({ report: 1 });
+
+			for (let job; (job = queue.pop()); ) queue.ack(job.id);
+
+			queue.push("first");
+
+			const first = queue.pop();
+			const empty = queue.pop();
+
+			// Let its visibility timeout run out so that it's handed out again.
+			const until = Date.now() + 200;
+			while (Date.now() < until);
+
+			const again = queue.pop();
+
+			response.write(
+				JSON.stringify([
+					first.value,
+					empty,
+					again.value,
+					again.attempts,
+					queue.ack(first.id),
+					queue.ack(again.id),
+					queue.size()
+				]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"(["first",null,"first",2,false,true,0])");
+		}
+
+		Sleep(500);
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/result");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([[{"report":1},1]])");
+		}
+	}
+
+	TEST_METHOD(Persist)
+	{
+		EXECUTE_SCRIPT(R"(
+		const store = ipc.init("persist_tests", { persist: "persist_tests.snapshot", persistInterval: 50 });
+
+		register((response, request) => {
+			store.set("config", { theme: "dark" });
+			store.incr("visits", 3);
+
+			// Wait for a snapshot to be written.
+			const until = Date.now() + 300;
+			while (Date.now() < until);
+
+			// A store which doesn't exist yet is restored from the snapshot.
+			const restored = ipc.init("persist_restore_tests", { persist: "persist_tests.snapshot", persistInterval: 600000 });
+
+			response.write(
+				JSON.stringify([ restored.get("config"), restored.getNumber("visits") ]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([{"theme":"dark"},3])");
+		}
+	}
+
+	TEST_METHOD(Cache)
+	{
+		EXECUTE_SCRIPT(R"(
+		const config = ipc.init("cache_tests", { cache: true });
+		const other = ipc.init("cache_tests");
+
+		register((response, request) => {
+			config.set("features", { search: true });
+
+			const first = config.get("features");
+			const cached = config.get("features") === first;
+
+			// A write through someone else's handle is seen by our next get.
+			other.set("features", { search: false });
+
+			const changed = config.get("features");
+
+			other.remove("features");
+
+			response.write(
+				JSON.stringify([ first, cached, changed, changed === first, config.get("features") ]),
+				"application/json"
+			);
+
+			return FINISH;
+		});
+		)");
+
+		//////////////////////////////////////////////
+
+		{
+			httplib::Client http_client(HOST);
+			auto response = http_client.Get("/");
+
+			if (!response) Assert::Fail(L"failed to get http response.");
+
+			Assert::AreEqual(response->body.c_str(), R"([{"search":true},true,{"search":false},false,null])");
+		}
+	}
 };
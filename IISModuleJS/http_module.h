@@ -25,6 +25,9 @@ public:
 	
 	VOID Terminate()
 	{
+		// Give our pending requests a chance to finish before we go.
+		v8_wrapper::shutdown();
+
 		delete this;
 	}
 };
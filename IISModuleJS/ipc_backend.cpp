@@ -0,0 +1,551 @@
+#include "ipc_backend.h"
+#include <ipckv/ipckv.h>
+#include <simdb/simdb.hpp>
+#include <unordered_map>
+#include <mutex>
+
+#define IPC_ARRAY_UNINITIALIZED 0
+#define IPC_ARRAY_INITIALIZING 1
+#define IPC_ARRAY_READY 2
+
+// The data of a shared array starts a cache line in, which keeps every element type aligned.
+#define IPC_ARRAY_HEADER_SIZE 64
+
+namespace v8_wrapper
+{
+	static IPC_KV_Number to_store_number(const IPCNumber& number)
+	{
+		IPC_KV_Number store_number;
+		store_number.kind = (IPC_KV_Kind)number.kind;
+		store_number.integer = number.integer;
+		store_number.real = number.real;
+
+		return store_number;
+	}
+
+	static IPCNumber from_store_number(const IPC_KV_Number& store_number)
+	{
+		IPCNumber number;
+		number.kind = (IPCKind)store_number.kind;
+		number.integer = store_number.integer;
+		number.real = store_number.real;
+
+		return number;
+	}
+
+	static IPC_KV_Version to_store_version(const IPCVersion& version)
+	{
+		IPC_KV_Version store_version;
+		store_version.entry = (const IPC_KV_Entry*)version.entry;
+		store_version.version = version.version;
+		store_version.generation = version.generation;
+		store_version.expires = version.expires;
+
+		return store_version;
+	}
+
+	static IPCVersion from_store_version(const IPC_KV_Version& store_version)
+	{
+		IPCVersion version;
+		version.entry = store_version.entry;
+		version.version = store_version.version;
+		version.generation = store_version.generation;
+		version.expires = store_version.expires;
+
+		return version;
+	}
+
+	/**
+	 * Our original store, which is guarded by a
+	 * reader-writer lock across all worker processes.
+	 */
+	class LockedIPCBackend : public IPCBackend
+	{
+	public:
+		LockedIPCBackend(const std::string& name, const IPC_KV_Options& options)
+			: m_store(name, options) {}
+
+		void set(const std::string& key, const unsigned char* data, size_t size, uint64_t ttl) override
+		{
+			if (size > m_store.max_value_size())
+				throw std::runtime_error("value is too large for the ipc store");
+
+			m_store.set(key, data, size, ttl);
+		}
+
+		bool get(const std::string& key, std::vector<unsigned char>& data, IPCNumber* number, IPCVersion* version) override
+		{
+			IPC_KV_Number store_number;
+			IPC_KV_Version store_version;
+
+			if (!m_store.get(key, data, number ? &store_number : nullptr, version ? &store_version : nullptr))
+				return false;
+
+			if (number) *number = from_store_number(store_number);
+			if (version) *version = from_store_version(store_version);
+
+			return true;
+		}
+
+		bool remove(const std::string& key) override
+		{
+			return m_store.remove(key);
+		}
+
+		bool read(const std::string& key, const std::function<unsigned char*(const unsigned char*, size_t)>& allocate) override
+		{
+			return m_store.read(key, allocate);
+		}
+
+		bool is_current(const IPCVersion& version) override
+		{
+			return m_store.is_current(to_store_version(version));
+		}
+
+		void set_many(const std::vector<IPCWrite>& writes, uint64_t ttl) override
+		{
+			std::vector<IPC_KV_Write> store_writes(writes.size());
+
+			for (size_t i = 0; i < writes.size(); i++)
+			{
+				if (writes[i].size > m_store.max_value_size())
+					throw std::runtime_error("value is too large for the ipc store");
+
+				store_writes[i].key = writes[i].key;
+				store_writes[i].data = writes[i].data;
+				store_writes[i].size = writes[i].size;
+			}
+
+			m_store.set_many(store_writes, ttl);
+		}
+
+		void get_many(const std::vector<std::string>& keys, std::vector<IPCValue>& values) override
+		{
+			// Our values are kept around between calls so that their buffers can be reused.
+			thread_local std::vector<IPC_KV_Value> store_values;
+
+			m_store.get_many(keys, store_values);
+
+			values.resize(keys.size());
+
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				values[i].found = store_values[i].found;
+				values[i].number = from_store_number(store_values[i].number);
+				values[i].data.swap(store_values[i].data);
+			}
+		}
+
+		size_t remove_many(const std::vector<std::string>& keys) override
+		{
+			return m_store.remove_many(keys);
+		}
+
+		uint64_t scan(uint64_t cursor, size_t count, std::vector<std::string>& keys, const std::string& prefix) override
+		{
+			return m_store.scan(cursor, count, keys, prefix);
+		}
+
+		std::vector<std::string> keys(const std::string& prefix, size_t limit) override
+		{
+			return m_store.keys(prefix, limit);
+		}
+
+		int64_t version(const std::string& key) override
+		{
+			return m_store.version(key);
+		}
+
+		void watch(const std::string& key) override
+		{
+			m_store.watch(key);
+		}
+
+		void unwatch(const std::string& key) override
+		{
+			m_store.unwatch(key);
+		}
+
+		void wait_for_changes(uint32_t timeout) override
+		{
+			m_store.wait_for_changes(timeout);
+		}
+
+		void wake() override
+		{
+			m_store.wake();
+		}
+
+		IPCNumber increment(const std::string& key, const IPCNumber& delta) override
+		{
+			return from_store_number(m_store.increment(key, to_store_number(delta)));
+		}
+
+		bool compare_and_set(const std::string& key, const IPCNumber* expected, const IPCNumber& next) override
+		{
+			if (expected == nullptr)
+				return m_store.compare_and_set(key, nullptr, to_store_number(next));
+
+			auto store_expected = to_store_number(*expected);
+
+			return m_store.compare_and_set(key, &store_expected, to_store_number(next));
+		}
+
+		bool get_number(const std::string& key, IPCNumber& number) override
+		{
+			IPC_KV_Number store_number;
+
+			if (!m_store.get_number(key, store_number))
+				return false;
+
+			number = from_store_number(store_number);
+
+			return true;
+		}
+
+		IPCStats stats() override
+		{
+			auto store_stats = m_store.stats();
+
+			IPCStats stats;
+			stats.hits = store_stats.hits;
+			stats.misses = store_stats.misses;
+			stats.evictions = store_stats.evictions;
+			stats.expirations = store_stats.expirations;
+			stats.size = store_stats.size;
+			stats.memory = store_stats.memory;
+
+			return stats;
+		}
+
+		void close() override
+		{
+			m_store.close();
+		}
+
+	private:
+		IPC_KV m_store;
+	};
+
+	/**
+	 * A store built on simdb, where every operation is a compare-and-swap
+	 * on a versioned index so that readers and writers never block each other.
+	 */
+	class LockFreeIPCBackend : public IPCBackend
+	{
+	public:
+		LockFreeIPCBackend(const std::string& name, uint32_t block_size, uint32_t block_count)
+			: m_store(name.c_str(), block_size, block_count)
+		{
+			if (m_store.error() != simdb_error::NO_ERRORS)
+				throw std::runtime_error("unable to open the lock-free ipc store");
+		}
+
+		~LockFreeIPCBackend()
+		{
+			m_store.close();
+		}
+
+		void set(const std::string& key, const unsigned char* data, size_t size, uint64_t ttl) override
+		{
+			if (key.empty())
+				throw std::runtime_error("invalid key for the ipc store");
+
+			if (ttl)
+				throw std::runtime_error("ttl is not supported by the lockfree engine");
+
+			if (!m_store.put(key.data(), (uint32_t)key.length(), data, (uint32_t)size))
+				throw std::runtime_error("the ipc store is full");
+		}
+
+		bool get(const std::string& key, std::vector<unsigned char>& data, IPCNumber* number, IPCVersion* version) override
+		{
+			if (key.empty()) return false;
+
+			if (number)
+				number->kind = IPCKind::Bytes;
+
+			// The value can be replaced in between reading its length and reading it,
+			// in which case its length no longer matches and we try again.
+			for (int attempt = 0; attempt < 16; attempt++)
+			{
+				uint32_t length = 0;
+
+				if (!m_store.len(key.data(), (uint32_t)key.length(), &length))
+				{
+					m_misses++;
+					return false;
+				}
+
+				data.resize(length);
+
+				uint32_t read_length = 0;
+
+				if (m_store.get(key.data(), (uint32_t)key.length(), data.data(), length, &read_length) && read_length == length)
+				{
+					m_hits++;
+					return true;
+				}
+			}
+
+			m_misses++;
+			return false;
+		}
+
+		bool remove(const std::string& key) override
+		{
+			if (key.empty()) return false;
+
+			return m_store.del(key.data(), (uint32_t)key.length());
+		}
+
+		// Our value can change length while we read it, so it's only handed over once we have all of it.
+		bool read(const std::string& key, const std::function<unsigned char*(const unsigned char*, size_t)>& allocate) override
+		{
+			thread_local std::vector<unsigned char> data;
+
+			if (!get(key, data, nullptr, nullptr))
+				return false;
+
+			std::memcpy(allocate(data.data(), data.size()), data.data(), data.size());
+
+			return true;
+		}
+
+		// We can't tell a value apart from the next one written to its key, so nothing read from us is cached.
+		bool is_current(const IPCVersion& version) override
+		{
+			return false;
+		}
+
+		// Our store doesn't have a lock to batch under, so these are only for convenience.
+		void set_many(const std::vector<IPCWrite>& writes, uint64_t ttl) override
+		{
+			for (auto & write : writes)
+			{
+				set(write.key, write.data, write.size, ttl);
+			}
+		}
+
+		void get_many(const std::vector<std::string>& keys, std::vector<IPCValue>& values) override
+		{
+			values.resize(keys.size());
+
+			for (size_t i = 0; i < keys.size(); i++)
+			{
+				values[i].found = get(keys[i], values[i].data, &values[i].number, nullptr);
+			}
+		}
+
+		size_t remove_many(const std::vector<std::string>& keys) override
+		{
+			size_t removed = 0;
+
+			for (auto & key : keys)
+			{
+				if (remove(key))
+					removed++;
+			}
+
+			return removed;
+		}
+
+		// Our store only lists its keys by walking every block at once, so there's no cursor to hand out.
+		uint64_t scan(uint64_t, size_t, std::vector<std::string>&, const std::string&) override
+		{
+			throw std::runtime_error("scan is not supported by the lockfree engine");
+		}
+
+		std::vector<std::string> keys(const std::string& prefix, size_t limit) override
+		{
+			std::vector<std::string> keys;
+
+			for (auto & key : m_store.getKeyStrs())
+			{
+				if (limit && keys.size() >= limit)
+					break;
+
+				if (key.str.compare(0, prefix.length(), prefix) == 0)
+					keys.push_back(key.str);
+			}
+
+			return keys;
+		}
+
+		// Our store has no versions of its own and nowhere to keep its watchers.
+		int64_t version(const std::string&) override
+		{
+			throw std::runtime_error("waiting is not supported by the lockfree engine");
+		}
+
+		void watch(const std::string&) override
+		{
+			throw std::runtime_error("waiting is not supported by the lockfree engine");
+		}
+
+		void unwatch(const std::string&) override {}
+		void wait_for_changes(uint32_t) override {}
+		void wake() override {}
+
+		IPCNumber increment(const std::string&, const IPCNumber&) override
+		{
+			throw std::runtime_error("numbers are not supported by the lockfree engine");
+		}
+
+		bool compare_and_set(const std::string&, const IPCNumber*, const IPCNumber&) override
+		{
+			throw std::runtime_error("numbers are not supported by the lockfree engine");
+		}
+
+		bool get_number(const std::string&, IPCNumber&) override
+		{
+			throw std::runtime_error("numbers are not supported by the lockfree engine");
+		}
+
+		// Our store doesn't keep any counters in shared memory, so ours only cover this process.
+		IPCStats stats() override
+		{
+			IPCStats stats;
+			stats.hits = m_hits;
+			stats.misses = m_misses;
+			stats.memory = m_store.size();
+
+			return stats;
+		}
+
+		void close() override
+		{
+			m_store.close();
+		}
+
+	private:
+		simdb m_store;
+
+		std::atomic<uint64_t> m_hits{ 0 };
+		std::atomic<uint64_t> m_misses{ 0 };
+	};
+
+	/**
+	 * Creates the backend that was asked for in our options.
+	 */
+	std::unique_ptr<IPCBackend> create_ipc_backend(const std::string& name, const IPCOptions& options)
+	{
+		if (options.engine == IPC_BACKEND_LOCKED)
+		{
+			IPC_KV_Options store_options;
+			store_options.max_value_size = options.max_value_size;
+			store_options.max_memory = options.max_memory;
+			store_options.persist_path = options.persist_path;
+			store_options.persist_interval = options.persist_interval;
+
+			return std::make_unique<LockedIPCBackend>(name, store_options);
+		}
+
+		if (options.engine == IPC_BACKEND_LOCKFREE)
+		{
+			if (!options.persist_path.empty())
+				throw std::runtime_error("persistence is not supported by the lockfree engine");
+
+			return std::make_unique<LockFreeIPCBackend>(name, options.block_size, options.block_count);
+		}
+
+		throw std::runtime_error("unknown engine for the ipc store");
+	}
+
+	/**
+	 * The start of a shared array's mapping, the first process to open it
+	 * claims it through m_state and every other one waits for it to be filled in.
+	 */
+	struct IPCArrayHeader
+	{
+		volatile LONG m_state;
+		uint32_t m_type;
+		uint64_t m_byte_length;
+	};
+
+	struct IPCArrayMapping
+	{
+		uint32_t type;
+		size_t byte_length;
+		char* data;
+	};
+
+	void* map_shared_array(const std::string& name, uint32_t type, size_t byte_length)
+	{
+		static std::mutex mappings_lock;
+		static std::unordered_map<std::string, IPCArrayMapping> mappings;
+
+		std::lock_guard<std::mutex> lock(mappings_lock);
+
+		auto mapping = mappings.find(name);
+
+		if (mapping != mappings.end())
+		{
+			if (mapping->second.type != type || mapping->second.byte_length != byte_length)
+				throw std::runtime_error("shared array already exists with a different type or length");
+
+			return mapping->second.data;
+		}
+
+		/////////////////////////////////////////////
+
+		uint64_t size = IPC_ARRAY_HEADER_SIZE + (uint64_t)byte_length;
+
+		auto handle = CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			(DWORD)(size >> 32),
+			(DWORD)size,
+			(name + "_array").c_str()
+		);
+
+		if (handle == nullptr)
+			throw std::runtime_error("unable to create the shared array");
+
+		auto data = (char*)MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+		if (data == nullptr)
+		{
+			CloseHandle(handle);
+			throw std::runtime_error("unable to map the shared array");
+		}
+
+		/////////////////////////////////////////////
+
+		auto header = (IPCArrayHeader*)data;
+
+		if (InterlockedCompareExchange(&header->m_state, IPC_ARRAY_INITIALIZING, IPC_ARRAY_UNINITIALIZED) == IPC_ARRAY_UNINITIALIZED)
+		{
+			header->m_type = type;
+			header->m_byte_length = byte_length;
+
+			InterlockedExchange(&header->m_state, IPC_ARRAY_READY);
+		}
+		else
+		{
+			while (InterlockedCompareExchange(&header->m_state, IPC_ARRAY_READY, IPC_ARRAY_READY) != IPC_ARRAY_READY)
+				Sleep(0);
+		}
+
+		if (header->m_type != type || header->m_byte_length != byte_length)
+		{
+			UnmapViewOfFile(data);
+			CloseHandle(handle);
+
+			throw std::runtime_error("shared array already exists with a different type or length");
+		}
+
+		/////////////////////////////////////////////
+
+		// Our handle stays open along with the view, so the array outlives every other process.
+		IPCArrayMapping new_mapping;
+		new_mapping.type = type;
+		new_mapping.byte_length = byte_length;
+		new_mapping.data = data + IPC_ARRAY_HEADER_SIZE;
+
+		mappings.emplace(name, new_mapping);
+
+		return new_mapping.data;
+	}
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+#include <atomic>
+#include <functional>
+
+#define IPC_BACKEND_LOCKED "locked"
+#define IPC_BACKEND_LOCKFREE "lockfree"
+
+#define IPC_LOCKFREE_BLOCK_SIZE 128
+#define IPC_LOCKFREE_BLOCK_COUNT 65536
+#define IPC_LOCKED_MAX_VALUE_SIZE (1024 * 1024)
+#define IPC_LOCKED_PERSIST_INTERVAL 60000
+
+namespace v8_wrapper
+{
+	/**
+	 * The options given to ipc.init, which select
+	 * the backend and how it's laid out in shared memory.
+	 */
+	struct IPCOptions
+	{
+		std::string engine = IPC_BACKEND_LOCKED;
+		uint32_t block_size = IPC_LOCKFREE_BLOCK_SIZE;
+		uint32_t block_count = IPC_LOCKFREE_BLOCK_COUNT;
+		uint32_t max_value_size = IPC_LOCKED_MAX_VALUE_SIZE;
+		uint64_t max_memory = 0;
+
+		// Where the locked store keeps its snapshot, so it survives every process exiting.
+		std::string persist_path;
+		uint64_t persist_interval = IPC_LOCKED_PERSIST_INTERVAL;
+	};
+
+	/**
+	 * A number which lives right in shared memory, where
+	 * it can be updated atomically by every process.
+	 */
+	enum class IPCKind
+	{
+		Bytes,
+		Integer,
+		Double,
+	};
+
+	struct IPCNumber
+	{
+		IPCKind kind = IPCKind::Integer;
+		int64_t integer = 0;
+		double real = 0;
+	};
+
+	/**
+	 * A value read by a batch, numbers are given
+	 * through number and everything else through data.
+	 */
+	struct IPCValue
+	{
+		bool found = false;
+		IPCNumber number;
+		std::vector<unsigned char> data;
+	};
+
+	/**
+	 * Which write a value was read from, a value cached
+	 * along with it is good for as long as it's current.
+	 */
+	struct IPCVersion
+	{
+		const void* entry = nullptr;
+		int64_t version = 0;
+		int64_t generation = 0;
+		uint64_t expires = 0;
+	};
+
+	struct IPCWrite
+	{
+		std::string key;
+		const unsigned char* data;
+		size_t size;
+	};
+
+	/**
+	 * The counters of a store, which are shared by
+	 * every process for the locked store.
+	 */
+	struct IPCStats
+	{
+		uint64_t hits = 0;
+		uint64_t misses = 0;
+		uint64_t evictions = 0;
+		uint64_t expirations = 0;
+		uint64_t size = 0;
+		uint64_t memory = 0;
+	};
+
+	/**
+	 * A key-value store in shared memory which is shared
+	 * between the worker processes of an application pool.
+	 */
+	class IPCBackend
+	{
+	public:
+		virtual ~IPCBackend() {}
+
+		virtual void set(const std::string& key, const unsigned char* data, size_t size, uint64_t ttl = 0) = 0;
+		virtual bool get(const std::string& key, std::vector<unsigned char>& data, IPCNumber* number = nullptr, IPCVersion* version = nullptr) = 0;
+		virtual bool remove(const std::string& key) = 0;
+
+		/**
+		 * Copies the bytes of a key into the memory allocate returns for them, rather than into
+		 * a vector of ours. allocate is shown the bytes first and can throw to refuse them.
+		 * Returns false if the key doesn't exist or holds a number.
+		 */
+		virtual bool read(const std::string& key, const std::function<unsigned char*(const unsigned char*, size_t)>& allocate) = 0;
+
+		virtual bool is_current(const IPCVersion& version) = 0;
+
+		virtual void set_many(const std::vector<IPCWrite>& writes, uint64_t ttl = 0) = 0;
+		virtual void get_many(const std::vector<std::string>& keys, std::vector<IPCValue>& values) = 0;
+		virtual size_t remove_many(const std::vector<std::string>& keys) = 0;
+
+		/**
+		 * Appends the keys of the next chunk of the store starting at cursor and returns
+		 * where the next call picks up, which is zero once every key has been visited.
+		 */
+		virtual uint64_t scan(uint64_t cursor, size_t count, std::vector<std::string>& keys, const std::string& prefix = "") = 0;
+		virtual std::vector<std::string> keys(const std::string& prefix = "", size_t limit = 0) = 0;
+
+		/**
+		 * Returns the version of a key, or zero if it doesn't exist. We only need to look at it
+		 * again once a wait for changes returns, as long as the key is being watched.
+		 */
+		virtual int64_t version(const std::string& key) = 0;
+		virtual void watch(const std::string& key) = 0;
+		virtual void unwatch(const std::string& key) = 0;
+
+		/**
+		 * Blocks until a watched key could have changed or timeout milliseconds have passed,
+		 * wake ends a wait of any thread of our process early.
+		 */
+		virtual void wait_for_changes(uint32_t timeout) = 0;
+		virtual void wake() = 0;
+
+		virtual IPCNumber increment(const std::string& key, const IPCNumber& delta) = 0;
+		virtual bool compare_and_set(const std::string& key, const IPCNumber* expected, const IPCNumber& next) = 0;
+		virtual bool get_number(const std::string& key, IPCNumber& number) = 0;
+
+		virtual IPCStats stats() = 0;
+		virtual void close() = 0;
+	};
+
+	/**
+	 * Creates the backend that was asked for in our options.
+	 */
+	std::unique_ptr<IPCBackend> create_ipc_backend(const std::string& name, const IPCOptions& options);
+
+	/**
+	 * Maps the shared array called name, which every process opening it with
+	 * the same type and length sees. The mapping lives as long as our process does,
+	 * since JS can hold on to its buffer for as long as it likes.
+	 */
+	void* map_shared_array(const std::string& name, uint32_t type, size_t byte_length);
+}
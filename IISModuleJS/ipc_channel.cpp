@@ -0,0 +1,366 @@
+#include "ipc_channel.h"
+#include <unordered_map>
+#include <cstring>
+
+#define IPC_CHANNEL_MAGIC 0x4E484349
+
+#define IPC_CHANNEL_UNINITIALIZED 0
+#define IPC_CHANNEL_INITIALIZING 1
+#define IPC_CHANNEL_READY 2
+
+// A slot which is being written has this sequence, a publisher waiting this long for it gives up.
+#define IPC_CHANNEL_BUSY ((LONG64)-1)
+#define IPC_CHANNEL_SPIN_LIMIT 65536
+
+// A subscriber slot which is claimed but whose event doesn't exist yet.
+#define IPC_CHANNEL_CLAIMED ((LONG)-1)
+
+namespace v8_wrapper
+{
+	/**
+	 * The start of a channel's mapping, followed by its slots.
+	 */
+	struct IPCChannelHeader
+	{
+		volatile LONG m_state;
+		uint32_t m_magic;
+		uint32_t m_capacity;
+		uint32_t m_slot_size;
+
+		// The sequence of the next message to publish.
+		volatile LONG64 m_sequence;
+
+		// The process ids of our subscribers, zero when a slot is free.
+		volatile LONG m_subscribers[IPC_CHANNEL_MAX_SUBSCRIBERS];
+	};
+
+	/**
+	 * A message in our ring, its sequence is one past the
+	 * sequence of the message once it's been written.
+	 */
+	struct IPCChannelSlot
+	{
+		volatile LONG64 m_sequence;
+		uint32_t m_length;
+		uint32_t m_reserved;
+		unsigned char m_data[IPC_CHANNEL_SLOT_SIZE];
+	};
+
+	static const size_t header_size = (sizeof(IPCChannelHeader) + 63) & ~(size_t)63;
+
+	static LONG64 load_sequence(volatile LONG64* sequence)
+	{
+		return InterlockedCompareExchange64(sequence, 0, 0);
+	}
+
+	static std::string get_event_name(const std::string& name, uint32_t index)
+	{
+		return name + "_channel_" + std::to_string(index);
+	}
+
+	static bool is_process_alive(DWORD process_id)
+	{
+		auto process = OpenProcess(SYNCHRONIZE, FALSE, process_id);
+
+		// We might not be allowed to open it, in which case it's certainly there.
+		if (process == nullptr)
+			return GetLastError() == ERROR_ACCESS_DENIED;
+
+		auto alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+
+		CloseHandle(process);
+
+		return alive;
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCChannel::IPCChannel(const std::string& name)
+		: m_name(name)
+	{
+		uint64_t size = header_size + (uint64_t)sizeof(IPCChannelSlot) * IPC_CHANNEL_CAPACITY;
+
+		m_handle = CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			(DWORD)(size >> 32),
+			(DWORD)size,
+			(name + "_channel").c_str()
+		);
+
+		if (m_handle == nullptr)
+			throw std::runtime_error("unable to create the ipc channel");
+
+		m_header = (IPCChannelHeader*)MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+		if (m_header == nullptr)
+		{
+			CloseHandle(m_handle);
+			throw std::runtime_error("unable to map the ipc channel");
+		}
+
+		/////////////////////////////////////////////
+
+		// Whoever maps our channel first fills in its layout, everyone else waits on them.
+		if (InterlockedCompareExchange(&m_header->m_state, IPC_CHANNEL_INITIALIZING, IPC_CHANNEL_UNINITIALIZED) == IPC_CHANNEL_UNINITIALIZED)
+		{
+			m_header->m_magic = IPC_CHANNEL_MAGIC;
+			m_header->m_capacity = IPC_CHANNEL_CAPACITY;
+			m_header->m_slot_size = IPC_CHANNEL_SLOT_SIZE;
+
+			InterlockedExchange(&m_header->m_state, IPC_CHANNEL_READY);
+		}
+		else
+		{
+			while (InterlockedCompareExchange(&m_header->m_state, IPC_CHANNEL_READY, IPC_CHANNEL_READY) != IPC_CHANNEL_READY)
+				Sleep(0);
+		}
+
+		if (
+			m_header->m_magic != IPC_CHANNEL_MAGIC ||
+			m_header->m_capacity != IPC_CHANNEL_CAPACITY ||
+			m_header->m_slot_size != IPC_CHANNEL_SLOT_SIZE
+		)
+		{
+			UnmapViewOfFile(m_header);
+			CloseHandle(m_handle);
+
+			throw std::runtime_error("ipc channel was created with a different layout");
+		}
+	}
+
+	IPCChannel::~IPCChannel()
+	{
+		for (auto handle : m_wake_handles)
+		{
+			if (handle) CloseHandle(handle);
+		}
+
+		UnmapViewOfFile(m_header);
+		CloseHandle(m_handle);
+	}
+
+	IPCChannelSlot* IPCChannel::get_slot(uint64_t sequence)
+	{
+		auto slots = (IPCChannelSlot*)((char*)m_header + header_size);
+
+		return &slots[sequence % IPC_CHANNEL_CAPACITY];
+	}
+
+	void IPCChannel::publish(const unsigned char* data, size_t size)
+	{
+		if (size > IPC_CHANNEL_SLOT_SIZE)
+			throw std::runtime_error("message is too large for the ipc channel");
+
+		auto sequence = (uint64_t)InterlockedExchangeAdd64(&m_header->m_sequence, 1);
+		auto slot = get_slot(sequence);
+
+		/////////////////////////////////////////////
+
+		// Claim our slot, waiting for whoever is still writing the message a lap behind ours.
+		for (int spins = 0;; spins++)
+		{
+			auto slot_sequence = load_sequence(&slot->m_sequence);
+
+			if (slot_sequence != IPC_CHANNEL_BUSY)
+			{
+				// A message a lap ahead of ours already took our slot.
+				if (slot_sequence > (LONG64)sequence)
+					return;
+
+				if (InterlockedCompareExchange64(&slot->m_sequence, IPC_CHANNEL_BUSY, slot_sequence) == slot_sequence)
+					break;
+			}
+			else if (spins > IPC_CHANNEL_SPIN_LIMIT)
+			{
+				// Its writer is most likely gone, and the slot was never ours to write over.
+				throw std::runtime_error("ipc channel slot is still being written, unable to publish");
+			}
+
+			Sleep(0);
+		}
+
+		std::memcpy(slot->m_data, data, size);
+		slot->m_length = (uint32_t)size;
+
+		InterlockedExchange64(&slot->m_sequence, (LONG64)sequence + 1);
+
+		/////////////////////////////////////////////
+
+		wake_subscribers();
+	}
+
+	void IPCChannel::wake_subscribers()
+	{
+		std::lock_guard<std::mutex> lock(m_wake_lock);
+
+		for (uint32_t i = 0; i < IPC_CHANNEL_MAX_SUBSCRIBERS; i++)
+		{
+			auto owner = m_header->m_subscribers[i];
+
+			if (owner == 0 || owner == IPC_CHANNEL_CLAIMED)
+				continue;
+
+			// Our cached event belongs to a previous subscriber.
+			if (m_wake_owners[i] != owner || m_wake_handles[i] == nullptr)
+			{
+				if (m_wake_handles[i]) CloseHandle(m_wake_handles[i]);
+
+				m_wake_handles[i] = OpenEventA(EVENT_MODIFY_STATE, FALSE, get_event_name(m_name, i).c_str());
+				m_wake_owners[i] = owner;
+
+				if (m_wake_handles[i] == nullptr)
+				{
+					// Its event is gone along with its process, so its slot is free again.
+					InterlockedCompareExchange(&m_header->m_subscribers[i], 0, owner);
+					m_wake_owners[i] = 0;
+
+					continue;
+				}
+			}
+
+			SetEvent(m_wake_handles[i]);
+		}
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCSubscriber::IPCSubscriber(std::shared_ptr<IPCChannel> channel)
+		: m_channel(std::move(channel))
+	{
+		auto header = m_channel->m_header;
+		auto claimed = false;
+
+		for (int attempt = 0; attempt < 2 && !claimed; attempt++)
+		{
+			for (uint32_t i = 0; i < IPC_CHANNEL_MAX_SUBSCRIBERS; i++)
+			{
+				if (InterlockedCompareExchange(&header->m_subscribers[i], IPC_CHANNEL_CLAIMED, 0) == 0)
+				{
+					m_index = i;
+					claimed = true;
+
+					break;
+				}
+			}
+
+			if (claimed) break;
+
+			// Every slot is taken, so free up those of processes that didn't exit cleanly.
+			for (uint32_t i = 0; i < IPC_CHANNEL_MAX_SUBSCRIBERS; i++)
+			{
+				auto owner = header->m_subscribers[i];
+
+				if (owner > 0 && !is_process_alive((DWORD)owner))
+					InterlockedCompareExchange(&header->m_subscribers[i], 0, owner);
+			}
+		}
+
+		if (!claimed)
+			throw std::runtime_error("too many subscribers for the ipc channel");
+
+		/////////////////////////////////////////////
+
+		m_event = CreateEventA(nullptr, FALSE, FALSE, get_event_name(m_channel->name(), m_index).c_str());
+
+		if (m_event == nullptr)
+		{
+			InterlockedExchange(&header->m_subscribers[m_index], 0);
+			throw std::runtime_error("unable to create the event for the ipc channel");
+		}
+
+		// We only get the messages that are published from now on.
+		m_cursor = (uint64_t)load_sequence(&header->m_sequence);
+
+		InterlockedExchange(&header->m_subscribers[m_index], (LONG)GetCurrentProcessId());
+	}
+
+	IPCSubscriber::~IPCSubscriber()
+	{
+		InterlockedExchange(&m_channel->m_header->m_subscribers[m_index], 0);
+		CloseHandle(m_event);
+	}
+
+	void IPCSubscriber::wait(DWORD timeout)
+	{
+		WaitForSingleObject(m_event, timeout);
+	}
+
+	size_t IPCSubscriber::read(std::vector<std::vector<unsigned char>>& messages, size_t count)
+	{
+		size_t read = 0;
+
+		while (read < count)
+		{
+			auto sequence = (uint64_t)load_sequence(&m_channel->m_header->m_sequence);
+
+			if (m_cursor >= sequence) break;
+
+			// We've fallen more than a lap behind, so skip what's been overwritten.
+			if (sequence - m_cursor > IPC_CHANNEL_CAPACITY)
+			{
+				m_dropped += sequence - IPC_CHANNEL_CAPACITY - m_cursor;
+				m_cursor = sequence - IPC_CHANNEL_CAPACITY;
+			}
+
+			/////////////////////////////////////////////
+
+			auto slot = m_channel->get_slot(m_cursor);
+			auto slot_sequence = load_sequence(&slot->m_sequence);
+
+			// Its message is still being written, its publisher wakes us once it's done.
+			if (slot_sequence == IPC_CHANNEL_BUSY || slot_sequence < (LONG64)m_cursor + 1)
+				break;
+
+			if (slot_sequence != (LONG64)m_cursor + 1)
+			{
+				m_dropped++;
+				m_cursor++;
+
+				continue;
+			}
+
+			/////////////////////////////////////////////
+
+			if (messages.size() <= read)
+				messages.emplace_back();
+
+			auto length = slot->m_length;
+
+			if (length > IPC_CHANNEL_SLOT_SIZE)
+				length = IPC_CHANNEL_SLOT_SIZE;
+
+			messages[read].assign(slot->m_data, slot->m_data + length);
+
+			// It was overwritten while we were copying it, which we find out on our next pass.
+			if (load_sequence(&slot->m_sequence) != (LONG64)m_cursor + 1)
+				continue;
+
+			read++;
+			m_cursor++;
+		}
+
+		return read;
+	}
+
+	////////////////////////////////////////////////////////
+
+	std::shared_ptr<IPCChannel> open_ipc_channel(const std::string& name)
+	{
+		static std::mutex channels_lock;
+		static std::unordered_map<std::string, std::shared_ptr<IPCChannel>> channels;
+
+		std::lock_guard<std::mutex> lock(channels_lock);
+
+		auto channel = channels.find(name);
+
+		if (channel != channels.end())
+			return channel->second;
+
+		auto new_channel = std::make_shared<IPCChannel>(name);
+		channels.emplace(name, new_channel);
+
+		return new_channel;
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+
+#define IPC_CHANNEL_CAPACITY 1024
+#define IPC_CHANNEL_SLOT_SIZE 1024
+#define IPC_CHANNEL_MAX_SUBSCRIBERS 64
+
+// How many messages are handed to JS at once, and how long a subscriber sleeps without being woken.
+#define IPC_CHANNEL_BATCH_SIZE 256
+#define IPC_CHANNEL_POLL_INTERVAL 1000
+
+namespace v8_wrapper
+{
+	struct IPCChannelHeader;
+	struct IPCChannelSlot;
+
+	/**
+	 * A ring buffer of messages in shared memory which every process can publish to,
+	 * a message that's overwritten before a subscriber gets to it is dropped for that subscriber.
+	 */
+	class IPCChannel
+	{
+	public:
+		explicit IPCChannel(const std::string& name);
+		~IPCChannel();
+
+		IPCChannel(const IPCChannel&) = delete;
+		IPCChannel& operator=(const IPCChannel&) = delete;
+
+		void publish(const unsigned char* data, size_t size);
+
+		const std::string& name() const { return m_name; }
+
+	private:
+		friend class IPCSubscriber;
+
+		IPCChannelSlot* get_slot(uint64_t sequence);
+		void wake_subscribers();
+
+		std::string m_name;
+
+		HANDLE m_handle = nullptr;
+		IPCChannelHeader* m_header = nullptr;
+
+		// The events of other subscribers we've woken before, along with whose they were.
+		std::mutex m_wake_lock;
+		HANDLE m_wake_handles[IPC_CHANNEL_MAX_SUBSCRIBERS] = {};
+		LONG m_wake_owners[IPC_CHANNEL_MAX_SUBSCRIBERS] = {};
+	};
+
+	/**
+	 * Our position in a channel, along with the event
+	 * publishers set to wake us up.
+	 */
+	class IPCSubscriber
+	{
+	public:
+		explicit IPCSubscriber(std::shared_ptr<IPCChannel> channel);
+		~IPCSubscriber();
+
+		IPCSubscriber(const IPCSubscriber&) = delete;
+		IPCSubscriber& operator=(const IPCSubscriber&) = delete;
+
+		/**
+		 * Waits until a message is published or our timeout runs out.
+		 */
+		void wait(DWORD timeout);
+
+		/**
+		 * Reads up to count messages, returns how many were read.
+		 */
+		size_t read(std::vector<std::vector<unsigned char>>& messages, size_t count);
+
+		const std::string& name() const { return m_channel->name(); }
+		uint64_t dropped() const { return m_dropped; }
+
+	private:
+		std::shared_ptr<IPCChannel> m_channel;
+
+		uint32_t m_index = 0;
+		HANDLE m_event = nullptr;
+
+		uint64_t m_cursor = 0;
+		uint64_t m_dropped = 0;
+	};
+
+	/**
+	 * Returns our process' mapping of the channel called name.
+	 */
+	std::shared_ptr<IPCChannel> open_ipc_channel(const std::string& name);
+}
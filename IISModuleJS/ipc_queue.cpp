@@ -0,0 +1,267 @@
+#include "ipc_queue.h"
+#include <unordered_map>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+
+#define IPC_QUEUE_MAGIC 0x55455149
+
+#define IPC_QUEUE_UNINITIALIZED 0
+#define IPC_QUEUE_INITIALIZING 1
+#define IPC_QUEUE_READY 2
+
+// The state of a slot is in the lower bits of its state word, a claimed
+// job keeps the time its visibility timeout runs out in the upper bits.
+#define IPC_JOB_FREE 0
+#define IPC_JOB_WRITING 1
+#define IPC_JOB_READY 2
+#define IPC_JOB_CLAIMED 3
+
+#define IPC_JOB_STATE_BITS 2
+#define IPC_JOB_STATE_MASK 3
+
+namespace v8_wrapper
+{
+	/**
+	 * The start of a queue's mapping, followed by its slots.
+	 */
+	struct IPCQueueHeader
+	{
+		volatile LONG m_state;
+		uint32_t m_magic;
+		uint32_t m_capacity;
+		uint32_t m_slot_size;
+
+		// Where pushes start looking for a free slot and pops for a job,
+		// which keeps our jobs roughly in the order they were pushed.
+		volatile LONG64 m_push_cursor;
+		volatile LONG64 m_pop_cursor;
+	};
+
+	struct IPCQueueSlot
+	{
+		volatile LONG64 m_state;
+		uint32_t m_length;
+		uint32_t m_attempts;
+		unsigned char m_data[IPC_QUEUE_SLOT_SIZE];
+	};
+
+	static const size_t header_size = (sizeof(IPCQueueHeader) + 63) & ~(size_t)63;
+
+	static LONG64 load_state(volatile LONG64* state)
+	{
+		return InterlockedCompareExchange64(state, 0, 0);
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCQueue::IPCQueue(const std::string& name)
+		: m_name(name)
+	{
+		uint64_t size = header_size + (uint64_t)sizeof(IPCQueueSlot) * IPC_QUEUE_CAPACITY;
+
+		m_handle = CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			(DWORD)(size >> 32),
+			(DWORD)size,
+			(name + "_queue").c_str()
+		);
+
+		if (m_handle == nullptr)
+			throw std::runtime_error("unable to create the ipc queue");
+
+		m_header = (IPCQueueHeader*)MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+		if (m_header == nullptr)
+		{
+			CloseHandle(m_handle);
+			throw std::runtime_error("unable to map the ipc queue");
+		}
+
+		/////////////////////////////////////////////
+
+		// Whoever maps our queue first fills in its layout, everyone else waits on them.
+		if (InterlockedCompareExchange(&m_header->m_state, IPC_QUEUE_INITIALIZING, IPC_QUEUE_UNINITIALIZED) == IPC_QUEUE_UNINITIALIZED)
+		{
+			m_header->m_magic = IPC_QUEUE_MAGIC;
+			m_header->m_capacity = IPC_QUEUE_CAPACITY;
+			m_header->m_slot_size = IPC_QUEUE_SLOT_SIZE;
+
+			InterlockedExchange(&m_header->m_state, IPC_QUEUE_READY);
+		}
+		else
+		{
+			while (InterlockedCompareExchange(&m_header->m_state, IPC_QUEUE_READY, IPC_QUEUE_READY) != IPC_QUEUE_READY)
+				Sleep(0);
+		}
+
+		if (
+			m_header->m_magic != IPC_QUEUE_MAGIC ||
+			m_header->m_capacity != IPC_QUEUE_CAPACITY ||
+			m_header->m_slot_size != IPC_QUEUE_SLOT_SIZE
+		)
+		{
+			UnmapViewOfFile(m_header);
+			CloseHandle(m_handle);
+
+			throw std::runtime_error("ipc queue was created with a different layout");
+		}
+
+		/////////////////////////////////////////////
+
+		// Every push releases our semaphore once, so that one waiting consumer wakes up per job.
+		m_semaphore = CreateSemaphoreA(nullptr, 0, IPC_QUEUE_CAPACITY, (name + "_queue_jobs").c_str());
+
+		if (m_semaphore == nullptr)
+		{
+			UnmapViewOfFile(m_header);
+			CloseHandle(m_handle);
+
+			throw std::runtime_error("unable to create the semaphore for the ipc queue");
+		}
+	}
+
+	IPCQueue::~IPCQueue()
+	{
+		CloseHandle(m_semaphore);
+		UnmapViewOfFile(m_header);
+		CloseHandle(m_handle);
+	}
+
+	IPCQueueSlot* IPCQueue::get_slot(uint64_t index)
+	{
+		auto slots = (IPCQueueSlot*)((char*)m_header + header_size);
+
+		return &slots[index % IPC_QUEUE_CAPACITY];
+	}
+
+	uint64_t IPCQueue::get_time()
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::system_clock::now().time_since_epoch()
+		).count();
+	}
+
+	void IPCQueue::push(const unsigned char* data, size_t size)
+	{
+		if (size > IPC_QUEUE_SLOT_SIZE)
+			throw std::runtime_error("job is too large for the ipc queue");
+
+		auto start = (uint64_t)InterlockedExchangeAdd64(&m_header->m_push_cursor, 1);
+
+		for (uint64_t i = 0; i < IPC_QUEUE_CAPACITY; i++)
+		{
+			auto slot = get_slot(start + i);
+
+			if (InterlockedCompareExchange64(&slot->m_state, IPC_JOB_WRITING, IPC_JOB_FREE) != IPC_JOB_FREE)
+				continue;
+
+			std::memcpy(slot->m_data, data, size);
+			slot->m_length = (uint32_t)size;
+			slot->m_attempts = 0;
+
+			InterlockedExchange64(&slot->m_state, IPC_JOB_READY);
+
+			ReleaseSemaphore(m_semaphore, 1, nullptr);
+
+			return;
+		}
+
+		throw std::runtime_error("the ipc queue is full");
+	}
+
+	bool IPCQueue::pop(IPCJob& job, uint64_t visibility_timeout)
+	{
+		auto time = get_time();
+		auto start = (uint64_t)load_state(&m_header->m_pop_cursor);
+
+		for (uint64_t i = 0; i < IPC_QUEUE_CAPACITY; i++)
+		{
+			auto index = (start + i) % IPC_QUEUE_CAPACITY;
+			auto slot = get_slot(index);
+			auto state = load_state(&slot->m_state);
+
+			auto kind = state & IPC_JOB_STATE_MASK;
+			auto deadline = (uint64_t)state >> IPC_JOB_STATE_BITS;
+
+			// A claimed job whose visibility timeout ran out belonged to a worker which is gone or stuck.
+			if (kind != IPC_JOB_READY && !(kind == IPC_JOB_CLAIMED && deadline <= time))
+				continue;
+
+			// Our deadline tells this claim apart from any later one, so it's part of our id as well.
+			auto new_deadline = time + visibility_timeout;
+
+			if (new_deadline <= deadline)
+				new_deadline = deadline + 1;
+
+			auto claimed = (LONG64)((new_deadline << IPC_JOB_STATE_BITS) | IPC_JOB_CLAIMED);
+
+			if (InterlockedCompareExchange64(&slot->m_state, claimed, state) != state)
+				continue;
+
+			/////////////////////////////////////////////
+
+			if (kind == IPC_JOB_READY)
+				InterlockedCompareExchange64(&m_header->m_pop_cursor, (LONG64)(start + i + 1), (LONG64)start);
+
+			slot->m_attempts++;
+
+			job.id = new_deadline * IPC_QUEUE_CAPACITY + index;
+			job.attempts = slot->m_attempts;
+			job.data.assign(slot->m_data, slot->m_data + slot->m_length);
+
+			return true;
+		}
+
+		return false;
+	}
+
+	bool IPCQueue::ack(uint64_t id)
+	{
+		auto slot = get_slot(id % IPC_QUEUE_CAPACITY);
+		auto claimed = (LONG64)(((id / IPC_QUEUE_CAPACITY) << IPC_JOB_STATE_BITS) | IPC_JOB_CLAIMED);
+
+		// This fails if the job was handed to someone else after its visibility timeout.
+		return InterlockedCompareExchange64(&slot->m_state, IPC_JOB_FREE, claimed) == claimed;
+	}
+
+	void IPCQueue::wait(DWORD timeout)
+	{
+		WaitForSingleObject(m_semaphore, timeout);
+	}
+
+	size_t IPCQueue::size()
+	{
+		size_t size = 0;
+
+		for (uint64_t i = 0; i < IPC_QUEUE_CAPACITY; i++)
+		{
+			if (load_state(&get_slot(i)->m_state) != IPC_JOB_FREE)
+				size++;
+		}
+
+		return size;
+	}
+
+	////////////////////////////////////////////////////////
+
+	std::shared_ptr<IPCQueue> open_ipc_queue(const std::string& name)
+	{
+		static std::mutex queues_lock;
+		static std::unordered_map<std::string, std::shared_ptr<IPCQueue>> queues;
+
+		std::lock_guard<std::mutex> lock(queues_lock);
+
+		auto queue = queues.find(name);
+
+		if (queue != queues.end())
+			return queue->second;
+
+		auto new_queue = std::make_shared<IPCQueue>(name);
+		queues.emplace(name, new_queue);
+
+		return new_queue;
+	}
+}
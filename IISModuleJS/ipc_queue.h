@@ -0,0 +1,77 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <stdexcept>
+
+#define IPC_QUEUE_CAPACITY 1024
+#define IPC_QUEUE_SLOT_SIZE 4096
+#define IPC_QUEUE_VISIBILITY_TIMEOUT 30000
+
+// How long a consumer sleeps without being woken, which is also how soon it notices an expired job.
+#define IPC_QUEUE_POLL_INTERVAL 1000
+
+namespace v8_wrapper
+{
+	struct IPCQueueHeader;
+	struct IPCQueueSlot;
+
+	/**
+	 * A job taken from a queue, its id acknowledges
+	 * it for as long as it's still ours.
+	 */
+	struct IPCJob
+	{
+		uint64_t id = 0;
+		uint32_t attempts = 0;
+		std::vector<unsigned char> data;
+	};
+
+	/**
+	 * A queue of jobs in shared memory which every process can push to and pop from,
+	 * a popped job that isn't acknowledged within its visibility timeout is handed out again.
+	 */
+	class IPCQueue
+	{
+	public:
+		explicit IPCQueue(const std::string& name);
+		~IPCQueue();
+
+		IPCQueue(const IPCQueue&) = delete;
+		IPCQueue& operator=(const IPCQueue&) = delete;
+
+		void push(const unsigned char* data, size_t size);
+		bool pop(IPCJob& job, uint64_t visibility_timeout);
+		bool ack(uint64_t id);
+
+		/**
+		 * Waits until a job is pushed or our timeout runs out.
+		 */
+		void wait(DWORD timeout);
+
+		/**
+		 * Returns the number of jobs which haven't been acknowledged yet.
+		 */
+		size_t size();
+
+		const std::string& name() const { return m_name; }
+
+	private:
+		IPCQueueSlot* get_slot(uint64_t index);
+
+		static uint64_t get_time();
+
+		std::string m_name;
+
+		HANDLE m_handle = nullptr;
+		HANDLE m_semaphore = nullptr;
+		IPCQueueHeader* m_header = nullptr;
+	};
+
+	/**
+	 * Returns our process' mapping of the queue called name.
+	 */
+	std::shared_ptr<IPCQueue> open_ipc_queue(const std::string& name);
+}
@@ -0,0 +1,333 @@
+#include "ipc_ratelimit.h"
+#include <unordered_map>
+#include <mutex>
+#include <cstring>
+
+#define IPC_RATE_LIMIT_MAGIC 0x4D494C52
+
+#define IPC_RATE_LIMIT_UNINITIALIZED 0
+#define IPC_RATE_LIMIT_INITIALIZING 1
+#define IPC_RATE_LIMIT_READY 2
+
+// A bucket keeps the millisecond it was last refilled above its tokens, which are counted in 1/256ths.
+#define IPC_TOKEN_BITS 24
+#define IPC_TOKEN_SCALE 256
+
+namespace v8_wrapper
+{
+	/**
+	 * The start of a rate limiter's mapping, followed by its slots.
+	 */
+	struct IPCRateLimiterHeader
+	{
+		volatile LONG m_state;
+		uint32_t m_magic;
+		uint32_t m_rate;
+		uint32_t m_burst;
+		uint32_t m_window;
+		uint32_t m_slots;
+		uint64_t m_epoch;
+	};
+
+	/**
+	 * The hash of a key and its state, a bucket or a pair of windows.
+	 */
+	struct IPCRateLimiterSlot
+	{
+		volatile LONG64 m_key;
+		volatile LONG64 m_state;
+	};
+
+	static const size_t header_size = (sizeof(IPCRateLimiterHeader) + 63) & ~(size_t)63;
+
+	/**
+	 * FNV-1a followed by the finalizer of MurmurHash3, zero is left for empty slots.
+	 */
+	static uint64_t hash_key(const unsigned char* key, size_t length)
+	{
+		uint64_t hash = 14695981039346656037ull;
+
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= key[i];
+			hash *= 1099511628211ull;
+		}
+
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+
+		return hash ? hash : 1;
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCRateLimiter::IPCRateLimiter(const std::string& name, uint32_t rate, uint32_t burst, uint32_t window, uint32_t slots)
+		: m_rate(rate), m_burst(burst), m_window(window), m_slots(slots)
+	{
+		if (rate == 0 || slots == 0)
+			throw std::runtime_error("invalid limits for the rate limiter");
+
+		if (window ? rate > IPC_RATE_LIMIT_MAX : (burst == 0 || burst > IPC_RATE_LIMIT_MAX))
+			throw std::runtime_error("rate limiter allows too many requests at once");
+
+		uint64_t size = header_size + (uint64_t)slots * sizeof(IPCRateLimiterSlot);
+
+		m_handle = CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			(DWORD)(size >> 32),
+			(DWORD)size,
+			(name + "_ratelimit").c_str()
+		);
+
+		if (m_handle == nullptr)
+			throw std::runtime_error("unable to create the rate limiter");
+
+		m_header = (IPCRateLimiterHeader*)MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+		if (m_header == nullptr)
+		{
+			CloseHandle(m_handle);
+			throw std::runtime_error("unable to map the rate limiter");
+		}
+
+		/////////////////////////////////////////////
+
+		// Whoever maps our limiter first fills in its limits, everyone else waits on them.
+		if (InterlockedCompareExchange(&m_header->m_state, IPC_RATE_LIMIT_INITIALIZING, IPC_RATE_LIMIT_UNINITIALIZED) == IPC_RATE_LIMIT_UNINITIALIZED)
+		{
+			m_header->m_magic = IPC_RATE_LIMIT_MAGIC;
+			m_header->m_rate = rate;
+			m_header->m_burst = burst;
+			m_header->m_window = window;
+			m_header->m_slots = slots;
+			m_header->m_epoch = GetTickCount64();
+
+			InterlockedExchange(&m_header->m_state, IPC_RATE_LIMIT_READY);
+		}
+		else
+		{
+			while (InterlockedCompareExchange(&m_header->m_state, IPC_RATE_LIMIT_READY, IPC_RATE_LIMIT_READY) != IPC_RATE_LIMIT_READY)
+				Sleep(0);
+		}
+
+		if (
+			m_header->m_magic != IPC_RATE_LIMIT_MAGIC ||
+			m_header->m_rate != rate ||
+			m_header->m_burst != burst ||
+			m_header->m_window != window ||
+			m_header->m_slots != slots
+		)
+		{
+			UnmapViewOfFile(m_header);
+			CloseHandle(m_handle);
+
+			throw std::runtime_error("rate limiter was created with different limits");
+		}
+
+		m_data = (IPCRateLimiterSlot*)((char*)m_header + header_size);
+	}
+
+	IPCRateLimiter::~IPCRateLimiter()
+	{
+		UnmapViewOfFile(m_header);
+		CloseHandle(m_handle);
+	}
+
+	/**
+	 * Our tick count is shared by every process, and starts at one so that
+	 * an empty state always reads as a full bucket or as an empty window.
+	 */
+	uint64_t IPCRateLimiter::get_time()
+	{
+		return GetTickCount64() - m_header->m_epoch + 1;
+	}
+
+	bool IPCRateLimiter::take(const unsigned char* key, size_t length, uint32_t cost)
+	{
+		auto time = get_time();
+		auto slot = find_slot(hash_key(key, length), time);
+
+		for (;;)
+		{
+			auto state = slot->m_state;
+			auto next = m_window ? take_window(state, time, cost) : take_token(state, time, cost);
+
+			if (next < 0)
+				return false;
+
+			if (InterlockedCompareExchange64(&slot->m_state, next, state) == state)
+				return true;
+		}
+	}
+
+	void IPCRateLimiter::reset(const std::string& key)
+	{
+		auto slot = find_slot(hash_key((const unsigned char*)key.data(), key.length()), get_time());
+
+		InterlockedExchange64(&slot->m_state, 0);
+	}
+
+	void IPCRateLimiter::clear()
+	{
+		std::memset((void*)m_data, 0, (size_t)m_slots * sizeof(IPCRateLimiterSlot));
+	}
+
+	/**
+	 * Returns the slot of our key, which is one of the few after its home. Slots are taken
+	 * over from keys which have been idle long enough for their state not to matter anymore.
+	 */
+	IPCRateLimiterSlot* IPCRateLimiter::find_slot(uint64_t key_hash, uint64_t time)
+	{
+		auto home = key_hash % m_slots;
+		IPCRateLimiterSlot* idle_slot = nullptr;
+
+		for (uint32_t i = 0; i < IPC_RATE_LIMIT_PROBES; i++)
+		{
+			auto slot = &m_data[(home + i) % m_slots];
+			auto slot_key = slot->m_key;
+
+			if (slot_key == (LONG64)key_hash)
+				return slot;
+
+			if (slot_key == 0)
+			{
+				slot_key = InterlockedCompareExchange64(&slot->m_key, (LONG64)key_hash, 0);
+
+				if (slot_key == 0 || slot_key == (LONG64)key_hash)
+					return slot;
+
+				continue;
+			}
+
+			if (!idle_slot && is_idle(slot->m_state, time))
+				idle_slot = slot;
+		}
+
+		if (idle_slot)
+		{
+			auto slot_key = idle_slot->m_key;
+
+			if (InterlockedCompareExchange64(&idle_slot->m_key, (LONG64)key_hash, slot_key) == slot_key)
+			{
+				InterlockedExchange64(&idle_slot->m_state, 0);
+				return idle_slot;
+			}
+		}
+
+		// Every slot we could have is busy with other keys, so we share our home with them.
+		return &m_data[home];
+	}
+
+	bool IPCRateLimiter::is_idle(int64_t state, uint64_t time)
+	{
+		if (state == 0)
+			return true;
+
+		if (m_window)
+			return ((uint64_t)state >> 32) + 1 < time / m_window;
+
+		// A full bucket is the same as a fresh one.
+		return take_token(state, time, m_burst) >= 0;
+	}
+
+	/**
+	 * Refills our bucket for the time that passed since it was last refilled and takes cost tokens
+	 * from it, returns its new state or -1 if it doesn't hold enough tokens.
+	 */
+	int64_t IPCRateLimiter::take_token(int64_t state, uint64_t time, uint32_t cost)
+	{
+		uint64_t capacity = (uint64_t)m_burst * IPC_TOKEN_SCALE;
+		uint64_t last = (uint64_t)state >> IPC_TOKEN_BITS;
+		uint64_t tokens = (uint64_t)state & ((1ull << IPC_TOKEN_BITS) - 1);
+
+		if (state == 0)
+		{
+			last = time;
+			tokens = capacity;
+		}
+
+		if (time > last)
+		{
+			auto elapsed = time - last;
+
+			// Anything longer than it takes to fill our bucket fills it.
+			auto refill = elapsed > capacity * 1000 / m_rate ? capacity : elapsed * m_rate * IPC_TOKEN_SCALE / 1000;
+
+			// Less than a fraction of a token isn't worth moving our time forward for, it would be lost.
+			if (refill)
+			{
+				tokens = tokens + refill > capacity ? capacity : tokens + refill;
+				last = time;
+			}
+		}
+
+		if (tokens < (uint64_t)cost * IPC_TOKEN_SCALE)
+			return -1;
+
+		tokens -= (uint64_t)cost * IPC_TOKEN_SCALE;
+
+		return (int64_t)((last << IPC_TOKEN_BITS) | tokens);
+	}
+
+	/**
+	 * Counts cost against the current window, returns its new state or -1 if the requests
+	 * of the current window and the part of the previous one still in our sliding window add up to more than our rate.
+	 */
+	int64_t IPCRateLimiter::take_window(int64_t state, uint64_t time, uint32_t cost)
+	{
+		uint64_t index = time / m_window;
+		uint64_t state_index = (uint64_t)state >> 32;
+		uint64_t current = ((uint64_t)state >> 16) & 0xFFFF;
+		uint64_t previous = (uint64_t)state & 0xFFFF;
+
+		if (index != state_index)
+		{
+			previous = index == state_index + 1 ? current : 0;
+			current = 0;
+		}
+
+		auto overlap = m_window - time % m_window;
+
+		if (previous * overlap + (current + cost) * m_window > (uint64_t)m_rate * m_window)
+			return -1;
+
+		current += cost;
+
+		return (int64_t)((index << 32) | (current << 16) | previous);
+	}
+
+	////////////////////////////////////////////////////////
+
+	std::shared_ptr<IPCRateLimiter> open_ipc_rate_limiter(const std::string& name, uint32_t rate, uint32_t burst, uint32_t window, uint32_t slots)
+	{
+		static std::mutex limiters_lock;
+		static std::unordered_map<std::string, std::shared_ptr<IPCRateLimiter>> limiters;
+
+		std::lock_guard<std::mutex> lock(limiters_lock);
+
+		auto limiter = limiters.find(name);
+
+		if (limiter != limiters.end())
+		{
+			if (
+				limiter->second->rate() != rate ||
+				limiter->second->burst() != burst ||
+				limiter->second->window() != window ||
+				limiter->second->slots() != slots
+			)
+				throw std::runtime_error("rate limiter was created with different limits");
+
+			return limiter->second;
+		}
+
+		auto new_limiter = std::make_shared<IPCRateLimiter>(name, rate, burst, window, slots);
+		limiters.emplace(name, new_limiter);
+
+		return new_limiter;
+	}
+}
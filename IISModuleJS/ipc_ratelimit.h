@@ -0,0 +1,79 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <stdexcept>
+
+// How many slots a rate limiter has for its keys unless it's told otherwise, and how many it looks at for a key.
+#define IPC_RATE_LIMIT_SLOTS 65536
+#define IPC_RATE_LIMIT_PROBES 8
+
+// The most tokens a bucket holds and the most requests a window allows, which is what fits in a slot.
+#define IPC_RATE_LIMIT_MAX 65535
+
+namespace v8_wrapper
+{
+	struct IPCRateLimiterHeader;
+	struct IPCRateLimiterSlot;
+
+	/**
+	 * A rate limiter in shared memory which every process takes from at once, each key has
+	 * a slot of its own whose state is a single word that's only ever updated by swapping it.
+	 *
+	 * Without a window it's a token bucket holding up to burst tokens, which refills at rate tokens
+	 * a second. With a window it allows rate requests per window milliseconds, weighing the requests
+	 * of the previous window by how much of it still overlaps the sliding window.
+	 */
+	class IPCRateLimiter
+	{
+	public:
+		IPCRateLimiter(const std::string& name, uint32_t rate, uint32_t burst, uint32_t window, uint32_t slots);
+		~IPCRateLimiter();
+
+		IPCRateLimiter(const IPCRateLimiter&) = delete;
+		IPCRateLimiter& operator=(const IPCRateLimiter&) = delete;
+
+		/**
+		 * Takes cost from the limit of key and returns whether it was allowed, a request
+		 * which isn't allowed takes nothing. Keys are any bytes, such as a raw address.
+		 */
+		bool take(const unsigned char* key, size_t length, uint32_t cost = 1);
+		bool take(const std::string& key, uint32_t cost = 1) { return take((const unsigned char*)key.data(), key.length(), cost); }
+
+		/**
+		 * Gives key its whole limit back.
+		 */
+		void reset(const std::string& key);
+		void clear();
+
+		uint32_t rate() const { return m_rate; }
+		uint32_t burst() const { return m_burst; }
+		uint32_t window() const { return m_window; }
+		uint32_t slots() const { return m_slots; }
+
+	private:
+		IPCRateLimiterSlot* find_slot(uint64_t key_hash, uint64_t time);
+		bool is_idle(int64_t state, uint64_t time);
+
+		int64_t take_token(int64_t state, uint64_t time, uint32_t cost);
+		int64_t take_window(int64_t state, uint64_t time, uint32_t cost);
+
+		uint64_t get_time();
+
+		uint32_t m_rate;
+		uint32_t m_burst;
+		uint32_t m_window;
+		uint32_t m_slots;
+
+		HANDLE m_handle = nullptr;
+		IPCRateLimiterHeader* m_header = nullptr;
+		IPCRateLimiterSlot* m_data = nullptr;
+	};
+
+	/**
+	 * Returns our process' mapping of the rate limiter called name, which
+	 * has to have been created with the same limits if it already exists.
+	 */
+	std::shared_ptr<IPCRateLimiter> open_ipc_rate_limiter(const std::string& name, uint32_t rate, uint32_t burst, uint32_t window, uint32_t slots);
+}
@@ -0,0 +1,359 @@
+#include "ipc_sketch.h"
+#include <intrin.h>
+#include <unordered_map>
+#include <mutex>
+#include <cmath>
+#include <cstring>
+
+#define IPC_SKETCH_MAGIC 0x48435453
+
+#define IPC_SKETCH_UNINITIALIZED 0
+#define IPC_SKETCH_INITIALIZING 1
+#define IPC_SKETCH_READY 2
+
+namespace v8_wrapper
+{
+	/**
+	 * The start of a sketch's mapping, followed by its registers.
+	 */
+	struct IPCSketchHeader
+	{
+		volatile LONG m_state;
+		uint32_t m_magic;
+		uint32_t m_kind;
+		uint32_t m_width;
+		uint32_t m_depth;
+	};
+
+	static const size_t header_size = (sizeof(IPCSketchHeader) + 63) & ~(size_t)63;
+
+	static const char* get_suffix(IPCSketchKind kind)
+	{
+		switch (kind)
+		{
+		case IPCSketchKind::HyperLogLog: return "_hll";
+		case IPCSketchKind::CountMin: return "_count_min";
+		default: return "_bloom";
+		}
+	}
+
+	/**
+	 * Returns the bytes taken up by the registers of a sketch, which are
+	 * rounded up to whole words since we update them a word at a time.
+	 */
+	static uint64_t get_data_size(IPCSketchKind kind, uint32_t width, uint32_t depth)
+	{
+		switch (kind)
+		{
+		case IPCSketchKind::HyperLogLog: return ((uint64_t)width + 3) & ~3ull;
+		case IPCSketchKind::CountMin: return (uint64_t)width * depth * sizeof(LONG64);
+		default: return ((uint64_t)width + 31) / 32 * sizeof(LONG);
+		}
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCSketch::IPCSketch(const std::string& name, IPCSketchKind kind, uint32_t width, uint32_t depth)
+		: m_kind(kind), m_width(width), m_depth(depth)
+	{
+		if (width == 0 || depth == 0 || depth > IPC_SKETCH_MAX_DEPTH)
+			throw std::runtime_error("invalid dimensions for the ipc sketch");
+
+		m_data_size = get_data_size(kind, width, depth);
+
+		if (m_data_size > IPC_SKETCH_MAX_SIZE)
+			throw std::runtime_error("ipc sketch is too large");
+
+		uint64_t size = header_size + m_data_size;
+
+		m_handle = CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			(DWORD)(size >> 32),
+			(DWORD)size,
+			(name + get_suffix(kind)).c_str()
+		);
+
+		if (m_handle == nullptr)
+			throw std::runtime_error("unable to create the ipc sketch");
+
+		m_header = (IPCSketchHeader*)MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+		if (m_header == nullptr)
+		{
+			CloseHandle(m_handle);
+			throw std::runtime_error("unable to map the ipc sketch");
+		}
+
+		/////////////////////////////////////////////
+
+		// Whoever maps our sketch first fills in its dimensions, everyone else waits on them.
+		if (InterlockedCompareExchange(&m_header->m_state, IPC_SKETCH_INITIALIZING, IPC_SKETCH_UNINITIALIZED) == IPC_SKETCH_UNINITIALIZED)
+		{
+			m_header->m_magic = IPC_SKETCH_MAGIC;
+			m_header->m_kind = (uint32_t)kind;
+			m_header->m_width = width;
+			m_header->m_depth = depth;
+
+			InterlockedExchange(&m_header->m_state, IPC_SKETCH_READY);
+		}
+		else
+		{
+			while (InterlockedCompareExchange(&m_header->m_state, IPC_SKETCH_READY, IPC_SKETCH_READY) != IPC_SKETCH_READY)
+				Sleep(0);
+		}
+
+		if (
+			m_header->m_magic != IPC_SKETCH_MAGIC ||
+			m_header->m_kind != (uint32_t)kind ||
+			m_header->m_width != width ||
+			m_header->m_depth != depth
+		)
+		{
+			UnmapViewOfFile(m_header);
+			CloseHandle(m_handle);
+
+			throw std::runtime_error("ipc sketch was created with different dimensions");
+		}
+
+		m_data = (char*)m_header + header_size;
+	}
+
+	IPCSketch::~IPCSketch()
+	{
+		UnmapViewOfFile(m_header);
+		CloseHandle(m_handle);
+	}
+
+	void IPCSketch::clear()
+	{
+		std::memset(m_data, 0, (size_t)m_data_size);
+	}
+
+	/**
+	 * FNV-1a followed by the finalizer of MurmurHash3, since our
+	 * HyperLogLog takes its register and its rank from different bits.
+	 */
+	uint64_t IPCSketch::hash(const std::string& key)
+	{
+		uint64_t hash = 14695981039346656037ull;
+
+		for (auto character : key)
+		{
+			hash ^= (unsigned char)character;
+			hash *= 1099511628211ull;
+		}
+
+		hash ^= hash >> 33;
+		hash *= 0xFF51AFD7ED558CCDull;
+		hash ^= hash >> 33;
+		hash *= 0xC4CEB9FE1A85EC53ull;
+		hash ^= hash >> 33;
+
+		return hash;
+	}
+
+	uint64_t IPCSketch::get_index(uint64_t hash, uint32_t row, uint64_t size)
+	{
+		uint64_t first = (uint32_t)hash;
+		uint64_t second = (hash >> 32) | 1;
+
+		return (first + row * second) % size;
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCHyperLogLog::IPCHyperLogLog(const std::string& name)
+		: IPCSketch(name, IPCSketchKind::HyperLogLog, IPC_HLL_REGISTERS, 1) {}
+
+	/**
+	 * Registers are single bytes, so we raise one by swapping the word it's part of.
+	 */
+	bool IPCHyperLogLog::add(const std::string& key)
+	{
+		auto key_hash = hash(key);
+		auto index = (uint32_t)(key_hash >> (64 - IPC_HLL_PRECISION));
+
+		// The rank is the position of the first set bit after our index, the bit we set ends the search.
+		unsigned long position;
+		_BitScanReverse64(&position, (key_hash << IPC_HLL_PRECISION) | (1ull << (IPC_HLL_PRECISION - 1)));
+
+		auto rank = (uint32_t)(64 - position);
+
+		auto word = (volatile LONG*)(m_data + (index & ~3u));
+		auto shift = (index & 3) * 8;
+
+		for (;;)
+		{
+			auto current = *word;
+
+			if ((((uint32_t)current >> shift) & 0xFF) >= rank)
+				return false;
+
+			auto next = (LONG)(((uint32_t)current & ~(0xFFu << shift)) | (rank << shift));
+
+			if (InterlockedCompareExchange(word, next, current) == current)
+				return true;
+		}
+	}
+
+	/**
+	 * The estimate of Flajolet et al, falling back to linear counting
+	 * while enough registers are still empty for it to be more accurate.
+	 */
+	uint64_t IPCHyperLogLog::count()
+	{
+		auto registers = (volatile uint8_t*)m_data;
+
+		double sum = 0;
+		uint32_t zeros = 0;
+
+		for (uint32_t i = 0; i < IPC_HLL_REGISTERS; i++)
+		{
+			auto rank = registers[i];
+
+			sum += std::ldexp(1.0, -(int)rank);
+
+			if (rank == 0)
+				zeros++;
+		}
+
+		double registers_count = IPC_HLL_REGISTERS;
+		double alpha = 0.7213 / (1 + 1.079 / registers_count);
+		double estimate = alpha * registers_count * registers_count / sum;
+
+		if (estimate <= 2.5 * registers_count && zeros)
+			estimate = registers_count * std::log(registers_count / zeros);
+
+		return (uint64_t)(estimate + 0.5);
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCCountMin::IPCCountMin(const std::string& name, uint32_t width, uint32_t depth)
+		: IPCSketch(name, IPCSketchKind::CountMin, width, depth) {}
+
+	int64_t IPCCountMin::add(const std::string& key, int64_t count)
+	{
+		auto key_hash = hash(key);
+		auto counters = (volatile LONG64*)m_data;
+
+		int64_t estimate = INT64_MAX;
+
+		for (uint32_t row = 0; row < m_depth; row++)
+		{
+			auto counter = &counters[(uint64_t)row * m_width + get_index(key_hash, row, m_width)];
+			auto value = InterlockedExchangeAdd64(counter, count) + count;
+
+			if (value < estimate)
+				estimate = value;
+		}
+
+		return estimate;
+	}
+
+	int64_t IPCCountMin::estimate(const std::string& key)
+	{
+		auto key_hash = hash(key);
+		auto counters = (volatile LONG64*)m_data;
+
+		int64_t estimate = INT64_MAX;
+
+		for (uint32_t row = 0; row < m_depth; row++)
+		{
+			int64_t value = counters[(uint64_t)row * m_width + get_index(key_hash, row, m_width)];
+
+			if (value < estimate)
+				estimate = value;
+		}
+
+		return estimate;
+	}
+
+	////////////////////////////////////////////////////////
+
+	IPCBloomFilter::IPCBloomFilter(const std::string& name, uint32_t bits, uint32_t hashes)
+		: IPCSketch(name, IPCSketchKind::Bloom, bits, hashes) {}
+
+	bool IPCBloomFilter::add(const std::string& key)
+	{
+		auto key_hash = hash(key);
+		auto words = (volatile LONG*)m_data;
+
+		bool added = false;
+
+		for (uint32_t i = 0; i < m_depth; i++)
+		{
+			auto bit = get_index(key_hash, i, m_width);
+			auto mask = (LONG)(1u << (bit % 32));
+
+			if (!(InterlockedOr(&words[bit / 32], mask) & mask))
+				added = true;
+		}
+
+		return added;
+	}
+
+	bool IPCBloomFilter::has(const std::string& key)
+	{
+		auto key_hash = hash(key);
+		auto words = (volatile LONG*)m_data;
+
+		for (uint32_t i = 0; i < m_depth; i++)
+		{
+			auto bit = get_index(key_hash, i, m_width);
+
+			if (!(words[bit / 32] & (LONG)(1u << (bit % 32))))
+				return false;
+		}
+
+		return true;
+	}
+
+	////////////////////////////////////////////////////////
+
+	/**
+	 * Every kind of sketch has names of its own, and each
+	 * of them is only ever mapped once by our process.
+	 */
+	template <typename Sketch, typename... Arguments>
+	static std::shared_ptr<Sketch> open_ipc_sketch(IPCSketchKind kind, const std::string& name, uint32_t width, uint32_t depth, Arguments... arguments)
+	{
+		static std::mutex sketches_lock;
+		static std::unordered_map<std::string, std::shared_ptr<IPCSketch>> sketches;
+
+		std::lock_guard<std::mutex> lock(sketches_lock);
+
+		auto key = name + get_suffix(kind);
+		auto sketch = sketches.find(key);
+
+		if (sketch != sketches.end())
+		{
+			if (sketch->second->width() != width || sketch->second->depth() != depth)
+				throw std::runtime_error("ipc sketch was created with different dimensions");
+
+			return std::static_pointer_cast<Sketch>(sketch->second);
+		}
+
+		auto new_sketch = std::make_shared<Sketch>(name, arguments...);
+		sketches.emplace(key, new_sketch);
+
+		return new_sketch;
+	}
+
+	std::shared_ptr<IPCHyperLogLog> open_ipc_hll(const std::string& name)
+	{
+		return open_ipc_sketch<IPCHyperLogLog>(IPCSketchKind::HyperLogLog, name, IPC_HLL_REGISTERS, 1);
+	}
+
+	std::shared_ptr<IPCCountMin> open_ipc_count_min(const std::string& name, uint32_t width, uint32_t depth)
+	{
+		return open_ipc_sketch<IPCCountMin>(IPCSketchKind::CountMin, name, width, depth, width, depth);
+	}
+
+	std::shared_ptr<IPCBloomFilter> open_ipc_bloom(const std::string& name, uint32_t bits, uint32_t hashes)
+	{
+		return open_ipc_sketch<IPCBloomFilter>(IPCSketchKind::Bloom, name, bits, hashes, bits, hashes);
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <memory>
+#include <stdexcept>
+
+// A HyperLogLog has 2^precision one byte registers, which gives it a standard error of about 0.8%.
+#define IPC_HLL_PRECISION 14
+#define IPC_HLL_REGISTERS (1 << IPC_HLL_PRECISION)
+
+// The most rows or hashes of a sketch, and the most bytes it can take up.
+#define IPC_SKETCH_MAX_DEPTH 32
+#define IPC_SKETCH_MAX_SIZE (1024ull * 1024 * 1024)
+
+namespace v8_wrapper
+{
+	struct IPCSketchHeader;
+
+	enum class IPCSketchKind : uint32_t
+	{
+		HyperLogLog = 1,
+		CountMin = 2,
+		Bloom = 3,
+	};
+
+	/**
+	 * A fixed size structure in shared memory which every process can update at once,
+	 * width and depth are its columns and rows, or its bits and hashes for a bloom filter.
+	 */
+	class IPCSketch
+	{
+	public:
+		IPCSketch(const std::string& name, IPCSketchKind kind, uint32_t width, uint32_t depth);
+		virtual ~IPCSketch();
+
+		IPCSketch(const IPCSketch&) = delete;
+		IPCSketch& operator=(const IPCSketch&) = delete;
+
+		/**
+		 * Resets every register, adds made while clearing may or may not survive it.
+		 */
+		void clear();
+
+		IPCSketchKind kind() const { return m_kind; }
+		uint32_t width() const { return m_width; }
+		uint32_t depth() const { return m_depth; }
+
+	protected:
+		/**
+		 * Returns the position of key in row out of size, every row is a different
+		 * combination of the two halves of a single 64-bit hash of the key.
+		 */
+		static uint64_t get_index(uint64_t hash, uint32_t row, uint64_t size);
+		static uint64_t hash(const std::string& key);
+
+		IPCSketchKind m_kind;
+		uint32_t m_width;
+		uint32_t m_depth;
+		uint64_t m_data_size = 0;
+
+		HANDLE m_handle = nullptr;
+		IPCSketchHeader* m_header = nullptr;
+		char* m_data = nullptr;
+	};
+
+	/**
+	 * Counts the distinct keys added to it.
+	 */
+	class IPCHyperLogLog : public IPCSketch
+	{
+	public:
+		explicit IPCHyperLogLog(const std::string& name);
+
+		/**
+		 * Returns whether the key changed our estimate.
+		 */
+		bool add(const std::string& key);
+		uint64_t count();
+	};
+
+	/**
+	 * Counts how often every key was added, an estimate is never below
+	 * the actual count and only above it when keys share all of their counters.
+	 */
+	class IPCCountMin : public IPCSketch
+	{
+	public:
+		IPCCountMin(const std::string& name, uint32_t width, uint32_t depth);
+
+		/**
+		 * Adds count to the counters of key and returns its new estimate.
+		 */
+		int64_t add(const std::string& key, int64_t count);
+		int64_t estimate(const std::string& key);
+	};
+
+	/**
+	 * Tells whether a key could have been added to it, which is never wrong for keys that were.
+	 */
+	class IPCBloomFilter : public IPCSketch
+	{
+	public:
+		IPCBloomFilter(const std::string& name, uint32_t bits, uint32_t hashes);
+
+		/**
+		 * Returns whether the key wasn't in the filter yet.
+		 */
+		bool add(const std::string& key);
+		bool has(const std::string& key);
+	};
+
+	/**
+	 * Returns our process' mapping of the sketch called name, which
+	 * has to have been created with the same dimensions if it already exists.
+	 */
+	std::shared_ptr<IPCHyperLogLog> open_ipc_hll(const std::string& name);
+	std::shared_ptr<IPCCountMin> open_ipc_count_min(const std::string& name, uint32_t width, uint32_t depth);
+	std::shared_ptr<IPCBloomFilter> open_ipc_bloom(const std::string& name, uint32_t bits, uint32_t hashes);
+}
@@ -4,49 +4,40 @@ namespace v8_wrapper
 {
 	namespace fs = std::experimental::filesystem;
 
-	// All the global objects and functions for v8.
-	v8::Global<v8::Object> global_db_object;
-	v8::Global<v8::Object> global_fetch_object;
+	// The engine and isolate the current thread is using, see EngineScope.
+	thread_local Engine * engine = nullptr;
+	thread_local v8::Isolate * isolate = nullptr; 
 
-	v8::Global<v8::Object> global_http_response_object;
-	v8::Global<v8::Object> global_http_request_object;
+	// The engine of the main script, which serves every host without a tenant.
+	Engine * default_engine = nullptr;
 
-	v8::Global<v8::Object> global_ipc_object;
-	 
-	/////////////////////////////////////////////////
+	// All of our engines, a retired engine is only destroyed once nothing uses it anymore. Snapshots
+	// of them share ownership, so that threads looking at a snapshot never see one destroyed under them.
+	std::vector<std::shared_ptr<Engine>> engines;
+	std::mutex engines_lock;
+
+	// Tenants are reconciled and their retired engines collected under this lock, so that an engine is never revived while it's destroyed.
+	std::mutex tenants_lock;
 
-	v8::Global<v8::Function> function_pre_begin_request;
-	v8::Global<v8::Function> function_begin_request;
-	v8::Global<v8::Function> function_directory_change;
-	v8::Global<v8::Function> function_send_response;
+	// The engines of the tenants by host, which is replaced as a whole whenever 
+	// the tenants change so that requests can look it up without locking.
+	std::shared_ptr<const std::unordered_map<std::wstring, Engine*>> tenant_map;
+	std::atomic<bool> tenants_enabled(false);
 
-	// A persistent context for v8.
-	v8::Persistent<v8::Context> context;
+	// Whether the worker process is shutting down, in which case nothing gets reloaded.
+	std::atomic<bool> shutting_down(false);
 
-	// The unique isolate for v8.
-	v8::Isolate * isolate = nullptr; 
+	// The scheduler which shares the machine between tenants.
+	TenantScheduler tenant_scheduler(pmax(int(std::thread::hardware_concurrency()), 1));
+
+	// The platform for v8, its worker threads are used for streaming compilation.
+	std::unique_ptr<v8::Platform> platform;
 
 	// The name of the default script to be launched. 
 	std::wstring script_name;
 	std::wstring app_pool_folder_name;
 	fs::path fs_directory;
 
-	// Cache containing all our Eternal names.
-	std::unordered_map<
-		const void*,
-		std::vector<
-			v8::Eternal<v8::Name>
-		>
-	> eternal_name_cache_;
-
-	// A list containing all the loaded scripts to watch.
-	std::vector<
-		std::pair<
-			std::experimental::filesystem::path, 
-			fs::file_time_type
-		>
-	> loaded_scripts;
-
 	// All variables needed for keeping track of the number of threads
 	// launched, we wish to keep it below a certain threshold as to
 	// not overload the machine.
@@ -67,7 +58,7 @@ namespace v8_wrapper
 
 			///////////////////////////
 			 
-			std::unique_ptr<v8::Platform> platform = v8::platform::NewDefaultPlatform();
+			platform = v8::platform::NewDefaultPlatform();
 			
 			v8::V8::InitializePlatform(platform.get());
 			v8::V8::InitializeICU(); 
@@ -77,12 +68,13 @@ namespace v8_wrapper
 #endif
 			///////////////////////////
 
-			v8::Isolate::CreateParams create_params;
-			create_params.array_buffer_allocator = v8::ArrayBuffer::Allocator::NewDefaultAllocator();
+			default_engine = create_engine(script_name, L"", 0);
 
-			///////////////////////////
+			//////////////////////////////////////////
 
-			isolate = v8::Isolate::New(create_params);
+			// Setup our thread which enforces tenant cpu budgets.
+			std::thread watchdog_thread(watch_cpu_budgets);
+			watchdog_thread.detach();
 
 			//////////////////////////////////////////
 
@@ -92,624 +84,3759 @@ namespace v8_wrapper
 	}
 
 	/**
-	 * Resets the engine by creating a new context.
+	 * Creates a new engine with its own isolate, 
+	 * the engine is loaded once it's first watched.
 	 */
-	void reset_engine()
+	Engine * create_engine(std::wstring script_name, std::wstring host, size_t heap_limit)
 	{
-		v8::Locker locker(isolate);
-		v8::Isolate::Scope isolate_scope(isolate);
-		v8::HandleScope handle_scope(isolate);
+		std::unique_ptr<v8::ArrayBuffer::Allocator> array_buffer_allocator(v8::ArrayBuffer::Allocator::NewDefaultAllocator());
 
-		global_http_response_object.Reset();
-		global_http_request_object.Reset();
-		
-		function_begin_request.Reset();
-		function_directory_change.Reset();
-		function_send_response.Reset();
-		function_pre_begin_request.Reset();
+		v8::Isolate::CreateParams create_params;
+		create_params.array_buffer_allocator = array_buffer_allocator.get();
 
-		loaded_scripts.clear();
+		// The heap limit of an isolate can only be set when it's created.
+		if (heap_limit)
+		{
+			create_params.constraints.set_max_old_space_size(pmax(int(heap_limit / (1024 * 1024)), 1));
+		}
 
-		// Reset our context...
-		context.Reset(isolate, create_shell_context());
+		///////////////////////////
 
-		// Initialize our objects...
-		initialize_objects();
-	} 
+		auto new_engine = std::make_shared<Engine>(
+			v8::Isolate::New(create_params),
+			script_name,
+			host,
+			heap_limit
+		);
+
+		new_engine->m_array_buffer_allocator = std::move(array_buffer_allocator);
+
+		if (heap_limit)
+		{
+			new_engine->m_isolate->AddNearHeapLimitCallback(Engine::near_heap_limit_callback, new_engine.get());
+		}
+
+		// Add the root script with a default file time type so the file gets initially loaded.
+		new_engine->m_loaded_scripts.push_back(
+			std::make_pair(
+				get_path(script_name),
+				fs::file_time_type()
+			)
+		);
+
+		//////////////////////////////////////////
+
+		// Setup our thread which runs deferred work, it's joined once our engine is destroyed.
+		new_engine->m_deferred_thread = std::thread([deferred_engine = new_engine.get()]() {
+			EngineScope engine_scope(deferred_engine);
+
+			drain_deferred_tasks();
+		});
+
+		//////////////////////////////////////////
+
+		std::lock_guard<std::mutex> lock_guard(engines_lock);
+		engines.push_back(new_engine);
+
+		return new_engine.get();
+	}
 
 	/**
-	* Directory notify change callback.
-	*/
-	void directory_change_callback()
+	 * Finds the engine of the tenant that a request belongs to, 
+	 * or the main engine if there's no such tenant.
+	 */
+	Engine * find_engine(IHttpContext * http_context)
 	{
-		v8::Locker locker(isolate);
-		v8::Isolate::Scope isolate_scope(isolate);
-		v8::HandleScope handle_scope(isolate);
-		v8::Context::Scope context_scope(context.Get(isolate));
-		
+		if (!tenants_enabled)
+			return default_engine;
+
 		////////////////////////////////////////////
 
-		if (function_directory_change.IsEmpty()) 
-			return;
+		auto current_tenant_map = std::atomic_load(&tenant_map);
+		auto cooked_url = http_context->GetRequest()->GetRawHttpRequest()->CookedUrl;
+
+		if (!current_tenant_map || !cooked_url.pHost)
+			return default_engine;
 
 		////////////////////////////////////////////
 
-		auto local_function = function_directory_change.Get(isolate);
-			
-		function_directory_change.Get(isolate)->Call(
-			isolate->GetCurrentContext(),
-			v8::Null(isolate),
-			0,
-			NULL
+		auto tenant = current_tenant_map->find(
+			normalize_host(std::wstring(cooked_url.pHost, cooked_url.HostLength / sizeof(wchar_t)))
 		);
+
+		return tenant != current_tenant_map->end() ? tenant->second : default_engine;
 	}
 
 	/**
-	* Returns the path to the filesystem directory.
-	*/
-	std::experimental::filesystem::path& get_relative_file_path(std::wstring &raw_input)
+	 * Returns a snapshot of every engine.
+	 */
+	std::vector<std::shared_ptr<Engine>> get_engines()
 	{
-		static auto cached_paths = std::unordered_map<std::wstring, std::experimental::filesystem::path>();
+		std::lock_guard<std::mutex> lock_guard(engines_lock);
 
-		auto path = cached_paths.find(raw_input);
+		return engines;
+	}
 
-		if (path != cached_paths.end())
+	/**
+	 * Lowercases a host and strips its port.
+	 */
+	std::wstring normalize_host(std::wstring host)
+	{
+		std::transform(host.begin(), host.end(), host.begin(), ::towlower);
+
+		// IPv6 hosts are enclosed in brackets, so their port comes after the closing one.
+		auto port_separator = host.rfind(L':');
+
+		if (port_separator != std::wstring::npos && (host.front() != L'[' || host.find(L']') < port_separator))
 		{
-			return path->second;
+			host.erase(port_separator);
 		}
 
-		////////////////////////////////////////////
-
-		std::wstring input = raw_input;
+		return host;
+	}
 
-		// Windows backend protection (https://tools.ietf.org/html/rfc3986#section-7.3):
-		auto pos = input.find(L"\\", 0);
+	/**
+	 * Reloads the main script of an engine.
+	 */
+	void reload_engine(Engine * reload_target)
+	{
+		EngineScope engine_scope(reload_target);
 
-		// Loop until there isn't any \ characters.
-		while (pos != std::string::npos)
+		// Start streaming every script that was loaded previously, this 
+		// way they're all compiled in parallel by the time they're loaded again.
+		for (auto & loaded_script : engine->m_loaded_scripts)
 		{
-			input.replace(pos, 1, L"/");
-			pos = input.find(L"\\", 0);
+			stream_file(loaded_script.first);
 		}
 
-		////////////////////////////////////////////
+		// Reset the engine...
+		reset_engine();
 
-		std::wstring output; 
-		output.reserve(input.length());
+		// Reload the main script.
+		auto script_path = get_path(engine->m_script_name);
+		execute_file(script_path);
 
-		/**
-		* RFC 3986 5.2.4.
-		* https://tools.ietf.org/html/rfc3986#section-5.2.4
-		*/
+		// Discard the scripts that were streamed but never loaded.
+		discard_streamed_scripts();
+
+		// Warm up our new generation and start serving requests with it.
+		activate_engine();
+	}
+
+	/**
+	 * Creates, reuses and retires tenant engines 
+	 * to match what the main script declared.
+	 */
+	void reconcile_tenants()
+	{
+		std::vector<TenantOptions> tenants;
 
-		// 1. The input buffer is initialized with the now-appended path
-		// components and the output buffer is initialized to the empty
-		// string.
-		while (!input.empty())
 		{
-			// 2.
+			EngineScope engine_scope(default_engine);
+			v8::Locker locker(isolate);
 
-			// A. If the input buffer begins with a prefix of "../" or "./",
-			// then remove that prefix from the input buffer; otherwise,
-			if (input.find(L"../", 0, 3) == 0)
-			{
-				input.replace(0, 3, L"");
-			}
-			else if (input.find(L"./", 0, 2) == 0)
+			if (engine->m_live_generation)
 			{
-				input.replace(0, 2, L"");
+				tenants = engine->m_live_generation->m_tenants;
 			}
+		}
 
-			// B. if the input buffer begins with a prefix of "/./" or "/.",
-			// where "." is a complete path segment, then replace that
-			// prefix with "/" in the input buffer; otherwise,
-			else if (input.find(L"/./", 0, 3) == 0)
-			{
-				input.replace(0, 3, L"/");
-			}
-			else if (input == L"/.")
-			{
-				input.replace(0, 2, L"/");
-			}
+		////////////////////////////////////////////
 
-			// C. if the input buffer begins with a prefix of "/../" or "/..",
-			// where ".." is a complete path segment, then replace that
-			// prefix with "/" in the input buffer and remove the last
-			// segment and its preceding "/" (if any) from the output
-			// buffer; otherwise,
-			else if (input.find(L"/../", 0, 4) == 0)
-			{
-				input.replace(0, 4, L"/");
+		std::lock_guard<std::mutex> lock_guard(tenants_lock);
 
-				auto position = output.find_last_of(L"/");
+		auto new_tenant_map = std::make_shared<std::unordered_map<std::wstring, Engine*>>();
+		auto existing_engines = get_engines();
 
-				if (position != std::string::npos)
+		for (auto & tenant : tenants)
+		{
+			Engine * tenant_engine = nullptr;
+
+			for (auto & existing_engine : existing_engines)
+			{
+				if (
+					existing_engine.get() != default_engine &&
+					existing_engine->m_host == tenant.host &&
+					existing_engine->m_script_name == tenant.script_name &&
+					existing_engine->m_heap_limit == tenant.heap_limit
+				)
 				{
-					output = output.substr(0, position);
+					tenant_engine = existing_engine.get();
+					break;
 				}
 			}
-			else if (input == L"/..")
+
+			// Create a new engine if nothing matched, a different heap limit needs a new isolate. A retired
+			// engine let go of its generation, so it's loaded again just like a new one.
+			if (!tenant_engine || tenant_engine->m_retired)
 			{
-				input.replace(0, 3, L"/");
+				if (!tenant_engine)
+				{
+					tenant_engine = create_engine(tenant.script_name, tenant.host, tenant.heap_limit);
+				}
 
-				auto position = output.find_last_of(L"/");
+				tenant_engine->m_retired = false;
 
-				if (position != std::string::npos)
+				// Load it right away if we can, otherwise it's loaded once its script shows up.
+				std::error_code error_code;
+
+				if (fs::exists(get_path(tenant.script_name), error_code))
 				{
-					output = output.substr(0, position);
+					reload_engine(tenant_engine);
 				}
 			}
 
-			// D. if the input buffer consists only of "." or "..", then remove
-			// that from the input buffer; otherwise,
-			else if (input == L"." || input == L"..")
+			tenant_engine->m_cpu_budget = tenant.cpu_budget;
+			tenant_engine->m_weight = tenant.weight;
+
+			(*new_tenant_map)[tenant.host] = tenant_engine;
+		}
+
+		////////////////////////////////////////////
+
+		std::atomic_store(
+			&tenant_map, 
+			std::shared_ptr<const std::unordered_map<std::wstring, Engine*>>(new_tenant_map)
+		);
+
+		tenants_enabled = !new_tenant_map->empty();
+
+		// Engines that no longer serve a host are retired, they're
+		// kept alive until the requests still using them are done.
+		for (auto & existing_engine : get_engines())
+		{
+			if (existing_engine.get() == default_engine || existing_engine->m_retired)
+				continue;
+
+			bool mapped = false;
+
+			for (auto & tenant : *new_tenant_map)
 			{
-				input = L"";
+				mapped |= tenant.second == existing_engine.get();
 			}
 
-			// E. move the first path segment in the input buffer to the end of
-			// the output buffer, including the initial "/" character(if
-			// any) and any subsequent characters up to, but not including,
-			// the next "/" character or the end of the input buffer.
-			else
+			if (!mapped)
 			{
-				auto position = input.find(L"/");
-
-				if (position == 0) position = input.find(L"/", position + 1);
-				if (position == std::string::npos) position = input.length();
-
-				output += input.substr(0, position);
-				input = input.substr(position);
+				retire_engine(existing_engine.get());
 			}
 		}
-
-		// 3. Finally, the output buffer is returned as the result of
-		// remove_dot_segments.
-		cached_paths[raw_input] = fs_directory / fs::path(output);
-
-		// Return the reference.
-		return cached_paths[raw_input];
-	} 
+	}
 
 	/**
-	 * Gets the path to the location of 
-	 * where all the scripts reside.
+	 * Stops an engine from serving requests and drains its live generation, 
+	 * its threads see that it was retired and let go of it on their own.
 	 */
-	std::experimental::filesystem::path get_path(std::wstring script = std::wstring())
+	void retire_engine(Engine * retired_engine)
 	{
-		//////////////////////////////////////////
+		EngineScope engine_scope(retired_engine);
+		v8::Locker locker(isolate);
 
-		// String containing our documents path.
-		PWSTR known_folder = nullptr;
-		
-		// Fetch our documents path.
-		auto hr = SHGetKnownFolderPath(FOLDERID_Public, 0, (HANDLE)-1, &known_folder);
+		auto now = std::chrono::steady_clock::now();
 
-		// Check if our hr failed...
-		if (FAILED(hr)) throw std::exception("unable to get known folder");
+		engine->m_retired = true;
+		engine->m_retired_at = now;
 
-		//////////////////////////////////////////
+		// New requests are passed on to IIS from now on.
+		engine->m_live_callback_mask = 0;
+		std::atomic_store(&engine->m_live_request_limit, std::shared_ptr<RequestLimit>());
 
-		// Setup our path.
-		fs::path path = known_folder;
+		retire_generation(std::move(engine->m_live_generation), now + std::chrono::milliseconds(DRAIN_TIMEOUT));
+	}
 
-		// Free our object.
-		CoTaskMemFree(known_folder);
+	/**
+	 * Destroys a retired engine once it has drained and nothing but its deferred thread is using it,
+	 * returns whether it was destroyed. Requests find our engine without taking any lock, so we also
+	 * give the ones which found it right before it was retired as long as its generation had to drain.
+	 */
+	bool collect_engine(const std::shared_ptr<Engine> & retired_engine)
+	{
+		std::lock_guard<std::mutex> lock_guard(tenants_lock);
+
+		if (
+			shutting_down ||
+			!retired_engine->m_retired ||
+			std::chrono::steady_clock::now() < retired_engine->m_retired_at + std::chrono::milliseconds(DRAIN_TIMEOUT) ||
+			retired_engine->m_draining_count ||
+			retired_engine->m_deferred_queued ||
+			retired_engine->m_deferred_pending ||
+			retired_engine->m_scopes > 1
+		) return false;
+
+		////////////////////////////////////////////
 
-		//////////////////////////////////////////
-		 
-		if (!script.empty())
 		{
-			path = path / app_pool_folder_name / fs::path(script).filename();
-		} 
+			std::lock_guard<std::mutex> engines_lock_guard(engines_lock);
 
-		/////////////////////////////////////////
-		
-		// Return path. 
-		return path; 
+			engines.erase(std::remove(engines.begin(), engines.end(), retired_engine), engines.end());
+		}
 
-		//////////////////////////////////////////
+		destroy_engine(retired_engine.get());
+
+		return true;
 	}
 
 	/**
-	 * Returns a preexisting or creates a new eternal instance.
+	 * Stops the deferred thread of an engine and disposes its isolate, 
+	 * whoever still holds a snapshot of our engine only gets to see its metrics.
 	 */
-	const v8::Eternal<v8::Name>* find_or_create_eternal_name_cache(
-		const void* lookup_key, 
-		const char* const names[],
-		size_t count)
+	void destroy_engine(Engine * destroyed_engine)
 	{
-		auto it = eternal_name_cache_.find(lookup_key);
-		const std::vector<v8::Eternal<v8::Name>>* vector = nullptr;
-
-		if (it == eternal_name_cache_.end()) 
 		{
-			std::vector<v8::Eternal<v8::Name>> new_vector(count);
-			std::transform(
-				names, names + count, new_vector.begin(), [](const char* name) {
-					return v8::Eternal<v8::Name>(isolate, v8pp::to_v8(isolate, name));
-				}
-			);
-
-			eternal_name_cache_[lookup_key] = std::move(new_vector);
-			vector = &eternal_name_cache_[lookup_key];
+			std::lock_guard<std::mutex> lock_guard(destroyed_engine->m_deferred_tasks_lock);
+			destroyed_engine->m_deferred_stopped = true;
 		}
-		else 
+
+		destroyed_engine->m_deferred_tasks_cv.notify_all();
+		destroyed_engine->m_deferred_thread.join();
+
+		////////////////////////////////////////////
+
 		{
-			vector = &it->second;
+			EngineScope engine_scope(destroyed_engine);
+			v8::Locker locker(isolate);
+			v8::Isolate::Scope isolate_scope(isolate);
+			v8::HandleScope handle_scope(isolate);
+
+			// Everything which holds on to a handle has to let go of it before our isolate is gone.
+			engine->m_live_generation.reset();
+			engine->m_staging_generation.reset();
+			engine->m_draining_generations.clear();
+			engine->m_deferred_tasks.clear();
+			engine->m_streamed_scripts.clear();
+
+			engine->m_global_db_object.Reset();
+			engine->m_global_fetch_object.Reset();
+			engine->m_global_ipc_object.Reset();
+			engine->m_global_queue_object.Reset();
+			engine->m_global_hll_object.Reset();
+			engine->m_global_count_min_object.Reset();
+			engine->m_global_bloom_object.Reset();
+			engine->m_global_rate_limiter_object.Reset();
 		}
-		
-		return vector->data();
+
+		destroyed_engine->m_isolate->Dispose();
+		destroyed_engine->m_isolate = nullptr;
 	}
 
 	/**
-	 * Loads an initial script file 
-	 * and watches for changes every second. 
+	 * Creates an object with the metrics of an engine, 
+	 * which is only read through atomics so any engine can be given.
 	 */
-	void load_and_watch()
-	{  
+	v8::Local<v8::Object> create_engine_metrics(Engine * metrics_engine)
+	{
+		auto context = isolate->GetCurrentContext();
 
-#ifdef _DEBUG
-		// Setup our rpc server to handle remote code executions 
-		// that are needed for debugging and tests.
-		rpc::server rpc_server(8080);
+		////////////////////////////////////////////////
 
-		// Bind our execute function to actually execute our scripts.
-		rpc_server.bind("execute", [](std::string script) {
-			reset_engine();
-			
-			return execute_string("(rpc)", (char*)script.c_str());
-		});
+		auto deferred_object = v8::Object::New(isolate);
+		deferred_object->Set(context, v8pp::to_v8(isolate, "queued"), v8pp::to_v8(isolate, metrics_engine->m_deferred_queued.load())).FromJust();
+		deferred_object->Set(context, v8pp::to_v8(isolate, "pending"), v8pp::to_v8(isolate, metrics_engine->m_deferred_pending.load())).FromJust();
+		deferred_object->Set(context, v8pp::to_v8(isolate, "completed"), v8pp::to_v8(isolate, double(metrics_engine->m_deferred_completed.load()))).FromJust();
+		deferred_object->Set(context, v8pp::to_v8(isolate, "failed"), v8pp::to_v8(isolate, double(metrics_engine->m_deferred_failed.load()))).FromJust();
+		deferred_object->Set(context, v8pp::to_v8(isolate, "rejected"), v8pp::to_v8(isolate, double(metrics_engine->m_deferred_rejected.load()))).FromJust();
+		deferred_object->Set(context, v8pp::to_v8(isolate, "limit"), v8pp::to_v8(isolate, MAX_DEFERRED_TASKS)).FromJust();
 
-		// Run our rpc server asynchronously.
-		rpc_server.async_run();
-#endif
-		 
-		//////////////////////////////////////////
-		 
-		auto script_path = get_path(script_name);
+		////////////////////////////////////////////////
 
-		// Add the root script with a default file time type so the file gets initially loaded.
-		loaded_scripts.push_back(
-			std::make_pair(
-				script_path,
-				fs::file_time_type()
-			)
-		);
+		// Our times are kept in microseconds but given in milliseconds.
+		auto metrics_object = v8::Object::New(isolate);
+		metrics_object->Set(context, v8pp::to_v8(isolate, "calls"), v8pp::to_v8(isolate, double(metrics_engine->m_calls.load()))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "cpuTime"), v8pp::to_v8(isolate, metrics_engine->m_cpu_time.load() / 1000.0)).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "queueTime"), v8pp::to_v8(isolate, metrics_engine->m_queue_time.load() / 1000.0)).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "terminations"), v8pp::to_v8(isolate, double(metrics_engine->m_terminations.load()))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "heapLimitHits"), v8pp::to_v8(isolate, double(metrics_engine->m_heap_limit_hits.load()))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "heapUsed"), v8pp::to_v8(isolate, double(metrics_engine->m_heap_used.load()))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "heapLimit"), v8pp::to_v8(isolate, double(metrics_engine->m_heap_limit) / (1024 * 1024))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "cpuBudget"), v8pp::to_v8(isolate, metrics_engine->m_cpu_budget.load())).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "weight"), v8pp::to_v8(isolate, metrics_engine->m_weight.load())).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "generation"), v8pp::to_v8(isolate, double(metrics_engine->m_generation_count.load()))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "draining"), v8pp::to_v8(isolate, double(metrics_engine->m_draining_count.load()))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "abandoned"), v8pp::to_v8(isolate, double(metrics_engine->m_abandoned_requests.load()))).FromJust();
+		metrics_object->Set(context, v8pp::to_v8(isolate, "deferred"), deferred_object).FromJust();
+
+		return metrics_object;
+	}
 
-		//////////////////////////////////////////
-		 
-		fs_directory = get_path() / app_pool_folder_name / "filesystem";
+	/**
+	 * Numbers without a fraction are kept as integers in 
+	 * shared memory, everything else as doubles.
+	 */
+	IPCNumber to_ipc_number(v8::Local<v8::Value> value)
+	{
+		IPCNumber number;
 
-		//////////////////////////////////////////
-		  
-		HANDLE change_notify_handle = 0;
-		 
-		//////////////////////////////////////////
-		 
-		if (!fs::is_directory(fs_directory))
+		if (value->IsBigInt())
 		{
-			vs_printf("Attempting to create a filesystem directory.\n");
-
-			vs_printf(
-				CreateDirectoryW(fs_directory.c_str(), NULL) ?
-				"Successfully created a new workspace directory.\n" 
-				: "Failed to create a workspace directory!\n" 
-			);
-		}  
-
-		//////////////////////////////////////////
-
-		// Wait for variable used for the find first change notification.
-		DWORD wait_for = 0; 
-		 
-		// The error code used for checking the last write of each loaded script.
-		std::error_code error_code;
+			number.integer = value.As<v8::BigInt>()->Int64Value();
+			return number;
+		}
 
-		for (;;)
-		{ 
-			// Loop through all our loaded scripts.
-			for (auto script = loaded_scripts.begin(); script != loaded_scripts.end(); script++)
-			{
-				// Check if one of the the scripts has been modified.
-				if (script->second != fs::last_write_time(script->first, error_code) && !error_code)
-				{
-					// Reset the engine if so.
-					reset_engine();
+		if (!value->IsNumber())
+			throw std::exception("invalid value, must be a number.");
 
-					// Reload the main script.
-					execute_file(script_path);
+		auto real = value.As<v8::Number>()->Value();
 
-					// Break out of the loop.
-					break;
-				}
-			}
-			 
-			//////////////////////////////////////////
-			 
-			if (wait_for != WAIT_TIMEOUT) 
-			{
-				change_notify_handle = FindFirstChangeNotificationW(
-					fs_directory.c_str(),
-					TRUE,
-					FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE
-				);
-			}
+		if (std::trunc(real) == real && std::abs(real) < 9.2e18)
+		{
+			number.integer = (int64_t)real;
+		}
+		else
+		{
+			number.kind = IPCKind::Double;
+			number.real = real;
+		}
 
-			auto wait_for = WaitForSingleObject(
-				change_notify_handle, 
-				1000
-			); 
+		return number;
+	}
 
-			if (wait_for == WAIT_OBJECT_0)
-			{ 
-				Sleep(1000);
+	v8::Local<v8::Value> from_ipc_number(const IPCNumber & number)
+	{
+		if (number.kind == IPCKind::Integer)
+			return v8::Number::New(isolate, (double)number.integer);
 
-				directory_change_callback();
-			}
-		}	 
-		
-		//////////////////////////////////////////
+		return v8::Number::New(isolate, number.real);
 	}
 
 	/**
-	 * Creates various global objects and methods 
-	 * and creates a brand new context.
+	 * Writes value to buffer, primitives and byte arrays are tagged and written by us
+	 * since setting up a ValueSerializer costs more than writing them does.
 	 */
-	v8::Local<v8::Context> create_shell_context()
+	bool serialize_ipc_value(v8::Local<v8::Value> value, std::vector<unsigned char> & buffer)
 	{
-		// Setup isolate locker...
-		v8::Locker locker(isolate);
-		v8::Isolate::Scope isolate_scope(isolate);
+		if (value->IsUndefined() || value->IsNull() || value->IsBoolean())
+		{
+			auto tag = value->IsUndefined() ? IPCValueTag::Undefined :
+				value->IsNull() ? IPCValueTag::Null :
+				value->IsTrue() ? IPCValueTag::True : IPCValueTag::False;
 
-		// Setup our global module.
-		v8pp::module global(isolate);
+			buffer.assign(1, (unsigned char)tag);
+			return true;
+		}
 
-		// print(msg: any, ...): void
-		global.set("print", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			for (int i = 0; i < args.Length(); i++)
-			{
-				// Get the string provided by the user.
-				v8::String::Utf8Value const value(
-					isolate,
-					args[i]->ToDetailString(
-						args.GetIsolate()->GetCurrentContext()
-					).ToLocalChecked()
-				);
+		if (value->IsInt32())
+		{
+			auto integer = value.As<v8::Int32>()->Value();
 
-				// Check if not first item.
-				if (i != 0) vs_printf(" ");
+			buffer.resize(1 + sizeof(integer));
+			buffer[0] = (unsigned char)IPCValueTag::Integer;
+			std::memcpy(buffer.data() + 1, &integer, sizeof(integer));
 
-				// Print contents provided.
-				vs_printf("%s", *value);
-			}
+			return true;
+		}
 
-			// Print a newline.
-			vs_printf("\n");
-		});
+		if (value->IsNumber())
+		{
+			auto real = value.As<v8::Number>()->Value();
 
-		// load(fileName: String, ...): void
-		global.set("load", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			for (int i = 0; i < args.Length(); i++)
-			{
-				// Get the name of the file provided by the user.
-				auto name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[i]);
+			buffer.resize(1 + sizeof(real));
+			buffer[0] = (unsigned char)IPCValueTag::Double;
+			std::memcpy(buffer.data() + 1, &real, sizeof(real));
 
-				// Get the path to the file.
-				auto path = get_path(name);
+			return true;
+		}
 
-				// Execute the file in v8.
-				execute_file(
-					path
-				);
-			}
-		});
-	
-		// [SIGNATURE 1]
-		// register(
-		//     type: CALLBACK_TYPES (Number),
-		//     callback: (Function(Response, Request): number)
-		// ): void
-		//
-		// [SIGNATURE 2]
-		// register(
-		//     callback: (Function(Response, Request): number)
-		// ): void
-		global.set("register", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1) throw std::exception("invalid function signature for register");
+		if (value->IsString())
+		{
+			auto string = value.As<v8::String>();
+			auto length = string->Length();
 
-			////////////////////////////////////////////////
+			if (string->IsOneByte())
+			{
+				buffer.resize(1 + (size_t)length);
+				buffer[0] = (unsigned char)IPCValueTag::OneByteString;
 
-			// Backwards compatibility for the older variant of the
-			// register function. Assumes that you want a BEGIN_REQUEST
-			// callback.
-			if (args.Length() == 1 && args[0]->IsFunction())
+				string->WriteOneByte(isolate, buffer.data() + 1, 0, length, v8::String::NO_NULL_TERMINATION);
+			}
+			else
 			{
-				function_begin_request.Reset(isolate, v8::Local<v8::Function>::Cast(args[0]));
+				// Our characters start at an even offset, so they're read back in place.
+				buffer.resize(2 + (size_t)length * sizeof(uint16_t));
+				buffer[0] = (unsigned char)IPCValueTag::TwoByteString;
+				buffer[1] = 0;
 
-				return;
+				string->Write(isolate, (uint16_t*)(buffer.data() + 2), 0, length, v8::String::NO_NULL_TERMINATION);
 			}
 
-			////////////////////////////////////////////////
-			
-			if (!args[0]->IsNumber() || !args[1]->IsFunction()) 
-				throw std::exception("invalid function signature 2 for register");
+			return true;
+		}
 
-			////////////////////////////////////////////////
+		if (value->IsUint8Array())
+		{
+			auto array = value.As<v8::Uint8Array>();
 
-			auto type = CALLBACK_TYPES(
-				v8pp::from_v8<int>(isolate, args[0])
-			);
+			buffer.resize(1 + array->ByteLength());
+			buffer[0] = (unsigned char)IPCValueTag::Uint8Array;
 
-			////////////////////////////////////////////////
-			
-			switch (type) 
-			{
-			case BEGIN_REQUEST:
-				function_begin_request.Reset(isolate, v8::Local<v8::Function>::Cast(args[1]));
-				break;
-			case SEND_RESPONSE:
-				function_send_response.Reset(isolate, v8::Local<v8::Function>::Cast(args[1]));
-				break;
-			case PRE_BEGIN_REQUEST:
-				function_pre_begin_request.Reset(isolate, v8::Local<v8::Function>::Cast(args[1]));
-				break;
-			default:
-				throw std::exception("invalid callback type for register");
-			}
-		});
+			array->CopyContents(buffer.data() + 1, array->ByteLength());
 
-		global.set_const("BEGIN_REQUEST", 0);
-		global.set_const("SEND_RESPONSE", 1);
-		global.set_const("PRE_BEGIN_REQUEST", 2);
-		
-		global.set_const("CONTINUE", 0);
-		global.set_const("FINISH", 1);
-		
-		////////////////////////////////////////
+			return true;
+		}
 
-		// http Property
-		v8pp::module http_module(isolate);	
+		/////////////////////////////////////////////
 
-		// http.fetch(
-		//	   hostname: String,
-		//	   path: String, 
-		//	   init: Object {optional},
-		// ): Promise
-		http_module.set("fetch", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 2) 
-				throw std::exception("invalid function signature for http.fetch");
+		SerializerDelegate serializer_delegate(isolate);
+		v8::ValueSerializer serializer(isolate, &serializer_delegate);
 
-			///////////////////////////////////////////////
-			
-			if (!args[0]->IsString() || !args[1]->IsString()) 
-				throw std::exception("invalid argument types for http.fetch");
+		if (!serializer.WriteValue(isolate->GetCurrentContext(), value).FromMaybe(false))
+			return false;
 
-			///////////////////////////////////////////////
+		auto serialized = serializer.Release();
 
-			// Require Parameters
-			
-			auto hostname = v8pp::from_v8<std::string>(isolate, args[0]);
-			auto path = v8pp::from_v8<std::string>(isolate, args[1]);
+		buffer.assign(serialized.first, serialized.first + serialized.second);
 
-			///////////////////////////////////////////////
+		serializer_delegate.FreeBufferMemory(serialized.first);
 
-			FetchRequest fetch_request(std::move(hostname), std::move(path));
+		return true;
+	}
 
-			///////////////////////////////////////////////
-			
-			if (args.Length() > 2 && args[2]->IsObject())
-			{
-				auto object = args[2].As<v8::Object>();
-				
-				////////////////////////////////////
+	/**
+	 * Reads a value written by serialize_ipc_value, or by a ValueSerializer.
+	 */
+	v8::Local<v8::Value> deserialize_ipc_value(const std::vector<unsigned char> & buffer)
+	{
+		if (buffer.empty()) throw std::exception("unable to deserialize value for ipc.");
 
-				static const char* const kKeys[] = 
-				{
-					"body",
-					"method",
-					"is_ssl",
-					"headers"
-				};
+		auto data = buffer.data() + 1;
+		auto size = buffer.size() - 1;
 
-				auto keys = find_or_create_eternal_name_cache(
-					kKeys, 
-					kKeys, 
-					std::size(kKeys)
-				);
+		switch ((IPCValueTag)buffer[0])
+		{
+		case IPCValueTag::Undefined: return v8::Undefined(isolate);
+		case IPCValueTag::Null: return v8::Null(isolate);
+		case IPCValueTag::True: return v8::True(isolate);
+		case IPCValueTag::False: return v8::False(isolate);
 
-				////////////////////////////////////
-				
-				auto context = isolate->GetCurrentContext();
-				
-				////////////////////////////////////
-				
-				// "body" property //
+		case IPCValueTag::Integer:
+		{
+			int32_t integer;
 
-				{
-					v8::Local<v8::Value> value;
+			if (size != sizeof(integer)) break;
 
-					if (!object->Get(context, keys[0].Get(isolate)).ToLocal(&value))
-					{
-						throw std::exception("unable to get value.");
-					}
+			std::memcpy(&integer, data, sizeof(integer));
 
-					if (value->IsString())
-					{
-						fetch_request.body = v8pp::from_v8<std::string>(isolate, value);
-					}
-				}
+			return v8::Integer::New(isolate, integer);
+		}
 
-				////////////////////////////////////
+		case IPCValueTag::Double:
+		{
+			double real;
 
-				// "method" property //
+			if (size != sizeof(real)) break;
 
-				{
-					v8::Local<v8::Value> value;
+			std::memcpy(&real, data, sizeof(real));
 
-					if (!object->Get(context, keys[1].Get(isolate)).ToLocal(&value))
-					{
+			return v8::Number::New(isolate, real);
+		}
+
+		case IPCValueTag::OneByteString:
+			return v8::String::NewFromOneByte(isolate, data, v8::NewStringType::kNormal, (int)size).ToLocalChecked();
+
+		case IPCValueTag::TwoByteString:
+		{
+			if (size == 0 || (size - 1) % sizeof(uint16_t)) break;
+
+			return v8::String::NewFromTwoByte(
+				isolate,
+				(const uint16_t*)(data + 1),
+				v8::NewStringType::kNormal,
+				(int)((size - 1) / sizeof(uint16_t))
+			).ToLocalChecked();
+		}
+
+		case IPCValueTag::Uint8Array:
+		{
+			auto array_buffer = v8::ArrayBuffer::New(isolate, size);
+
+			if (size) std::memcpy(array_buffer->GetContents().Data(), data, size);
+
+			return v8::Uint8Array::New(array_buffer, 0, size);
+		}
+
+		default:
+		{
+			DeserializerDelegate deserializer_delegate(isolate);
+			v8::ValueDeserializer deserializer(
+				isolate,
+				buffer.data(),
+				buffer.size(),
+				&deserializer_delegate
+			);
+
+			auto value = deserializer.ReadValue(isolate->GetCurrentContext());
+
+			if (value.IsEmpty()) throw std::exception("unable to deserialize value for ipc.");
+
+			return value.ToLocalChecked();
+		}
+		}
+
+		throw std::exception("unable to deserialize value for ipc.");
+	}
+
+	/**
+	 * Clones the object of a kind of sketch for our sketch,
+	 * which is let go of once JS no longer holds on to it.
+	 */
+	v8::Local<v8::Object> create_sketch_object(v8::Global<v8::Object> & global_object, std::shared_ptr<IPCSketch> sketch)
+	{
+		auto sketch_object = global_object.Get(isolate)->Clone();
+		auto sketch_handler = new IPCSketchHandler(isolate, sketch_object, std::move(sketch));
+
+		sketch_handler->sketch_object.SetWeak(
+			sketch_handler,
+			[](const v8::WeakCallbackInfo<IPCSketchHandler>& data)
+			{
+				data.GetParameter()->sketch_object.Reset();
+
+				data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(
+					-(int64_t)sizeof(IPCSketchHandler)
+				);
+
+				delete data.GetParameter();
+			},
+			v8::WeakCallbackType::kParameter
+		);
+
+		isolate->AdjustAmountOfExternalAllocatedMemory(
+			(int64_t)sizeof(IPCSketchHandler)
+		);
+
+		return sketch_object;
+	}
+
+	/**
+	 * Clones our rate limiter object for a rate limiter,
+	 * which is let go of once JS no longer holds on to it.
+	 */
+	v8::Local<v8::Object> create_rate_limiter_object(std::shared_ptr<IPCRateLimiter> limiter)
+	{
+		auto limiter_object = engine->m_global_rate_limiter_object.Get(isolate)->Clone();
+		auto limiter_handler = new RateLimiterHandler(isolate, limiter_object, std::move(limiter));
+
+		limiter_handler->limiter_object.SetWeak(
+			limiter_handler,
+			[](const v8::WeakCallbackInfo<RateLimiterHandler>& data)
+			{
+				data.GetParameter()->limiter_object.Reset();
+
+				data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(
+					-(int64_t)sizeof(RateLimiterHandler)
+				);
+
+				delete data.GetParameter();
+			},
+			v8::WeakCallbackType::kParameter
+		);
+
+		isolate->AdjustAmountOfExternalAllocatedMemory(
+			(int64_t)sizeof(RateLimiterHandler)
+		);
+
+		return limiter_object;
+	}
+
+	/**
+	 * Terminates the callbacks of tenants which 
+	 * have gone over their cpu budget.
+	 */
+	void watch_cpu_budgets()
+	{
+		for (;;)
+		{
+			auto now = std::chrono::steady_clock::now();
+
+			for (auto & watched_engine : get_engines())
+			{
+				watched_engine->enforce_cpu_budget(now);
+			}
+
+			Sleep(10);
+		}
+	}
+
+	/**
+	 * Resets the engine by creating a new staging generation, 
+	 * which only starts serving requests once it's activated.
+	 */
+	void reset_engine()
+	{
+		v8::Locker locker(isolate);
+		v8::Isolate::Scope isolate_scope(isolate);
+		v8::HandleScope handle_scope(isolate);
+
+		engine->m_loaded_scripts.clear();
+
+		// Setup our new generation...
+		engine->m_staging_generation = std::make_unique<EngineGeneration>(isolate, ++engine->m_generation_count);
+
+		// Create our context and have it point back to its generation...
+		auto local_context = create_shell_context();
+		local_context->SetAlignedPointerInEmbedderData(ENGINE_GENERATION_INDEX, engine->m_staging_generation.get());
+
+		engine->m_staging_generation->m_context.Reset(isolate, local_context);
+
+		// Initialize our objects...
+		initialize_objects(engine->m_staging_generation.get());
+	} 
+
+	/**
+	 * Warms up the staging generation and swaps it live.
+	 */
+	void activate_engine()
+	{
+		warm_up_engine();
+
+		/////////////////////////////////////////////
+
+		v8::Locker locker(isolate);
+		v8::Isolate::Scope isolate_scope(isolate);
+		v8::HandleScope handle_scope(isolate);
+
+		if (!engine->m_staging_generation) return;
+
+		// Swap our generations, the previous one is drained 
+		// of its pending requests before it's destroyed.
+		auto previous_generation = std::move(engine->m_live_generation);
+
+		engine->m_live_generation = std::move(engine->m_staging_generation);
+		engine->m_live_callback_mask = engine->m_live_generation->callback_mask();
+		std::atomic_store(&engine->m_live_request_limit, engine->m_live_generation->m_request_limit);
+
+		retire_generation(
+			std::move(previous_generation), 
+			std::chrono::steady_clock::now() + std::chrono::milliseconds(DRAIN_TIMEOUT)
+		);
+	}
+
+	/**
+	 * Hands a generation that no longer serves requests over to be drained.
+	 */
+	void retire_generation(std::unique_ptr<EngineGeneration> generation, std::chrono::steady_clock::time_point deadline)
+	{
+		if (!generation) return;
+
+		generation->m_drain_deadline = deadline;
+
+		engine->m_draining_generations.push_back(std::move(generation));
+
+		// Destroy it right away if there's nothing to wait for.
+		drain_generations(false);
+	}
+
+	/**
+	 * Destroys the retired generations which have drained, or 
+	 * whose deadline has passed in which case their pending requests
+	 * are completed for them. Returns how many are still draining.
+	 */
+	size_t drain_generations(bool force)
+	{
+		v8::Locker locker(isolate);
+		v8::Isolate::Scope isolate_scope(isolate);
+		v8::HandleScope handle_scope(isolate);
+
+		auto now = std::chrono::steady_clock::now();
+		auto & generations = engine->m_draining_generations;
+
+		for (auto generation = generations.begin(); generation != generations.end();)
+		{
+			auto in_flight = (*generation)->m_in_flight;
+
+			if (!in_flight->is_idle() && !force && now < (*generation)->m_drain_deadline)
+			{
+				generation++;
+				continue;
+			}
+
+			////////////////////////////////////////////////
+
+			// Whatever is left is completed for it, so that no request is left hanging.
+			for (auto request : in_flight->abandon())
+			{
+				// Anything still running must no longer use the request.
+				if (!request->m_http_response_object.IsEmpty())
+					request->m_http_response_object.Get(isolate)->SetAlignedPointerInInternalField(0, nullptr);
+
+				if (!request->m_http_request_object.IsEmpty())
+					request->m_http_request_object.Get(isolate)->SetAlignedPointerInInternalField(0, nullptr);
+
+				request->m_http_response_object.Reset();
+				request->m_http_request_object.Reset();
+
+				////////////////////////////////////////////////
+
+				request->m_http_context->GetResponse()->SetStatus(503, "Service Unavailable");
+				request->m_http_context->IndicateCompletion(RQ_NOTIFICATION_FINISH_REQUEST);
+
+				engine->m_abandoned_requests++;
+			}
+
+			// Worker jobs hold on to the tracker rather than to us, so they can safely finish later.
+			generation = generations.erase(generation);
+		}
+
+		engine->m_draining_count = generations.size();
+
+		return generations.size();
+	}
+
+	/**
+	 * Stops serving requests and drains every generation 
+	 * of every engine, used when the worker process shuts down.
+	 */
+	void shutdown()
+	{
+		std::vector<std::shared_ptr<Engine>> all_engines;
+
+		// Once we're shutting down no engine is destroyed anymore, so we can't be left with one that's gone.
+		{
+			std::lock_guard<std::mutex> lock_guard(tenants_lock);
+
+			shutting_down = true;
+			all_engines = get_engines();
+		}
+
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(DRAIN_TIMEOUT);
+
+		for (auto & shutdown_engine : all_engines)
+		{
+			EngineScope engine_scope(shutdown_engine.get());
+			v8::Locker locker(isolate);
+
+			// New requests are passed on to IIS from now on.
+			engine->m_live_callback_mask = 0;
+			std::atomic_store(&engine->m_live_request_limit, std::shared_ptr<RequestLimit>());
+
+			retire_generation(std::move(engine->m_live_generation), deadline);
+		}
+
+		////////////////////////////////////////////////
+
+		// Wait for our requests, worker jobs and deferred work to 
+		// finish, once we're out of time whatever is left is completed for them.
+		for (;;)
+		{
+			auto expired = std::chrono::steady_clock::now() >= deadline;
+			auto drained = true;
+
+			for (auto & shutdown_engine : all_engines)
+			{
+				EngineScope engine_scope(shutdown_engine.get());
+
+				drained &= drain_generations(expired) == 0;
+				drained &= expired || (engine->m_deferred_queued == 0 && engine->m_deferred_pending == 0);
+			}
+
+			if (drained) break;
+
+			Sleep(10);
+		}
+	}
+
+	/**
+	 * Tracks a worker job of the current generation.
+	 */
+	InFlightJob track_job()
+	{
+		auto generation = ENGINE_GENERATION;
+
+		return InFlightJob(generation ? generation->m_in_flight : nullptr);
+	}
+
+	/**
+	 * Replays the warm-up requests of the staging generation against its handlers
+	 * until it made all of its iterations or its time budget runs out.
+	 */
+	void warm_up_engine()
+	{
+		EngineGeneration * generation = nullptr;
+
+		{
+			v8::Locker locker(isolate);
+			v8::Isolate::Scope isolate_scope(isolate);
+			v8::HandleScope handle_scope(isolate);
+
+			generation = engine->m_staging_generation.get();
+
+			// There's nothing to warm up without any requests or handlers, and if nothing
+			// is live then we'd only be letting requests through without any handlers.
+			if (
+				!generation || 
+				!engine->m_live_generation || 
+				!generation->callback_mask() || 
+				generation->m_warmup_requests.empty()
+			) return;
+		}
+
+		/////////////////////////////////////////////
+
+		auto start_time = std::chrono::steady_clock::now();
+		auto deadline = start_time + std::chrono::milliseconds(generation->m_warmup_budget);
+
+		int iteration = 0;
+
+		while (
+			iteration < generation->m_warmup_iterations && 
+			std::chrono::steady_clock::now() < deadline
+		)
+		{
+			// We lock for each iteration so that live 
+			// requests can still be served in between.
+			v8::Locker locker(isolate);
+			v8::Isolate::Scope isolate_scope(isolate);
+			v8::HandleScope handle_scope(isolate);
+
+			// Check if our generation was replaced while we were unlocked.
+			if (engine->m_staging_generation.get() != generation) break;
+
+			v8::Context::Scope context_scope(generation->m_context.Get(isolate));
+
+			/////////////////////////////////////////////
+
+			for (auto & warmup_request : generation->m_warmup_requests)
+			{
+				run_warmup_request(generation, warmup_request);
+			}
+
+			iteration++;
+		}
+
+		/////////////////////////////////////////////
+
+		v8::Locker locker(isolate);
+
+		vs_printf(
+			"Warmed up handlers in %d iterations (%lld ms)...\n", 
+			iteration,
+			(long long)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start_time).count()
+		);
+	}
+
+	/**
+	 * Runs a single warm-up request through each of the registered 
+	 * handlers using synthetic response and request objects.
+	 */
+	void run_warmup_request(EngineGeneration * generation, const WarmupRequest & warmup_request)
+	{
+		// Handlers can modify the request, so each run gets its own copy.
+		auto request = std::make_shared<WarmupRequest>(warmup_request);
+
+		// The order in which IIS would call our handlers.
+		static const CALLBACK_TYPES callback_types[] = 
+		{
+			PRE_BEGIN_REQUEST,
+			BEGIN_REQUEST,
+			SEND_RESPONSE
+		};
+
+		v8::TryCatch try_catch(isolate);
+
+		for (auto type : callback_types)
+		{
+			auto callback_function = generation->get_callback(type);
+
+			if (callback_function->IsEmpty()) continue;
+
+			////////////////////////////////////////////////
+
+			// Clone the same objects as live requests so that any
+			// optimized code is specialized for the same maps.
+			auto http_response_object = generation->m_http_response_object.Get(isolate)->Clone();
+			auto http_request_object = generation->m_http_request_object.Get(isolate)->Clone();
+
+			for (auto object : { http_response_object, http_request_object })
+			{
+				auto warmup_handler = new WarmupRequestHandler(isolate, object, request);
+
+				warmup_handler->warmup_object.SetWeak(
+					warmup_handler,
+					[](const v8::WeakCallbackInfo<WarmupRequestHandler>& data)
+					{
+						// Reset our JS object.
+						data.GetParameter()->warmup_object.Reset();
+
+						///////////////////////////////
+
+						// Delete our object.
+						delete data.GetParameter();
+					},
+					v8::WeakCallbackType::kParameter
+				);
+			}
+
+			////////////////////////////////////////////////
+
+			v8::Local<v8::Value> arguments[3];
+			arguments[0] = http_response_object;
+			arguments[1] = http_request_object;
+			arguments[2] = v8pp::to_v8(isolate, 0);
+
+			auto result = callback_function->Get(isolate)->Call(
+				isolate->GetCurrentContext(),
+				v8::Null(isolate),
+				type == SEND_RESPONSE ? 3 : 2,
+				arguments
+			);
+
+			////////////////////////////////////////////////
+
+			v8::Local<v8::Value> result_value;
+
+			// Stop if our handler threw, or if it finished the request before it began.
+			if (
+				!result.ToLocal(&result_value) || 
+				(type == PRE_BEGIN_REQUEST && v8pp::from_v8<int>(isolate, result_value, 0))
+			) break;
+		}
+	}
+
+	/**
+	 * Returns the context that scripts should be loaded into, which 
+	 * is the staging generation's context while the engine is being reset.
+	 */
+	v8::Local<v8::Context> get_loading_context()
+	{
+		if (isolate->InContext())
+			return isolate->GetCurrentContext();
+
+		auto generation = engine->m_staging_generation ? 
+			engine->m_staging_generation.get() : engine->m_live_generation.get();
+
+		return generation->m_context.Get(isolate);
+	}
+
+	/**
+	 * Reserves a slot for deferred work, 
+	 * throws if the backlog is full.
+	 */
+	void reserve_deferred_task()
+	{
+		if (engine->m_deferred_queued + engine->m_deferred_pending >= MAX_DEFERRED_TASKS)
+		{
+			engine->m_deferred_rejected++;
+
+			throw std::exception("the deferred backlog is full");
+		}
+
+		engine->m_deferred_scheduled++;
+	}
+
+	/**
+	 * Keeps track of a promise until it settles.
+	 */
+	void track_deferred_promise(v8::Local<v8::Promise> promise)
+	{
+		engine->m_deferred_pending++;
+
+		////////////////////////////////////////////////
+
+		auto context = isolate->GetCurrentContext();
+
+		auto on_fulfilled = v8::Function::New(context, [](const v8::FunctionCallbackInfo<v8::Value>& args) {
+			engine->m_deferred_pending--;
+			engine->m_deferred_completed++;
+		}).ToLocalChecked();
+
+		auto on_rejected = v8::Function::New(context, [](const v8::FunctionCallbackInfo<v8::Value>& args) {
+			engine->m_deferred_pending--;
+			engine->m_deferred_failed++;
+
+			v8::String::Utf8Value reason(args.GetIsolate(), args[0]);
+
+			vs_printf("Deferred work failed: %s\n", c_string(reason));
+		}).ToLocalChecked();
+
+		////////////////////////////////////////////////
+
+		promise->Then(context, on_fulfilled, on_rejected);
+	}
+
+	/**
+	 * Runs the functions given to defer, each function locks the isolate on 
+	 * its own so that requests can run in between. Returns once our engine is destroyed.
+	 */
+	void drain_deferred_tasks()
+	{
+		for (;;)
+		{
+			std::vector<v8::Global<v8::Function>> tasks;
+
+			{
+				auto unique_lock = std::unique_lock<std::mutex>(engine->m_deferred_tasks_lock);
+				engine->m_deferred_tasks_cv.wait(unique_lock, []() { return !engine->m_deferred_tasks.empty() || engine->m_deferred_stopped; });
+
+				if (engine->m_deferred_stopped) return;
+
+				tasks.swap(engine->m_deferred_tasks);
+			}
+
+			////////////////////////////////////////////////
+
+			for (auto & task : tasks)
+			{
+				v8::Locker locker(isolate);
+				v8::Isolate::Scope isolate_scope(isolate);
+				v8::HandleScope handle_scope(isolate);
+
+				auto function = task.Get(isolate);
+
+				// Call our function in the context it was created in.
+				v8::Context::Scope context_scope(function->CreationContext());
+				v8::TryCatch try_catch(isolate);
+
+				auto call_started = engine->begin_call();
+
+				auto result = function->Call(
+					isolate->GetCurrentContext(),
+					v8::Null(isolate),
+					0,
+					nullptr
+				);
+
+				engine->end_call(call_started);
+
+				task.Reset();
+				engine->m_deferred_queued--;
+
+				////////////////////////////////////////////////
+
+				if (result.IsEmpty())
+				{
+					engine->m_deferred_failed++;
+
+					report_exception(&try_catch);
+				}
+				else if (result.ToLocalChecked()->IsPromise())
+				{
+					track_deferred_promise(result.ToLocalChecked().As<v8::Promise>());
+				}
+				else
+				{
+					engine->m_deferred_completed++;
+				}
+			}
+		}
+	}
+
+	/**
+	 * Waits for messages on a channel and hands them to the subscriptions
+	 * of our live generation, locking the isolate once per batch.
+	 */
+	void dispatch_channel_messages(std::shared_ptr<IPCSubscriber> subscriber)
+	{
+		std::vector<std::vector<unsigned char>> messages;
+		size_t count = 0;
+
+		for (;;)
+		{
+			// We only decide to stop under the lock subscribe takes, so that an engine which is brought back 
+			// either finds us still running or starts a thread of its own. Letting go of our subscriber frees its slot.
+			if (engine->m_retired || shutting_down)
+			{
+				std::lock_guard<std::mutex> lock_guard(engine->m_subscribers_lock);
+
+				if (engine->m_retired || shutting_down)
+				{
+					auto existing_subscriber = engine->m_subscribers.find(subscriber->name());
+
+					if (existing_subscriber != engine->m_subscribers.end() && existing_subscriber->second == subscriber)
+						engine->m_subscribers.erase(existing_subscriber);
+
+					return;
+				}
+			}
+
+			// Only sleep once we've caught up.
+			if (count < IPC_CHANNEL_BATCH_SIZE)
+				subscriber->wait(IPC_CHANNEL_POLL_INTERVAL);
+
+			count = subscriber->read(messages, IPC_CHANNEL_BATCH_SIZE);
+
+			if (!count) continue;
+
+			////////////////////////////////////////////////
+
+			v8::Locker locker(isolate);
+			v8::Isolate::Scope isolate_scope(isolate);
+			v8::HandleScope handle_scope(isolate);
+
+			if (!engine->m_live_generation)
+				continue;
+
+			auto generation = engine->m_live_generation.get();
+
+			v8::Context::Scope context_scope(generation->m_context.Get(isolate));
+
+			////////////////////////////////////////////////
+
+			for (size_t i = 0; i < count; i++)
+			{
+				v8::HandleScope message_scope(isolate);
+				v8::TryCatch try_catch(isolate);
+
+				v8::Local<v8::Value> value;
+
+				try
+				{
+					value = deserialize_ipc_value(messages[i]);
+				}
+				catch (std::exception& exception)
+				{
+					vs_printf("Unable to read a message from %s: %s\n", subscriber->name().c_str(), exception.what());
+					continue;
+				}
+
+				for (auto & subscription : generation->m_subscriptions)
+				{
+					if (subscription.first != subscriber->name())
+						continue;
+
+					auto call_started = engine->begin_call();
+
+					auto result = subscription.second.Get(isolate)->Call(
+						isolate->GetCurrentContext(),
+						v8::Null(isolate),
+						1,
+						&value
+					);
+
+					engine->end_call(call_started);
+
+					if (result.IsEmpty())
+					{
+						report_exception(&try_catch);
+						try_catch.Reset();
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * Takes jobs from a queue and hands them to the onJob callback of our live
+	 * generation, the next job is only taken once the previous one has settled.
+	 */
+	void dispatch_queue_jobs(std::shared_ptr<IPCQueueConsumer> consumer)
+	{
+		IPCJob job;
+
+		for (;;)
+		{
+			// Stopping works just like it does for our channels, except that the promise of our last job 
+			// can still settle with our consumer, so our engine keeps it around until it's destroyed.
+			if (engine->m_retired || shutting_down)
+			{
+				std::lock_guard<std::mutex> lock_guard(engine->m_queue_consumers_lock);
+
+				if (engine->m_retired || shutting_down)
+				{
+					auto existing_consumer = engine->m_queue_consumers.find(consumer->m_queue->name());
+
+					if (existing_consumer != engine->m_queue_consumers.end() && existing_consumer->second == consumer)
+						engine->m_queue_consumers.erase(existing_consumer);
+
+					engine->m_stopped_queue_consumers.push_back(consumer);
+
+					return;
+				}
+			}
+
+			{
+				auto unique_lock = std::unique_lock<std::mutex>(consumer->m_lock);
+
+				if (!consumer->m_settled_cv.wait_for(
+					unique_lock, 
+					std::chrono::milliseconds(IPC_QUEUE_POLL_INTERVAL), 
+					[&]() { return !consumer->m_pending; }
+				)) continue;
+			}
+
+			// We also look for jobs when our wait times out, which is how expired jobs are picked up.
+			consumer->m_queue->wait(IPC_QUEUE_POLL_INTERVAL);
+
+			if (!consumer->m_queue->pop(job, consumer->m_visibility_timeout))
+				continue;
+
+			////////////////////////////////////////////////
+
+			v8::Locker locker(isolate);
+			v8::Isolate::Scope isolate_scope(isolate);
+			v8::HandleScope handle_scope(isolate);
+
+			// Whoever takes the job next gets it once its visibility timeout runs out.
+			if (!engine->m_live_generation)
+				continue;
+
+			auto generation = engine->m_live_generation.get();
+			auto callback = std::find_if(
+				generation->m_job_callbacks.begin(),
+				generation->m_job_callbacks.end(),
+				[&](const std::pair<std::string, v8::Global<v8::Function>>& job_callback) {
+					return job_callback.first == consumer->m_queue->name();
+				}
+			);
+
+			if (callback == generation->m_job_callbacks.end())
+				continue;
+
+			v8::Context::Scope context_scope(generation->m_context.Get(isolate));
+			v8::TryCatch try_catch(isolate);
+
+			////////////////////////////////////////////////
+
+			v8::Local<v8::Value> arguments[2];
+
+			try
+			{
+				arguments[0] = deserialize_ipc_value(job.data);
+			}
+			catch (std::exception& exception)
+			{
+				// It would never get any better, so drop it.
+				vs_printf("Unable to read a job from %s: %s\n", consumer->m_queue->name().c_str(), exception.what());
+
+				consumer->m_queue->ack(job.id);
+				continue;
+			}
+
+			arguments[1] = v8pp::to_v8(isolate, job.attempts);
+
+			////////////////////////////////////////////////
+
+			auto call_started = engine->begin_call();
+
+			auto result = callback->second.Get(isolate)->Call(
+				isolate->GetCurrentContext(),
+				v8::Null(isolate),
+				2,
+				arguments
+			);
+
+			engine->end_call(call_started);
+
+			if (result.IsEmpty())
+			{
+				report_exception(&try_catch);
+				continue;
+			}
+
+			if (!result.ToLocalChecked()->IsPromise())
+			{
+				consumer->m_queue->ack(job.id);
+				continue;
+			}
+
+			////////////////////////////////////////////////
+
+			{
+				std::lock_guard<std::mutex> lock_guard(consumer->m_lock);
+
+				consumer->m_job_id = job.id;
+				consumer->m_pending = true;
+			}
+
+			auto context = isolate->GetCurrentContext();
+
+			// Our consumer lives as long as our engine, even once it's stopped, so it can safely be given to our handlers.
+			auto consumer_data = v8::External::New(isolate, consumer.get());
+
+			auto on_fulfilled = v8::Function::New(context, [](const v8::FunctionCallbackInfo<v8::Value>& args) {
+				((IPCQueueConsumer*)args.Data().As<v8::External>()->Value())->settle(true);
+			}, consumer_data).ToLocalChecked();
+
+			auto on_rejected = v8::Function::New(context, [](const v8::FunctionCallbackInfo<v8::Value>& args) {
+				auto rejected_consumer = (IPCQueueConsumer*)args.Data().As<v8::External>()->Value();
+
+				v8::String::Utf8Value reason(args.GetIsolate(), args[0]);
+
+				vs_printf("Job of %s failed: %s\n", rejected_consumer->m_queue->name().c_str(), c_string(reason));
+
+				rejected_consumer->settle(false);
+			}, consumer_data).ToLocalChecked();
+
+			result.ToLocalChecked().As<v8::Promise>()->Then(context, on_fulfilled, on_rejected);
+		}
+	}
+
+	/**
+	 * Settles the pending waits of an ipc object as their keys change, we only look at the
+	 * store without holding our isolate and only lock it once there's something to settle.
+	 */
+	void dispatch_ipc_waits(IPCHandler * handler)
+	{
+		std::vector<std::pair<uint64_t, int64_t>> settled;
+		std::vector<std::pair<uint64_t, std::string>> watched;
+		std::vector<int64_t> versions;
+
+		for (;;)
+		{
+			auto cancelled = false;
+			auto timeout = std::chrono::milliseconds(IPC_WAIT_POLL_INTERVAL);
+
+			settled.clear();
+			watched.clear();
+			versions.clear();
+
+			{
+				std::lock_guard<std::mutex> lock_guard(handler->m_waits_lock);
+
+				cancelled = handler->m_closing || engine->m_retired || shutting_down;
+
+				if (!cancelled)
+				{
+					auto now = std::chrono::steady_clock::now();
+
+					for (auto & wait : handler->m_waits)
+					{
+						watched.emplace_back(wait.id, wait.key);
+						versions.push_back(wait.version);
+
+						timeout = std::min(timeout, std::chrono::duration_cast<std::chrono::milliseconds>(
+							std::max(wait.deadline - now, std::chrono::steady_clock::duration::zero())
+						));
+					}
+
+					handler->m_in_backend = true;
+				}
+			}
+
+			////////////////////////////////////////////////
+
+			if (!cancelled)
+			{
+				try
+				{
+					handler->m_context->wait_for_changes((uint32_t)timeout.count());
+
+					auto now = std::chrono::steady_clock::now();
+
+					for (size_t i = 0; i < watched.size(); i++)
+					{
+						auto version = handler->m_context->version(watched[i].second);
+
+						if (version != versions[i])
+							settled.emplace_back(watched[i].first, version);
+					}
+
+					// Whatever is left over has to look at its deadline.
+					std::lock_guard<std::mutex> lock_guard(handler->m_waits_lock);
+
+					for (size_t i = 0; i < watched.size(); i++)
+					{
+						auto wait = std::find_if(handler->m_waits.begin(), handler->m_waits.end(), [&](const IPCPendingWait& pending_wait) {
+							return pending_wait.id == watched[i].first;
+						});
+
+						auto is_settled = std::any_of(settled.begin(), settled.end(), [&](const std::pair<uint64_t, int64_t>& candidate) {
+							return candidate.first == watched[i].first;
+						});
+
+						if (!is_settled && wait != handler->m_waits.end() && wait->deadline <= now)
+							settled.emplace_back(wait->id, versions[i]);
+					}
+				}
+				catch (std::exception& exception)
+				{
+					vs_printf("Unable to wait on an ipc object: %s\n", exception.what());
+
+					cancelled = true;
+				}
+
+				{
+					std::lock_guard<std::mutex> lock_guard(handler->m_waits_lock);
+
+					handler->m_in_backend = false;
+				}
+
+				handler->m_waits_cv.notify_all();
+			}
+
+			if (!cancelled && settled.empty())
+				continue;
+
+			////////////////////////////////////////////////
+
+			// Our handler is only let go of by the garbage collector, which can't run while we hold our isolate.
+			v8::Locker locker(isolate);
+			v8::Isolate::Scope isolate_scope(isolate);
+			v8::HandleScope handle_scope(isolate);
+
+			std::lock_guard<std::mutex> lock_guard(handler->m_waits_lock);
+
+			for (auto wait = handler->m_waits.begin(); wait != handler->m_waits.end();)
+			{
+				auto settled_wait = std::find_if(settled.begin(), settled.end(), [&](const std::pair<uint64_t, int64_t>& candidate) {
+					return candidate.first == wait->id;
+				});
+
+				if (!cancelled && settled_wait == settled.end())
+				{
+					++wait;
+					continue;
+				}
+
+				auto resolver = wait->resolver.Get(isolate);
+
+				v8::Context::Scope context_scope(resolver->CreationContext());
+
+				handler->m_context->unwatch(wait->key);
+
+				if (cancelled)
+				{
+					resolver->Reject(isolate->GetCurrentContext(), v8pp::to_v8(isolate, "ipc wait was cancelled"));
+				}
+				else
+				{
+					resolver->Resolve(isolate->GetCurrentContext(), v8pp::to_v8(isolate, (double)settled_wait->second));
+				}
+
+				wait = handler->m_waits.erase(wait);
+			}
+
+			if (handler->m_waits.empty())
+			{
+				handler->m_waiting = false;
+				handler->m_waits_owner.Reset();
+
+				return;
+			}
+		}
+	}
+
+	/**
+	* Directory notify change callback.
+	*/
+	void directory_change_callback()
+	{
+		v8::Locker locker(isolate);
+		v8::Isolate::Scope isolate_scope(isolate);
+		v8::HandleScope handle_scope(isolate);
+
+		if (!engine->m_live_generation) 
+			return;
+
+		v8::Context::Scope context_scope(engine->m_live_generation->m_context.Get(isolate));
+		
+		////////////////////////////////////////////
+
+		if (engine->m_live_generation->m_function_directory_change.IsEmpty()) 
+			return;
+
+		////////////////////////////////////////////
+			
+		engine->m_live_generation->m_function_directory_change.Get(isolate)->Call(
+			isolate->GetCurrentContext(),
+			v8::Null(isolate),
+			0,
+			NULL
+		);
+	}
+
+	/**
+	* Returns the path to the filesystem directory.
+	*/
+	std::experimental::filesystem::path& get_relative_file_path(std::wstring &raw_input)
+	{
+		static auto cached_paths = std::unordered_map<std::wstring, std::experimental::filesystem::path>();
+
+		auto path = cached_paths.find(raw_input);
+
+		if (path != cached_paths.end())
+		{
+			return path->second;
+		}
+
+		////////////////////////////////////////////
+
+		std::wstring input = raw_input;
+
+		// Windows backend protection (https://tools.ietf.org/html/rfc3986#section-7.3):
+		auto pos = input.find(L"\\", 0);
+
+		// Loop until there isn't any \ characters.
+		while (pos != std::string::npos)
+		{
+			input.replace(pos, 1, L"/");
+			pos = input.find(L"\\", 0);
+		}
+
+		////////////////////////////////////////////
+
+		std::wstring output; 
+		output.reserve(input.length());
+
+		/**
+		* RFC 3986 5.2.4.
+		* https://tools.ietf.org/html/rfc3986#section-5.2.4
+		*/
+
+		// 1. The input buffer is initialized with the now-appended path
+		// components and the output buffer is initialized to the empty
+		// string.
+		while (!input.empty())
+		{
+			// 2.
+
+			// A. If the input buffer begins with a prefix of "../" or "./",
+			// then remove that prefix from the input buffer; otherwise,
+			if (input.find(L"../", 0, 3) == 0)
+			{
+				input.replace(0, 3, L"");
+			}
+			else if (input.find(L"./", 0, 2) == 0)
+			{
+				input.replace(0, 2, L"");
+			}
+
+			// B. if the input buffer begins with a prefix of "/./" or "/.",
+			// where "." is a complete path segment, then replace that
+			// prefix with "/" in the input buffer; otherwise,
+			else if (input.find(L"/./", 0, 3) == 0)
+			{
+				input.replace(0, 3, L"/");
+			}
+			else if (input == L"/.")
+			{
+				input.replace(0, 2, L"/");
+			}
+
+			// C. if the input buffer begins with a prefix of "/../" or "/..",
+			// where ".." is a complete path segment, then replace that
+			// prefix with "/" in the input buffer and remove the last
+			// segment and its preceding "/" (if any) from the output
+			// buffer; otherwise,
+			else if (input.find(L"/../", 0, 4) == 0)
+			{
+				input.replace(0, 4, L"/");
+
+				auto position = output.find_last_of(L"/");
+
+				if (position != std::string::npos)
+				{
+					output = output.substr(0, position);
+				}
+			}
+			else if (input == L"/..")
+			{
+				input.replace(0, 3, L"/");
+
+				auto position = output.find_last_of(L"/");
+
+				if (position != std::string::npos)
+				{
+					output = output.substr(0, position);
+				}
+			}
+
+			// D. if the input buffer consists only of "." or "..", then remove
+			// that from the input buffer; otherwise,
+			else if (input == L"." || input == L"..")
+			{
+				input = L"";
+			}
+
+			// E. move the first path segment in the input buffer to the end of
+			// the output buffer, including the initial "/" character(if
+			// any) and any subsequent characters up to, but not including,
+			// the next "/" character or the end of the input buffer.
+			else
+			{
+				auto position = input.find(L"/");
+
+				if (position == 0) position = input.find(L"/", position + 1);
+				if (position == std::string::npos) position = input.length();
+
+				output += input.substr(0, position);
+				input = input.substr(position);
+			}
+		}
+
+		// 3. Finally, the output buffer is returned as the result of
+		// remove_dot_segments.
+		cached_paths[raw_input] = fs_directory / fs::path(output);
+
+		// Return the reference.
+		return cached_paths[raw_input];
+	} 
+
+	/**
+	 * Gets the path to the location of 
+	 * where all the scripts reside.
+	 */
+	std::experimental::filesystem::path get_path(std::wstring script = std::wstring())
+	{
+		//////////////////////////////////////////
+
+		// String containing our documents path.
+		PWSTR known_folder = nullptr;
+		
+		// Fetch our documents path.
+		auto hr = SHGetKnownFolderPath(FOLDERID_Public, 0, (HANDLE)-1, &known_folder);
+
+		// Check if our hr failed...
+		if (FAILED(hr)) throw std::exception("unable to get known folder");
+
+		//////////////////////////////////////////
+
+		// Setup our path.
+		fs::path path = known_folder;
+
+		// Free our object.
+		CoTaskMemFree(known_folder);
+
+		//////////////////////////////////////////
+		 
+		if (!script.empty())
+		{
+			path = path / app_pool_folder_name / fs::path(script).filename();
+		} 
+
+		/////////////////////////////////////////
+		
+		// Return path. 
+		return path; 
+
+		//////////////////////////////////////////
+	}
+
+	/**
+	 * Returns a preexisting or creates a new eternal instance.
+	 */
+	const v8::Eternal<v8::Name>* find_or_create_eternal_name_cache(
+		const void* lookup_key, 
+		const char* const names[],
+		size_t count)
+	{
+		auto it = engine->m_eternal_name_cache.find(lookup_key);
+		const std::vector<v8::Eternal<v8::Name>>* vector = nullptr;
+
+		if (it == engine->m_eternal_name_cache.end()) 
+		{
+			std::vector<v8::Eternal<v8::Name>> new_vector(count);
+			std::transform(
+				names, names + count, new_vector.begin(), [](const char* name) {
+					return v8::Eternal<v8::Name>(isolate, v8pp::to_v8(isolate, name));
+				}
+			);
+
+			engine->m_eternal_name_cache[lookup_key] = std::move(new_vector);
+			vector = &engine->m_eternal_name_cache[lookup_key];
+		}
+		else 
+		{
+			vector = &it->second;
+		}
+		
+		return vector->data();
+	}
+
+	/**
+	 * Loads an initial script file 
+	 * and watches for changes every second. 
+	 */
+	void load_and_watch()
+	{  
+
+#ifdef _DEBUG
+		// Setup our rpc server to handle remote code executions 
+		// that are needed for debugging and tests.
+		rpc::server rpc_server(8080);
+
+		// Bind our execute function to actually execute our scripts.
+		rpc_server.bind("execute", [](std::string script) {
+			bool result;
+
+			{
+				EngineScope engine_scope(default_engine);
+
+				reset_engine();
+
+				result = execute_string("(rpc)", (char*)script.c_str());
+
+				activate_engine();
+			}
+
+			reconcile_tenants();
+
+			return result;
+		});
+
+		// Run our rpc server asynchronously.
+		rpc_server.async_run();
+#endif
+		 
+		//////////////////////////////////////////
+		 
+		fs_directory = get_path() / app_pool_folder_name / "filesystem";
+
+		//////////////////////////////////////////
+		  
+		HANDLE change_notify_handle = 0;
+		 
+		//////////////////////////////////////////
+		 
+		if (!fs::is_directory(fs_directory))
+		{
+			vs_printf("Attempting to create a filesystem directory.\n");
+
+			vs_printf(
+				CreateDirectoryW(fs_directory.c_str(), NULL) ?
+				"Successfully created a new workspace directory.\n" 
+				: "Failed to create a workspace directory!\n" 
+			);
+		}  
+
+		//////////////////////////////////////////
+
+		// Wait for variable used for the find first change notification.
+		DWORD wait_for = 0; 
+		 
+		// The error code used for checking the last write of each loaded script.
+		std::error_code error_code;
+
+		for (;;)
+		{ 
+			// Loop through all our engines, reloading the ones whose scripts were modified.
+			for (auto & watched_engine : get_engines())
+			{
+				// Destroy the generations that have finished draining.
+				{
+					EngineScope engine_scope(watched_engine.get());
+
+					drain_generations(false);
+				}
+
+				if (watched_engine->m_retired || shutting_down)
+				{
+					collect_engine(watched_engine);
+					continue;
+				}
+
+				////////////////////////////////////////////
+
+				bool modified = false;
+
+				for (auto & script : watched_engine->m_loaded_scripts)
+				{
+					// Check if one of the the scripts has been modified.
+					if (script.second != fs::last_write_time(script.first, error_code) && !error_code)
+					{
+						modified = true;
+						break;
+					}
+				}
+
+				if (!modified)
+					continue;
+
+				////////////////////////////////////////////
+
+				reload_engine(watched_engine.get());
+
+				// The main script declares our tenants, so make sure they're up to date.
+				if (watched_engine.get() == default_engine)
+				{
+					reconcile_tenants();
+				}
+			}
+			 
+			//////////////////////////////////////////
+			 
+			if (wait_for != WAIT_TIMEOUT) 
+			{
+				change_notify_handle = FindFirstChangeNotificationW(
+					fs_directory.c_str(),
+					TRUE,
+					FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE
+				);
+			}
+
+			auto wait_for = WaitForSingleObject(
+				change_notify_handle, 
+				1000
+			); 
+
+			if (wait_for == WAIT_OBJECT_0)
+			{ 
+				Sleep(1000);
+
+				for (auto & watched_engine : get_engines())
+				{
+					EngineScope engine_scope(watched_engine.get());
+
+					directory_change_callback();
+				}
+			}
+		}	 
+		
+		//////////////////////////////////////////
+	}
+
+	/**
+	 * Creates various global objects and methods 
+	 * and creates a brand new context.
+	 */
+	v8::Local<v8::Context> create_shell_context()
+	{
+		// Setup isolate locker...
+		v8::Locker locker(isolate);
+		v8::Isolate::Scope isolate_scope(isolate);
+
+		// Setup our global module.
+		v8pp::module global(isolate);
+
+		// print(msg: any, ...): void
+		global.set("print", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			for (int i = 0; i < args.Length(); i++)
+			{
+				// Get the string provided by the user.
+				v8::String::Utf8Value const value(
+					isolate,
+					args[i]->ToDetailString(
+						args.GetIsolate()->GetCurrentContext()
+					).ToLocalChecked()
+				);
+
+				// Check if not first item.
+				if (i != 0) vs_printf(" ");
+
+				// Print contents provided.
+				vs_printf("%s", *value);
+			}
+
+			// Print a newline.
+			vs_printf("\n");
+		});
+
+		// load(fileName: String, ...): void
+		global.set("load", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			std::vector<fs::path> paths;
+
+			for (int i = 0; i < args.Length(); i++)
+			{
+				// Get the name of the file provided by the user.
+				auto name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[i]);
+
+				// Get the path to the file.
+				paths.push_back(
+					get_path(name)
+				);
+			}
+
+			// Start streaming all the files at once so that they're 
+			// compiled in parallel on the platform's worker threads.
+			for (auto & path : paths)
+			{
+				stream_file(path);
+			}
+
+			// Execute the files in v8 in order, each one only 
+			// waits for its own compilation to finish.
+			for (auto & path : paths)
+			{
+				execute_file(path);
+			}
+		});
+	
+		// [SIGNATURE 1]
+		// register(
+		//     type: CALLBACK_TYPES (Number),
+		//     callback: (Function(Response, Request): number)
+		// ): void
+		//
+		// [SIGNATURE 2]
+		// register(
+		//     callback: (Function(Response, Request): number)
+		// ): void
+		global.set("register", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1) throw std::exception("invalid function signature for register");
+
+			////////////////////////////////////////////////
+
+			// Get the generation of the context we're being called from.
+			auto generation = ENGINE_GENERATION;
+
+			if (!generation) throw std::exception("unable to register in a retired context");
+
+			////////////////////////////////////////////////
+
+			// Backwards compatibility for the older variant of the
+			// register function. Assumes that you want a BEGIN_REQUEST
+			// callback.
+			if (args.Length() == 1 && args[0]->IsFunction())
+			{
+				generation->m_function_begin_request.Reset(isolate, v8::Local<v8::Function>::Cast(args[0]));
+
+				// Update our mask if we're registering in the live generation.
+				if (generation == engine->m_live_generation.get())
+					engine->m_live_callback_mask = generation->callback_mask();
+
+				return;
+			}
+
+			////////////////////////////////////////////////
+			
+			if (!args[0]->IsNumber() || !args[1]->IsFunction()) 
+				throw std::exception("invalid function signature 2 for register");
+
+			////////////////////////////////////////////////
+
+			auto type = CALLBACK_TYPES(
+				v8pp::from_v8<int>(isolate, args[0])
+			);
+
+			////////////////////////////////////////////////
+			
+			switch (type) 
+			{
+			case BEGIN_REQUEST:
+				generation->m_function_begin_request.Reset(isolate, v8::Local<v8::Function>::Cast(args[1]));
+				break;
+			case SEND_RESPONSE:
+				generation->m_function_send_response.Reset(isolate, v8::Local<v8::Function>::Cast(args[1]));
+				break;
+			case PRE_BEGIN_REQUEST:
+				generation->m_function_pre_begin_request.Reset(isolate, v8::Local<v8::Function>::Cast(args[1]));
+				break;
+			default:
+				throw std::exception("invalid callback type for register");
+			}
+
+			////////////////////////////////////////////////
+
+			// Update our mask if we're registering in the live generation.
+			if (generation == engine->m_live_generation.get())
+				engine->m_live_callback_mask = generation->callback_mask();
+		});
+
+		// warmup(
+		//     requests: Object[] ({ method, url, headers, body, remoteAddress }),
+		//     options: Object {optional} ({ iterations, budget })
+		// ): void
+		global.set("warmup", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1 || !args[0]->IsArray()) 
+				throw std::exception("invalid function signature for warmup");
+
+			////////////////////////////////////////////////
+
+			auto generation = ENGINE_GENERATION;
+
+			if (!generation) throw std::exception("unable to warmup in a retired context");
+
+			////////////////////////////////////////////////
+
+			static const char* const kKeys[] =
+			{
+				"method",
+				"url",
+				"headers",
+				"body",
+				"remoteAddress",
+				"iterations",
+				"budget"
+			};
+
+			auto keys = find_or_create_eternal_name_cache(
+				kKeys,
+				kKeys,
+				std::size(kKeys)
+			);
+
+			auto context = isolate->GetCurrentContext();
+
+			auto get_value = [&](v8::Local<v8::Object> object, size_t key) {
+				v8::Local<v8::Value> value;
+
+				if (!object->Get(context, keys[key].Get(isolate)).ToLocal(&value))
+					throw std::exception("unable to get value.");
+
+				return value;
+			};
+
+			////////////////////////////////////////////////
+
+			auto requests = args[0].As<v8::Array>();
+
+			std::vector<WarmupRequest> warmup_requests;
+			warmup_requests.reserve(requests->Length());
+
+			for (uint32_t i = 0; i < requests->Length(); i++)
+			{
+				v8::Local<v8::Value> value;
+
+				if (!requests->Get(context, i).ToLocal(&value) || !value->IsObject())
+					throw std::exception("invalid request object for warmup");
+
+				auto object = value.As<v8::Object>();
+
+				////////////////////////////////////
+
+				WarmupRequest warmup_request;
+
+				warmup_request.m_method = v8pp::from_v8<std::string>(isolate, get_value(object, 0), "GET");
+				warmup_request.m_body = v8pp::from_v8<std::string>(isolate, get_value(object, 3), "");
+				warmup_request.m_remote_address = v8pp::from_v8<std::string>(isolate, get_value(object, 4), "127.0.0.1");
+
+				////////////////////////////////////
+
+				auto headers = get_value(object, 2);
+
+				if (headers->IsObject())
+				{
+					auto headers_object = headers.As<v8::Object>();
+					auto header_names = headers_object->GetOwnPropertyNames(context).ToLocalChecked();
+
+					for (uint32_t j = 0; j < header_names->Length(); j++)
+					{
+						auto header_name = header_names->Get(context, j).ToLocalChecked();
+						auto header_value = headers_object->Get(context, header_name).ToLocalChecked();
+
+						warmup_request.m_headers[WarmupRequest::header_key(v8pp::from_v8<std::string>(isolate, header_name))] = 
+							v8pp::from_v8<std::string>(isolate, header_value, "");
+					}
+				}
+
+				// The host is taken from the host header like IIS does.
+				auto host = warmup_request.m_headers.find("host");
+
+				if (host != warmup_request.m_headers.end())
+					warmup_request.m_host = std::wstring(host->second.begin(), host->second.end());
+
+				////////////////////////////////////
+
+				warmup_request.set_url(
+					v8pp::from_v8<std::wstring>(isolate, get_value(object, 1), L"/")
+				);
+
+				warmup_requests.push_back(std::move(warmup_request));
+			}
+
+			////////////////////////////////////////////////
+
+			if (args.Length() > 1 && args[1]->IsObject())
+			{
+				auto options = args[1].As<v8::Object>();
+
+				generation->m_warmup_iterations = v8pp::from_v8<int>(isolate, get_value(options, 5), generation->m_warmup_iterations);
+				generation->m_warmup_budget = v8pp::from_v8<int>(isolate, get_value(options, 6), generation->m_warmup_budget);
+			}
+
+			generation->m_warmup_requests = std::move(warmup_requests);
+		});
+
+		// defer(callback: Function): void
+		global.set("defer", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1 || !args[0]->IsFunction()) 
+				throw std::exception("invalid function signature for defer");
+
+			////////////////////////////////////////////////
+
+			reserve_deferred_task();
+
+			{
+				std::lock_guard<std::mutex> lock_guard(engine->m_deferred_tasks_lock);
+
+				engine->m_deferred_tasks.emplace_back(isolate, args[0].As<v8::Function>());
+			}
+
+			engine->m_deferred_queued++;
+			engine->m_deferred_tasks_cv.notify_one();
+		});
+
+		// tenant(
+		//     host: String,
+		//     script: String,
+		//     options: Object {optional} ({ heapLimit, cpuBudget, weight })
+		// ): void
+		global.set("tenant", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2 || !args[0]->IsString() || !args[1]->IsString()) 
+				throw std::exception("invalid function signature for tenant");
+
+			if (engine != default_engine)
+				throw std::exception("tenants can only be declared by the main script");
+
+			////////////////////////////////////////////////
+
+			auto generation = ENGINE_GENERATION;
+
+			if (!generation) throw std::exception("unable to declare a tenant in a retired context");
+
+			////////////////////////////////////////////////
+
+			TenantOptions tenant;
+			tenant.host = normalize_host(v8pp::from_v8<std::wstring>(isolate, args[0]));
+			tenant.script_name = v8pp::from_v8<std::wstring>(isolate, args[1]);
+
+			if (tenant.host.empty()) 
+				throw std::exception("invalid host for tenant");
+
+			for (auto & existing_tenant : generation->m_tenants)
+			{
+				if (existing_tenant.host == tenant.host)
+					throw std::exception("a tenant was already declared for this host");
+			}
+
+			////////////////////////////////////////////////
+
+			if (args.Length() > 2 && args[2]->IsObject())
+			{
+				static const char* const kKeys[] =
+				{
+					"heapLimit",
+					"cpuBudget",
+					"weight"
+				};
+
+				auto keys = find_or_create_eternal_name_cache(
+					kKeys,
+					kKeys,
+					std::size(kKeys)
+				);
+
+				auto context = isolate->GetCurrentContext();
+				auto options = args[2].As<v8::Object>();
+
+				auto get_number = [&](size_t key) {
+					v8::Local<v8::Value> value;
+
+					if (!options->Get(context, keys[key].Get(isolate)).ToLocal(&value))
+						throw std::exception("unable to get value.");
+
+					return pmax(v8pp::from_v8<double>(isolate, value, 0), 0.0);
+				};
+
+				// Our heap limit is given in megabytes.
+				tenant.heap_limit = size_t(get_number(0) * 1024 * 1024);
+				tenant.cpu_budget = int(get_number(1));
+				tenant.weight = pmax(int(get_number(2)), 1);
+			}
+
+			generation->m_tenants.push_back(std::move(tenant));
+		});
+
+		// metrics(): Object
+		global.set("metrics", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			auto context = isolate->GetCurrentContext();
+			auto metrics_object = create_engine_metrics(engine);
+
+			////////////////////////////////////////////////
+
+			// Only the main script gets to see the metrics of every tenant.
+			if (engine == default_engine)
+			{
+				auto tenants_object = v8::Object::New(isolate);
+
+				for (auto & tenant_engine : get_engines())
+				{
+					if (tenant_engine->m_retired || tenant_engine->m_host.empty())
+						continue;
+
+					tenants_object->Set(
+						context, 
+						v8pp::to_v8(isolate, tenant_engine->m_host), 
+						create_engine_metrics(tenant_engine.get())
+					).FromJust();
+				}
+
+				metrics_object->Set(context, v8pp::to_v8(isolate, "tenants"), tenants_object).FromJust();
+			}
+
+			args.GetReturnValue().Set(metrics_object);
+		});
+
+		global.set_const("BEGIN_REQUEST", 0);
+		global.set_const("SEND_RESPONSE", 1);
+		global.set_const("PRE_BEGIN_REQUEST", 2);
+		
+		global.set_const("CONTINUE", 0);
+		global.set_const("FINISH", 1);
+		
+		////////////////////////////////////////
+
+		// http Property
+		v8pp::module http_module(isolate);	
+
+		// http.fetch(
+		//	   hostname: String,
+		//	   path: String, 
+		//	   init: Object {optional},
+		// ): Promise
+		http_module.set("fetch", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2) 
+				throw std::exception("invalid function signature for http.fetch");
+
+			///////////////////////////////////////////////
+			
+			if (!args[0]->IsString() || !args[1]->IsString()) 
+				throw std::exception("invalid argument types for http.fetch");
+
+			///////////////////////////////////////////////
+
+			// Require Parameters
+			
+			auto hostname = v8pp::from_v8<std::string>(isolate, args[0]);
+			auto path = v8pp::from_v8<std::string>(isolate, args[1]);
+
+			///////////////////////////////////////////////
+
+			FetchRequest fetch_request(std::move(hostname), std::move(path));
+
+			///////////////////////////////////////////////
+			
+			if (args.Length() > 2 && args[2]->IsObject())
+			{
+				auto object = args[2].As<v8::Object>();
+				
+				////////////////////////////////////
+
+				static const char* const kKeys[] = 
+				{
+					"body",
+					"method",
+					"is_ssl",
+					"headers"
+				};
+
+				auto keys = find_or_create_eternal_name_cache(
+					kKeys, 
+					kKeys, 
+					std::size(kKeys)
+				);
+
+				////////////////////////////////////
+				
+				auto context = isolate->GetCurrentContext();
+				
+				////////////////////////////////////
+				
+				// "body" property //
+
+				{
+					v8::Local<v8::Value> value;
+
+					if (!object->Get(context, keys[0].Get(isolate)).ToLocal(&value))
+					{
+						throw std::exception("unable to get value.");
+					}
+
+					if (value->IsString())
+					{
+						fetch_request.body = v8pp::from_v8<std::string>(isolate, value);
+					}
+				}
+
+				////////////////////////////////////
+
+				// "method" property //
+
+				{
+					v8::Local<v8::Value> value;
+
+					if (!object->Get(context, keys[1].Get(isolate)).ToLocal(&value))
+					{
+						throw std::exception("unable to get value.");
+					}
+
+					if (value->IsString())
+					{
+						fetch_request.method = v8pp::from_v8<std::string>(isolate, value);
+					}
+				}
+
+				////////////////////////////////////
+
+				// "is_ssl" property //
+
+				{
+					v8::Local<v8::Value> value;
+
+					if (!object->Get(context, keys[2].Get(isolate)).ToLocal(&value))
+					{
+						throw std::exception("unable to get value.");
+					}
+
+					if (value->IsBoolean())
+					{
+						fetch_request.is_ssl = v8pp::from_v8<bool>(isolate, value);
+					}
+				}
+
+				////////////////////////////////////
+
+				// "headers" property //
+
+				{
+					v8::Local<v8::Value> value;
+
+					if (!object->Get(context, keys[3].Get(isolate)).ToLocal(&value))
+					{
 						throw std::exception("unable to get value.");
 					}
 
-					if (value->IsString())
-					{
-						fetch_request.method = v8pp::from_v8<std::string>(isolate, value);
-					}
+					if (value->IsObject())
+					{
+						auto object_value = value.As<v8::Object>();
+					
+						if (!object_value.IsEmpty())
+						{
+							auto prop_names = object_value->GetPropertyNames(context).ToLocalChecked();
+							
+							for (uint32_t i = 0, count = prop_names->Length(); i < count; ++i)
+							{
+								v8::Local<v8::Value> key = prop_names->Get(context, i).ToLocalChecked();
+								v8::Local<v8::Value> val = object_value->Get(context, key).ToLocalChecked();
+
+								fetch_request.headers.emplace(
+									v8pp::from_v8<std::string>(isolate, key),
+									v8pp::from_v8<std::string>(isolate, val)
+								);
+							}
+						}
+					}
+				}
+			} 
+
+			/////////////////////////////////////////////
+
+			// Wait until threads free up.
+			{
+				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+
+				thread_count++;
+			} 
+
+			/////////////////////////////////////////////
+
+			// Setup a resolver.
+			auto resolver = v8::Promise::Resolver::New(args.GetIsolate()->GetCurrentContext()).ToLocalChecked();
+			auto resolver_global = v8::Global<v8::Promise::Resolver>(args.GetIsolate(), resolver);
+
+			// Set the return value to our promise.
+			args.GetReturnValue().Set(
+				resolver_global.Get(isolate)->GetPromise()
+			);
+
+			// Our request thread.
+			std::thread request_thread([
+				resolver = std::move(resolver_global), 
+				fetch_request = std::move(fetch_request),
+				thread_engine = engine,
+				job = track_job()
+			] {
+				EngineScope engine_scope(thread_engine);
+
+				std::unique_ptr<httplib::Response> response;
+				 
+				if (fetch_request.is_ssl)
+				{
+					httplib::SSLClient client(fetch_request.hostname);
+					client.enable_server_certificate_verification(false);
+
+					if (fetch_request.method == "GET")
+					{
+						response = client.Get(fetch_request.path.c_str(), fetch_request.headers);
+					}
+
+					if (fetch_request.method == "POST")
+					{
+						response = client.Post(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
+					}
+
+					if (fetch_request.method == "HEAD")
+					{
+						response = client.Head(fetch_request.path.c_str(), fetch_request.headers);
+					}
+
+					if (fetch_request.method == "PUT")
+					{
+						response = client.Put(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
+					}
+					
+					if (fetch_request.method == "DELETE")
+					{
+						response = client.Delete(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
+					}
+
+					if (fetch_request.method == "OPTIONS")
+					{
+						response = client.Options(fetch_request.path.c_str(), fetch_request.headers);
+					}
+
+					if (fetch_request.method == "PATCH")
+					{
+						response = client.Patch(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body, nullptr);
+					}
+				}
+				else
+				{
+					httplib::Client client(fetch_request.hostname);	
+
+					if (fetch_request.method == "GET")
+					{
+						response = client.Get(fetch_request.path.c_str(), fetch_request.headers);
+					}
+
+					if (fetch_request.method == "POST")
+					{
+						response = client.Post(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
+					}
+
+					if (fetch_request.method == "HEAD")
+					{
+						response = client.Head(fetch_request.path.c_str(), fetch_request.headers);
+					}
+
+					if (fetch_request.method == "PUT")
+					{
+						response = client.Put(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
+					}
+
+					if (fetch_request.method == "DELETE")
+					{
+						response = client.Delete(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
+					}
+
+					if (fetch_request.method == "OPTIONS")
+					{
+						response = client.Options(fetch_request.path.c_str(), fetch_request.headers);
+					}
+
+					if (fetch_request.method == "PATCH")
+					{
+						response = client.Patch(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body, nullptr);
+					}
+				} 
+
+				////////////////////////////////////////////
+
+				// Decrement out thread count.
+				{
+					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+					thread_count--;
+				}
+
+				// Notify all waitees.
+				thread_count_cv.notify_one();
+				
+				////////////////////////////////////////////
+
+				// We should only lock once the request has finished.
+				v8::Locker locker(isolate);
+				v8::Isolate::Scope isolate_scope(isolate);
+				v8::HandleScope handle_scope(isolate);
+				v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
+
+				// Check if our request was successful.
+				if (!response)
+				{
+					resolver.Get(isolate)->Reject(
+						isolate->GetCurrentContext(),
+						v8pp::to_v8(isolate, "unable to fetch")
+					);
+					 
+					return;  
+				}
+
+				//////////////////////////////////
+
+				auto fetch_object = engine->m_global_fetch_object.Get(isolate)->Clone();
+
+				//////////////////////////////////
+
+				auto fetch_response = new FetchResponse(isolate, fetch_object, response.release());
+
+				//////////////////////////////////
+				
+				fetch_response->response_object.SetWeak(
+					fetch_response,
+					[](const v8::WeakCallbackInfo<FetchResponse>& data)
+					{
+						// Reset our JS object.
+						data.GetParameter()->response_object.Reset();
+
+						///////////////////////////////
+
+						// Decrement our external memory usage.
+						data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(
+							-data.GetParameter()->capacity()
+						);
+
+						///////////////////////////////
+
+						// Delete our object.
+						delete data.GetParameter();
+					},
+					v8::WeakCallbackType::kParameter
+				);
+
+				// Increment our external memory usage.
+				isolate->AdjustAmountOfExternalAllocatedMemory(
+					fetch_response->capacity()
+				);
+
+				//////////////////////////////////
+
+				resolver.Get(isolate)->Resolve(
+					isolate->GetCurrentContext(), 
+					fetch_object
+				);
+			});
+
+			request_thread.detach();
+		});
+
+		////////////////////////////////////////
+
+		// ipc Property
+		v8pp::module ipc_module(isolate); 
+
+		// ipc.init(
+		//     name: String, 
+		//     options: Object {optional} ({ engine, blockSize, blockCount, maxValueSize, maxMemory, persist, persistInterval, cache })
+		// ): IPCObject
+		ipc_module.set("init", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for ipc.init");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.init");
+
+			/////////////////////////////////////////////
+			 
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+			
+			/////////////////////////////////////////////
+
+			IPCOptions options;
+			size_t cache_size = 0;
+
+			if (args.Length() > 1 && args[1]->IsObject())
+			{
+				static const char* const kKeys[] =
+				{
+					"engine",
+					"blockSize",
+					"blockCount",
+					"maxValueSize",
+					"maxMemory",
+					"persist",
+					"persistInterval",
+					"cache"
+				};
+
+				auto keys = find_or_create_eternal_name_cache(
+					kKeys,
+					kKeys,
+					std::size(kKeys)
+				);
+
+				auto context = isolate->GetCurrentContext();
+				auto object = args[1].As<v8::Object>();
+
+				auto get_value = [&](size_t key) {
+					v8::Local<v8::Value> value;
+
+					if (!object->Get(context, keys[key].Get(isolate)).ToLocal(&value))
+						throw std::exception("unable to get value.");
+
+					return value;
+				};
+
+				options.engine = v8pp::from_v8<std::string>(isolate, get_value(0), options.engine);
+				options.block_size = v8pp::from_v8<uint32_t>(isolate, get_value(1), options.block_size);
+				options.block_count = v8pp::from_v8<uint32_t>(isolate, get_value(2), options.block_count);
+				options.max_value_size = v8pp::from_v8<uint32_t>(isolate, get_value(3), options.max_value_size);
+				options.max_memory = v8pp::from_v8<uint64_t>(isolate, get_value(4), options.max_memory);
+				options.persist_interval = v8pp::from_v8<uint64_t>(isolate, get_value(6), options.persist_interval);
+
+				auto persist = get_value(5);
+
+				if (persist->IsString())
+				{
+					auto persist_name = v8pp::from_v8<std::wstring>(isolate, persist);
+
+					options.persist_path = get_relative_file_path(persist_name).string();
+				}
+
+				auto cache = get_value(7);
+
+				if (cache->IsTrue())
+					cache_size = IPC_CACHE_SIZE;
+				else if (cache->IsNumber())
+					cache_size = v8pp::from_v8<uint32_t>(isolate, cache);
+
+				if (cache_size && options.engine == IPC_BACKEND_LOCKFREE)
+					throw std::exception("caching is not supported by the lockfree engine");
+			}
+
+			/////////////////////////////////////////////
+			
+			auto ipc_context = create_ipc_backend(name, options);
+
+			/////////////////////////////////////////////
+
+			auto ipc_object = engine->m_global_ipc_object.Get(isolate)->Clone();
+			auto ipc_handler = new IPCHandler(isolate, ipc_object, ipc_context.release(), cache_size);
+
+			engine->m_ipc_handlers.insert(ipc_handler);
+
+			//////////////////////////////////
+
+			ipc_handler->ipc_object.SetWeak(
+				ipc_handler,
+				[](const v8::WeakCallbackInfo<IPCHandler>& data)
+				{
+					// Reset our JS object.
+					data.GetParameter()->ipc_object.Reset();
+					engine->m_ipc_handlers.erase(data.GetParameter());
+
+					///////////////////////////////
+
+					// Decrement our external memory usage.
+					data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(
+						-(int64_t)sizeof(IPCHandler)
+					);
+
+					///////////////////////////////
+
+					// Delete our object.
+					delete data.GetParameter();
+				},
+				v8::WeakCallbackType::kParameter
+			);
+
+			//////////////////////////////////
+
+			// Increment our external memory usage.
+			isolate->AdjustAmountOfExternalAllocatedMemory(
+				(int64_t)sizeof(IPCHandler)
+			);
+
+			//////////////////////////////////
+
+			args.GetReturnValue().Set(
+				ipc_object
+			);
+		});
+
+		// ipc.sharedArray(
+		//     name: String, 
+		//     type: String ("int8", "uint8", "int16", "uint16", "int32", "uint32", "float32", "float64", "bigint64", "biguint64"), 
+		//     length: Number
+		// ): TypedArray
+		ipc_module.set("sharedArray", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 3)
+				throw std::exception("invalid function signature for ipc.sharedArray");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.sharedArray");
+
+			if (!args[1]->IsString())
+				throw std::exception("invalid second parameter, must be a string for ipc.sharedArray");
+
+			if (!args[2]->IsNumber())
+				throw std::exception("invalid third parameter, must be a number for ipc.sharedArray");
+
+			/////////////////////////////////////////////
+
+			static const char* const kTypes[] =
+			{
+				"int8",
+				"uint8",
+				"int16",
+				"uint16",
+				"int32",
+				"uint32",
+				"float32",
+				"float64",
+				"bigint64",
+				"biguint64"
+			};
+
+			static const size_t kTypeSizes[] = { 1, 1, 2, 2, 4, 4, 4, 8, 8, 8 };
+
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+			auto type_name = v8pp::from_v8<std::string>(isolate, args[1]);
+			auto length = v8pp::from_v8<double>(isolate, args[2]);
+
+			uint32_t type = 0;
+
+			while (type < std::size(kTypes) && type_name != kTypes[type])
+				type++;
+
+			if (type == std::size(kTypes))
+				throw std::exception("invalid type for ipc.sharedArray");
+
+			if (length < 1 || length != std::floor(length) || length * kTypeSizes[type] > v8::TypedArray::kMaxLength)
+				throw std::exception("invalid length for ipc.sharedArray");
+
+			/////////////////////////////////////////////
+
+			auto byte_length = (size_t)length * kTypeSizes[type];
+			auto data = map_shared_array(name, type, byte_length);
+
+			// Our buffer is externalized, so V8 never frees the mapping underneath it.
+			auto array_buffer = v8::SharedArrayBuffer::New(
+				isolate,
+				data,
+				byte_length,
+				v8::ArrayBufferCreationMode::kExternalized
+			);
+
+			/////////////////////////////////////////////
+
+			v8::Local<v8::TypedArray> typed_array;
+
+			switch (type)
+			{
+				case 0: typed_array = v8::Int8Array::New(array_buffer, 0, (size_t)length); break;
+				case 1: typed_array = v8::Uint8Array::New(array_buffer, 0, (size_t)length); break;
+				case 2: typed_array = v8::Int16Array::New(array_buffer, 0, (size_t)length); break;
+				case 3: typed_array = v8::Uint16Array::New(array_buffer, 0, (size_t)length); break;
+				case 4: typed_array = v8::Int32Array::New(array_buffer, 0, (size_t)length); break;
+				case 5: typed_array = v8::Uint32Array::New(array_buffer, 0, (size_t)length); break;
+				case 6: typed_array = v8::Float32Array::New(array_buffer, 0, (size_t)length); break;
+				case 7: typed_array = v8::Float64Array::New(array_buffer, 0, (size_t)length); break;
+				case 8: typed_array = v8::BigInt64Array::New(array_buffer, 0, (size_t)length); break;
+				case 9: typed_array = v8::BigUint64Array::New(array_buffer, 0, (size_t)length); break;
+			}
+
+			args.GetReturnValue().Set(typed_array);
+		});
+
+		// ipc.publish(channel: String, value: any): void
+		ipc_module.set("publish", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2)
+				throw std::exception("invalid function signature for ipc.publish");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.publish");
+
+			/////////////////////////////////////////////
+
+			auto channel = open_ipc_channel(v8pp::from_v8<std::string>(isolate, args[0]));
+
+			/////////////////////////////////////////////
+
+			thread_local std::vector<unsigned char> buffer;
+
+			if (!serialize_ipc_value(args[1], buffer))
+				throw std::exception("invalid object given, unable to serialize for ipc.publish");
+
+			channel->publish(buffer.data(), buffer.size());
+		});
+
+		// ipc.subscribe(channel: String, callback: Function): void
+		ipc_module.set("subscribe", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2)
+				throw std::exception("invalid function signature for ipc.subscribe");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.subscribe");
+
+			if (!args[1]->IsFunction())
+				throw std::exception("invalid second parameter, must be a function for ipc.subscribe");
+
+			////////////////////////////////////////////////
+
+			auto generation = ENGINE_GENERATION;
+
+			if (!generation) throw std::exception("unable to subscribe in a retired context");
+
+			////////////////////////////////////////////////
+
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+
+			{
+				std::lock_guard<std::mutex> lock_guard(engine->m_subscribers_lock);
+
+				if (engine->m_subscribers.find(name) == engine->m_subscribers.end())
+				{
+					auto subscriber = std::make_shared<IPCSubscriber>(open_ipc_channel(name));
+
+					std::thread subscriber_thread([subscriber, thread_engine = engine]() {
+						EngineScope engine_scope(thread_engine);
+
+						dispatch_channel_messages(subscriber);
+					});
+					subscriber_thread.detach();
+
+					engine->m_subscribers.emplace(name, subscriber);
+				}
+			}
+
+			generation->m_subscriptions.emplace_back(
+				name,
+				v8::Global<v8::Function>(isolate, args[1].As<v8::Function>())
+			);
+		});
+
+		// ipc.queue(
+		//     name: String, 
+		//     options: Object {optional} ({ visibilityTimeout })
+		// ): QueueObject
+		ipc_module.set("queue", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for ipc.queue");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.queue");
+
+			/////////////////////////////////////////////
+
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+
+			uint64_t visibility_timeout = IPC_QUEUE_VISIBILITY_TIMEOUT;
+
+			if (args.Length() > 1 && args[1]->IsObject())
+			{
+				static const char* const kKeys[] =
+				{
+					"visibilityTimeout"
+				};
+
+				auto keys = find_or_create_eternal_name_cache(
+					kKeys,
+					kKeys,
+					std::size(kKeys)
+				);
+
+				v8::Local<v8::Value> value;
+
+				if (!args[1].As<v8::Object>()->Get(isolate->GetCurrentContext(), keys[0].Get(isolate)).ToLocal(&value))
+					throw std::exception("unable to get value.");
+
+				visibility_timeout = v8pp::from_v8<uint64_t>(isolate, value, visibility_timeout);
+			}
+
+			/////////////////////////////////////////////
+
+			auto queue_object = engine->m_global_queue_object.Get(isolate)->Clone();
+			auto queue_handler = new IPCQueueHandler(isolate, queue_object, open_ipc_queue(name), visibility_timeout);
+
+			//////////////////////////////////
+
+			queue_handler->queue_object.SetWeak(
+				queue_handler,
+				[](const v8::WeakCallbackInfo<IPCQueueHandler>& data)
+				{
+					// Reset our JS object.
+					data.GetParameter()->queue_object.Reset();
+
+					///////////////////////////////
+
+					// Decrement our external memory usage.
+					data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(
+						-(int64_t)sizeof(IPCQueueHandler)
+					);
+
+					///////////////////////////////
+
+					// Delete our object.
+					delete data.GetParameter();
+				},
+				v8::WeakCallbackType::kParameter
+			);
+
+			//////////////////////////////////
+
+			// Increment our external memory usage.
+			isolate->AdjustAmountOfExternalAllocatedMemory(
+				(int64_t)sizeof(IPCQueueHandler)
+			);
+
+			//////////////////////////////////
+
+			args.GetReturnValue().Set(
+				queue_object
+			);
+		});
+
+		// ipc.hll(name: String): HyperLogLogObject
+		ipc_module.set("hll", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for ipc.hll");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.hll");
+
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+
+			args.GetReturnValue().Set(
+				create_sketch_object(engine->m_global_hll_object, open_ipc_hll(name))
+			);
+		});
+
+		// ipc.countMin(name: String, width: Number, depth: Number): CountMinObject
+		ipc_module.set("countMin", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 3)
+				throw std::exception("invalid function signature for ipc.countMin");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.countMin");
+
+			if (!args[1]->IsUint32() || !args[2]->IsUint32())
+				throw std::exception("invalid width or depth, must be positive integers for ipc.countMin");
+
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+			auto width = args[1].As<v8::Uint32>()->Value();
+			auto depth = args[2].As<v8::Uint32>()->Value();
+
+			args.GetReturnValue().Set(
+				create_sketch_object(engine->m_global_count_min_object, open_ipc_count_min(name, width, depth))
+			);
+		});
+
+		// ipc.bloom(name: String, bits: Number, hashes: Number): BloomObject
+		ipc_module.set("bloom", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 3)
+				throw std::exception("invalid function signature for ipc.bloom");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ipc.bloom");
+
+			if (!args[1]->IsUint32() || !args[2]->IsUint32())
+				throw std::exception("invalid bits or hashes, must be positive integers for ipc.bloom");
+
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+			auto bits = args[1].As<v8::Uint32>()->Value();
+			auto hashes = args[2].As<v8::Uint32>()->Value();
+
+			args.GetReturnValue().Set(
+				create_sketch_object(engine->m_global_bloom_object, open_ipc_bloom(name, bits, hashes))
+			);
+		});
+
+		////////////////////////////////////////
+
+		// ratelimit Property
+		v8pp::module ratelimit_module(isolate);
+
+		// ratelimit.create(
+		//     name: String,
+		//     options: Object ({ rate, burst, window, slots })
+		// ): RateLimiterObject
+		ratelimit_module.set("create", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2)
+				throw std::exception("invalid function signature for ratelimit.create");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for ratelimit.create");
+
+			if (!args[1]->IsObject())
+				throw std::exception("invalid second parameter, must be an object for ratelimit.create");
+
+			/////////////////////////////////////////////
+
+			static const char* const kKeys[] =
+			{
+				"rate",
+				"burst",
+				"window",
+				"slots"
+			};
+
+			auto keys = find_or_create_eternal_name_cache(
+				kKeys,
+				kKeys,
+				std::size(kKeys)
+			);
+
+			auto context = isolate->GetCurrentContext();
+			auto options = args[1].As<v8::Object>();
+
+			uint32_t limits[std::size(kKeys)] = { 0, 0, 0, IPC_RATE_LIMIT_SLOTS };
+
+			for (size_t i = 0; i < std::size(kKeys); i++)
+			{
+				v8::Local<v8::Value> value;
+
+				if (!options->Get(context, keys[i].Get(isolate)).ToLocal(&value))
+					throw std::exception("unable to get value.");
+
+				if (value->IsUndefined())
+					continue;
+
+				if (!value->IsUint32())
+					throw std::exception("invalid limits, must be positive integers for ratelimit.create");
+
+				limits[i] = value.As<v8::Uint32>()->Value();
+			}
+
+			/////////////////////////////////////////////
+
+			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
+
+			// A bucket holds a second worth of tokens unless it's told otherwise.
+			auto burst = limits[2] ? 0 : (limits[1] ? limits[1] : limits[0]);
+
+			args.GetReturnValue().Set(
+				create_rate_limiter_object(open_ipc_rate_limiter(name, limits[0], burst, limits[2], limits[3]))
+			);
+		});
+
+		////////////////////////////////////////
+		  
+		// fs Property 
+		v8pp::module fs_module(isolate);
+		    
+		// fs.register(callback: Function): void
+		fs_module.set("register", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1) throw std::exception("invalid function signature for fs.register");
+
+			////////////////////////////////////////////////
+
+			auto generation = ENGINE_GENERATION;
+
+			if (!generation) throw std::exception("unable to register in a retired context");
+
+			////////////////////////////////////////////////
+
+			generation->m_function_directory_change.Reset(isolate, v8::Local<v8::Function>::Cast(args[0]));
+		});
+
+		// fs.copy(existingFileName: String, newFileName: String, overwrite: boolean {optional, default: false}): boolean 
+		fs_module.set("copy", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2)
+				throw std::exception("invalid function signature for fs.copy");
+
+			if (!args[0]->IsString() || !args[1]->IsString())
+				throw std::exception("invalid first two parameters, must be both a string for fs.copy");
+
+			/////////////////////////////////////////////
+
+			auto existing_file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
+			auto existing_file_path = get_relative_file_path(existing_file_name);
+			
+			auto new_file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[1]);
+			auto new_file_path = get_relative_file_path(new_file_name);
+
+			auto overwrite = args.Length() > 2 && args[2]->IsBoolean() && v8pp::from_v8<bool>(args.GetIsolate(), args[2]);
+
+			/////////////////////////////////////////////
+
+			RETURN_THIS(
+				(bool)CopyFileW(existing_file_path.c_str(), new_file_path.c_str(), !overwrite)
+			)
+		});
+
+		// fs.exists(fileName: String): boolean 
+		fs_module.set("exists", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for fs.exists");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for fs.exists");
+
+			/////////////////////////////////////////////
+
+			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
+			auto file_path = get_relative_file_path(file_name);
+
+			/////////////////////////////////////////////
+
+			RETURN_THIS(
+				(bool)PathFileExistsW(file_path.c_str())
+			)
+		});
+
+		// fs.delete(fileName: String): boolean 
+		fs_module.set("delete", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for fs.delete");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for fs.delete");
+
+			/////////////////////////////////////////////
+
+			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
+			auto file_path = get_relative_file_path(file_name);
+
+			/////////////////////////////////////////////
+
+			RETURN_THIS(
+				(bool)DeleteFileW(file_path.c_str())
+			)
+		});
+
+		// fs.write(fileName: String, content: String || Uint8Array, append: boolean {optional, default: false}): void 
+		fs_module.set("write", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2)
+				throw std::exception("invalid function signature for fs.write");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for fs.write");
+
+			/////////////////////////////////////////////
+
+			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
+			auto file_path = get_relative_file_path(file_name);
+
+			// Whether or not we should simply append to our file
+			auto append = args.Length() > 2 && args[2]->IsBoolean() && v8pp::from_v8<bool>(args.GetIsolate(), args[2]);
+
+			/////////////////////////////////////////////
+
+			// Attempt to open a handle to the file.
+			auto file = _wfopen(file_path.c_str(), append ? L"ab" : L"wb");
+
+			// Throw an exception if we were unable to open the file.
+			if (file == nullptr)
+				throw std::exception("unable to open file handle.");
+
+			/////////////////////////////////////////////
+
+			if (args[1]->IsString())
+			{
+				// Get the utf8 value from our string.
+				v8::String::Utf8Value const utf8_string(isolate, args[1]);
+
+				// Write the contents of the string to the file.
+				fwrite(*utf8_string, sizeof(unsigned char), utf8_string.length(), file);
+			}
+			else if (args[1]->IsUint8Array())
+			{
+				// Get the uint8array buffer contents.
+				auto uint8array_buffer = args[1].As<v8::Uint8Array>()->Buffer()->GetContents();
+
+				// Write the contents of the buffer to the file.
+				fwrite(uint8array_buffer.Data(), sizeof(unsigned char), uint8array_buffer.ByteLength(), file);
+			}
+			else throw std::exception("invalid data type provided.");
+
+			// Close our handle to the file.
+			fclose(file);
+		});
+
+		// fs.read(fileName: String, asArray: bool {optional, default: false}): String || Uint8Array || null
+		fs_module.set("read", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for fs.read");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for fs.read");
+
+			/////////////////////////////////////////////
+			 
+			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
+			auto file_path = get_relative_file_path(file_name); 
+
+			/////////////////////////////////////////////
+
+			// Attempt to open a handle to the file.
+			auto file = _wfopen(file_path.c_str(), L"rb");
+
+			// Throw an exception if we were unable to open the file.
+			if (file == nullptr)
+				throw std::exception("unable to open file handle.");
+
+			/////////////////////////////////////////////
+
+			fseek(file, 0, SEEK_END);
+			size_t file_size = ftell(file);
+			rewind(file); 
+
+			/////////////////////////////////////////////
+
+			auto as_array = args.Length() > 1 && args[1]->IsBoolean() && v8pp::from_v8<bool>(args.GetIsolate(), args[1]);
+
+			if (as_array)
+			{
+				auto array_buffer = v8::ArrayBuffer::New(
+					isolate,
+					file_size
+				);
+
+				////////////////////////////////////////////////
+
+				fread(
+					array_buffer->GetContents().Data(), 
+					sizeof(unsigned char), 
+					file_size, 
+					file
+				);
+
+				////////////////////////////////////////////////
+
+				auto uint8_array = v8::Uint8Array::New(
+					array_buffer,
+					0,
+					file_size
+				);
+
+				////////////////////////////////////////////////
+
+				args.GetReturnValue().Set(
+					uint8_array
+				);
+			}
+			else
+			{
+				auto external_string = new ExternalString(file_size);
+
+				////////////////////////////////////////////////
+
+				fread(
+					(void*)external_string->data(),
+					sizeof(unsigned char),
+					file_size,
+					file 
+				);
+
+				////////////////////////////////////////////////
+
+				auto string = v8::String::NewExternalOneByte(isolate, external_string);
+
+				////////////////////////////////////////////////
+
+				args.GetReturnValue().Set(
+					string.ToLocalChecked()
+				);
+			}
+
+			fclose(file);
+		}); 
+
+		////////////////////////////////////////
+
+		// db Property 
+		v8pp::module db_module(isolate);
+		 
+		// db.init(connectionInfo: String): db Object
+		db_module.set("init", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for db.init");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for db.init");
+
+			/////////////////////////////////////////////
+
+			auto connection_info = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
+
+			/////////////////////////////////////////////
+
+			auto db_context = std::make_unique<DbContext>();
+			db_context.get()->session.open(connection_info);
+
+			//////////////////////////////////
+
+			auto db_object = engine->m_global_db_object.Get(isolate)->Clone();
+			auto db_handler = new DbHandler(isolate, db_object, db_context.release());
+
+			//////////////////////////////////
+
+			db_handler->db_object.SetWeak(
+				db_handler,
+				[](const v8::WeakCallbackInfo<DbHandler>& data)
+				{
+					// Reset our JS object.
+					data.GetParameter()->db_object.Reset();
+
+					///////////////////////////////
+
+					// Decrement our external memory usage.
+					isolate->AdjustAmountOfExternalAllocatedMemory(
+						-data.GetParameter()->capacity()
+					);
+
+					///////////////////////////////
+
+					// Delete our object.
+					delete data.GetParameter();
+				},
+				v8::WeakCallbackType::kParameter
+			);
+
+			//////////////////////////////////
+
+			// Increment our external memory usage.
+			isolate->AdjustAmountOfExternalAllocatedMemory(
+				db_handler->capacity()
+			);
+
+			//////////////////////////////////
+
+			args.GetReturnValue().Set(
+				db_object
+			);
+		});
+
+		db_module.set_const("STRING", 0);
+		db_module.set_const("INTEGER", 1);
+		db_module.set_const("DOUBLE", 2);
+		db_module.set_const("BOOL", 3);
+
+		////////////////////////////////////////
+
+		// gzip Property  
+		v8pp::module gzip_module(isolate);
+
+		// gzip.compress(input: String, compressionLevel: Integer {32-bit only, optional, default: 6}): Promise<Uint8Array>
+		gzip_module.set("compress", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for gzip.compress");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for gzip.compress");
+
+			auto string = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
+
+			/////////////////////////////////////////////
+			 
+			// Setup our default workload.
+			int compressionLevel = Z_DEFAULT_COMPRESSION;
+
+			// Check if we were provided a custom workload value. 
+			if (args.Length() > 1 && args[1]->IsInt32())
+			{
+				compressionLevel = std::max(
+					0, std::min(v8pp::from_v8<int>(args.GetIsolate(), args[1]), 9)
+				);
+			}
+
+			/////////////////////////////////////////////
+
+			// Wait until threads free up.
+			{
+				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+
+				thread_count++;
+			}
+
+			/////////////////////////////////////////////
+
+			// Setup a resolver.
+			auto resolver = v8::Promise::Resolver::New(
+				args.GetIsolate()->GetCurrentContext()
+			).ToLocalChecked();
+
+			// Setup a global resolver object.
+			auto resolver_global = v8::Global<v8::Promise::Resolver>(
+				args.GetIsolate(), resolver
+			);
+
+			/////////////////////////////////////////////
+
+			// Set the return value to our promise.
+			args.GetReturnValue().Set(
+				resolver_global.Get(isolate)->GetPromise()
+			);
+
+			std::thread gzip_thread([string = std::move(string), compressionLevel, resolver = std::move(resolver_global), thread_engine = engine, job = track_job()] {
+				EngineScope engine_scope(thread_engine);
+
+				// Setup an empty string because EXCEPTIONS! 
+				std::string compressed;
+
+				try 
+				{
+					compressed = gzip::compress(string.c_str(), string.length(), compressionLevel);
+				}
+				catch (std::exception & e) 
+				{
+					vs_printf("Exception at gzip.compress in gzip_thread (%s)\n", e.what());
+				} 
+
+				/////////////////////////////////////////////
+
+				// Decrement out thread count.
+				{
+					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+					thread_count--;
+				}
+				 
+				// Notify all waitees.
+				thread_count_cv.notify_one();
+
+				/////////////////////////////////////////////
+
+				v8::Locker locker(isolate);
+				v8::Isolate::Scope isolate_scope(isolate);
+				v8::HandleScope handle_scope(isolate);
+				v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
+
+				if (!compressed.empty())
+				{
+					auto array_buffer = v8::ArrayBuffer::New(
+						isolate,
+						compressed.size()
+					);
+
+					////////////////////////////////////////////////
+					
+					std::memcpy(
+						array_buffer->GetContents().Data(),
+						compressed.data(),
+						compressed.size()
+					);
+
+					////////////////////////////////////////////////
+
+					auto uint8_array = v8::Uint8Array::New(
+						array_buffer,
+						0,
+						compressed.size()
+					); 
+
+					////////////////////////////////////////////////
+
+					resolver.Get(isolate)->Resolve(
+						isolate->GetCurrentContext(),
+						uint8_array
+					);
 				}
+				else
+				{
+					resolver.Get(isolate)->Reject(
+						isolate->GetCurrentContext(),
+						v8pp::to_v8(isolate, "failed to compress using gzip.")
+					);
+				}			
+			}); 
 
-				////////////////////////////////////
+			gzip_thread.detach();
+		}); 
 
-				// "is_ssl" property //
+		// gzip.decompress(input: Uint8Array): Promise<String>
+		gzip_module.set("decompress", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for gzip.decompress");
+			 
+			if (!args[0]->IsUint8Array())
+				throw std::exception("invalid first parameter, must be a uint8array for gzip.decompress");
+
+			auto uint8array_contents = args[0].As<v8::Uint8Array>()->Buffer()->GetContents();
+
+			// Get the uint8array buffer contents.
+			auto buffer = uint8array_contents.Data();
+			auto length = uint8array_contents.ByteLength();
+
+			/////////////////////////////////////////////
+
+			// Wait until threads free up.
+			{
+				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+
+				thread_count++;
+			} 
+
+			/////////////////////////////////////////////
+
+			// Setup a resolver.
+			auto resolver = v8::Promise::Resolver::New(
+				args.GetIsolate()->GetCurrentContext()
+			).ToLocalChecked();
+
+			// Setup a global resolver object.
+			auto resolver_global = v8::Global<v8::Promise::Resolver>(
+				args.GetIsolate(), resolver
+			);
+
+			/////////////////////////////////////////////
+
+			// Set the return value to our promise.
+			args.GetReturnValue().Set(
+				resolver_global.Get(isolate)->GetPromise()
+			);
+
+			std::thread gzip_thread([buffer, length, resolver = std::move(resolver_global), thread_engine = engine, job = track_job()] {
+				EngineScope engine_scope(thread_engine);
+
+				std::string decompressed;
 
+				try 
 				{
-					v8::Local<v8::Value> value;
+					decompressed = gzip::decompress((const char*)buffer, length);
+				}
+				catch (std::exception & e) 
+				{
+					vs_printf("Exception at gzip.decompressed in gzip_thread (%s)\n", e.what());
+				} 
 
-					if (!object->Get(context, keys[2].Get(isolate)).ToLocal(&value))
-					{
-						throw std::exception("unable to get value.");
-					}
+				/////////////////////////////////////////////
 
-					if (value->IsBoolean())
-					{
-						fetch_request.is_ssl = v8pp::from_v8<bool>(isolate, value);
-					}
+				// Decrement out thread count.
+				{
+					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+					thread_count--;
 				}
+				 
+				// Notify all waitees.
+				thread_count_cv.notify_one();
 
-				////////////////////////////////////
+				/////////////////////////////////////////////
 
-				// "headers" property //
+				v8::Locker locker(isolate);
+				v8::Isolate::Scope isolate_scope(isolate);
+				v8::HandleScope handle_scope(isolate);
+				v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
+				 
+				if (!decompressed.empty())
+				{
+					resolver.Get(isolate)->Resolve(
+						isolate->GetCurrentContext(),
+						v8pp::to_v8(isolate, std::move(decompressed))
+					);
+				}
+				else
+				{
+					resolver.Get(isolate)->Reject(
+						isolate->GetCurrentContext(),
+						v8pp::to_v8(isolate, "failed to decompress using gzip.")
+					);
+				}			
+			}); 
+
+			gzip_thread.detach();
+		});
+
+		gzip_module.set_const("NO_COMPRESSION", 0);
+		gzip_module.set_const("BEST_SPEED", 1);
+		gzip_module.set_const("BEST_COMPRESSION", 9);
+
+		////////////////////////////////////////
+
+		// crypto Property  
+		v8pp::module crypto_module(isolate);
+		 
+		// bcrypt Module
+		v8pp::module bcrypt_module(isolate);
+
+		// Add our bcrypt module to the crypto module.
+		crypto_module.set_const("bcrypt", bcrypt_module);
+
+		// crypto.bcrypt.hash(input: String, workload: Integer {32-bit only, optional, default: 12}): Promise<String>
+		bcrypt_module.set("hash", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 1)
+				throw std::exception("invalid function signature for crypto.bcrypt");
+
+			if (!args[0]->IsString())
+				throw std::exception("invalid first parameter, must be a string for crypto.bcrypt");
+
+			/////////////////////////////////////////////
+
+			auto input = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
+
+			/////////////////////////////////////////////
+
+			// Setup our default workload.
+			int workload = 12;
+
+			// Check if we were provided a custom workload value.
+			if (args.Length() > 1 && args[1]->IsInt32())
+				workload = v8pp::from_v8<int>(args.GetIsolate(), args[1]);
+
+			/////////////////////////////////////////////
+
+			// Wait until threads free up.
+			{
+				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+
+				thread_count++;
+			}
 
+			/////////////////////////////////////////////
+
+			// Setup a resolver.
+			auto resolver = v8::Promise::Resolver::New(
+				args.GetIsolate()->GetCurrentContext()
+			).ToLocalChecked();
+
+			// Setup a global resolver object.
+			auto resolver_global = v8::Global<v8::Promise::Resolver>(
+				args.GetIsolate(), resolver
+			);
+
+			/////////////////////////////////////////////
+
+			// Set the return value to our promise.
+			args.GetReturnValue().Set(
+				resolver_global.Get(isolate)->GetPromise()
+			);
+
+			std::thread bcrypt_thread([workload, input_value = std::move(input), resolver = std::move(resolver_global), thread_engine = engine, job = track_job()] {
+				EngineScope engine_scope(thread_engine);
+
+				char salt[BCRYPT_HASHSIZE];
+				char hash[BCRYPT_HASHSIZE];
+
+				// Attempt to generate a salt.
+				int result = bcrypt_gensalt(workload, salt);
+
+				// Check if we were unable to generate the salt.
+				if (result != 0)
 				{
-					v8::Local<v8::Value> value;
+					goto finish;
+				}
 
-					if (!object->Get(context, keys[3].Get(isolate)).ToLocal(&value))
-					{
-						throw std::exception("unable to get value.");
-					}
+				/////////////////////////////////////////////
 
-					if (value->IsObject())
-					{
-						auto object_value = value.As<v8::Object>();
-					
-						if (!object_value.IsEmpty())
-						{
-							auto prop_names = object_value->GetPropertyNames(context).ToLocalChecked();
-							
-							for (uint32_t i = 0, count = prop_names->Length(); i < count; ++i)
-							{
-								v8::Local<v8::Value> key = prop_names->Get(context, i).ToLocalChecked();
-								v8::Local<v8::Value> val = object_value->Get(context, key).ToLocalChecked();
+				// Attempt to hash the password.
+				result = bcrypt_hashpw(input_value.c_str(), salt, hash);
 
-								fetch_request.headers.emplace(
-									v8pp::from_v8<std::string>(isolate, key),
-									v8pp::from_v8<std::string>(isolate, val)
-								);
-							}
-						}
-					}
+				// Check if we were unable to generate the hash.
+				if (result != 0)
+				{
+					goto finish;
+				}
+
+				/////////////////////////////////////////////
+
+			finish:
+
+				// Decrement out thread count.
+				{
+					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+					thread_count--;
+				}
+				 
+				// Notify all waitees.
+				thread_count_cv.notify_one();
+
+				/////////////////////////////////////////////
+
+				v8::Locker locker(isolate);
+				v8::Isolate::Scope isolate_scope(isolate);
+				v8::HandleScope handle_scope(isolate);
+				v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
+
+				if (result != 0)
+				{
+					resolver.Get(isolate)->Reject(
+						isolate->GetCurrentContext(),
+						v8pp::to_v8(isolate, "failed to generate bcrypt hash.")
+					);
+				}
+				else
+				{
+					// Resolve our promise.
+					resolver.Get(isolate)->Resolve(
+						isolate->GetCurrentContext(),
+						v8pp::to_v8(isolate, hash, strlen(hash))
+					);
 				}
-			} 
+			}); 
+
+			bcrypt_thread.detach();
+		});
+
+		// crypto.bcrypt.check(password: String, hash: String): Promise<bool>
+		bcrypt_module.set("check", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+			if (args.Length() < 2)
+				throw std::exception("invalid function signature for crypto.bcryptCompare");
+
+			if (!args[0]->IsString() || !args[1]->IsString())
+				throw std::exception("invalid first parameter, must be a string for crypto.bcryptCompare");
+
+			/////////////////////////////////////////////
+
+			auto password = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
+			auto hash = v8pp::from_v8<std::string>(args.GetIsolate(), args[1]);
 
 			/////////////////////////////////////////////
 
@@ -719,1114 +3846,1193 @@ namespace v8_wrapper
 				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
 
 				thread_count++;
-			} 
+			}
 
 			/////////////////////////////////////////////
 
 			// Setup a resolver.
-			auto resolver = v8::Promise::Resolver::New(args.GetIsolate()->GetCurrentContext()).ToLocalChecked();
-			auto resolver_global = v8::Global<v8::Promise::Resolver>(args.GetIsolate(), resolver);
+			auto resolver = v8::Promise::Resolver::New(
+				args.GetIsolate()->GetCurrentContext()
+			).ToLocalChecked();
+
+			// Setup a global resolver object.
+			auto resolver_global = v8::Global<v8::Promise::Resolver>(
+				args.GetIsolate(), resolver
+			);
+
+			/////////////////////////////////////////////
 
 			// Set the return value to our promise.
 			args.GetReturnValue().Set(
 				resolver_global.Get(isolate)->GetPromise()
 			);
 
-			// Our request thread.
-			std::thread request_thread([
-				resolver = std::move(resolver_global), 
-				fetch_request = std::move(fetch_request)
-			] {
-				std::unique_ptr<httplib::Response> response;
-				 
-				if (fetch_request.is_ssl)
+			std::thread bcrypt_thread([
+				input_password = std::move(password),
+				input_hash = std::move(hash),
+				resolver = std::move(resolver_global),
+				thread_engine = engine,
+				job = track_job()
+			]  
+			{
+				EngineScope engine_scope(thread_engine);
+
+				bool result = (bcrypt_checkpw(input_password.c_str(), input_hash.c_str()) == 0);
+
+				////////////////////////////////////////////
+
+				// Decrement out thread count.
 				{
-					httplib::SSLClient client(fetch_request.hostname);
-					client.enable_server_certificate_verification(false);
+					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
+					thread_count--;
+				}
 
-					if (fetch_request.method == "GET")
-					{
-						response = client.Get(fetch_request.path.c_str(), fetch_request.headers);
-					}
+				// Notify all waitees.
+				thread_count_cv.notify_one();
 
-					if (fetch_request.method == "POST")
-					{
-						response = client.Post(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
-					}
+				/////////////////////////////////////////////
 
-					if (fetch_request.method == "HEAD")
-					{
-						response = client.Head(fetch_request.path.c_str(), fetch_request.headers);
-					}
+				v8::Locker locker(isolate);
+				v8::Isolate::Scope isolate_scope(isolate);
+				v8::HandleScope handle_scope(isolate);
+				v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
 
-					if (fetch_request.method == "PUT")
-					{
-						response = client.Put(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
-					}
-					
-					if (fetch_request.method == "DELETE")
-					{
-						response = client.Delete(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
-					}
+				// Resolve our promise.
+				resolver.Get(isolate)->Resolve(
+					isolate->GetCurrentContext(),
+					v8pp::to_v8(isolate, result)
+				);
+			}); 
 
-					if (fetch_request.method == "OPTIONS")
-					{
-						response = client.Options(fetch_request.path.c_str(), fetch_request.headers);
-					}
+			bcrypt_thread.detach();
+		}); 
 
-					if (fetch_request.method == "PATCH")
-					{
-						response = client.Patch(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body, nullptr);
-					}
-				}
-				else
-				{
-					httplib::Client client(fetch_request.hostname);	
+		////////////////////////////////////////
 
-					if (fetch_request.method == "GET")
-					{
-						response = client.Get(fetch_request.path.c_str(), fetch_request.headers);
-					}
+		// ipc Object
+		global.set_const("ipc", ipc_module);
 
-					if (fetch_request.method == "POST")
-					{
-						response = client.Post(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
-					}
+		// ratelimit Object
+		global.set_const("ratelimit", ratelimit_module);
 
-					if (fetch_request.method == "HEAD")
-					{
-						response = client.Head(fetch_request.path.c_str(), fetch_request.headers);
-					}
+		// http Object
+		global.set_const("http", http_module);
 
-					if (fetch_request.method == "PUT")
-					{
-						response = client.Put(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
-					}
+		// fs Object
+		global.set_const("fs", fs_module);
 
-					if (fetch_request.method == "DELETE")
-					{
-						response = client.Delete(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body);
-					}
+		// db Object
+		global.set_const("db", db_module);
+		
+		// crypto Object
+		global.set_const("crypto", crypto_module);
+		
+		// gzip Object
+		global.set_const("gzip", gzip_module);
 
-					if (fetch_request.method == "OPTIONS")
-					{
-						response = client.Options(fetch_request.path.c_str(), fetch_request.headers);
-					}
+		////////////////////////////////////////
 
-					if (fetch_request.method == "PATCH")
-					{
-						response = client.Patch(fetch_request.path.c_str(), fetch_request.headers, fetch_request.body, nullptr);
-					}
-				} 
+		return v8::Context::New(isolate, nullptr, global.obj_);
+	}
 
-				////////////////////////////////////////////
+	/**
+	 * Initializes global objects.
+	 */
+	void initialize_objects(EngineGeneration * generation)
+	{
+		v8::Locker locker(isolate);
+		v8::Isolate::Scope isolate_scope(isolate);
+		v8::HandleScope handle_scope(isolate); 
+		v8::Context::Scope context_scope(generation->m_context.Get(isolate));
 
-				// Decrement out thread count.
-				{
-					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-					thread_count--;
-				}
 
-				// Notify all waitees.
-				thread_count_cv.notify_one();
-				
-				////////////////////////////////////////////
+		/////////////////////////////
+		//      IPC JS Object      //
+		/////////////////////////////
+		if (engine->m_global_ipc_object.IsEmpty())
+		{
+			// Setup our module...
+			v8pp::module module(isolate); 
 
-				// We should only lock once the request has finished.
-				v8::Locker locker(isolate);
-				v8::Isolate::Scope isolate_scope(isolate);
-				v8::HandleScope handle_scope(isolate);
-				v8::Context::Scope context_scope(context.Get(isolate));
+			// Setup our functions
 
-				// Check if our request was successful.
-				if (!response)
+			// ipc.set(key: String, value: any, options: Object {optional} ({ ttl })): void
+			module.set("set", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.set");
+
+				if (args.Length() < 2) 
+					throw std::exception("invalid function signature for ipc.set");
+			
+				if (!args[0]->IsString()) 
+					throw std::exception("invalid first parameter, must be a string for ipc.set");
+				 
+				/////////////////////////////////////////////
+
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
+
+				/////////////////////////////////////////////
+
+				uint64_t ttl = 0;
+
+				if (args.Length() > 2 && args[2]->IsObject())
 				{
-					resolver.Get(isolate)->Reject(
-						isolate->GetCurrentContext(),
-						v8pp::to_v8(isolate, "unable to fetch")
+					static const char* const kKeys[] =
+					{
+						"ttl"
+					};
+
+					auto keys = find_or_create_eternal_name_cache(
+						kKeys,
+						kKeys,
+						std::size(kKeys)
 					);
-					 
-					return;  
+
+					v8::Local<v8::Value> value;
+
+					if (!args[2].As<v8::Object>()->Get(isolate->GetCurrentContext(), keys[0].Get(isolate)).ToLocal(&value))
+						throw std::exception("unable to get value.");
+
+					ttl = v8pp::from_v8<uint64_t>(isolate, value, ttl);
 				}
 
-				//////////////////////////////////
+				/////////////////////////////////////////////
 
-				auto fetch_object = global_fetch_object.Get(isolate)->Clone();
+				// Reuse our buffer between calls since values can be of any size.
+				thread_local std::vector<unsigned char> buffer;
 
-				//////////////////////////////////
+				if (!serialize_ipc_value(args[1], buffer))
+					throw std::exception("invalid object given, unable to serialize for ipc.set");
 
-				auto fetch_response = new FetchResponse(isolate, fetch_object, response.release());
+				IPC_OBJECT->set(key, buffer.data(), buffer.size(), ttl);
+			});
 
-				//////////////////////////////////
-				
-				fetch_response->response_object.SetWeak(
-					fetch_response,
-					[](const v8::WeakCallbackInfo<FetchResponse>& data)
+			// ipc.setRaw(key: String, bytes: String || Uint8Array, options: Object {optional} ({ ttl })): void
+			module.set("setRaw", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.setRaw");
+
+				if (args.Length() < 2)
+					throw std::exception("invalid function signature for ipc.setRaw");
+
+				if (!args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for ipc.setRaw");
+
+				if (!args[1]->IsString() && !args[1]->IsUint8Array())
+					throw std::exception("invalid second parameter, must be a string or a uint8array for ipc.setRaw");
+
+				/////////////////////////////////////////////
+
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
+
+				/////////////////////////////////////////////
+
+				uint64_t ttl = 0;
+
+				if (args.Length() > 2 && args[2]->IsObject())
+				{
+					static const char* const kKeys[] =
 					{
-						// Reset our JS object.
-						data.GetParameter()->response_object.Reset();
+						"ttl"
+					};
 
-						///////////////////////////////
+					auto keys = find_or_create_eternal_name_cache(
+						kKeys,
+						kKeys,
+						std::size(kKeys)
+					);
 
-						// Decrement our external memory usage.
-						data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(
-							-data.GetParameter()->capacity()
-						);
+					v8::Local<v8::Value> value;
+
+					if (!args[2].As<v8::Object>()->Get(isolate->GetCurrentContext(), keys[0].Get(isolate)).ToLocal(&value))
+						throw std::exception("unable to get value.");
+
+					ttl = v8pp::from_v8<uint64_t>(isolate, value, ttl);
+				}
+
+				/////////////////////////////////////////////
+
+				// Strings are stored as UTF-8, so either way we end up with bytes which get reads back as a Uint8Array.
+				thread_local std::vector<unsigned char> buffer;
+
+				if (args[1]->IsString())
+				{
+					auto string = args[1].As<v8::String>();
+					auto length = string->Utf8Length(isolate);
+
+					buffer.resize(1 + (size_t)length);
+					string->WriteUtf8(isolate, (char*)buffer.data() + 1, length, nullptr, v8::String::NO_NULL_TERMINATION);
+				}
+				else
+				{
+					auto array = args[1].As<v8::Uint8Array>();
+
+					buffer.resize(1 + array->ByteLength());
+					array->CopyContents(buffer.data() + 1, array->ByteLength());
+				}
 
-						///////////////////////////////
+				buffer[0] = (unsigned char)IPCValueTag::Uint8Array;
 
-						// Delete our object.
-						delete data.GetParameter();
-					},
-					v8::WeakCallbackType::kParameter
-				);
+				IPC_OBJECT->set(key, buffer.data(), buffer.size(), ttl);
+			});
 
-				// Increment our external memory usage.
-				isolate->AdjustAmountOfExternalAllocatedMemory(
-					fetch_response->capacity()
-				);
+			// ipc.get(key: String): any || null
+			module.set("get", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.get");
+			
+				if (args.Length() < 1) 
+					throw std::exception("invalid function signature for ipc.get");
 
-				//////////////////////////////////
+				if (!args[0]->IsString()) 
+					throw std::exception("invalid first parameter, must be a string for ipc.get");
 
-				resolver.Get(isolate)->Resolve(
-					isolate->GetCurrentContext(), 
-					fetch_object
-				);
-			});
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-			request_thread.detach();
-		});
+				/////////////////////////////////////////////
 
-		////////////////////////////////////////
+				auto handler = IPC_HANDLER;
 
-		// ipc Property
-		v8pp::module ipc_module(isolate); 
+				// A cached value is handed out as long as nobody has written its key since, which
+				// only takes a couple of atomic reads of shared memory rather than the lock.
+				if (handler->m_cache_size)
+				{
+					auto cached_value = handler->m_cache.find(key);
 
-		// ipc.init(name: String): IPCObject
-		ipc_module.set("init", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for db.init");
+					if (cached_value != handler->m_cache.end())
+					{
+						if (IPC_OBJECT->is_current(cached_value->second.version))
+						{
+							args.GetReturnValue().Set(cached_value->second.value.Get(isolate));
+							return;
+						}
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for db.init");
+						handler->m_cache.erase(cached_value);
+					}
+				}
 
-			/////////////////////////////////////////////
-			 
-			auto name = v8pp::from_v8<std::string>(isolate, args[0]);
-			
-			/////////////////////////////////////////////
-			
-			auto ipc_context = std::make_unique<IPC_KV>(name.c_str());
+				/////////////////////////////////////////////
 
-			/////////////////////////////////////////////
+				// Reuse our buffer between calls since values can be of any size.
+				thread_local std::vector<unsigned char> buffer;
 
-			auto ipc_object = global_ipc_object.Get(isolate)->Clone();
-			auto ipc_handler = new IPCHandler(isolate, ipc_object, ipc_context.release());
+				/////////////////////////////////////////////
 
-			//////////////////////////////////
+				IPCNumber number;
+				IPCVersion version;
 
-			ipc_handler->ipc_object.SetWeak(
-				ipc_handler,
-				[](const v8::WeakCallbackInfo<IPCHandler>& data)
+				bool result = IPC_OBJECT->get(key, buffer, &number, handler->m_cache_size ? &version : nullptr);
+
+				if (!result) RETURN_NULL
+
+				// Numbers are cheaper to read than to check, so they're never cached.
+				if (number.kind != IPCKind::Bytes)
 				{
-					// Reset our JS object.
-					data.GetParameter()->ipc_object.Reset();
+					args.GetReturnValue().Set(from_ipc_number(number));
+					return;
+				}
 
-					///////////////////////////////
+				/////////////////////////////////////////////
 
-					// Decrement our external memory usage.
-					data.GetIsolate()->AdjustAmountOfExternalAllocatedMemory(
-						-(int64_t)sizeof(IPC_KV)
-					);
+				auto value = deserialize_ipc_value(buffer);
 
-					///////////////////////////////
+				if (handler->m_cache_size)
+					handler->cache(isolate, key, version, value);
 
-					// Delete our object.
-					delete data.GetParameter();
-				},
-				v8::WeakCallbackType::kParameter
-			);
+				args.GetReturnValue().Set(value); 
+			});
 
-			//////////////////////////////////
+			// ipc.getMany(keys: Array<String>): Array<any || null>
+			module.set("getMany", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.getMany");
 
-			// Increment our external memory usage.
-			isolate->AdjustAmountOfExternalAllocatedMemory(
-				(int64_t)sizeof(IPC_KV)
-			);
+				if (args.Length() < 1 || !args[0]->IsArray())
+					throw std::exception("invalid first parameter, must be an array for ipc.getMany");
 
-			//////////////////////////////////
+				auto context = isolate->GetCurrentContext();
+				auto keys_array = args[0].As<v8::Array>();
 
-			args.GetReturnValue().Set(
-				ipc_object
-			);
-		});
+				/////////////////////////////////////////////
 
-		////////////////////////////////////////
-		  
-		// fs Property 
-		v8pp::module fs_module(isolate);
-		    
-		// fs.register(callback: Function): void
-		fs_module.set("register", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1) throw std::exception("invalid function signature for fs.register");
+				std::vector<std::string> keys(keys_array->Length());
 
-			////////////////////////////////////////////////
+				for (uint32_t i = 0; i < keys.size(); i++)
+				{
+					v8::Local<v8::Value> key;
 
-			function_directory_change.Reset(isolate, v8::Local<v8::Function>::Cast(args[0]));
-		});
+					if (!keys_array->Get(context, i).ToLocal(&key) || !key->IsString())
+						throw std::exception("invalid key, must be a string for ipc.getMany");
 
-		// fs.copy(existingFileName: String, newFileName: String, overwrite: boolean {optional, default: false}): boolean 
-		fs_module.set("copy", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 2)
-				throw std::exception("invalid function signature for fs.copy");
+					keys[i] = v8pp::from_v8<std::string>(isolate, key);
+				}
 
-			if (!args[0]->IsString() || !args[1]->IsString())
-				throw std::exception("invalid first two parameters, must be both a string for fs.copy");
+				/////////////////////////////////////////////
 
-			/////////////////////////////////////////////
+				// Reuse our buffers between calls since values can be of any size.
+				thread_local std::vector<IPCValue> values;
 
-			auto existing_file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
-			auto existing_file_path = get_relative_file_path(existing_file_name);
-			
-			auto new_file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[1]);
-			auto new_file_path = get_relative_file_path(new_file_name);
+				IPC_OBJECT->get_many(keys, values);
 
-			auto overwrite = args.Length() > 2 && args[2]->IsBoolean() && v8pp::from_v8<bool>(args.GetIsolate(), args[2]);
+				/////////////////////////////////////////////
 
-			/////////////////////////////////////////////
+				auto result = v8::Array::New(isolate, (int)keys.size());
 
-			RETURN_THIS(
-				(bool)CopyFileW(existing_file_path.c_str(), new_file_path.c_str(), !overwrite)
-			)
-		});
+				for (uint32_t i = 0; i < keys.size(); i++)
+				{
+					auto& value = values[i];
 
-		// fs.exists(fileName: String): boolean 
-		fs_module.set("exists", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for fs.exists");
+					if (!value.found)
+						result->Set(context, i, v8::Null(isolate)).FromJust();
+					else if (value.number.kind != IPCKind::Bytes)
+						result->Set(context, i, from_ipc_number(value.number)).FromJust();
+					else
+						result->Set(context, i, deserialize_ipc_value(value.data)).FromJust();
+				}
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for fs.exists");
+				args.GetReturnValue().Set(result);
+			});
 
-			/////////////////////////////////////////////
+			// ipc.setMany(
+			//     entries: Object || Array<[String, any]>, 
+			//     options: Object {optional} ({ ttl })
+			// ): void
+			module.set("setMany", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.setMany");
 
-			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
-			auto file_path = get_relative_file_path(file_name);
+				if (args.Length() < 1 || !args[0]->IsObject())
+					throw std::exception("invalid first parameter, must be an object or an array for ipc.setMany");
 
-			/////////////////////////////////////////////
+				auto context = isolate->GetCurrentContext();
 
-			RETURN_THIS(
-				(bool)PathFileExistsW(file_path.c_str())
-			)
-		});
+				/////////////////////////////////////////////
 
-		// fs.delete(fileName: String): boolean 
-		fs_module.set("delete", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for fs.delete");
+				uint64_t ttl = 0;
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for fs.delete");
+				if (args.Length() > 1 && args[1]->IsObject())
+				{
+					static const char* const kKeys[] =
+					{
+						"ttl"
+					};
 
-			/////////////////////////////////////////////
+					auto keys = find_or_create_eternal_name_cache(
+						kKeys,
+						kKeys,
+						std::size(kKeys)
+					);
 
-			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
-			auto file_path = get_relative_file_path(file_name);
+					v8::Local<v8::Value> value;
 
-			/////////////////////////////////////////////
+					if (!args[1].As<v8::Object>()->Get(context, keys[0].Get(isolate)).ToLocal(&value))
+						throw std::exception("unable to get value.");
 
-			RETURN_THIS(
-				(bool)DeleteFileW(file_path.c_str())
-			)
-		});
+					ttl = v8pp::from_v8<uint64_t>(isolate, value, ttl);
+				}
 
-		// fs.write(fileName: String, content: String || Uint8Array, append: boolean {optional, default: false}): void 
-		fs_module.set("write", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 2)
-				throw std::exception("invalid function signature for fs.write");
+				/////////////////////////////////////////////
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for fs.write");
+				std::vector<IPCWrite> writes;
+				std::vector<std::vector<unsigned char>> buffers;
 
-			/////////////////////////////////////////////
+				auto add_entry = [&](v8::Local<v8::Value> key, v8::Local<v8::Value> value) {
+					if (!key->IsString())
+						throw std::exception("invalid key, must be a string for ipc.setMany");
 
-			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
-			auto file_path = get_relative_file_path(file_name);
+					std::vector<unsigned char> buffer;
 
-			// Whether or not we should simply append to our file
-			auto append = args.Length() > 2 && args[2]->IsBoolean() && v8pp::from_v8<bool>(args.GetIsolate(), args[2]);
+					if (!serialize_ipc_value(value, buffer))
+						throw std::exception("invalid object given, unable to serialize for ipc.setMany");
 
-			/////////////////////////////////////////////
+					IPCWrite write;
+					write.key = v8pp::from_v8<std::string>(isolate, key);
+					write.data = nullptr;
+					write.size = buffer.size();
 
-			// Attempt to open a handle to the file.
-			auto file = _wfopen(file_path.c_str(), append ? L"ab" : L"wb");
+					writes.push_back(write);
+					buffers.push_back(std::move(buffer));
+				};
 
-			// Throw an exception if we were unable to open the file.
-			if (file == nullptr)
-				throw std::exception("unable to open file handle.");
+				/////////////////////////////////////////////
 
-			/////////////////////////////////////////////
+				if (args[0]->IsArray())
+				{
+					auto entries = args[0].As<v8::Array>();
 
-			if (args[1]->IsString())
-			{
-				// Get the utf8 value from our string.
-				v8::String::Utf8Value const utf8_string(isolate, args[1]);
+					for (uint32_t i = 0; i < entries->Length(); i++)
+					{
+						v8::Local<v8::Value> entry;
 
-				// Write the contents of the string to the file.
-				fwrite(*utf8_string, sizeof(unsigned char), utf8_string.length(), file);
-			}
-			else if (args[1]->IsUint8Array())
-			{
-				// Get the uint8array buffer contents.
-				auto uint8array_buffer = args[1].As<v8::Uint8Array>()->Buffer()->GetContents();
+						if (!entries->Get(context, i).ToLocal(&entry) || !entry->IsArray())
+							throw std::exception("invalid entry, must be a [key, value] array for ipc.setMany");
 
-				// Write the contents of the buffer to the file.
-				fwrite(uint8array_buffer.Data(), sizeof(unsigned char), uint8array_buffer.ByteLength(), file);
-			}
-			else throw std::exception("invalid data type provided.");
+						auto pair = entry.As<v8::Array>();
 
-			// Close our handle to the file.
-			fclose(file);
-		});
+						add_entry(
+							pair->Get(context, 0).ToLocalChecked(),
+							pair->Get(context, 1).ToLocalChecked()
+						);
+					}
+				}
+				else
+				{
+					auto object = args[0].As<v8::Object>();
+					auto names = object->GetOwnPropertyNames(context).ToLocalChecked();
 
-		// fs.read(fileName: String, asArray: bool {optional, default: false}): String || Uint8Array || null
-		fs_module.set("read", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for fs.read");
+					for (uint32_t i = 0; i < names->Length(); i++)
+					{
+						auto name = names->Get(context, i).ToLocalChecked();
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for fs.read");
+						add_entry(
+							name,
+							object->Get(context, name).ToLocalChecked()
+						);
+					}
+				}
 
-			/////////////////////////////////////////////
-			 
-			auto file_name = v8pp::from_v8<std::wstring>(args.GetIsolate(), args[0]);
-			auto file_path = get_relative_file_path(file_name); 
+				// Our buffers are only done moving around once every entry is in.
+				for (size_t i = 0; i < writes.size(); i++)
+					writes[i].data = buffers[i].data();
 
-			/////////////////////////////////////////////
+				IPC_OBJECT->set_many(writes, ttl);
+			});
 
-			// Attempt to open a handle to the file.
-			auto file = _wfopen(file_path.c_str(), L"rb");
+			// ipc.removeMany(keys: Array<String>): Number
+			module.set("removeMany", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.removeMany");
 
-			// Throw an exception if we were unable to open the file.
-			if (file == nullptr)
-				throw std::exception("unable to open file handle.");
+				if (args.Length() < 1 || !args[0]->IsArray())
+					throw std::exception("invalid first parameter, must be an array for ipc.removeMany");
 
-			/////////////////////////////////////////////
+				auto context = isolate->GetCurrentContext();
+				auto keys_array = args[0].As<v8::Array>();
 
-			fseek(file, 0, SEEK_END);
-			size_t file_size = ftell(file);
-			rewind(file); 
+				std::vector<std::string> keys(keys_array->Length());
 
-			/////////////////////////////////////////////
+				for (uint32_t i = 0; i < keys.size(); i++)
+				{
+					v8::Local<v8::Value> key;
 
-			auto as_array = args.Length() > 1 && args[1]->IsBoolean() && v8pp::from_v8<bool>(args.GetIsolate(), args[1]);
+					if (!keys_array->Get(context, i).ToLocal(&key) || !key->IsString())
+						throw std::exception("invalid key, must be a string for ipc.removeMany");
 
-			if (as_array)
-			{
-				auto array_buffer = v8::ArrayBuffer::New(
-					isolate,
-					file_size
-				);
+					keys[i] = v8pp::from_v8<std::string>(isolate, key);
+				}
 
-				////////////////////////////////////////////////
+				RETURN_THIS((double)IPC_OBJECT->remove_many(keys))
+			});
 
-				fread(
-					array_buffer->GetContents().Data(), 
-					sizeof(unsigned char), 
-					file_size, 
-					file
-				);
+			// ipc.keys(prefix: String {optional}, limit: Number {optional}): Array<String>
+			module.set("keys", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.keys");
+
+				std::string prefix;
+				size_t limit = 0;
+
+				if (args.Length() > 0 && !args[0]->IsNullOrUndefined())
+				{
+					if (!args[0]->IsString())
+						throw std::exception("invalid first parameter, must be a string for ipc.keys");
 
-				////////////////////////////////////////////////
+					prefix = v8pp::from_v8<std::string>(isolate, args[0]);
+				}
 
-				auto uint8_array = v8::Uint8Array::New(
-					array_buffer,
-					0,
-					file_size
-				);
+				if (args.Length() > 1 && !args[1]->IsNullOrUndefined())
+				{
+					if (!args[1]->IsNumber() || args[1].As<v8::Number>()->Value() < 0)
+						throw std::exception("invalid second parameter, must be a positive number for ipc.keys");
 
-				////////////////////////////////////////////////
+					limit = (size_t)args[1].As<v8::Number>()->Value();
+				}
 
 				args.GetReturnValue().Set(
-					uint8_array
+					v8pp::to_v8(isolate, IPC_OBJECT->keys(prefix, limit))
 				);
-			}
-			else
-			{
-				auto external_string = new ExternalString(file_size);
-
-				////////////////////////////////////////////////
+			});
 
-				fread(
-					(void*)external_string->data(),
-					sizeof(unsigned char),
-					file_size,
-					file 
-				);
+			// ipc.scan(cursor: Number, count: Number {optional}, prefix: String {optional}): Object ({ cursor, keys })
+			module.set("scan", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.scan");
 
-				////////////////////////////////////////////////
+				if (args.Length() < 1 || !args[0]->IsNumber() || args[0].As<v8::Number>()->Value() < 0)
+					throw std::exception("invalid first parameter, must be a positive number for ipc.scan");
 
-				auto string = v8::String::NewExternalOneByte(isolate, external_string);
+				auto cursor = (uint64_t)args[0].As<v8::Number>()->Value();
+				size_t count = IPC_SCAN_COUNT;
+				std::string prefix;
 
-				////////////////////////////////////////////////
+				if (args.Length() > 1 && !args[1]->IsNullOrUndefined())
+				{
+					if (!args[1]->IsNumber() || args[1].As<v8::Number>()->Value() < 1)
+						throw std::exception("invalid second parameter, must be a positive number for ipc.scan");
 
-				args.GetReturnValue().Set(
-					string.ToLocalChecked()
-				);
-			}
+					count = (size_t)args[1].As<v8::Number>()->Value();
+				}
 
-			fclose(file);
-		}); 
+				if (args.Length() > 2 && !args[2]->IsNullOrUndefined())
+				{
+					if (!args[2]->IsString())
+						throw std::exception("invalid third parameter, must be a string for ipc.scan");
 
-		////////////////////////////////////////
+					prefix = v8pp::from_v8<std::string>(isolate, args[2]);
+				}
 
-		// db Property 
-		v8pp::module db_module(isolate);
-		 
-		// db.init(connectionInfo: String): db Object
-		db_module.set("init", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for db.init");
+				std::vector<std::string> keys;
+				cursor = IPC_OBJECT->scan(cursor, count, keys, prefix);
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for db.init");
+				auto context = isolate->GetCurrentContext();
 
-			/////////////////////////////////////////////
+				auto scan_object = v8::Object::New(isolate);
+				scan_object->Set(context, v8pp::to_v8(isolate, "cursor"), v8pp::to_v8(isolate, double(cursor))).FromJust();
+				scan_object->Set(context, v8pp::to_v8(isolate, "keys"), v8pp::to_v8(isolate, keys)).FromJust();
 
-			auto connection_info = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
+				args.GetReturnValue().Set(scan_object);
+			});
 
-			/////////////////////////////////////////////
+			// ipc.version(key: String): Number
+			module.set("version", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.version");
 
-			auto db_context = std::make_unique<DbContext>();
-			db_context.get()->session.open(connection_info);
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for ipc.version");
 
-			//////////////////////////////////
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-			auto db_object = global_db_object.Get(isolate)->Clone();
-			auto db_handler = new DbHandler(isolate, db_object, db_context.release());
+				RETURN_THIS((double)IPC_OBJECT->version(key))
+			});
 
-			//////////////////////////////////
+			// ipc.wait(key: String, lastVersion: Number, timeout: Number): Promise<Number>
+			module.set("wait", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.wait");
 
-			db_handler->db_object.SetWeak(
-				db_handler,
-				[](const v8::WeakCallbackInfo<DbHandler>& data)
-				{
-					// Reset our JS object.
-					data.GetParameter()->db_object.Reset();
+				if (args.Length() < 3)
+					throw std::exception("invalid function signature for ipc.wait");
 
-					///////////////////////////////
+				if (!args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for ipc.wait");
 
-					// Decrement our external memory usage.
-					isolate->AdjustAmountOfExternalAllocatedMemory(
-						-data.GetParameter()->capacity()
-					);
+				if (!args[1]->IsNumber())
+					throw std::exception("invalid second parameter, must be a number for ipc.wait");
 
-					///////////////////////////////
+				if (!args[2]->IsNumber() || args[2].As<v8::Number>()->Value() < 0)
+					throw std::exception("invalid third parameter, must be a positive number for ipc.wait");
 
-					// Delete our object.
-					delete data.GetParameter();
-				},
-				v8::WeakCallbackType::kParameter
-			);
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
+				auto last_version = (int64_t)args[1].As<v8::Number>()->Value();
+				auto timeout = (int64_t)args[2].As<v8::Number>()->Value();
 
-			//////////////////////////////////
+				auto handler = IPC_HANDLER;
+				auto backend = IPC_OBJECT;
 
-			// Increment our external memory usage.
-			isolate->AdjustAmountOfExternalAllocatedMemory(
-				db_handler->capacity()
-			);
+				// We watch our key before looking at it, so that a change in between still wakes us.
+				backend->watch(key);
 
-			//////////////////////////////////
+				auto version = backend->version(key);
+				auto resolver = v8::Promise::Resolver::New(isolate->GetCurrentContext()).ToLocalChecked();
 
-			args.GetReturnValue().Set(
-				db_object
-			);
-		});
+				args.GetReturnValue().Set(resolver->GetPromise());
 
-		db_module.set_const("STRING", 0);
-		db_module.set_const("INTEGER", 1);
-		db_module.set_const("DOUBLE", 2);
-		db_module.set_const("BOOL", 3);
+				if (version != last_version || timeout == 0)
+				{
+					backend->unwatch(key);
+					resolver->Resolve(isolate->GetCurrentContext(), v8pp::to_v8(isolate, (double)version));
 
-		////////////////////////////////////////
+					return;
+				}
 
-		// gzip Property  
-		v8pp::module gzip_module(isolate);
+				/////////////////////////////////////////////
 
-		// gzip.compress(input: String, compressionLevel: Integer {32-bit only, optional, default: 6}): Promise<Uint8Array>
-		gzip_module.set("compress", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for gzip.compress");
+				{
+					std::lock_guard<std::mutex> lock_guard(handler->m_waits_lock);
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for gzip.compress");
+					IPCPendingWait wait;
+					wait.id = handler->m_next_wait_id++;
+					wait.key = key;
+					wait.version = last_version;
+					wait.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+					wait.resolver.Reset(isolate, resolver);
 
-			auto string = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
+					handler->m_waits.push_back(std::move(wait));
 
-			/////////////////////////////////////////////
-			 
-			// Setup our default workload.
-			int compressionLevel = Z_DEFAULT_COMPRESSION;
+					if (!handler->m_waiting)
+					{
+						handler->m_waiting = true;
+						handler->m_waits_owner.Reset(isolate, args.This());
 
-			// Check if we were provided a custom workload value. 
-			if (args.Length() > 1 && args[1]->IsInt32())
-			{
-				compressionLevel = std::max(
-					0, std::min(v8pp::from_v8<int>(args.GetIsolate(), args[1]), 9)
-				);
-			}
+						std::thread wait_thread([handler, thread_engine = engine]() {
+							EngineScope engine_scope(thread_engine);
 
-			/////////////////////////////////////////////
+							dispatch_ipc_waits(handler);
+						});
+						wait_thread.detach();
+					}
+				}
 
-			// Wait until threads free up.
-			{
-				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+				// Our thread might be asleep with an earlier deadline than ours.
+				backend->wake();
+			});
 
-				thread_count++;
-			}
+			// ipc.incr(key: String, delta: Number {optional}): Number
+			module.set("incr", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.incr");
 
-			/////////////////////////////////////////////
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for ipc.incr");
 
-			// Setup a resolver.
-			auto resolver = v8::Promise::Resolver::New(
-				args.GetIsolate()->GetCurrentContext()
-			).ToLocalChecked();
+				IPCNumber delta;
+				delta.integer = 1;
 
-			// Setup a global resolver object.
-			auto resolver_global = v8::Global<v8::Promise::Resolver>(
-				args.GetIsolate(), resolver
-			);
+				if (args.Length() > 1 && !args[1]->IsUndefined())
+					delta = to_ipc_number(args[1]);
 
-			/////////////////////////////////////////////
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-			// Set the return value to our promise.
-			args.GetReturnValue().Set(
-				resolver_global.Get(isolate)->GetPromise()
-			);
+				args.GetReturnValue().Set(
+					from_ipc_number(IPC_OBJECT->increment(key, delta))
+				);
+			});
 
-			std::thread gzip_thread([string = std::move(string), compressionLevel, resolver = std::move(resolver_global)] {
-				// Setup an empty string because EXCEPTIONS! 
-				std::string compressed;
+			// ipc.decr(key: String, delta: Number {optional}): Number
+			module.set("decr", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.decr");
 
-				try 
-				{
-					compressed = gzip::compress(string.c_str(), string.length(), compressionLevel);
-				}
-				catch (std::exception & e) 
-				{
-					vs_printf("Exception at gzip.compress in gzip_thread (%s)\n", e.what());
-				} 
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for ipc.decr");
 
-				/////////////////////////////////////////////
+				IPCNumber delta;
+				delta.integer = 1;
 
-				// Decrement out thread count.
-				{
-					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-					thread_count--;
-				}
-				 
-				// Notify all waitees.
-				thread_count_cv.notify_one();
+				if (args.Length() > 1 && !args[1]->IsUndefined())
+					delta = to_ipc_number(args[1]);
 
-				/////////////////////////////////////////////
+				delta.integer = -delta.integer;
+				delta.real = -delta.real;
 
-				v8::Locker locker(isolate);
-				v8::Isolate::Scope isolate_scope(isolate);
-				v8::HandleScope handle_scope(isolate);
-				v8::Context::Scope context_scope(context.Get(isolate));
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-				if (!compressed.empty())
-				{
-					auto array_buffer = v8::ArrayBuffer::New(
-						isolate,
-						compressed.size()
-					);
+				args.GetReturnValue().Set(
+					from_ipc_number(IPC_OBJECT->increment(key, delta))
+				);
+			});
 
-					////////////////////////////////////////////////
-					
-					std::memcpy(
-						array_buffer->GetContents().Data(),
-						compressed.data(),
-						compressed.size()
-					);
+			// ipc.compareAndSet(key: String, expected: Number || null, next: Number): Boolean
+			module.set("compareAndSet", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.compareAndSet");
 
-					////////////////////////////////////////////////
+				if (args.Length() < 3)
+					throw std::exception("invalid function signature for ipc.compareAndSet");
 
-					auto uint8_array = v8::Uint8Array::New(
-						array_buffer,
-						0,
-						compressed.size()
-					); 
+				if (!args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for ipc.compareAndSet");
 
-					////////////////////////////////////////////////
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
+				auto next = to_ipc_number(args[2]);
 
-					resolver.Get(isolate)->Resolve(
-						isolate->GetCurrentContext(),
-						uint8_array
-					);
-				}
-				else
+				// A null expected number means our key must not exist yet.
+				if (args[1]->IsNullOrUndefined())
 				{
-					resolver.Get(isolate)->Reject(
-						isolate->GetCurrentContext(),
-						v8pp::to_v8(isolate, "failed to compress using gzip.")
-					);
-				}			
-			}); 
+					RETURN_THIS(IPC_OBJECT->compare_and_set(key, nullptr, next))
+				}
 
-			gzip_thread.detach();
-		}); 
+				auto expected = to_ipc_number(args[1]);
 
-		// gzip.decompress(input: Uint8Array): Promise<String>
-		gzip_module.set("decompress", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for gzip.decompress");
-			 
-			if (!args[0]->IsUint8Array())
-				throw std::exception("invalid first parameter, must be a uint8array for gzip.decompress");
+				RETURN_THIS(IPC_OBJECT->compare_and_set(key, &expected, next))
+			});
 
-			auto uint8array_contents = args[0].As<v8::Uint8Array>()->Buffer()->GetContents();
+			// ipc.getNumber(key: String): Number || null
+			module.set("getNumber", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.getNumber");
 
-			// Get the uint8array buffer contents.
-			auto buffer = uint8array_contents.Data();
-			auto length = uint8array_contents.ByteLength();
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for ipc.getNumber");
 
-			/////////////////////////////////////////////
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-			// Wait until threads free up.
-			{
-				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+				IPCNumber number;
 
-				thread_count++;
-			} 
+				if (!IPC_OBJECT->get_number(key, number)) RETURN_NULL
 
-			/////////////////////////////////////////////
+				args.GetReturnValue().Set(from_ipc_number(number));
+			});
 
-			// Setup a resolver.
-			auto resolver = v8::Promise::Resolver::New(
-				args.GetIsolate()->GetCurrentContext()
-			).ToLocalChecked();
+			// ipc.stats(): Object ({ hits, misses, evictions, expirations, size, memory })
+			module.set("stats", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.stats");
 
-			// Setup a global resolver object.
-			auto resolver_global = v8::Global<v8::Promise::Resolver>(
-				args.GetIsolate(), resolver
-			);
+				auto stats = IPC_OBJECT->stats();
+				auto context = isolate->GetCurrentContext();
 
-			/////////////////////////////////////////////
+				auto stats_object = v8::Object::New(isolate);
+				stats_object->Set(context, v8pp::to_v8(isolate, "hits"), v8pp::to_v8(isolate, double(stats.hits))).FromJust();
+				stats_object->Set(context, v8pp::to_v8(isolate, "misses"), v8pp::to_v8(isolate, double(stats.misses))).FromJust();
+				stats_object->Set(context, v8pp::to_v8(isolate, "evictions"), v8pp::to_v8(isolate, double(stats.evictions))).FromJust();
+				stats_object->Set(context, v8pp::to_v8(isolate, "expirations"), v8pp::to_v8(isolate, double(stats.expirations))).FromJust();
+				stats_object->Set(context, v8pp::to_v8(isolate, "size"), v8pp::to_v8(isolate, double(stats.size))).FromJust();
+				stats_object->Set(context, v8pp::to_v8(isolate, "memory"), v8pp::to_v8(isolate, double(stats.memory))).FromJust();
 
-			// Set the return value to our promise.
-			args.GetReturnValue().Set(
-				resolver_global.Get(isolate)->GetPromise()
-			);
+				args.GetReturnValue().Set(stats_object);
+			});
+
+			// ipc.close(): void
+			module.set("close", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_OBJECT)
+					throw std::exception("invalid function pointer for ipc.close");
 
-			std::thread gzip_thread([buffer, length, resolver = std::move(resolver_global)] {
-				std::string decompressed;
+				auto handler = IPC_HANDLER;
+				std::vector<IPCPendingWait> waits;
 
-				try 
+				// Our wait thread has to be out of our store before we can close it.
 				{
-					decompressed = gzip::decompress((const char*)buffer, length);
+					std::lock_guard<std::mutex> lock_guard(handler->m_waits_lock);
+
+					handler->m_closing = true;
 				}
-				catch (std::exception & e) 
-				{
-					vs_printf("Exception at gzip.decompressed in gzip_thread (%s)\n", e.what());
-				} 
 
-				/////////////////////////////////////////////
+				IPC_OBJECT->wake();
 
-				// Decrement out thread count.
 				{
-					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-					thread_count--;
-				}
-				 
-				// Notify all waitees.
-				thread_count_cv.notify_one();
+					auto unique_lock = std::unique_lock<std::mutex>(handler->m_waits_lock);
+					handler->m_waits_cv.wait(unique_lock, [&]() { return !handler->m_in_backend; });
 
-				/////////////////////////////////////////////
+					waits = std::move(handler->m_waits);
+					handler->m_waits.clear();
+				}
 
-				v8::Locker locker(isolate);
-				v8::Isolate::Scope isolate_scope(isolate);
-				v8::HandleScope handle_scope(isolate);
-				v8::Context::Scope context_scope(context.Get(isolate));
-				 
-				if (!decompressed.empty())
+				for (auto & wait : waits)
 				{
-					resolver.Get(isolate)->Resolve(
+					wait.resolver.Get(isolate)->Reject(
 						isolate->GetCurrentContext(),
-						v8pp::to_v8(isolate, std::move(decompressed))
+						v8pp::to_v8(isolate, "ipc object was closed")
 					);
 				}
-				else
-				{
-					resolver.Get(isolate)->Reject(
-						isolate->GetCurrentContext(),
-						v8pp::to_v8(isolate, "failed to decompress using gzip.")
-					);
-				}			
-			}); 
 
-			gzip_thread.detach();
-		});
+				IPC_OBJECT->close();
+				handler->m_cache.clear();
 
-		gzip_module.set_const("NO_COMPRESSION", 0);
-		gzip_module.set_const("BEST_SPEED", 1);
-		gzip_module.set_const("BEST_COMPRESSION", 9);
+				args.This()->SetAlignedPointerInInternalField(0, nullptr);
+			});
 
-		////////////////////////////////////////
+			// Set our internal field count, our backend and our handler.
+			module.obj_->SetInternalFieldCount(2);
 
-		// crypto Property  
-		v8pp::module crypto_module(isolate);
-		 
-		// bcrypt Module
-		v8pp::module bcrypt_module(isolate);
+			// Reset our pointer...
+			engine->m_global_ipc_object.Reset(isolate, module.new_instance());
+		}
 
-		// Add our bcrypt module to the crypto module.
-		crypto_module.set_const("bcrypt", bcrypt_module);
 
-		// crypto.bcrypt.hash(input: String, workload: Integer {32-bit only, optional, default: 12}): Promise<String>
-		bcrypt_module.set("hash", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 1)
-				throw std::exception("invalid function signature for crypto.bcrypt");
+		/////////////////////////////
+		//     Queue JS Object     //
+		/////////////////////////////
+		if (engine->m_global_queue_object.IsEmpty())
+		{
+			// Setup our module...
+			v8pp::module module(isolate); 
 
-			if (!args[0]->IsString())
-				throw std::exception("invalid first parameter, must be a string for crypto.bcrypt");
+			// queue.push(value: any): void
+			module.set("push", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_QUEUE)
+					throw std::exception("invalid function pointer for queue.push");
 
-			/////////////////////////////////////////////
+				if (args.Length() < 1)
+					throw std::exception("invalid function signature for queue.push");
 
-			auto input = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
+				/////////////////////////////////////////////
 
-			/////////////////////////////////////////////
+				thread_local std::vector<unsigned char> buffer;
 
-			// Setup our default workload.
-			int workload = 12;
+				if (!serialize_ipc_value(args[0], buffer))
+					throw std::exception("invalid object given, unable to serialize for queue.push");
 
-			// Check if we were provided a custom workload value.
-			if (args.Length() > 1 && args[1]->IsInt32())
-				workload = v8pp::from_v8<int>(args.GetIsolate(), args[1]);
+				IPC_QUEUE->m_queue->push(buffer.data(), buffer.size());
+			});
 
-			/////////////////////////////////////////////
+			// queue.pop(): Object ({ id, value, attempts }) || null
+			module.set("pop", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_QUEUE)
+					throw std::exception("invalid function pointer for queue.pop");
 
-			// Wait until threads free up.
-			{
-				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+				// Reuse our job between calls since jobs can be of any size.
+				thread_local IPCJob job;
 
-				thread_count++;
-			}
+				if (!IPC_QUEUE->m_queue->pop(job, IPC_QUEUE->m_visibility_timeout))
+					RETURN_NULL
 
-			/////////////////////////////////////////////
+				/////////////////////////////////////////////
 
-			// Setup a resolver.
-			auto resolver = v8::Promise::Resolver::New(
-				args.GetIsolate()->GetCurrentContext()
-			).ToLocalChecked();
+				auto context = isolate->GetCurrentContext();
+				auto job_object = v8::Object::New(isolate);
 
-			// Setup a global resolver object.
-			auto resolver_global = v8::Global<v8::Promise::Resolver>(
-				args.GetIsolate(), resolver
-			);
+				job_object->Set(context, v8pp::to_v8(isolate, "id"), v8pp::to_v8(isolate, double(job.id))).FromJust();
+				job_object->Set(context, v8pp::to_v8(isolate, "value"), deserialize_ipc_value(job.data)).FromJust();
+				job_object->Set(context, v8pp::to_v8(isolate, "attempts"), v8pp::to_v8(isolate, job.attempts)).FromJust();
 
-			/////////////////////////////////////////////
+				args.GetReturnValue().Set(job_object);
+			});
 
-			// Set the return value to our promise.
-			args.GetReturnValue().Set(
-				resolver_global.Get(isolate)->GetPromise()
-			);
+			// queue.ack(id: Number): boolean
+			module.set("ack", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_QUEUE)
+					throw std::exception("invalid function pointer for queue.ack");
 
-			std::thread bcrypt_thread([workload, input_value = std::move(input), resolver = std::move(resolver_global)] {
-				char salt[BCRYPT_HASHSIZE];
-				char hash[BCRYPT_HASHSIZE];
+				if (args.Length() < 1 || !args[0]->IsNumber())
+					throw std::exception("invalid first parameter, must be a number for queue.ack");
 
-				// Attempt to generate a salt.
-				int result = bcrypt_gensalt(workload, salt);
+				auto id = (uint64_t)v8pp::from_v8<double>(isolate, args[0]);
 
-				// Check if we were unable to generate the salt.
-				if (result != 0)
-				{
-					goto finish;
-				}
+				RETURN_THIS(IPC_QUEUE->m_queue->ack(id))
+			});
 
-				/////////////////////////////////////////////
+			// queue.size(): Number
+			module.set("size", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_QUEUE)
+					throw std::exception("invalid function pointer for queue.size");
 
-				// Attempt to hash the password.
-				result = bcrypt_hashpw(input_value.c_str(), salt, hash);
+				RETURN_THIS((double)IPC_QUEUE->m_queue->size())
+			});
 
-				// Check if we were unable to generate the hash.
-				if (result != 0)
-				{
-					goto finish;
-				}
+			// queue.onJob(callback: Function): void
+			module.set("onJob", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_QUEUE)
+					throw std::exception("invalid function pointer for queue.onJob");
 
-				/////////////////////////////////////////////
+				if (args.Length() < 1 || !args[0]->IsFunction())
+					throw std::exception("invalid first parameter, must be a function for queue.onJob");
 
-			finish:
+				////////////////////////////////////////////////
+
+				auto generation = ENGINE_GENERATION;
+
+				if (!generation) throw std::exception("unable to take jobs in a retired context");
+
+				////////////////////////////////////////////////
+
+				auto queue = IPC_QUEUE->m_queue;
 
-				// Decrement out thread count.
 				{
-					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-					thread_count--;
-				}
-				 
-				// Notify all waitees.
-				thread_count_cv.notify_one();
+					std::lock_guard<std::mutex> lock_guard(engine->m_queue_consumers_lock);
 
-				/////////////////////////////////////////////
+					if (engine->m_queue_consumers.find(queue->name()) == engine->m_queue_consumers.end())
+					{
+						auto consumer = std::make_shared<IPCQueueConsumer>(queue, IPC_QUEUE->m_visibility_timeout);
 
-				v8::Locker locker(isolate);
-				v8::Isolate::Scope isolate_scope(isolate);
-				v8::HandleScope handle_scope(isolate);
-				v8::Context::Scope context_scope(context.Get(isolate));
+						std::thread consumer_thread([consumer, thread_engine = engine]() {
+							EngineScope engine_scope(thread_engine);
 
-				if (result != 0)
+							dispatch_queue_jobs(consumer);
+						});
+						consumer_thread.detach();
+
+						engine->m_queue_consumers.emplace(queue->name(), consumer);
+					}
+				}
+
+				////////////////////////////////////////////////
+
+				// A queue only has one callback per generation, the last one given wins.
+				for (auto & job_callback : generation->m_job_callbacks)
 				{
-					resolver.Get(isolate)->Reject(
-						isolate->GetCurrentContext(),
-						v8pp::to_v8(isolate, "failed to generate bcrypt hash.")
-					);
+					if (job_callback.first == queue->name())
+					{
+						job_callback.second.Reset(isolate, args[0].As<v8::Function>());
+						return;
+					}
 				}
-				else
+
+				generation->m_job_callbacks.emplace_back(
+					queue->name(),
+					v8::Global<v8::Function>(isolate, args[0].As<v8::Function>())
+				);
+			});
+
+			// Set our internal field count.
+			module.obj_->SetInternalFieldCount(1);
+
+			// Reset our pointer...
+			engine->m_global_queue_object.Reset(isolate, module.new_instance());
+		}
+
+		/////////////////////////////
+		//    Sketch JS Objects    //
+		/////////////////////////////
+		if (engine->m_global_hll_object.IsEmpty())
+		{
+			v8pp::module module(isolate);
+
+			// hll.add(key: String || Array<String>): boolean
+			module.set("add", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for hll.add");
+
+				if (args.Length() < 1 || !(args[0]->IsString() || args[0]->IsArray()))
+					throw std::exception("invalid first parameter, must be a string or an array for hll.add");
+
+				auto hll = IPC_SKETCH->get<IPCHyperLogLog>();
+
+				if (args[0]->IsString())
 				{
-					// Resolve our promise.
-					resolver.Get(isolate)->Resolve(
-						isolate->GetCurrentContext(),
-						v8pp::to_v8(isolate, hash, strlen(hash))
-					);
+					RETURN_THIS(hll->add(v8pp::from_v8<std::string>(isolate, args[0])))
 				}
-			}); 
 
-			bcrypt_thread.detach();
-		});
+				auto context = isolate->GetCurrentContext();
+				auto keys = args[0].As<v8::Array>();
 
-		// crypto.bcrypt.check(password: String, hash: String): Promise<bool>
-		bcrypt_module.set("check", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-			if (args.Length() < 2)
-				throw std::exception("invalid function signature for crypto.bcryptCompare");
+				bool changed = false;
 
-			if (!args[0]->IsString() || !args[1]->IsString())
-				throw std::exception("invalid first parameter, must be a string for crypto.bcryptCompare");
+				for (uint32_t i = 0; i < keys->Length(); i++)
+				{
+					v8::Local<v8::Value> key;
 
-			/////////////////////////////////////////////
+					if (!keys->Get(context, i).ToLocal(&key) || !key->IsString())
+						throw std::exception("invalid key, must be a string for hll.add");
 
-			auto password = v8pp::from_v8<std::string>(args.GetIsolate(), args[0]);
-			auto hash = v8pp::from_v8<std::string>(args.GetIsolate(), args[1]);
+					if (hll->add(v8pp::from_v8<std::string>(isolate, key)))
+						changed = true;
+				}
 
-			/////////////////////////////////////////////
+				RETURN_THIS(changed)
+			});
 
-			// Wait until threads free up.
-			{
-				auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-				thread_count_cv.wait(unique_lock, []() { return thread_count < MAX_THREADS; });
+			// hll.count(): Number
+			module.set("count", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for hll.count");
 
-				thread_count++;
-			}
+				RETURN_THIS((double)IPC_SKETCH->get<IPCHyperLogLog>()->count())
+			});
 
-			/////////////////////////////////////////////
+			// hll.clear(): void
+			module.set("clear", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for hll.clear");
 
-			// Setup a resolver.
-			auto resolver = v8::Promise::Resolver::New(
-				args.GetIsolate()->GetCurrentContext()
-			).ToLocalChecked();
+				IPC_SKETCH->m_sketch->clear();
+			});
 
-			// Setup a global resolver object.
-			auto resolver_global = v8::Global<v8::Promise::Resolver>(
-				args.GetIsolate(), resolver
-			);
+			module.obj_->SetInternalFieldCount(1);
 
-			/////////////////////////////////////////////
+			engine->m_global_hll_object.Reset(isolate, module.new_instance());
+		}
 
-			// Set the return value to our promise.
-			args.GetReturnValue().Set(
-				resolver_global.Get(isolate)->GetPromise()
-			);
+		if (engine->m_global_count_min_object.IsEmpty())
+		{
+			v8pp::module module(isolate);
 
-			std::thread bcrypt_thread([
-				input_password = std::move(password),
-				input_hash = std::move(hash),
-				resolver = std::move(resolver_global)
-			]  
-			{
-				bool result = (bcrypt_checkpw(input_password.c_str(), input_hash.c_str()) == 0);
+			// countMin.add(key: String, count: Number {optional}): Number
+			module.set("add", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for countMin.add");
 
-				////////////////////////////////////////////
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for countMin.add");
 
-				// Decrement out thread count.
+				int64_t count = 1;
+
+				if (args.Length() > 1 && !args[1]->IsNullOrUndefined())
 				{
-					auto unique_lock = std::unique_lock<std::mutex>(thread_count_lock);
-					thread_count--;
+					if (!args[1]->IsNumber() || args[1].As<v8::Number>()->Value() < 0)
+						throw std::exception("invalid second parameter, must be a positive number for countMin.add");
+
+					count = (int64_t)args[1].As<v8::Number>()->Value();
 				}
 
-				// Notify all waitees.
-				thread_count_cv.notify_one();
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-				/////////////////////////////////////////////
+				RETURN_THIS((double)IPC_SKETCH->get<IPCCountMin>()->add(key, count))
+			});
+
+			// countMin.estimate(key: String): Number
+			module.set("estimate", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for countMin.estimate");
+
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for countMin.estimate");
+
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
+
+				RETURN_THIS((double)IPC_SKETCH->get<IPCCountMin>()->estimate(key))
+			});
+
+			// countMin.clear(): void
+			module.set("clear", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for countMin.clear");
+
+				IPC_SKETCH->m_sketch->clear();
+			});
+
+			module.obj_->SetInternalFieldCount(1);
+
+			engine->m_global_count_min_object.Reset(isolate, module.new_instance());
+		}
+
+		if (engine->m_global_bloom_object.IsEmpty())
+		{
+			v8pp::module module(isolate);
 
-				v8::Locker locker(isolate);
-				v8::Isolate::Scope isolate_scope(isolate);
-				v8::HandleScope handle_scope(isolate);
-				v8::Context::Scope context_scope(context.Get(isolate));
+			// bloom.add(key: String): boolean
+			module.set("add", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for bloom.add");
 
-				// Resolve our promise.
-				resolver.Get(isolate)->Resolve(
-					isolate->GetCurrentContext(),
-					v8pp::to_v8(isolate, result)
-				);
-			}); 
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for bloom.add");
 
-			bcrypt_thread.detach();
-		}); 
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-		////////////////////////////////////////
+				RETURN_THIS(IPC_SKETCH->get<IPCBloomFilter>()->add(key))
+			});
 
-		// ipc Object
-		global.set_const("ipc", ipc_module);
+			// bloom.has(key: String): boolean
+			module.set("has", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for bloom.has");
 
-		// http Object
-		global.set_const("http", http_module);
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for bloom.has");
 
-		// fs Object
-		global.set_const("fs", fs_module);
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-		// db Object
-		global.set_const("db", db_module);
-		
-		// crypto Object
-		global.set_const("crypto", crypto_module);
-		
-		// gzip Object
-		global.set_const("gzip", gzip_module);
+				RETURN_THIS(IPC_SKETCH->get<IPCBloomFilter>()->has(key))
+			});
 
-		////////////////////////////////////////
+			// bloom.clear(): void
+			module.set("clear", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!IPC_SKETCH)
+					throw std::exception("invalid function pointer for bloom.clear");
 
-		return v8::Context::New(isolate, nullptr, global.obj_);
-	}
+				IPC_SKETCH->m_sketch->clear();
+			});
 
-	/**
-	 * Initializes global objects.
-	 */
-	void initialize_objects()
-	{
-		v8::Locker locker(isolate);
-		v8::Isolate::Scope isolate_scope(isolate);
-		v8::HandleScope handle_scope(isolate); 
-		v8::Context::Scope context_scope(context.Get(isolate));
+			module.obj_->SetInternalFieldCount(1);
 
+			engine->m_global_bloom_object.Reset(isolate, module.new_instance());
+		}
 
 		/////////////////////////////
-		//      IPC JS Object      //
+		//  Rate Limiter JS Object //
 		/////////////////////////////
-		if (global_ipc_object.IsEmpty())
+		if (engine->m_global_rate_limiter_object.IsEmpty())
 		{
-			// Setup our module...
-			v8pp::module module(isolate); 
-
-			// Setup our functions
-
-			// ipc.set(key: String, value: any): void
-			module.set("set", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-				if (!IPC_OBJECT)
-					throw std::exception("invalid function pointer for ipc.set");
+			v8pp::module module(isolate);
 
-				if (args.Length() < 2) 
-					throw std::exception("invalid function signature for ipc.set");
-			
-				if (!args[0]->IsString()) 
-					throw std::exception("invalid first parameter, must be a string for ipc.set");
-				 
-				/////////////////////////////////////////////
+			// limiter.take(key: String, cost: Number {optional}): boolean
+			module.set("take", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!RATE_LIMITER)
+					throw std::exception("invalid function pointer for limiter.take");
 
-				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for limiter.take");
 
-				/////////////////////////////////////////////
+				uint32_t cost = 1;
 
-				SerializerDelegate serializer_delegate(isolate);
-				v8::ValueSerializer serializer(isolate, &serializer_delegate);
+				if (args.Length() > 1 && !args[1]->IsUndefined())
+				{
+					if (!args[1]->IsUint32())
+						throw std::exception("invalid cost, must be a positive integer for limiter.take");
 
-				auto result = serializer.WriteValue(
-					isolate->GetCurrentContext(),
-					args[1]
-				).FromMaybe(false);
+					cost = args[1].As<v8::Uint32>()->Value();
+				}
 
-				if (!result) throw std::exception("invalid object given, unable to serialize for ipc.set");
+				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
 
-				/////////////////////////////////////////////
+				RETURN_THIS(RATE_LIMITER->m_limiter->take(key, cost))
+			});
 
-				std::pair<uint8_t*, size_t> buffer = serializer.Release();
+			// limiter.reset(key: String): void
+			module.set("reset", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!RATE_LIMITER)
+					throw std::exception("invalid function pointer for limiter.reset");
 
-				IPC_OBJECT->set(key, buffer.first, buffer.second);
+				if (args.Length() < 1 || !args[0]->IsString())
+					throw std::exception("invalid first parameter, must be a string for limiter.reset");
 
-				serializer_delegate.FreeBufferMemory(buffer.first);
+				RATE_LIMITER->m_limiter->reset(v8pp::from_v8<std::string>(isolate, args[0]));
 			});
 
-			// ipc.get(key: String): any || null
-			module.set("get", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-				if (!IPC_OBJECT)
-					throw std::exception("invalid function pointer for ipc.get");
-			
-				if (args.Length() < 1) 
-					throw std::exception("invalid function signature for ipc.get");
+			// limiter.clear(): void
+			module.set("clear", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!RATE_LIMITER)
+					throw std::exception("invalid function pointer for limiter.clear");
 
-				if (!args[0]->IsString()) 
-					throw std::exception("invalid first parameter, must be a string for ipc.get");
+				RATE_LIMITER->m_limiter->clear();
+			});
 
-				auto key = v8pp::from_v8<std::string>(isolate, args[0]);
+			// limiter.protect(options: Object {optional} ({ status, reason })): void
+			module.set("protect", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (!RATE_LIMITER)
+					throw std::exception("invalid function pointer for limiter.protect");
 
-				/////////////////////////////////////////////
+				auto generation = ENGINE_GENERATION;
 
-				unsigned char buffer[IPCKV_DATA_SIZE];
-				size_t size;
+				if (!generation) throw std::exception("unable to protect in a retired context");
 
 				/////////////////////////////////////////////
 
-				bool result = IPC_OBJECT->get(key, buffer, size);
-
-				if (!result) RETURN_NULL
-
-				/////////////////////////////////////////////
+				auto request_limit = std::make_shared<RequestLimit>();
 
-				DeserializerDelegate deserializer_delegate(isolate);
-				v8::ValueDeserializer deserializer(
-					isolate,
-					buffer,
-					size,
-					&deserializer_delegate
-				); 
+				request_limit->m_limiter = RATE_LIMITER->m_limiter;
+				request_limit->m_status = 429;
+				request_limit->m_reason = "Too Many Requests";
 
-				auto value = deserializer.ReadValue(isolate->GetCurrentContext());
+				if (args.Length() > 0 && args[0]->IsObject())
+				{
+					static const char* const kKeys[] =
+					{
+						"status",
+						"reason"
+					};
+
+					auto keys = find_or_create_eternal_name_cache(
+						kKeys,
+						kKeys,
+						std::size(kKeys)
+					);
 
-				if (value.IsEmpty()) throw std::exception("unable to deserialize value for ipc.get");
+					auto context = isolate->GetCurrentContext();
+					auto options = args[0].As<v8::Object>();
 
-				/////////////////////////////////////////////
+					v8::Local<v8::Value> status;
+					v8::Local<v8::Value> reason;
 
-				args.GetReturnValue().Set(
-					value.ToLocalChecked()
-				); 
-			});
+					if (
+						!options->Get(context, keys[0].Get(isolate)).ToLocal(&status) ||
+						!options->Get(context, keys[1].Get(isolate)).ToLocal(&reason)
+					)
+						throw std::exception("unable to get value.");
 
-			// ipc.close(): void
-			module.set("close", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
-				if (!IPC_OBJECT)
-					throw std::exception("invalid function pointer for ipc.close");
+					request_limit->m_status = v8pp::from_v8<USHORT>(isolate, status, request_limit->m_status);
+					request_limit->m_reason = v8pp::from_v8<std::string>(isolate, reason, request_limit->m_reason);
+				}
 
-				IPC_OBJECT->close();
+				generation->m_request_limit = request_limit;
 
-				args.This()->SetAlignedPointerInInternalField(0, nullptr);
+				// Protect our requests right away if we're protecting the live generation.
+				if (generation == engine->m_live_generation.get())
+					std::atomic_store(&engine->m_live_request_limit, request_limit);
 			});
 
-			// Set our internal field count.
 			module.obj_->SetInternalFieldCount(1);
 
-			// Reset our pointer...
-			global_ipc_object.Reset(isolate, module.new_instance());
+			engine->m_global_rate_limiter_object.Reset(isolate, module.new_instance());
 		}
 
-
 		/////////////////////////////
 		//      DB JS Object       //
 		/////////////////////////////
 		
-		if (global_db_object.IsEmpty())
+		if (engine->m_global_db_object.IsEmpty())
 		{
 			// Setup our module...
 			v8pp::module module(isolate);
@@ -1894,7 +5100,9 @@ namespace v8_wrapper
 					resolver_global.Get(isolate)->GetPromise()
 				);
 
-				std::thread db_thread([db_context = DB_CONTEXT, resolver = std::move(resolver_global)] {
+				std::thread db_thread([db_context = DB_CONTEXT, resolver = std::move(resolver_global), thread_engine = engine, job = track_job()] {
+					EngineScope engine_scope(thread_engine);
+
 					std::string error_message;
 
 					try 
@@ -1922,7 +5130,7 @@ namespace v8_wrapper
 					v8::Locker locker(isolate);
 					v8::Isolate::Scope isolate_scope(isolate);
 					v8::HandleScope handle_scope(isolate);
-					v8::Context::Scope context_scope(context.Get(isolate));
+					v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
 
 					if (error_message.empty())
 					{
@@ -1985,7 +5193,9 @@ namespace v8_wrapper
 					resolver_global.Get(isolate)->GetPromise()
 				);
 
-				std::thread db_thread([db_context = DB_CONTEXT, resolver = std::move(resolver_global)] {
+				std::thread db_thread([db_context = DB_CONTEXT, resolver = std::move(resolver_global), thread_engine = engine, job = track_job()] {
+					EngineScope engine_scope(thread_engine);
+
 					std::string error_message;
 
 					try 
@@ -2013,7 +5223,7 @@ namespace v8_wrapper
 					v8::Locker locker(isolate);
 					v8::Isolate::Scope isolate_scope(isolate);
 					v8::HandleScope handle_scope(isolate);
-					v8::Context::Scope context_scope(context.Get(isolate));
+					v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
 
 					if (error_message.empty())
 					{
@@ -2076,7 +5286,9 @@ namespace v8_wrapper
 					resolver_global.Get(isolate)->GetPromise()
 				);
 
-				std::thread db_thread([db_context = DB_CONTEXT, resolver = std::move(resolver_global)] {
+				std::thread db_thread([db_context = DB_CONTEXT, resolver = std::move(resolver_global), thread_engine = engine, job = track_job()] {
+					EngineScope engine_scope(thread_engine);
+
 					std::string error_message;
 
 					try 
@@ -2104,7 +5316,7 @@ namespace v8_wrapper
 					v8::Locker locker(isolate);
 					v8::Isolate::Scope isolate_scope(isolate);
 					v8::HandleScope handle_scope(isolate);
-					v8::Context::Scope context_scope(context.Get(isolate));
+					v8::Context::Scope context_scope(resolver.Get(isolate)->CreationContext());
 
 					if (error_message.empty())
 					{
@@ -2335,13 +5547,13 @@ namespace v8_wrapper
 			module.obj_->SetInternalFieldCount(1);
 
 			// Reset our pointer...
-			global_db_object.Reset(isolate, module.new_instance());
+			engine->m_global_db_object.Reset(isolate, module.new_instance());
 		}
 		
 		/////////////////////////////
 		// FetchResponse JS Object //
 		/////////////////////////////
-		if (global_fetch_object.IsEmpty())
+		if (engine->m_global_fetch_object.IsEmpty())
 		{
 			// Setup our module...
 			v8pp::module module(isolate); 
@@ -2464,13 +5676,13 @@ namespace v8_wrapper
 			module.obj_->SetInternalFieldCount(1);
 
 			// Reset our pointer...
-			global_fetch_object.Reset(isolate, module.new_instance());
+			engine->m_global_fetch_object.Reset(isolate, module.new_instance());
 		}
 		
 		////////////////////////////
 		// HttpResponse JS Object //
 		////////////////////////////
-		if (global_http_response_object.IsEmpty())
+		if (generation->m_http_response_object.IsEmpty())
 		{
 			// Setup our module...
 			v8pp::module module(isolate);
@@ -2479,6 +5691,14 @@ namespace v8_wrapper
 			 
 			// clear(): void
 			module.set("clear", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					WARMUP_REQUEST->m_response_body.clear();
+					WARMUP_REQUEST->m_response_headers.clear();
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for clear");
 
 				HTTP_RESPONSE->Clear();
@@ -2486,6 +5706,13 @@ namespace v8_wrapper
 
 			// clearHeaders(): void
 			module.set("clearHeaders", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					WARMUP_REQUEST->m_response_headers.clear();
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for clearHeaders");
 
 				HTTP_RESPONSE->ClearHeaders();
@@ -2493,6 +5720,8 @@ namespace v8_wrapper
 
 			// closeConnection(): void
 			module.set("closeConnection", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for closeConnection");
 					
 				HTTP_RESPONSE->CloseConnection();
@@ -2500,6 +5729,8 @@ namespace v8_wrapper
 
 			// disableBuffering(): void
 			module.set("disableBuffering", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for disableBuffering");
 
 				HTTP_RESPONSE->DisableBuffering();
@@ -2507,6 +5738,8 @@ namespace v8_wrapper
 			
 			// setNeedDisconnect(): void
 			module.set("setNeedDisconnect", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for setNeedDisconnect");
 					
 				HTTP_RESPONSE->SetNeedDisconnect();
@@ -2514,6 +5747,8 @@ namespace v8_wrapper
 
 			// getKernelCacheEnabled(): bool
 			module.set("getKernelCacheEnabled", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return false;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for getKernelCacheEnabled");
 
 				return bool(HTTP_RESPONSE->GetKernelCacheEnabled());
@@ -2521,6 +5756,8 @@ namespace v8_wrapper
 
 			// resetConnection(): void
 			module.set("resetConnection", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for resetConnection");
 					
 				HTTP_RESPONSE->ResetConnection(); 
@@ -2528,6 +5765,8 @@ namespace v8_wrapper
 							
 			// getStatus(): Number
 			module.set("getStatus", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return WARMUP_REQUEST->m_status;
+
 				// Check if our http response is set.
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for getStatus");
 
@@ -2543,6 +5782,13 @@ namespace v8_wrapper
 
 			// setStatus(statusCode: Number, statusMessage: String): void
 			module.set("setStatus", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					WARMUP_REQUEST->m_status = USHORT(v8pp::from_v8<int>(args.GetIsolate(), args[0], 200));
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for setStatus");
 
 				////////////////////////////////
@@ -2567,6 +5813,8 @@ namespace v8_wrapper
 
 			// redirect(url: String, resetStatusCode: bool, includeParameters: bool): void
 			module.set("redirect", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for redirect");
 
 				////////////////////////////////
@@ -2594,6 +5842,8 @@ namespace v8_wrapper
 
 			// setErrorDescription(decription: String, shouldHtmlEncode: bool): void
 			module.set("setErrorDescription", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for setErrorDescription");
 
 				////////////////////////////////
@@ -2618,6 +5868,8 @@ namespace v8_wrapper
 
 			// disableKernelCache(reason: Number): void
 			module.set("disableKernelCache", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) return;
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for disableKernelCache");
 
 				////////////////////////////////
@@ -2637,6 +5889,15 @@ namespace v8_wrapper
 
 			// deleteHeader(headerName: String): void
 			module.set("deleteHeader", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					WARMUP_REQUEST->m_response_headers.erase(
+						WarmupRequest::header_key(v8pp::from_v8<std::string>(args.GetIsolate(), args[0], ""))
+					);
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for deleteHeader");
 
 				////////////////////////////////
@@ -2660,6 +5921,17 @@ namespace v8_wrapper
 
 			// getHeader(headerName: String): String || null
 			module.set("getHeader", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					auto header = WARMUP_REQUEST->m_response_headers.find(
+						WarmupRequest::header_key(v8pp::from_v8<std::string>(args.GetIsolate(), args[0], ""))
+					);
+
+					if (header == WARMUP_REQUEST->m_response_headers.end()) RETURN_NULL
+
+					RETURN_THIS(header->second)
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for getHeader");
 
 				////////////////////////////////
@@ -2702,6 +5974,32 @@ namespace v8_wrapper
 
 			// read(asArray: bool {optional}): String || Uint8Array || null
 			module.set("read", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					auto & body = WARMUP_REQUEST->m_response_body;
+
+					if (body.empty()) RETURN_NULL
+
+					if (v8pp::from_v8<bool>(isolate, args[0], false))
+					{
+						auto array_buffer = v8::ArrayBuffer::New(isolate, body.size());
+
+						std::memcpy(array_buffer->GetContents().Data(), body.data(), body.size());
+
+						args.GetReturnValue().Set(
+							v8::Uint8Array::New(array_buffer, 0, body.size())
+						);
+					}
+					else
+					{
+						args.GetReturnValue().Set(
+							v8pp::to_v8(isolate, body.data(), body.size())
+						);
+					}
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for read");
 
 				////////////////////////////////////////////////
@@ -2833,7 +6131,7 @@ namespace v8_wrapper
 			// write(body: String || Uint8Array, mimetype: String {optional}, contentEncoding: String {optional}): void
 			module.set("write", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
 				// Check if our http response is set.
-				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for write");
+				if (!WARMUP_REQUEST && (!HTTP_CONTEXT || !HTTP_RESPONSE)) throw std::exception("invalid p_http_response for write");
 
 				// Check arguments.
 				if (args.Length() < 1) throw std::exception("invalid signature for write");
@@ -2869,6 +6167,18 @@ namespace v8_wrapper
 				 
 				////////////////////////////////////////////////
 
+				// Warm-up requests only collect what was written.
+				if (WARMUP_REQUEST)
+				{
+					WARMUP_REQUEST->m_response_headers["content-type"] = 
+						v8pp::from_v8<std::string>(isolate, args[1], "text/html");
+					WARMUP_REQUEST->m_response_body.append((const char*)buffer, buffer_size);
+
+					return;
+				}
+
+				////////////////////////////////////////////////
+
 				if (args.Length() >= 2 && args[1]->IsString())
 				{
 					// Get our mimetype.
@@ -2900,39 +6210,176 @@ namespace v8_wrapper
 				  
 				////////////////////////////////////////////////
 
-				unsigned long buffer_offset = 0;
-				unsigned long bytes_to_write = pmin(pmax(buffer_size - buffer_offset, 0), MAX_BYTES);
-				bool has_more_data = buffer_size - bytes_to_write > 0;
+				unsigned long buffer_offset = 0;
+				unsigned long bytes_to_write = pmin(pmax(buffer_size - buffer_offset, 0), MAX_BYTES);
+				bool has_more_data = buffer_size - bytes_to_write > 0;
+
+				// Loop until we write all our data.
+				do 
+				{ 
+					// Create an array of data chunks.
+					HTTP_DATA_CHUNK data_chunk = HTTP_DATA_CHUNK();
+					unsigned long cb_sent = 0;
+					 
+					// Set the chunk to a chunk in memory.
+					data_chunk.DataChunkType = HttpDataChunkFromMemory;
+					data_chunk.FromMemory.pBuffer = PVOID((unsigned char*)buffer + buffer_offset);
+					data_chunk.FromMemory.BufferLength = USHORT(bytes_to_write);
+
+					// Insert the data chunks into the response.
+					auto hr = HTTP_RESPONSE->WriteEntityChunks(&data_chunk, 1, FALSE, has_more_data, &cb_sent);
+
+					// Check if our result was not successful.
+					if (FAILED(hr)) throw std::exception("failed to write");
+
+					////////////////////////////////////////
+
+					buffer_offset += bytes_to_write;
+					bytes_to_write = pmin(pmax(buffer_size - buffer_offset, 0), MAX_BYTES);
+					has_more_data = buffer_size - buffer_offset > 0;
+					
+				} while (has_more_data);
+			});
+
+			// writeFromIpc(store: IPC, key: String, mimetype: String {optional}): Boolean
+			module.set("writeFromIpc", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				// Check if our http response is set.
+				if (!WARMUP_REQUEST && (!HTTP_CONTEXT || !HTTP_RESPONSE)) throw std::exception("invalid p_http_response for writeFromIpc");
+
+				// Check arguments.
+				if (args.Length() < 2) throw std::exception("invalid signature for writeFromIpc");
+
+				if (!args[1]->IsString()) throw std::exception("second argument must be a string for writeFromIpc");
+
+				////////////////////////////////////////////////
+
+				IPCBackend * store = nullptr;
+
+				if (args[0]->IsObject() && args[0].As<v8::Object>()->InternalFieldCount() == 2)
+				{
+					auto store_object = args[0].As<v8::Object>();
+
+					if (engine->m_ipc_handlers.count((IPCHandler*)store_object->GetAlignedPointerFromInternalField(1)))
+						store = (IPCBackend*)store_object->GetAlignedPointerFromInternalField(0);
+				}
+
+				if (!store) throw std::exception("first argument must be an open ipc store for writeFromIpc");
+
+				auto key = v8pp::from_v8<std::string>(isolate, args[1]);
+
+				////////////////////////////////////////////////
+
+				// Our bytes are copied once, straight from the store into memory which lives as long as our request.
+				unsigned char * buffer = nullptr;
+				size_t buffer_size = 0;
+
+				thread_local std::vector<unsigned char> warmup_buffer;
+
+				// Our tag is looked at first, so that nothing is allocated for a value we'd refuse.
+				auto found = store->read(key, [&](const unsigned char * value, size_t size) {
+					if (!size || value[0] != (unsigned char)IPCValueTag::Uint8Array)
+						throw std::exception("value is not raw bytes, it must be set with ipc.setRaw for writeFromIpc");
+
+					if (WARMUP_REQUEST)
+					{
+						warmup_buffer.resize(size);
+						buffer = warmup_buffer.data();
+					}
+					else
+						buffer = (unsigned char*)HTTP_CONTEXT->AllocateRequestMemory((DWORD)size);
+
+					if (!buffer) throw std::runtime_error("invalid allocation pointer for writeFromIpc.");
+
+					buffer_size = size;
+
+					return buffer;
+				});
+
+				if (!found)
+				{
+					RETURN_THIS(false)
+				}
+
+				// Skip our tag.
+				buffer++;
+				buffer_size--;
+
+				////////////////////////////////////////////////
+
+				// Warm-up requests only collect what was written.
+				if (WARMUP_REQUEST)
+				{
+					WARMUP_REQUEST->m_response_headers["content-type"] = 
+						v8pp::from_v8<std::string>(isolate, args[2], "text/html");
+					WARMUP_REQUEST->m_response_body.append((const char*)buffer, buffer_size);
+
+					RETURN_THIS(true)
+				}
+
+				////////////////////////////////////////////////
+
+				if (args.Length() >= 3 && args[2]->IsString())
+				{
+					// Get our mimetype.
+					v8::String::Utf8Value mime_type(isolate, args[2]);
+
+					// Check the length of the mime type.
+					if (!*mime_type) throw std::exception("third argument is invalid for writeFromIpc");
+
+					// Clear and set our header...
+					HTTP_RESPONSE->SetHeader(HttpHeaderContentType, *mime_type, mime_type.length(), TRUE);
+				}
+				else
+					HTTP_RESPONSE->SetHeader(HttpHeaderContentType, "text/html", strlen("text/html"), TRUE);
+
+				////////////////////////////////////////////////
+
+				// A constant representing the maximum bytes per HTTP_CHUNK_DATA.
+				constexpr size_t MAX_BYTES = 65535;
+
+				// And the most chunks a single WriteEntityChunks takes.
+				constexpr size_t MAX_CHUNKS = 65535;
+
+				std::vector<HTTP_DATA_CHUNK> data_chunks;
+
+				// None of our chunks has to be copied by IIS first, so they go in as few calls as we can.
+				for (size_t offset = 0; offset < buffer_size;)
+				{
+					data_chunks.clear();
+
+					for (; offset < buffer_size && data_chunks.size() < MAX_CHUNKS; offset += MAX_BYTES)
+					{
+						HTTP_DATA_CHUNK data_chunk = HTTP_DATA_CHUNK();
+
+						data_chunk.DataChunkType = HttpDataChunkFromMemory;
+						data_chunk.FromMemory.pBuffer = PVOID(buffer + offset);
+						data_chunk.FromMemory.BufferLength = ULONG(pmin(buffer_size - offset, MAX_BYTES));
+
+						data_chunks.push_back(data_chunk);
+					}
 
-				// Loop until we write all our data.
-				do 
-				{ 
-					// Create an array of data chunks.
-					HTTP_DATA_CHUNK data_chunk = HTTP_DATA_CHUNK();
 					unsigned long cb_sent = 0;
-					 
-					// Set the chunk to a chunk in memory.
-					data_chunk.DataChunkType = HttpDataChunkFromMemory;
-					data_chunk.FromMemory.pBuffer = PVOID((unsigned char*)buffer + buffer_offset);
-					data_chunk.FromMemory.BufferLength = USHORT(bytes_to_write);
 
-					// Insert the data chunks into the response.
-					auto hr = HTTP_RESPONSE->WriteEntityChunks(&data_chunk, 1, FALSE, has_more_data, &cb_sent);
+					auto hr = HTTP_RESPONSE->WriteEntityChunks(data_chunks.data(), (USHORT)data_chunks.size(), FALSE, offset < buffer_size, &cb_sent);
 
-					// Check if our result was not successful.
 					if (FAILED(hr)) throw std::exception("failed to write");
+				}
 
-					////////////////////////////////////////
-
-					buffer_offset += bytes_to_write;
-					bytes_to_write = pmin(pmax(buffer_size - buffer_offset, 0), MAX_BYTES);
-					has_more_data = buffer_size - buffer_offset > 0;
-					
-				} while (has_more_data);
+				RETURN_THIS(true)
 			});
 
 			// setHeader(headerName: String, headerValue: String, shouldReplace: bool {optional}): void
 			module.set("setHeader", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					auto header_name = WarmupRequest::header_key(v8pp::from_v8<std::string>(args.GetIsolate(), args[0], ""));
+
+					if (v8pp::from_v8<bool>(args.GetIsolate(), args[2], true) || !WARMUP_REQUEST->m_response_headers.count(header_name))
+						WARMUP_REQUEST->m_response_headers[header_name] = v8pp::from_v8<std::string>(args.GetIsolate(), args[1], "");
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_RESPONSE) throw std::exception("invalid p_http_response for setHeader");
 
 				////////////////////////////////
@@ -2959,11 +6406,16 @@ namespace v8_wrapper
 				if (FAILED(hr)) throw std::exception("failed to set header");
 			});
 
-			// Set our internal field count.
-			module.obj_->SetInternalFieldCount(1);
+			// Set our internal field count, the second field is used by warm-up requests.
+			module.obj_->SetInternalFieldCount(2);
+
+			// Setup our instance, clones will start with empty internal pointers.
+			auto instance = module.new_instance();
+			instance->SetAlignedPointerInInternalField(0, nullptr);
+			instance->SetAlignedPointerInInternalField(1, nullptr);
 
 			// Reset our pointer...
-			global_http_response_object.Reset(isolate, module.new_instance());
+			generation->m_http_response_object.Reset(isolate, instance);
 		}
 
 		////////////////////////////////////////////////
@@ -2971,7 +6423,7 @@ namespace v8_wrapper
 		///////////////////////////
 		// HttpRequest JS Object //
 		///////////////////////////
-		if (global_http_request_object.IsEmpty())
+		if (generation->m_http_request_object.IsEmpty())
 		{
 			// Setup our module...
 			v8pp::module module(isolate);
@@ -2980,6 +6432,19 @@ namespace v8_wrapper
 			
 			// read(rewrite: bool {optional}): String || null
 			module.set("read", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					auto & body = WARMUP_REQUEST->m_body;
+
+					if (body.empty()) RETURN_NULL
+
+					args.GetReturnValue().Set(
+						v8pp::to_v8(isolate, body.data(), body.size())
+					);
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for read");
 
 				////////////////////////////////
@@ -3069,6 +6534,13 @@ namespace v8_wrapper
 
 			// setUrl(url: String, resetQueryString: bool {optional}): void
 			module.set("setUrl", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					WARMUP_REQUEST->set_url(v8pp::from_v8<std::wstring>(isolate, args[0], L"/"));
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for setUrl");
 
 				////////////////////////////////
@@ -3095,6 +6567,15 @@ namespace v8_wrapper
 
 			// deleteHeader(headerName: String): void
 			module.set("deleteHeader", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					WARMUP_REQUEST->m_headers.erase(
+						WarmupRequest::header_key(v8pp::from_v8<std::string>(isolate, args[0], ""))
+					);
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for deleteHeader");
 
 				///////////////////////////////
@@ -3118,6 +6599,16 @@ namespace v8_wrapper
 
 			// setHeader(headerName: String, headerValue: String, shouldReplace: bool {optional}): void
 			module.set("setHeader", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					auto header_name = WarmupRequest::header_key(v8pp::from_v8<std::string>(args.GetIsolate(), args[0], ""));
+
+					if (v8pp::from_v8<bool>(args.GetIsolate(), args[2], true) || !WARMUP_REQUEST->m_headers.count(header_name))
+						WARMUP_REQUEST->m_headers[header_name] = v8pp::from_v8<std::string>(args.GetIsolate(), args[1], "");
+
+					return;
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for setHeader");
 
 				////////////////////////////////
@@ -3145,6 +6636,8 @@ namespace v8_wrapper
 
 			// getMethod(): String
 			module.set("getMethod", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->m_method) }
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getMethod");
 
 				auto method = HTTP_REQUEST->GetHttpMethod();
@@ -3156,6 +6649,8 @@ namespace v8_wrapper
 
 			// getAbsPath(): String
 			module.set("getAbsPath", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->m_abs_path) }
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getMethod");
 
 				args.GetReturnValue().Set(
@@ -3169,6 +6664,8 @@ namespace v8_wrapper
 			 
 			// getFullUrl(): String
 			module.set("getFullUrl", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->full_url()) }
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getFullUrl");
 
 				args.GetReturnValue().Set(
@@ -3182,6 +6679,8 @@ namespace v8_wrapper
 
 			// getQueryString(): String
 			module.set("getQueryString", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->m_query_string) }
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getQueryString");
 
 				args.GetReturnValue().Set(
@@ -3195,6 +6694,8 @@ namespace v8_wrapper
 
 			// getPath(): String
 			module.set("getPath", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->m_abs_path + WARMUP_REQUEST->m_query_string) }
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getQueryString");
 
 				args.GetReturnValue().Set(
@@ -3210,6 +6711,8 @@ namespace v8_wrapper
 
 			// getHost(): String
 			module.set("getHost", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->m_host) }
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getHost");
 
 				args.GetReturnValue().Set(
@@ -3223,6 +6726,8 @@ namespace v8_wrapper
 
 			// getLocalAddress(): String
 			module.set("getLocalAddress", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->m_local_address) }
+
 				// Check if our pointer is valid...
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getLocalAddress");
 
@@ -3235,6 +6740,8 @@ namespace v8_wrapper
 
 			// getRemoteAddress(): String
 			module.set("getRemoteAddress", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) { RETURN_THIS(WARMUP_REQUEST->m_remote_address) }
+
 				// Check if our pointer is valid...
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getRemoteAddress");
 				
@@ -3245,8 +6752,33 @@ namespace v8_wrapper
 				) 
 			});
 
+			// isWarmup(): bool
+			module.set("isWarmup", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				return WARMUP_REQUEST != nullptr;
+			});
+
+			// waitUntil(promise: Promise): void
+			module.set("waitUntil", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (args.Length() < 1 || !args[0]->IsPromise()) 
+					throw std::exception("invalid signature for waitUntil");
+
+				reserve_deferred_task();
+				track_deferred_promise(args[0].As<v8::Promise>());
+			});
+
 			// getHeader(headerName: String): String || null
 			module.set("getHeader", [](v8::FunctionCallbackInfo<v8::Value> const& args) {
+				if (WARMUP_REQUEST) 
+				{
+					auto header = WARMUP_REQUEST->m_headers.find(
+						WarmupRequest::header_key(v8pp::from_v8<std::string>(isolate, args[0], ""))
+					);
+
+					if (header == WARMUP_REQUEST->m_headers.end()) RETURN_NULL
+
+					RETURN_THIS(header->second)
+				}
+
 				if (!HTTP_CONTEXT || !HTTP_REQUEST) throw std::exception("invalid p_http_request for getHeader");
 				
 				////////////////////////////////
@@ -3287,10 +6819,16 @@ namespace v8_wrapper
 				args.GetReturnValue().Set(string);
 			});
 
-			module.obj_->SetInternalFieldCount(1);
+			// Set our internal field count, the second field is used by warm-up requests.
+			module.obj_->SetInternalFieldCount(2);
+
+			// Setup our instance, clones will start with empty internal pointers.
+			auto instance = module.new_instance();
+			instance->SetAlignedPointerInInternalField(0, nullptr);
+			instance->SetAlignedPointerInInternalField(1, nullptr);
 
 			// Reset our pointer...
-			global_http_request_object.Reset(isolate, module.new_instance());
+			generation->m_http_request_object.Reset(isolate, instance);
 		}
 	}
 	 
@@ -3299,45 +6837,108 @@ namespace v8_wrapper
 	 */
 	int handle_callback(CALLBACK_TYPES type, IHttpContext * pHttpContext, void * pObject)
 	{
-		if (!isolate) return 0 /* CONTINUE */;
+		auto request_engine = find_engine(pHttpContext);
+
+		if (!request_engine) return 0 /* CONTINUE */;
 
 		////////////////////////////////////////////////
 
-		v8::Global<v8::Function> * callback_function = nullptr;
+		// Requests over our limit are turned away before they ever get near JS.
+		if (type == PRE_BEGIN_REQUEST)
+		{
+			auto request_limit = std::atomic_load(&request_engine->m_live_request_limit);
 
-		////////////////////////////////////////////////
-		 
-		switch (type)
-		{
-		case BEGIN_REQUEST:
-			callback_function = &function_begin_request;
-			break;
-		case SEND_RESPONSE:
-			callback_function = &function_send_response;
-			break;
-		case PRE_BEGIN_REQUEST:
-			callback_function = &function_pre_begin_request;
-			break;
-		} 
+			if (request_limit && !take_request_limit(request_limit.get(), pHttpContext))
+				return GL_NOTIFICATION_HANDLED;
+		}
 
 		////////////////////////////////////////////////
-		
-		if (!callback_function || callback_function->IsEmpty()) 
+
+		// Avoid locking if the live generation hasn't registered this callback.
+		if (!(request_engine->m_live_callback_mask & (1 << type)))
 			return 0 /* CONTINUE */;
 
 		////////////////////////////////////////////////
 
+		EngineScope engine_scope(request_engine);
+
+		// Without tenants there's nothing to be fair between.
+		if (!tenants_enabled)
+			return run_callback(type, pHttpContext, pObject);
+
+		////////////////////////////////////////////////
+
+		request_engine->m_queue_time += std::chrono::duration_cast<std::chrono::microseconds>(
+			tenant_scheduler.acquire(request_engine)
+		).count();
+
+		auto started = std::chrono::steady_clock::now();
+		auto result = run_callback(type, pHttpContext, pObject);
+
+		tenant_scheduler.release(request_engine, std::chrono::steady_clock::now() - started);
+
+		return result;
+	}
+
+	/**
+	 * Takes a request from the limit given to protect, keyed on its remote address the
+	 * way request.getRemoteAddress() returns it. A request that isn't allowed is finished here.
+	 */
+	bool take_request_limit(RequestLimit * request_limit, IHttpContext * pHttpContext)
+	{
+		auto address = pHttpContext->GetRequest()->GetRemoteAddress();
+
+		if (!address) return true;
+
+		char ip_address[INET6_ADDRSTRLEN] = { 0 };
+
+		if (address->sa_family == AF_INET)
+			InetNtopA(AF_INET, &((sockaddr_in*)address)->sin_addr, ip_address, sizeof ip_address);
+		else if (address->sa_family == AF_INET6)
+			InetNtopA(AF_INET6, &((sockaddr_in6*)address)->sin6_addr, ip_address, sizeof ip_address);
+		else
+			return true;
+
+		if (request_limit->m_limiter->take((const unsigned char*)ip_address, strlen(ip_address)))
+			return true;
+
+		pHttpContext->GetResponse()->SetStatus(request_limit->m_status, request_limit->m_reason.c_str());
+
+		return false;
+	}
+
+	/**
+	 * Runs a callback of the current engine.
+	 */
+	int run_callback(CALLBACK_TYPES type, IHttpContext * pHttpContext, void * pObject)
+	{
 		// Setup our lockers, isolate scope, and handle scope...
 		v8::Locker locker(isolate);
 		v8::Isolate::Scope isolate_scope(isolate);
 		v8::HandleScope handle_scope(isolate);
-		v8::Context::Scope context_scope(context.Get(isolate));
+
+		////////////////////////////////////////////////
+
+		// Our generation may have been swapped before we got the lock.
+		auto generation = engine->m_live_generation.get();
+
+		if (!generation) 
+			return 0 /* CONTINUE */;
+
+		auto callback_function = generation->get_callback(type);
+		
+		if (!callback_function || callback_function->IsEmpty()) 
+			return 0 /* CONTINUE */;
+
+		////////////////////////////////////////////////
+
+		v8::Context::Scope context_scope(generation->m_context.Get(isolate));
 		
 		////////////////////////////////////////////////
 		 
 		// Clone our arguments to be given to JavaScript.
-		auto http_response_object = global_http_response_object.Get(isolate)->Clone();
-		auto http_request_object = global_http_request_object.Get(isolate)->Clone();
+		auto http_response_object = generation->m_http_response_object.Get(isolate)->Clone();
+		auto http_request_object = generation->m_http_request_object.Get(isolate)->Clone();
 
 		// Set the internal pointers in the objects.
 		http_response_object->SetAlignedPointerInInternalField(0, pHttpContext);
@@ -3368,6 +6969,9 @@ namespace v8_wrapper
 		}
 
 		////////////////////////////////////////////////
+
+		auto deferred_scheduled_before = engine->m_deferred_scheduled.load();
+		auto call_started = engine->begin_call();
 		 
 		auto result = local_function->Call(
 			isolate->GetCurrentContext(),
@@ -3376,6 +6980,24 @@ namespace v8_wrapper
 			arguments
 		);
 
+		engine->end_call(call_started);
+
+		////////////////////////////////////////////////
+
+		// Deferred work can outlive our request, so if our callback has 
+		// completed we make sure that it can no longer use our objects.
+		if (
+			engine->m_deferred_scheduled != deferred_scheduled_before && (
+				result.IsEmpty() || 
+				!result.ToLocalChecked()->IsPromise() ||
+				result.ToLocalChecked().As<v8::Promise>()->State() != v8::Promise::kPending
+			)
+		)
+		{
+			http_response_object->SetAlignedPointerInInternalField(0, nullptr);
+			http_request_object->SetAlignedPointerInInternalField(0, nullptr);
+		}
+
 		// Check if our function returned anything...
 		if (result.IsEmpty())
 		{
@@ -3437,68 +7059,51 @@ namespace v8_wrapper
 				int request_notification_status = v8pp::from_v8<int>(args.GetIsolate(), args[0], 0)
 					? RQ_NOTIFICATION_FINISH_REQUEST : RQ_NOTIFICATION_CONTINUE;
 
-#ifndef DISABLE_INTERNAL_POINTER_RESET
 				// Cast our passthrough objects as an array.
 				auto passthrough_object = (PassthroughObject*)(args.Data().As<v8::External>()->Value());
 
-				// Setup our objects.
-				auto http_response_object = passthrough_object->m_http_request_object.Get(args.GetIsolate());
-				auto http_request_object = passthrough_object->m_http_response_object.Get(args.GetIsolate());
+				// Our request might have already been completed for us if it took too long to drain.
+				if (passthrough_object->m_in_flight->end_request(passthrough_object))
+				{
+#ifndef DISABLE_INTERNAL_POINTER_RESET
+					// Setup our objects.
+					auto http_response_object = passthrough_object->m_http_request_object.Get(args.GetIsolate());
+					auto http_request_object = passthrough_object->m_http_response_object.Get(args.GetIsolate());
+#endif
 
-				// Cast our given Data,
-				auto http_context = (IHttpContext*)(
-					passthrough_object->m_http_context
+					// Regardless of any result,
+					// we need to indicate that the we've completed
+					// our execution to IIS.
+					passthrough_object->m_http_context->IndicateCompletion(
+						REQUEST_NOTIFICATION_STATUS(request_notification_status)
 					);
 
-				// Regardless of any result,
-				// we need to indicate that the we've completed
-				// our execution to IIS.
-				http_context->IndicateCompletion(
-					REQUEST_NOTIFICATION_STATUS(request_notification_status)
-				);
-
-				// Reset internal pointers.
-				RESET_INTERNAL_POINTERS
+					// Reset internal pointers.
+					RESET_INTERNAL_POINTERS
+				}
 
 				// Delete the object.
 				delete passthrough_object;
-#else
-				// Cast our given Data,
-				auto http_context = (IHttpContext*)args.Data().As<v8::External>()->Value();
-
-				// Regardless of any result,
-				// we need to indicate that the we've completed
-				// our execution to IIS.
-				http_context->IndicateCompletion(
-					REQUEST_NOTIFICATION_STATUS(request_notification_status)
-				);
-#endif 
 			};
 
 			////////////////////////////////////////////////
 
-#ifndef DISABLE_INTERNAL_POINTER_RESET
-			// Get our current context so we can create our array object.
-			auto context = isolate->GetCurrentContext();
+			// Keep track of our request so that it can be drained if our generation is replaced.
 			auto objects = new PassthroughObject(
 				isolate,
 				pHttpContext,
 				std::move(http_response_object),
-				std::move(http_request_object)
+				std::move(http_request_object),
+				generation->m_in_flight
 			);
 
+			generation->m_in_flight->begin_request(objects);
+
 			auto function = v8::Function::New(
 				isolate->GetCurrentContext(),
 				callback,
 				v8::External::New(isolate, objects)
 			).ToLocalChecked();
-#else
-			auto function = v8::Function::New(
-				isolate->GetCurrentContext(),
-				callback,
-				v8::External::New(isolate, pHttpContext)
-			).ToLocalChecked();
-#endif
 			
 			// Attach our callback function to our promise to handle both scenarios.
 			promise->Then(isolate->GetCurrentContext(), function, function);
@@ -3569,6 +7174,43 @@ namespace v8_wrapper
 		return std::string();
 	}
 
+	/**
+	 * Runs a script compiled under try_catch, reporting whatever was thrown 
+	 * while compiling or running it. Returns false if it didn't compile.
+	 */
+	bool run_script(v8::TryCatch & try_catch, v8::MaybeLocal<v8::Script> compiled_script)
+	{
+		v8::Local<v8::Script> script;
+
+		if (!compiled_script.ToLocal(&script))
+		{
+			// Print errors that happened during compilation.
+			report_exception(&try_catch);
+
+			return false;
+		}
+
+		//////////////////////////////////////////////////
+
+		v8::Local<v8::Value> result;
+
+		if (!script->Run(isolate->GetCurrentContext()).ToLocal(&result))
+		{
+			assert(try_catch.HasCaught());
+
+			// Print errors that happened during execution.
+			report_exception(&try_catch);
+
+			return true;
+		}
+
+		//////////////////////////////////////////////////
+
+		assert(!try_catch.HasCaught());
+
+		return true;
+	}
+
 	/**
 	 * Executes a string containing JavaScript.
 	 */
@@ -3578,7 +7220,7 @@ namespace v8_wrapper
 		v8::Locker locker(isolate);
 		v8::Isolate::Scope isolate_scope(isolate);
 		v8::HandleScope handle_scope(isolate);
-		v8::Context::Scope context_scope(context.Get(isolate));
+		v8::Context::Scope context_scope(get_loading_context());
 
 		// Enter the execution environment before evaluating any code.
 		v8::Local<v8::String> name(
@@ -3592,57 +7234,117 @@ namespace v8_wrapper
 		v8::TryCatch try_catch(isolate);
 		v8::ScriptOrigin origin(name);
 		v8::Local<v8::Context> context(isolate->GetCurrentContext());
-		v8::Local<v8::Script> script;
 
 		// Setup our source...
 		auto source = v8::String::NewFromUtf8(isolate, str, v8::NewStringType::kNormal).ToLocalChecked();
 
-		// Compile.
-		if (!v8::Script::Compile(context, source, &origin).ToLocal(&script))
-		{
-			// Print errors that happened during compilation.
-			report_exception(&try_catch);
+		// Compile and run.
+		return run_script(try_catch, v8::Script::Compile(context, source, &origin));
+	}
 
-			// Return false here...
-			return false;
+	/**
+	 * Starts reading and compiling a file on one of the platform's 
+	 * worker threads, or returns the script if it's already streaming.
+	 */
+	std::shared_ptr<StreamedScript> stream_file(std::experimental::filesystem::path & script_path)
+	{
+		v8::Locker locker(isolate);
+		v8::Isolate::Scope isolate_scope(isolate);
+
+		/////////////////////////////////////////////
+
+		auto streamed_script = engine->m_streamed_scripts.find(script_path.wstring());
+
+		// Check if our script is already being streamed.
+		if (streamed_script != engine->m_streamed_scripts.end())
+		{
+			return streamed_script->second;
 		}
 
-		//////////////////////////////////////////////////
+		/////////////////////////////////////////////
 
-		v8::Local<v8::Value> result;
+		auto script = std::make_shared<StreamedScript>(script_path);
+
+		// Setup the source which will read our file in chunks.
+		script->m_streamed_source = std::make_unique<v8::ScriptCompiler::StreamedSource>(
+			std::make_unique<FileSourceStream>(script.get()),
+			v8::ScriptCompiler::StreamedSource::UTF8
+		);
+
+		// Setup the streaming task, this may be null if 
+		// the script cannot be streamed.
+		script->m_streaming_task.reset(
+			v8::ScriptCompiler::StartStreamingScript(
+				isolate, 
+				script->m_streamed_source.get()
+			)
+		);
+
+		/////////////////////////////////////////////
+
+		engine->m_streamed_scripts[script_path.wstring()] = script;
+
+		// Post our task to one of the worker threads.
+		platform->CallOnWorkerThread(
+			std::make_unique<ScriptStreamingTask>(script)
+		);
+
+		return script;
+	}
+
+	/**
+	 * Waits for and discards all scripts which were 
+	 * streamed but never executed.
+	 */
+	void discard_streamed_scripts()
+	{
+		decltype(engine->m_streamed_scripts) unused_scripts;
 
-		if (!script->Run(context).ToLocal(&result))
 		{
-			assert(try_catch.HasCaught());
+			v8::Locker locker(isolate);
 
-			// Print errors that happened during execution.
-			report_exception(&try_catch);
+			unused_scripts.swap(engine->m_streamed_scripts);
+		}
 
-			return true;
+		/////////////////////////////////////////////
+
+		// Our worker threads still reference the streamed sources 
+		// so we have to wait for them to finish.
+		for (auto & unused_script : unused_scripts)
+		{
+			unused_script.second->wait();
 		}
 
-		//////////////////////////////////////////////////
+		/////////////////////////////////////////////
 
-		assert(!try_catch.HasCaught());
+		v8::Locker locker(isolate);
 
-		return true;
+		unused_scripts.clear();
 	}
 
 	/**
-	 * Executes a file by reading it's contents and 
-	 * passing it to execute_string.
+	 * Executes a file by waiting for its background 
+	 * compilation to finish and running it.
 	 */
 	void execute_file(std::experimental::filesystem::path & script_path)
 	{
+		// Get our script, this will start streaming it if it wasn't already.
+		auto script = stream_file(script_path);
+
+		/////////////////////////////////////////////
+
 		v8::Locker locker(isolate);
 		v8::Isolate::Scope isolate_scope(isolate);
 		v8::HandleScope handle_scope(isolate);
-		v8::Context::Scope context_scope(context.Get(isolate));
+		v8::Context::Scope context_scope(get_loading_context());
 
 		/////////////////////////////////////////////
 
+		// Our script will be executed, thus it's no longer pending.
+		engine->m_streamed_scripts.erase(script_path.wstring());
+
 		// Push our script to the loaded scripts
-		loaded_scripts.push_back( 
+		engine->m_loaded_scripts.push_back( 
 			std::make_pair(
 				script_path,
 				fs::last_write_time(script_path)
@@ -3651,62 +7353,49 @@ namespace v8_wrapper
 
 		/////////////////////////////////////////////
 
-		// Attempt to open a file handle.
-		auto file = _wfopen(script_path.c_str(), L"rb");
-
-		// Check if we were successful in opening a file handle.
-		if (file == nullptr) 
+		// Wait for our script to be compiled without 
+		// blocking any other threads from using the isolate.
 		{
-			// Throw a javascript exception.
-			isolate->ThrowException(
-				v8::String::NewFromUtf8(isolate, "failed to open a handle to the script file", v8::NewStringType::kNormal)
-					.ToLocalChecked()
-			);
-			 
-			// Return here.
-			return;
-		} 
+			v8::Unlocker unlocker(isolate);
 
-		/////////////////////////////////////////////
-
-		// Check the file size.
-		fseek(file, 0, SEEK_END);
-		size_t size = ftell(file); 
-		rewind(file); 
+			script->wait();
+		}
 
 		/////////////////////////////////////////////
 
-		// Create a unqiue pointer to our char array.
-		auto chars_unique_ptr = std::make_unique<char[]>(size + 1);
-
-		// Get the raw pointer to the chars.
-		auto chars = chars_unique_ptr.get();
-
-		// Place a terminating byte at the end;
-		chars[size] = 0;
-
-		// Attempt to read the entire file into our chars array.
-		fread(chars, sizeof(char), size, file);
-
 		// Check if we were successful in reading our file.
-		if (ferror(file))
+		if (script->m_failed)
 		{
 			isolate->ThrowException(
 				v8::String::NewFromUtf8(isolate, "failed to read the contents of the script file", v8::NewStringType::kNormal)
 				.ToLocalChecked()
 			);
 
-			// Close our file handle.
-			fclose(file);
-
 			return;
 		}
 
-		// Close our file handle.
-		fclose(file);
+		/////////////////////////////////////////////
+
+		v8::TryCatch try_catch(isolate);
+		v8::ScriptOrigin origin(
+			v8pp::to_v8(isolate, script_path.filename().u8string())
+		);
+		v8::Local<v8::Context> context(isolate->GetCurrentContext());
+
+		// V8 doesn't keep the source while streaming, so we need to provide it.
+		auto source = v8::String::NewFromUtf8(
+			isolate, 
+			script->m_source.data(), 
+			v8::NewStringType::kNormal, 
+			(int)script->m_source.size()
+		).ToLocalChecked();
+
+		// Finalize our compilation, this is cheap if the script was streamed.
+		auto result = script->m_streaming_task ?
+			v8::ScriptCompiler::Compile(context, script->m_streamed_source.get(), source, origin) :
+			v8::Script::Compile(context, source, &origin);
 
-		// Attempt to execute our script.
-		if (!execute_string(script_path.filename().u8string().c_str(), chars))
+		if (!run_script(try_catch, result))
 		{
 			isolate->ThrowException(
 				v8::String::NewFromUtf8(isolate, "failed to execute script file", v8::NewStringType::kNormal)
@@ -3729,7 +7418,7 @@ namespace v8_wrapper
 		v8::Locker locker(isolate);
 		v8::Isolate::Scope isolate_scope(isolate);
 		v8::HandleScope handle_scope(isolate);
-		v8::Context::Scope context_scope(context.Get(isolate));
+		v8::Context::Scope context_scope(get_loading_context());
 
 		v8::String::Utf8Value exception(isolate, try_catch->Exception());
 		const char* exception_string = c_string(exception);
@@ -7,6 +7,8 @@
 #define CPPHTTPLIB_OPENSSL_SUPPORT
 #define BCRYPT_HASHSIZE	(64)
 #define MAX_THREADS	24
+#define MAX_DEFERRED_TASKS	1024
+#define DRAIN_TIMEOUT	30000
 
 #include <windows.h>
 #include <sal.h>
@@ -16,10 +18,19 @@
 #include <string> 
 #include <condition_variable> 
 #include <atomic>
+#include <set>
+#include <unordered_set>
+#include <unordered_map>
+#include <algorithm>
+#include <cmath>
 #include <Shlobj.h>
 #include <httplib/httplib.h>
 #include <Shlwapi.h>
-#include <ipckv/ipckv.h>
+#include "ipc_backend.h"
+#include "ipc_channel.h"
+#include "ipc_queue.h"
+#include "ipc_sketch.h"
+#include "ipc_ratelimit.h"
  
 #pragma comment(lib, "sqlite3.lib")
 
@@ -27,7 +38,6 @@
 #include <rpc/server.h>
 #pragma comment(lib, "v8_monolith.64.lib")
 #pragma comment(lib, "rpc.lib")
-#pragma comment(lib, "ipckv.lib")
 #pragma comment(lib, "dbghelp.lib")
 #pragma comment(lib, "winmm.lib")  
 #pragma comment(lib, "libcppdb.lib")
@@ -40,7 +50,6 @@
 #pragma comment(lib, "dbghelp.lib")
 #pragma comment(lib, "libcppdb.release.lib")
 #pragma comment(lib, "zlibstatic.release.lib")
-#pragma comment(lib, "ipckv.release.lib")
 #endif 
  
 #pragma comment(lib, "crypt32.lib")
@@ -70,6 +79,7 @@
 #define RETURN_THIS(value) args.GetReturnValue().Set(v8pp::to_v8(isolate, value)); return;
 
 #define HTTP_CONTEXT ((IHttpContext*)args.This()->GetAlignedPointerFromInternalField(0))
+#define WARMUP_REQUEST ((WarmupRequest*)args.This()->GetAlignedPointerFromInternalField(1))
 #define HTTP_REQUEST HTTP_CONTEXT->GetRequest()
 #define HTTP_RESPONSE HTTP_CONTEXT->GetResponse()
 
@@ -86,13 +96,27 @@ http_request_object->SetAlignedPointerInInternalField(0, nullptr);
 
 #define FETCH_RESPONSE ((httplib::Response*)args.This()->GetAlignedPointerFromInternalField(0))
 #define DB_CONTEXT ((DbContext*)args.This()->GetAlignedPointerFromInternalField(0))
-#define IPC_OBJECT ((IPC_KV*)args.This()->GetAlignedPointerFromInternalField(0))
+#define IPC_OBJECT ((IPCBackend*)args.This()->GetAlignedPointerFromInternalField(0))
+#define IPC_QUEUE ((IPCQueueHandler*)args.This()->GetAlignedPointerFromInternalField(0))
+#define IPC_HANDLER ((IPCHandler*)args.This()->GetAlignedPointerFromInternalField(1))
+#define IPC_SKETCH ((IPCSketchHandler*)args.This()->GetAlignedPointerFromInternalField(0))
+#define RATE_LIMITER ((RateLimiterHandler*)args.This()->GetAlignedPointerFromInternalField(0))
+
+// How many values an ipc object keeps around when it's opened with { cache: true }.
+#define IPC_CACHE_SIZE 1024
+
+// How many keys ipc.scan asks for when it isn't given a count.
+#define IPC_SCAN_COUNT 100
+
+// How long the waits of an ipc object sleep before they look at their keys anyway.
+#define IPC_WAIT_POLL_INTERVAL 1000
+
+#define ENGINE_GENERATION_INDEX 1
+#define ENGINE_GENERATION ((EngineGeneration*)isolate->GetCurrentContext()->GetAlignedPointerFromEmbedderData(ENGINE_GENERATION_INDEX))
 
 #define pmax(a,b) (((a) > (b)) ? (a) : (b))
 #define pmin(a,b) (((a) < (b)) ? (a) : (b))
 
-#define IPCKV_DATA_SIZE 2048 
-
 namespace v8_wrapper
 {
 	/**
@@ -148,6 +172,46 @@ namespace v8_wrapper
 		size_t length_;
 	};
 
+	/**
+	 * The first byte of an ipc value we encode ourselves, anything
+	 * written by ValueSerializer starts with its version tag (0xFF) instead.
+	 */
+	enum class IPCValueTag : uint8_t
+	{
+		Undefined = 1,
+		Null = 2,
+		True = 3,
+		False = 4,
+		Integer = 5,
+		Double = 6,
+		OneByteString = 7,
+		TwoByteString = 8,
+		Uint8Array = 9
+	};
+
+	/**
+	 * A value deserialized by ipc.get, which is handed
+	 * out again for as long as its version is current.
+	 */
+	struct IPCCachedValue
+	{
+		IPCVersion version;
+		v8::Global<v8::Value> value;
+	};
+
+	/**
+	 * A promise of ipc.wait, which is settled once the version
+	 * of its key is no longer version or its deadline has passed.
+	 */
+	struct IPCPendingWait
+	{
+		uint64_t id;
+		std::string key;
+		int64_t version;
+		std::chrono::steady_clock::time_point deadline;
+		v8::Global<v8::Promise::Resolver> resolver;
+	};
+
 	/**
 	 * A class that manages the everything related to the ipc object.
 	 */
@@ -157,10 +221,12 @@ namespace v8_wrapper
 		IPCHandler(
 			v8::Isolate* isolate,
 			v8::Local<v8::Object> object,
-			IPC_KV * context
-		) : m_context(context), ipc_object(isolate, object)
+			IPCBackend * context,
+			size_t cache_size = 0
+		) : m_context(context), m_cache_size(cache_size), ipc_object(isolate, object)
 		{
 			object->SetAlignedPointerInInternalField(0, m_context);
+			object->SetAlignedPointerInInternalField(1, this);
 		}
 
 		~IPCHandler()
@@ -168,10 +234,147 @@ namespace v8_wrapper
 			delete m_context;
 		}
 
-		IPC_KV * m_context;
+		void cache(v8::Isolate* isolate, const std::string& key, const IPCVersion& version, v8::Local<v8::Value> value)
+		{
+			// Rather than keeping track of which values are read the most, we make room by dropping any of them.
+			if (m_cache.size() >= m_cache_size && m_cache.find(key) == m_cache.end())
+				m_cache.erase(m_cache.begin());
+
+			auto& cached_value = m_cache[key];
+
+			cached_value.version = version;
+			cached_value.value.Reset(isolate, value);
+		}
+
+		IPCBackend * m_context;
+
+		// Our values by key, zero means we don't cache anything.
+		size_t m_cache_size;
+		std::unordered_map<std::string, IPCCachedValue> m_cache;
+
+		// Our pending waits, which are settled by a thread of our own
+		// that only runs while there are any and keeps our object alive meanwhile.
+		std::mutex m_waits_lock;
+		std::condition_variable m_waits_cv;
+		std::vector<IPCPendingWait> m_waits;
+		v8::Global<v8::Object> m_waits_owner;
+		uint64_t m_next_wait_id = 0;
+		bool m_waiting = false;
+		bool m_in_backend = false;
+		bool m_closing = false;
+
 		v8::Persistent<v8::Object> ipc_object;
 	};
 
+	/**
+	 * A class that manages everything related to a queue object.
+	 */
+	class IPCQueueHandler
+	{
+	public:
+		IPCQueueHandler(
+			v8::Isolate* isolate,
+			v8::Local<v8::Object> object,
+			std::shared_ptr<IPCQueue> queue,
+			uint64_t visibility_timeout
+		) : m_queue(std::move(queue)), m_visibility_timeout(visibility_timeout), queue_object(isolate, object)
+		{
+			object->SetAlignedPointerInInternalField(0, this);
+		}
+
+		std::shared_ptr<IPCQueue> m_queue;
+		uint64_t m_visibility_timeout;
+		v8::Persistent<v8::Object> queue_object;
+	};
+
+	/**
+	 * A class that manages everything related to a sketch object, whichever kind it is.
+	 */
+	class IPCSketchHandler
+	{
+	public:
+		IPCSketchHandler(
+			v8::Isolate* isolate,
+			v8::Local<v8::Object> object,
+			std::shared_ptr<IPCSketch> sketch
+		) : m_sketch(std::move(sketch)), sketch_object(isolate, object)
+		{
+			object->SetAlignedPointerInInternalField(0, this);
+		}
+
+		template <typename Sketch>
+		Sketch* get() { return (Sketch*)m_sketch.get(); }
+
+		std::shared_ptr<IPCSketch> m_sketch;
+		v8::Persistent<v8::Object> sketch_object;
+	};
+
+	/**
+	 * A class that manages everything related to a rate limiter object.
+	 */
+	class RateLimiterHandler
+	{
+	public:
+		RateLimiterHandler(
+			v8::Isolate* isolate,
+			v8::Local<v8::Object> object,
+			std::shared_ptr<IPCRateLimiter> limiter
+		) : m_limiter(std::move(limiter)), limiter_object(isolate, object)
+		{
+			object->SetAlignedPointerInInternalField(0, this);
+		}
+
+		std::shared_ptr<IPCRateLimiter> m_limiter;
+		v8::Persistent<v8::Object> limiter_object;
+	};
+
+	/**
+	 * The rate limiter given to protect, which every request of 
+	 * a generation is taken from before it can reach JS.
+	 */
+	struct RequestLimit
+	{
+		std::shared_ptr<IPCRateLimiter> m_limiter;
+		USHORT m_status;
+		std::string m_reason;
+	};
+
+	/**
+	 * Takes jobs from a queue for the callback given to onJob,
+	 * one at a time so that idle workers end up with more of them.
+	 */
+	class IPCQueueConsumer
+	{
+	public:
+		IPCQueueConsumer(std::shared_ptr<IPCQueue> queue, uint64_t visibility_timeout)
+			: m_queue(std::move(queue)), m_visibility_timeout(visibility_timeout) {}
+
+		/**
+		 * Called once the promise of our current job settles, a
+		 * job which failed is handed out again after its visibility timeout.
+		 */
+		void settle(bool succeeded)
+		{
+			{
+				std::lock_guard<std::mutex> lock_guard(m_lock);
+
+				if (succeeded) m_queue->ack(m_job_id);
+
+				m_pending = false;
+			}
+
+			m_settled_cv.notify_one();
+		}
+
+		std::shared_ptr<IPCQueue> m_queue;
+		uint64_t m_visibility_timeout;
+
+		std::mutex m_lock;
+		std::condition_variable m_settled_cv;
+		uint64_t m_job_id = 0;
+		bool m_pending = false;
+	};
+
 
 	/**
 	* A class that handles the IHttpContext object.
@@ -412,24 +615,774 @@ namespace v8_wrapper
 	* An object used to pass response and request objects to the
 	* finalization of an async response.
 	*/
+	class InFlightTracker;
+
 	class PassthroughObject
 	{
 	public:
 		v8::Global<v8::Object> m_http_response_object;
 		v8::Global<v8::Object> m_http_request_object;
 		IHttpContext * m_http_context;
+		std::shared_ptr<InFlightTracker> m_in_flight;
 
 		PassthroughObject(
 			v8::Isolate * isolate,
 			IHttpContext * http_context,
 			v8::Local<v8::Object> http_response_object,
-			v8::Local<v8::Object> http_request_object
+			v8::Local<v8::Object> http_request_object,
+			std::shared_ptr<InFlightTracker> in_flight
 		) :
 			m_http_context(http_context),
 			m_http_response_object(isolate, http_response_object),
-			m_http_request_object(isolate, http_request_object)
+			m_http_request_object(isolate, http_request_object),
+			m_in_flight(std::move(in_flight))
+		{
+		}
+	};
+
+	/**
+	 * Keeps track of the asynchronous requests and worker jobs of a generation, 
+	 * so that a generation which was replaced can be drained before it's destroyed.
+	 */
+	class InFlightTracker
+	{
+	public:
+		explicit InFlightTracker(uint64_t generation) 
+			: m_generation(generation) {}
+
+		void begin_request(PassthroughObject * request)
+		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+			m_requests.insert(request);
+		}
+
+		/**
+		 * Returns false if the request was already 
+		 * abandoned, in which case IIS must not be notified again.
+		 */
+		bool end_request(PassthroughObject * request)
+		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+			return m_requests.erase(request) > 0;
+		}
+
+		void begin_job()
 		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+			m_jobs++;
+		}
+
+		void end_job()
+		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+			m_jobs--;
+		}
+
+		bool is_idle()
+		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+			return m_requests.empty() && m_jobs == 0;
+		}
+
+		/**
+		 * Gives up on every request that is still pending, 
+		 * the caller is responsible for completing them.
+		 */
+		std::vector<PassthroughObject*> abandon()
+		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+
+			std::vector<PassthroughObject*> requests(m_requests.begin(), m_requests.end());
+			m_requests.clear();
+
+			return requests;
 		}
+
+		size_t pending_requests()
+		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+			return m_requests.size();
+		}
+
+		int pending_jobs()
+		{
+			std::lock_guard<std::mutex> lock_guard(m_lock);
+			return m_jobs;
+		}
+
+		const uint64_t m_generation;
+
+	private:
+		std::mutex m_lock;
+		std::unordered_set<PassthroughObject*> m_requests;
+		int m_jobs = 0;
+	};
+
+	/**
+	 * A worker job which keeps its generation from 
+	 * being destroyed until it's finished.
+	 */
+	class InFlightJob
+	{
+	public:
+		explicit InFlightJob(std::shared_ptr<InFlightTracker> in_flight) 
+			: m_in_flight(std::move(in_flight))
+		{
+			if (m_in_flight) m_in_flight->begin_job();
+		}
+
+		InFlightJob(InFlightJob && other) = default;
+		InFlightJob(const InFlightJob &) = delete;
+
+		~InFlightJob()
+		{
+			if (m_in_flight) m_in_flight->end_job();
+		}
+
+	private:
+		std::shared_ptr<InFlightTracker> m_in_flight;
+	};
+
+	/**
+	 * A synthetic request which is replayed against the handlers 
+	 * of a new engine generation before it goes live.
+	 */
+	class WarmupRequest
+	{
+	public:
+		/**
+		 * Splits a url into its host, path and query string.
+		 */
+		void set_url(std::wstring url)
+		{
+			auto scheme = url.find(L"://");
+
+			if (scheme != std::wstring::npos)
+			{
+				auto path = url.find(L'/', scheme + 3);
+
+				m_host = url.substr(scheme + 3, path == std::wstring::npos ? path : path - (scheme + 3));
+				url = path == std::wstring::npos ? L"/" : url.substr(path);
+			}
+
+			auto query = url.find(L'?');
+
+			m_abs_path = url.substr(0, query);
+			m_query_string = query == std::wstring::npos ? L"" : url.substr(query);
+
+			if (m_abs_path.empty()) m_abs_path = L"/";
+		}
+
+		std::wstring full_url() const
+		{
+			return L"http://" + m_host + m_abs_path + m_query_string;
+		}
+
+		/**
+		 * Header names are case-insensitive so we store them lowercase.
+		 */
+		static std::string header_key(std::string name)
+		{
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+			return name;
+		}
+
+		std::string m_method = "GET";
+		std::wstring m_host = L"localhost";
+		std::wstring m_abs_path = L"/";
+		std::wstring m_query_string;
+		std::string m_local_address = "127.0.0.1";
+		std::string m_remote_address = "127.0.0.1";
+		std::string m_body;
+		std::unordered_map<std::string, std::string> m_headers;
+
+		USHORT m_status = 200;
+		std::string m_response_body;
+		std::unordered_map<std::string, std::string> m_response_headers;
+	};
+
+	/**
+	 * A class that keeps a warm-up request alive for as long 
+	 * as the response or request object referencing it.
+	 */
+	class WarmupRequestHandler
+	{
+	public:
+		WarmupRequestHandler(
+			v8::Isolate* isolate,
+			v8::Local<v8::Object> object,
+			std::shared_ptr<WarmupRequest> request
+		) : m_request(std::move(request)), warmup_object(isolate, object)
+		{
+			object->SetAlignedPointerInInternalField(0, nullptr);
+			object->SetAlignedPointerInInternalField(1, m_request.get());
+		}
+
+		std::shared_ptr<WarmupRequest> m_request;
+		v8::Persistent<v8::Object> warmup_object;
+	};
+
+	/**
+	 * The options of a tenant, which is a host served by 
+	 * its own script in its own engine.
+	 */
+	struct TenantOptions
+	{
+		std::wstring host;
+		std::wstring script_name;
+		size_t heap_limit = 0;
+		int cpu_budget = 0;
+		int weight = 1;
+	};
+
+	/**
+	 * A generation of the engine, which is everything that gets 
+	 * replaced when the engine is reset. A new generation is prepared
+	 * and warmed up while the previous one keeps serving requests.
+	 */
+	class EngineGeneration
+	{
+	public:
+		EngineGeneration(v8::Isolate * isolate, uint64_t id) 
+			: m_isolate(isolate), m_id(id), m_in_flight(std::make_shared<InFlightTracker>(id)) {}
+
+		~EngineGeneration()
+		{
+			// Our context can outlive us, so make sure it no longer points to us.
+			if (!m_context.IsEmpty())
+			{
+				v8::HandleScope handle_scope(m_isolate);
+
+				m_context.Get(m_isolate)->SetAlignedPointerInEmbedderData(ENGINE_GENERATION_INDEX, nullptr);
+			}
+		}
+
+		v8::Global<v8::Function> * get_callback(CALLBACK_TYPES type)
+		{
+			switch (type)
+			{
+			case BEGIN_REQUEST:
+				return &m_function_begin_request;
+			case SEND_RESPONSE:
+				return &m_function_send_response;
+			case PRE_BEGIN_REQUEST:
+				return &m_function_pre_begin_request;
+			}
+
+			return nullptr;
+		}
+
+		/**
+		 * Returns a mask containing a bit for each registered callback type.
+		 */
+		int callback_mask()
+		{
+			int mask = 0;
+
+			if (!m_function_begin_request.IsEmpty()) mask |= 1 << BEGIN_REQUEST;
+			if (!m_function_send_response.IsEmpty()) mask |= 1 << SEND_RESPONSE;
+			if (!m_function_pre_begin_request.IsEmpty()) mask |= 1 << PRE_BEGIN_REQUEST;
+
+			return mask;
+		}
+
+		v8::Isolate * m_isolate;
+		v8::Global<v8::Context> m_context;
+
+		// Our generation number and what we're still waiting on, a replaced 
+		// generation is only destroyed once it's drained or its deadline has passed.
+		uint64_t m_id;
+		std::shared_ptr<InFlightTracker> m_in_flight;
+		std::chrono::steady_clock::time_point m_drain_deadline;
+
+		v8::Global<v8::Object> m_http_response_object;
+		v8::Global<v8::Object> m_http_request_object;
+
+		v8::Global<v8::Function> m_function_pre_begin_request;
+		v8::Global<v8::Function> m_function_begin_request;
+		v8::Global<v8::Function> m_function_directory_change;
+		v8::Global<v8::Function> m_function_send_response;
+
+		// The callbacks given to ipc.subscribe along with their channel.
+		std::vector<std::pair<std::string, v8::Global<v8::Function>>> m_subscriptions;
+
+		// The callbacks given to onJob along with their queue.
+		std::vector<std::pair<std::string, v8::Global<v8::Function>>> m_job_callbacks;
+
+		std::vector<WarmupRequest> m_warmup_requests;
+		int m_warmup_iterations = 1000;
+		int m_warmup_budget = 2000;
+
+		std::vector<TenantOptions> m_tenants;
+
+		// The rate limiter given to protect, if any.
+		std::shared_ptr<RequestLimit> m_request_limit;
+	};
+
+	/**
+	 * A script file that is being read and compiled by a
+	 * background streaming task on one of the platform's worker threads.
+	 */
+	class StreamedScript
+	{
+	public:
+		explicit StreamedScript(std::experimental::filesystem::path path)
+			: m_path(std::move(path)) {}
+
+		/**
+		 * Blocks until the streaming task has finished.
+		 */
+		void wait()
+		{
+			auto unique_lock = std::unique_lock<std::mutex>(m_lock);
+			m_finished_cv.wait(unique_lock, [this]() { return m_finished; });
+		}
+
+		/**
+		 * Marks the streaming task as finished and notifies waitees.
+		 */
+		void finish()
+		{
+			{
+				auto unique_lock = std::unique_lock<std::mutex>(m_lock);
+				m_finished = true;
+			}
+
+			m_finished_cv.notify_all();
+		}
+
+		std::experimental::filesystem::path m_path;
+		std::string m_source;
+		bool m_failed = false;
+
+		std::unique_ptr<v8::ScriptCompiler::StreamedSource> m_streamed_source;
+		std::unique_ptr<v8::ScriptCompiler::ScriptStreamingTask> m_streaming_task;
+
+	private:
+		bool m_finished = false;
+		std::mutex m_lock;
+		std::condition_variable m_finished_cv;
+	};
+
+	/**
+	 * A source stream which reads a script file in chunks,
+	 * called by V8 from the background streaming task.
+	 */
+	class FileSourceStream : public v8::ScriptCompiler::ExternalSourceStream
+	{
+	public:
+		explicit FileSourceStream(StreamedScript * script)
+			: m_script(script) {}
+
+		~FileSourceStream() override
+		{
+			if (m_file) fclose(m_file);
+		}
+
+		size_t GetMoreData(const uint8_t** src) override
+		{
+			// A constant representing the amount of bytes read per chunk.
+			constexpr size_t CHUNK_SIZE = 65536;
+
+			if (!m_file && !m_finished && !m_script->m_failed)
+			{
+				m_file = _wfopen(m_script->m_path.c_str(), L"rb");
+
+				if (!m_file) m_script->m_failed = true;
+			}
+
+			if (!m_file) return 0;
+
+			////////////////////////////////////////////////
+
+			auto chunk = new uint8_t[CHUNK_SIZE];
+			auto read_bytes = fread(chunk, sizeof(uint8_t), CHUNK_SIZE, m_file);
+
+			if (ferror(m_file)) m_script->m_failed = true;
+
+			if (!read_bytes)
+			{
+				delete[] chunk;
+
+				fclose(m_file);
+				m_file = nullptr;
+				m_finished = true;
+
+				return 0;
+			}
+
+			////////////////////////////////////////////////
+
+			// Keep a copy of the source since V8 needs the full
+			// source string once the streamed script is compiled.
+			m_script->m_source.append((const char*)chunk, read_bytes);
+
+			*src = chunk;
+
+			return read_bytes;
+		}
+
+	private:
+		StreamedScript * m_script;
+		FILE * m_file = nullptr;
+		bool m_finished = false;
+	};
+
+	/**
+	 * A platform task which runs the streaming task of a script
+	 * and keeps the script alive until it has finished.
+	 */
+	class ScriptStreamingTask : public v8::Task
+	{
+	public:
+		explicit ScriptStreamingTask(std::shared_ptr<StreamedScript> script)
+			: m_script(std::move(script)) {}
+
+		void Run() override
+		{
+			if (m_script->m_streaming_task)
+			{
+				m_script->m_streaming_task->Run();
+			}
+			else
+			{
+				// The script can't be streamed, so only read 
+				// its source and let it be compiled normally.
+				FileSourceStream stream(m_script.get());
+				const uint8_t* chunk = nullptr;
+
+				while (stream.GetMoreData(&chunk)) delete[] chunk;
+			}
+
+			m_script->finish();
+		}
+
+	private:
+		std::shared_ptr<StreamedScript> m_script;
+	};
+
+	/**
+	 * An engine is an isolate along with everything that belongs to it, 
+	 * the main script has an engine and so does every tenant.
+	 */
+	class Engine
+	{
+	public:
+		Engine(v8::Isolate * isolate, std::wstring script_name, std::wstring host, size_t heap_limit) 
+			: m_isolate(isolate), m_script_name(std::move(script_name)), m_host(std::move(host)), m_heap_limit(heap_limit) {}
+
+		~Engine()
+		{
+			// Only retired engines are ever destroyed on purpose, everything else is 
+			// left to the process exiting and so is its deferred thread.
+			if (m_deferred_thread.joinable())
+				m_deferred_thread.detach();
+		}
+
+		/**
+		 * Marks the start of a callback so that the 
+		 * watchdog can enforce our cpu budget.
+		 */
+		std::chrono::steady_clock::time_point begin_call()
+		{
+			auto now = std::chrono::steady_clock::now();
+
+			std::lock_guard<std::mutex> lock_guard(m_watchdog_lock);
+			m_call_started = now;
+
+			return now;
+		}
+
+		/**
+		 * Marks the end of a callback, clearing any termination 
+		 * so that the isolate can be used again.
+		 */
+		void end_call(std::chrono::steady_clock::time_point started)
+		{
+			{
+				std::lock_guard<std::mutex> lock_guard(m_watchdog_lock);
+				m_call_started = std::chrono::steady_clock::time_point();
+
+				if (m_isolate->IsExecutionTerminating())
+					m_isolate->CancelTerminateExecution();
+			}
+
+			////////////////////////////////////////////////
+
+			m_calls++;
+			m_cpu_time += std::chrono::duration_cast<std::chrono::microseconds>(
+				std::chrono::steady_clock::now() - started
+			).count();
+
+			////////////////////////////////////////////////
+
+			// Restore our heap limit if we had to raise it to terminate.
+			if (m_heap_limit_reached)
+			{
+				m_heap_limit_reached = false;
+
+				m_isolate->RemoveNearHeapLimitCallback(near_heap_limit_callback, m_initial_heap_limit);
+				m_isolate->AddNearHeapLimitCallback(near_heap_limit_callback, this);
+			}
+
+			// Sampling the heap isn't free, so only do it periodically.
+			if (m_calls % 64 == 0)
+			{
+				v8::HeapStatistics heap_statistics;
+				m_isolate->GetHeapStatistics(&heap_statistics);
+
+				m_heap_used = heap_statistics.used_heap_size();
+			}
+		}
+
+		/**
+		 * Called by the watchdog, terminates the 
+		 * current callback if it's over our cpu budget.
+		 */
+		void enforce_cpu_budget(std::chrono::steady_clock::time_point now)
+		{
+			auto cpu_budget = m_cpu_budget.load();
+
+			if (!cpu_budget) return;
+
+			////////////////////////////////////////////////
+
+			std::lock_guard<std::mutex> lock_guard(m_watchdog_lock);
+
+			if (
+				m_call_started != std::chrono::steady_clock::time_point() &&
+				now - m_call_started > std::chrono::milliseconds(cpu_budget)
+			)
+			{
+				m_call_started = std::chrono::steady_clock::time_point();
+				m_terminations++;
+
+				m_isolate->TerminateExecution();
+			}
+		}
+
+		/**
+		 * Called by V8 when we're about to run out of heap, we terminate 
+		 * whatever is running and raise our limit enough to let it unwind.
+		 */
+		static size_t near_heap_limit_callback(void * data, size_t current_heap_limit, size_t initial_heap_limit)
+		{
+			auto heap_engine = (Engine*)data;
+
+			heap_engine->m_heap_limit_hits++;
+			heap_engine->m_heap_limit_reached = true;
+			heap_engine->m_initial_heap_limit = initial_heap_limit;
+
+			heap_engine->m_isolate->TerminateExecution();
+
+			return current_heap_limit + initial_heap_limit / 2;
+		}
+
+		v8::Isolate * m_isolate;
+		std::wstring m_script_name;
+
+		// Our tenant settings, the main engine has no host.
+		std::wstring m_host;
+		size_t m_heap_limit;
+		std::atomic<int> m_cpu_budget{ 0 };
+		std::atomic<int> m_weight{ 1 };
+		std::atomic<bool> m_retired{ false };
+
+		// When we were retired, we're only destroyed once every request which could still have found us is long gone.
+		std::chrono::steady_clock::time_point m_retired_at;
+
+		// How many threads are inside an EngineScope of ours, our deferred thread always is.
+		std::atomic<int> m_scopes{ 0 };
+		std::unique_ptr<v8::ArrayBuffer::Allocator> m_array_buffer_allocator;
+
+		std::unique_ptr<EngineGeneration> m_live_generation;
+		std::unique_ptr<EngineGeneration> m_staging_generation;
+		std::vector<std::unique_ptr<EngineGeneration>> m_draining_generations;
+		std::atomic<int> m_live_callback_mask{ 0 };
+
+		// The request limit of our live generation, which is read without our lock so it's swapped atomically.
+		std::shared_ptr<RequestLimit> m_live_request_limit;
+		std::atomic<uint64_t> m_generation_count{ 0 };
+		std::atomic<uint64_t> m_abandoned_requests{ 0 };
+		std::atomic<size_t> m_draining_count{ 0 };
+
+		v8::Global<v8::Object> m_global_db_object;
+		v8::Global<v8::Object> m_global_fetch_object;
+		v8::Global<v8::Object> m_global_ipc_object;
+		v8::Global<v8::Object> m_global_queue_object;
+		v8::Global<v8::Object> m_global_hll_object;
+		v8::Global<v8::Object> m_global_count_min_object;
+		v8::Global<v8::Object> m_global_bloom_object;
+		v8::Global<v8::Object> m_global_rate_limiter_object;
+
+		// The handlers of our ipc objects, which is how we tell one apart from any other object.
+		std::unordered_set<IPCHandler*> m_ipc_handlers;
+
+		std::unordered_map<
+			const void*,
+			std::vector<
+				v8::Eternal<v8::Name>
+			>
+		> m_eternal_name_cache;
+
+		std::vector<
+			std::pair<
+				std::experimental::filesystem::path,
+				std::experimental::filesystem::file_time_type
+			>
+		> m_loaded_scripts;
+
+		std::unordered_map<
+			std::wstring,
+			std::shared_ptr<StreamedScript>
+		> m_streamed_scripts;
+
+		std::vector<v8::Global<v8::Function>> m_deferred_tasks;
+		std::condition_variable m_deferred_tasks_cv;
+		std::mutex m_deferred_tasks_lock;
+		std::thread m_deferred_thread;
+		bool m_deferred_stopped = false;
+
+		std::atomic<int> m_deferred_queued{ 0 };
+		std::atomic<int> m_deferred_pending{ 0 };
+		std::atomic<uint64_t> m_deferred_scheduled{ 0 };
+		std::atomic<uint64_t> m_deferred_completed{ 0 };
+		std::atomic<uint64_t> m_deferred_failed{ 0 };
+		std::atomic<uint64_t> m_deferred_rejected{ 0 };
+
+		// The channels we're subscribed to, each has a thread of its own which outlives our generations
+		// and takes itself out of here once our engine is retired.
+		std::unordered_map<std::string, std::shared_ptr<IPCSubscriber>> m_subscribers;
+		std::mutex m_subscribers_lock;
+
+		// The queues we take jobs from, which work the same way. Consumers whose thread stopped are
+		// kept until we're destroyed, since their handlers might still settle their last job.
+		std::unordered_map<std::string, std::shared_ptr<IPCQueueConsumer>> m_queue_consumers;
+		std::vector<std::shared_ptr<IPCQueueConsumer>> m_stopped_queue_consumers;
+		std::mutex m_queue_consumers_lock;
+
+		// Our metrics, times are in microseconds.
+		std::atomic<uint64_t> m_calls{ 0 };
+		std::atomic<uint64_t> m_cpu_time{ 0 };
+		std::atomic<uint64_t> m_queue_time{ 0 };
+		std::atomic<uint64_t> m_terminations{ 0 };
+		std::atomic<uint64_t> m_heap_limit_hits{ 0 };
+		std::atomic<size_t> m_heap_used{ 0 };
+
+		// Our scheduling state, which is guarded by the scheduler's lock.
+		double m_virtual_finish = 0;
+		double m_average_cost = 1000;
+
+	private:
+		std::mutex m_watchdog_lock;
+		std::chrono::steady_clock::time_point m_call_started;
+
+		std::atomic<bool> m_heap_limit_reached{ false };
+		size_t m_initial_heap_limit = 0;
+	};
+
+	extern thread_local Engine * engine;
+	extern thread_local v8::Isolate * isolate;
+
+	/**
+	 * Sets the engine that the current thread is using, 
+	 * and restores the previous one once we're out of scope.
+	 */
+	class EngineScope
+	{
+	public:
+		explicit EngineScope(Engine * scope_engine)
+			: m_engine(scope_engine), m_previous_engine(engine), m_previous_isolate(isolate)
+		{
+			engine = scope_engine;
+			isolate = scope_engine->m_isolate;
+
+			m_engine->m_scopes++;
+		}
+
+		~EngineScope()
+		{
+			m_engine->m_scopes--;
+
+			engine = m_previous_engine;
+			isolate = m_previous_isolate;
+		}
+
+	private:
+		Engine * m_engine;
+		Engine * m_previous_engine;
+		v8::Isolate * m_previous_isolate;
+	};
+
+	/**
+	 * A start-time fair queueing scheduler which admits the callbacks of 
+	 * tenants in proportion to their weight, the cost of a callback is 
+	 * the average time its tenant's callbacks have been taking.
+	 */
+	class TenantScheduler
+	{
+	public:
+		explicit TenantScheduler(int capacity) 
+			: m_capacity(capacity) {}
+
+		/**
+		 * Blocks until it's our tenant's turn, returns the time we waited.
+		 */
+		std::chrono::steady_clock::duration acquire(Engine * tenant)
+		{
+			auto start_time = std::chrono::steady_clock::now();
+			auto unique_lock = std::unique_lock<std::mutex>(m_lock);
+
+			// Our start tag is the later of the virtual time and when our tenant's previous callback finishes.
+			auto start_tag = pmax(m_virtual_time, tenant->m_virtual_finish);
+			tenant->m_virtual_finish = start_tag + tenant->m_average_cost / pmax(tenant->m_weight.load(), 1);
+
+			auto ticket = std::make_pair(start_tag, m_sequence++);
+			m_waiting.insert(ticket);
+
+			m_waiting_cv.wait(unique_lock, [&]() {
+				return m_running < m_capacity && *m_waiting.begin() == ticket;
+			});
+
+			m_waiting.erase(m_waiting.begin());
+			m_virtual_time = start_tag;
+			m_running++;
+
+			unique_lock.unlock();
+
+			// The next ticket might be admitted as well if there's capacity left.
+			m_waiting_cv.notify_all();
+
+			return std::chrono::steady_clock::now() - start_time;
+		}
+
+		/**
+		 * Frees our slot and updates the average cost of our tenant.
+		 */
+		void release(Engine * tenant, std::chrono::steady_clock::duration cost)
+		{
+			{
+				std::lock_guard<std::mutex> lock_guard(m_lock);
+
+				tenant->m_average_cost = tenant->m_average_cost * 0.9 + 
+					std::chrono::duration_cast<std::chrono::microseconds>(cost).count() * 0.1;
+
+				m_running--;
+			}
+
+			m_waiting_cv.notify_all();
+		}
+
+	private:
+		int m_capacity;
+		int m_running = 0;
+		double m_virtual_time = 0;
+		uint64_t m_sequence = 0;
+
+		std::set<std::pair<double, uint64_t>> m_waiting;
+		std::condition_variable m_waiting_cv;
+		std::mutex m_lock;
 	};
 
 	const v8::Eternal<v8::Name>* find_or_create_eternal_name_cache(
@@ -438,20 +1391,59 @@ namespace v8_wrapper
 		size_t count);
 	
 	int handle_callback(CALLBACK_TYPES type, IHttpContext * pHttpContext, void * pObject);
+	int run_callback(CALLBACK_TYPES type, IHttpContext * pHttpContext, void * pObject);
+	bool take_request_limit(RequestLimit * request_limit, IHttpContext * pHttpContext);
 
 	void start(std::wstring app_pool_name);
 	void reset_engine();
+	void activate_engine();
+	void retire_generation(std::unique_ptr<EngineGeneration> generation, std::chrono::steady_clock::time_point deadline);
+	size_t drain_generations(bool force);
+	void shutdown();
+	InFlightJob track_job();
+	void warm_up_engine();
+	void run_warmup_request(EngineGeneration * generation, const WarmupRequest & warmup_request);
+	v8::Local<v8::Context> get_loading_context();
 	void load_and_watch();
-	void initialize_objects();
+	void initialize_objects(EngineGeneration * generation);
+
+	Engine * create_engine(std::wstring script_name, std::wstring host, size_t heap_limit);
+	Engine * find_engine(IHttpContext * http_context);
+	std::vector<std::shared_ptr<Engine>> get_engines();
+	std::wstring normalize_host(std::wstring host);
+	void reload_engine(Engine * reload_target);
+	void reconcile_tenants();
+	void retire_engine(Engine * retired_engine);
+	bool collect_engine(const std::shared_ptr<Engine> & retired_engine);
+	void destroy_engine(Engine * destroyed_engine);
+	void watch_cpu_budgets();
+	v8::Local<v8::Object> create_engine_metrics(Engine * metrics_engine);
+
+	IPCNumber to_ipc_number(v8::Local<v8::Value> value);
+	v8::Local<v8::Value> from_ipc_number(const IPCNumber & number);
+	bool serialize_ipc_value(v8::Local<v8::Value> value, std::vector<unsigned char> & buffer);
+	v8::Local<v8::Value> deserialize_ipc_value(const std::vector<unsigned char> & buffer);
+	v8::Local<v8::Object> create_sketch_object(v8::Global<v8::Object> & global_object, std::shared_ptr<IPCSketch> sketch);
+	v8::Local<v8::Object> create_rate_limiter_object(std::shared_ptr<IPCRateLimiter> limiter);
+
+	void reserve_deferred_task();
+	void track_deferred_promise(v8::Local<v8::Promise> promise);
+	void drain_deferred_tasks();
+	void dispatch_channel_messages(std::shared_ptr<IPCSubscriber> subscriber);
+	void dispatch_queue_jobs(std::shared_ptr<IPCQueueConsumer> consumer);
+	void dispatch_ipc_waits(IPCHandler * handler);
 
 	void directory_change_callback();
 	std::experimental::filesystem::path& get_relative_file_path(std::wstring &raw_input);
 
 	std::experimental::filesystem::path get_path(std::wstring script);
+	std::shared_ptr<StreamedScript> stream_file(std::experimental::filesystem::path & script_path);
+	void discard_streamed_scripts();
 	void execute_file(std::experimental::filesystem::path & script_path);
 	void report_exception(v8::TryCatch * try_catch);
 
 	std::string sock_to_ip(PSOCKADDR address);
+	bool run_script(v8::TryCatch & try_catch, v8::MaybeLocal<v8::Script> compiled_script);
 	bool execute_string(const char * script_name, char * str);
 	const char* c_string(v8::String::Utf8Value& value);
 	int vs_printf(const char *format, ...);
@@ -0,0 +1,2348 @@
+#include "ipckv.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define IPCKV_SSE2
+#endif
+
+static int64_t load_slot(int64_t* slot)
+{
+	return ipckv_load(slot);
+}
+
+static bool exchange_slot(int64_t* slot, int64_t& expected, int64_t desired)
+{
+	auto actual = ipckv_compare_exchange(slot, desired, expected);
+
+	if (actual == expected)
+		return true;
+
+	expected = actual;
+
+	return false;
+}
+
+/**
+ * Returns a bit for every control byte of a group which is value.
+ */
+static uint32_t match_group(const uint8_t* control, uint8_t value)
+{
+#ifdef IPCKV_SSE2
+	auto group = _mm_loadu_si128((const __m128i*)control);
+
+	return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)value)));
+#else
+	uint32_t matches = 0;
+
+	for (uint32_t i = 0; i < IPCKV_GROUP_SIZE; i++)
+	{
+		if (control[i] == value) matches |= 1u << i;
+	}
+
+	return matches;
+#endif
+}
+
+/**
+ * Returns a bit for every control byte of a group which holds an entry, which is their high bit.
+ */
+static uint32_t match_occupied(const uint8_t* control)
+{
+#ifdef IPCKV_SSE2
+	return (uint32_t)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)control));
+#else
+	uint32_t matches = 0;
+
+	for (uint32_t i = 0; i < IPCKV_GROUP_SIZE; i++)
+	{
+		if (control[i] & IPCKV_CONTROL_OCCUPIED) matches |= 1u << i;
+	}
+
+	return matches;
+#endif
+}
+
+static uint8_t get_occupied_control(uint32_t hash)
+{
+	return (uint8_t)(IPCKV_CONTROL_OCCUPIED | (hash & 0x7F));
+}
+
+/**
+ * Our groups are a power of two, so stepping one further every time visits all of them.
+ */
+static size_t get_first_group(uint32_t hash, size_t groups)
+{
+	return (size_t)(hash >> 7) & (groups - 1);
+}
+
+static size_t get_next_group(size_t group, size_t step, size_t groups)
+{
+	return (group + step) & (groups - 1);
+}
+
+static double to_double(int64_t bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+/**
+ * Reverses the bits of a cursor, which is how scans count through our groups.
+ */
+static uint64_t reverse_bits(uint64_t value)
+{
+	value = ((value >> 1) & 0x5555555555555555ull) | ((value & 0x5555555555555555ull) << 1);
+	value = ((value >> 2) & 0x3333333333333333ull) | ((value & 0x3333333333333333ull) << 2);
+	value = ((value >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((value & 0x0F0F0F0F0F0F0F0Full) << 4);
+	value = ((value >> 8) & 0x00FF00FF00FF00FFull) | ((value & 0x00FF00FF00FF00FFull) << 8);
+	value = ((value >> 16) & 0x0000FFFF0000FFFFull) | ((value & 0x0000FFFF0000FFFFull) << 16);
+
+	return (value >> 32) | (value << 32);
+}
+
+/**
+ * Moves a cursor on to the next group of a table with mask + 1 groups. We count up from
+ * the highest bit of our group, so a group visited before our table doubled has already
+ * had both of the groups it's split into visited, and the same goes the other way around.
+ */
+static uint64_t get_next_cursor(uint64_t cursor, uint64_t mask)
+{
+	cursor |= ~mask;
+	cursor = reverse_bits(cursor);
+	cursor++;
+
+	return reverse_bits(cursor);
+}
+
+static int64_t to_bits(double value)
+{
+	int64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+
+	return bits;
+}
+
+static double as_double(const IPC_KV_Number& number)
+{
+	return number.kind == IPC_KV_Kind::Integer ? (double)number.integer : number.real;
+}
+
+/**
+ * CRC-32 (IEEE), which checksums our snapshots.
+ */
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size)
+{
+	static uint32_t table[256] = {};
+
+	if (!table[1])
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t value = i;
+
+			for (int bit = 0; bit < 8; bit++)
+				value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+
+			table[i] = value;
+		}
+	}
+
+	crc = ~crc;
+
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+/**
+ * Opens or creates the store, the first process to
+ * take the write lock lays out our shared memory.
+ */
+IPC_KV::IPC_KV(const std::string& name, const IPC_KV_Options& options)
+	: m_name(name), m_persist_path(options.persist_path), m_persist_interval(options.persist_interval)
+{
+	if (m_name.length() > IPCKV_MAX_NAME)
+	{
+		throw std::runtime_error("rwlock name too long.");
+	}
+
+	// Our lock is opened once here rather than every time it's taken.
+	if (!m_lock.open(m_name))
+	{
+		close();
+
+		throw std::runtime_error("could not create rwlock.");
+	}
+
+	if (!m_header_memory.create(m_name + "_header", sizeof(IPC_KV_Header)))
+	{
+		close();
+
+		throw std::runtime_error("could not create file mapping.");
+	}
+
+	m_header = (IPC_KV_Header*)m_header_memory.data();
+
+	try
+	{
+		initialize_header(options);
+	}
+	catch (...)
+	{
+		close();
+		throw;
+	}
+
+	if (!m_persist_path.empty())
+		start_persister();
+}
+
+IPC_KV::~IPC_KV()
+{
+	close();
+}
+
+/**
+ * Lays out our header and first segment, unless
+ * another process has already done so.
+ */
+void IPC_KV::initialize_header(const IPC_KV_Options& options)
+{
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+	if (m_header->m_magic == IPCKV_MAGIC)
+	{
+		m_header->m_references++;
+		m_attached = true;
+
+		return;
+	}
+
+	memset((void*)m_header, 0, sizeof(IPC_KV_Header));
+
+	m_header->m_max_value_size = options.max_value_size;
+	m_header->m_max_memory = options.max_memory;
+
+	initialize_segment(0, IPCKV_SEGMENT_SIZE);
+
+	// We keep the start of our first segment reserved so that an offset of zero is never a block.
+	m_header->m_segment_used = IPCKV_SEGMENT_RESERVED;
+
+	m_header->m_capacity = IPCKV_INITIAL_CAPACITY;
+	m_header->m_table = allocate_table(IPCKV_INITIAL_CAPACITY);
+
+	m_header->m_magic = IPCKV_MAGIC;
+	m_header->m_references = 1;
+	m_attached = true;
+
+	// Only the process which lays out our store restores it, while everyone else waits on our lock.
+	if (!m_persist_path.empty())
+		restore(m_persist_path);
+}
+
+/**
+ * Creates a new segment, this is only ever done while holding the write lock.
+ */
+void IPC_KV::initialize_segment(uint32_t index, uint64_t size)
+{
+	if (index >= IPCKV_MAX_SEGMENTS)
+	{
+		throw std::runtime_error("out of shared memory.");
+	}
+
+	auto segment_name = m_name + "_segment_" + std::to_string(index);
+
+	std::lock_guard<std::mutex> segments_lock(m_segments_lock);
+
+	auto& memory = m_segment_memory[index];
+
+	if (!memory.create(segment_name, size))
+	{
+		throw std::runtime_error("could not create file mapping.");
+	}
+
+	m_segments[index].store(memory.data(), std::memory_order_release);
+
+	m_header->m_segment_sizes[index] = size;
+	m_header->m_segment_count = index + 1;
+}
+
+/**
+ * Maps a segment which was created by another process.
+ */
+char* IPC_KV::map_segment(uint32_t index)
+{
+	if (index >= IPCKV_MAX_SEGMENTS)
+	{
+		throw std::runtime_error("invalid offset into shared memory.");
+	}
+
+	std::lock_guard<std::mutex> segments_lock(m_segments_lock);
+
+	auto segment = m_segments[index].load(std::memory_order_acquire);
+
+	if (segment)
+		return segment;
+
+	auto segment_name = m_name + "_segment_" + std::to_string(index);
+	auto& memory = m_segment_memory[index];
+
+	if (!memory.open(segment_name))
+	{
+		throw std::runtime_error("could not open file mapping.");
+	}
+
+	segment = memory.data();
+	m_segments[index].store(segment, std::memory_order_release);
+
+	return segment;
+}
+
+/**
+ * Turns an offset into our shared memory into a pointer in this process.
+ */
+char* IPC_KV::resolve(uint64_t offset)
+{
+	auto index = (uint32_t)(offset >> IPCKV_SEGMENT_SHIFT);
+	auto segment = index < IPCKV_MAX_SEGMENTS ? m_segments[index].load(std::memory_order_acquire) : nullptr;
+
+	if (segment == nullptr)
+		segment = map_segment(index);
+
+	return segment + (offset & IPCKV_SEGMENT_MASK);
+}
+
+////////////////////////////////////////////////////
+
+size_t IPC_KV::class_size(size_t size_class)
+{
+	if (size_class < IPCKV_SMALL_CLASSES)
+		return IPCKV_MIN_BLOCK_SIZE * (size_class + 1);
+
+	size_class -= IPCKV_SMALL_CLASSES;
+
+	auto base = (size_t)IPCKV_SMALL_BLOCK_SIZE << (size_class / 4);
+
+	return base + (base / 4) * (size_class % 4 + 1);
+}
+
+size_t IPC_KV::size_class(size_t size)
+{
+	if (size <= IPCKV_SMALL_BLOCK_SIZE)
+		return size ? (size - 1) / IPCKV_MIN_BLOCK_SIZE : 0;
+
+	size_t size_class = IPCKV_SMALL_CLASSES;
+
+	// Skip whole powers of two first, then step through the quarters of the last one.
+	while (size_class + 4 < IPCKV_SIZE_CLASSES && class_size(size_class + 3) < size)
+		size_class += 4;
+
+	while (size_class < IPCKV_SIZE_CLASSES && class_size(size_class) < size)
+		size_class++;
+
+	if (size_class >= IPCKV_SIZE_CLASSES)
+	{
+		throw std::runtime_error("allocation is too large.");
+	}
+
+	return size_class;
+}
+
+/**
+ * Allocates a block from its size class, either by reusing a freed
+ * block or by carving it out of the end of our last segment.
+ */
+uint64_t IPC_KV::allocate(size_t size)
+{
+	auto block_class = size_class(size);
+	auto block_size = class_size(block_class);
+
+	auto& free_list = m_header->m_free_lists[block_class];
+
+	if (free_list)
+	{
+		auto offset = free_list;
+		memcpy(&free_list, resolve(offset), sizeof(uint64_t));
+
+		m_header->m_memory_used += block_size;
+
+		return offset;
+	}
+
+	auto index = m_header->m_segment_count - 1;
+
+	if (m_header->m_segment_used + block_size > m_header->m_segment_sizes[index])
+	{
+		// Whatever is left at the end of our last segment is handed to the smaller classes.
+		auto remaining = m_header->m_segment_sizes[index] - m_header->m_segment_used;
+		auto remaining_offset = ((uint64_t)index << IPCKV_SEGMENT_SHIFT) | m_header->m_segment_used;
+
+		while (remaining >= IPCKV_MIN_BLOCK_SIZE)
+		{
+			auto remaining_class = size_class(remaining);
+
+			if (class_size(remaining_class) > remaining)
+				remaining_class--;
+
+			auto remaining_size = class_size(remaining_class);
+
+			memcpy(resolve(remaining_offset), &m_header->m_free_lists[remaining_class], sizeof(uint64_t));
+			m_header->m_free_lists[remaining_class] = remaining_offset;
+
+			remaining_offset += remaining_size;
+			remaining -= remaining_size;
+		}
+
+		auto segment_size = m_header->m_segment_sizes[index] * 2;
+
+		if (segment_size < block_size)
+			segment_size = block_size;
+
+		initialize_segment(index + 1, segment_size);
+
+		m_header->m_segment_used = 0;
+		index++;
+	}
+
+	auto offset = ((uint64_t)index << IPCKV_SEGMENT_SHIFT) | m_header->m_segment_used;
+
+	m_header->m_segment_used += block_size;
+	m_header->m_memory_used += block_size;
+
+	return offset;
+}
+
+/**
+ * Returns a block to the free list of its size class.
+ */
+void IPC_KV::free(uint64_t offset, size_t size)
+{
+	auto block_class = size_class(size);
+
+	memcpy(resolve(offset), &m_header->m_free_lists[block_class], sizeof(uint64_t));
+	m_header->m_free_lists[block_class] = offset;
+
+	m_header->m_memory_used -= class_size(block_class);
+}
+
+/**
+ * Reuses the table we let go of last time when there is one, which is what keeps rehashing
+ * away our tombstones at the same capacity from using up more memory each time. Tables
+ * carved out of memory which has never been used are already cleared.
+ */
+uint64_t IPC_KV::allocate_table(size_t capacity)
+{
+	auto size = table_size(capacity);
+	auto is_reused = m_header->m_free_lists[size_class(size)] != 0;
+
+	auto offset = allocate(size);
+
+	if (is_reused)
+		memset(resolve(offset), 0, size);
+
+	return offset;
+}
+
+/**
+ * A table is its control bytes, then the hashes of its entries and then its entries.
+ * Our capacity is a multiple of our group size, which keeps all of them aligned.
+ */
+size_t IPC_KV::table_size(size_t capacity)
+{
+	return capacity * (sizeof(uint8_t) + sizeof(uint32_t) + sizeof(IPC_KV_Entry));
+}
+
+IPC_KV_Entry* IPC_KV::get_table()
+{
+	return (IPC_KV_Entry*)(resolve(m_header->m_table) + m_header->m_capacity * (sizeof(uint8_t) + sizeof(uint32_t)));
+}
+
+IPC_KV_Entry* IPC_KV::get_old_table()
+{
+	if (!m_header->m_old_table)
+		return nullptr;
+
+	return (IPC_KV_Entry*)(resolve(m_header->m_old_table) + m_header->m_old_capacity * (sizeof(uint8_t) + sizeof(uint32_t)));
+}
+
+uint8_t* IPC_KV::get_control(IPC_KV_Entry* table, size_t capacity)
+{
+	return (uint8_t*)table - capacity * (sizeof(uint8_t) + sizeof(uint32_t));
+}
+
+uint32_t* IPC_KV::get_tags(IPC_KV_Entry* table, size_t capacity)
+{
+	return (uint32_t*)((char*)table - capacity * sizeof(uint32_t));
+}
+
+/**
+ * Changes the state of an entry in whichever table it's in, along with its control byte and hash.
+ */
+void IPC_KV::set_state(IPC_KV_Entry* entry, uint8_t state)
+{
+	auto table = get_table();
+	size_t capacity = m_header->m_capacity;
+
+	if (entry < table || entry >= table + capacity)
+	{
+		table = get_old_table();
+		capacity = m_header->m_old_capacity;
+	}
+
+	auto index = entry - table;
+
+	entry->m_state = state;
+
+	if (state == Occupied)
+	{
+		get_control(table, capacity)[index] = get_occupied_control(entry->m_hash);
+		get_tags(table, capacity)[index] = entry->m_hash;
+	}
+	else
+	{
+		get_control(table, capacity)[index] = state == Deleted ? IPCKV_CONTROL_DELETED : IPCKV_CONTROL_EMPTY;
+	}
+}
+
+////////////////////////////////////////////////////
+
+bool IPC_KV::is_match(const IPC_KV_Entry& entry, const std::string& key)
+{
+	return entry.m_key_length == key.length() && memcmp(resolve(entry.m_block), key.data(), key.length()) == 0;
+}
+
+/**
+ * Finds the entry holding our key in a table, or nullptr if there is none. Only an entry whose
+ * control byte and hash both match ours is looked at, and a group with an empty entry ends our probe.
+ */
+IPC_KV_Entry* IPC_KV::find_entry(IPC_KV_Entry* table, size_t capacity, const std::string& key, uint32_t hash)
+{
+	auto control = get_control(table, capacity);
+	auto tags = get_tags(table, capacity);
+
+	auto groups = capacity / IPCKV_GROUP_SIZE;
+	auto group = get_first_group(hash, groups);
+	auto occupied = get_occupied_control(hash);
+
+	for (size_t step = 1; step <= groups; step++)
+	{
+		auto start = group * IPCKV_GROUP_SIZE;
+
+		for (auto matches = match_group(control + start, occupied); matches; matches &= matches - 1)
+		{
+			auto index = start + ipckv_trailing_zeros(matches);
+
+			if (tags[index] == hash && is_match(table[index], key))
+				return &table[index];
+		}
+
+		if (match_group(control + start, IPCKV_CONTROL_EMPTY))
+			return nullptr;
+
+		group = get_next_group(group, step, groups);
+	}
+
+	return nullptr;
+}
+
+/**
+ * Finds the entry holding our key, looking in the
+ * table we're migrating away from if it isn't in ours yet.
+ */
+IPC_KV_Entry* IPC_KV::find(const std::string& key, uint32_t hash)
+{
+	auto entry = find_entry(get_table(), m_header->m_capacity, key, hash);
+
+	if (entry == nullptr && m_header->m_old_table)
+		entry = find_entry(get_old_table(), m_header->m_old_capacity, key, hash);
+
+	return entry;
+}
+
+/**
+ * Finds the entry holding our key, or otherwise the first
+ * free entry along its probe sequence to insert it into.
+ */
+IPC_KV_Entry* IPC_KV::find_slot(IPC_KV_Entry* table, size_t capacity, const std::string& key, uint32_t hash)
+{
+	auto entry = find_entry(table, capacity, key, hash);
+
+	if (entry)
+		return entry;
+
+	auto control = get_control(table, capacity);
+
+	auto groups = capacity / IPCKV_GROUP_SIZE;
+	auto group = get_first_group(hash, groups);
+
+	for (size_t step = 1; step <= groups; step++)
+	{
+		auto start = group * IPCKV_GROUP_SIZE;
+		auto free_entries = match_group(control + start, IPCKV_CONTROL_EMPTY) | match_group(control + start, IPCKV_CONTROL_DELETED);
+
+		if (free_entries)
+			return &table[start + ipckv_trailing_zeros(free_entries)];
+
+		group = get_next_group(group, step, groups);
+	}
+
+	return nullptr;
+}
+
+/**
+ * Moves an entry of our old table into the first free entry of
+ * our table, a key only ever lives in one of the two tables.
+ */
+void IPC_KV::insert_entry(IPC_KV_Entry& entry)
+{
+	auto table = get_table();
+	size_t capacity = m_header->m_capacity;
+	auto control = get_control(table, capacity);
+
+	auto groups = capacity / IPCKV_GROUP_SIZE;
+	auto group = get_first_group(entry.m_hash, groups);
+
+	for (size_t step = 1; step <= groups; step++)
+	{
+		auto start = group * IPCKV_GROUP_SIZE;
+		auto free_entries = match_group(control + start, IPCKV_CONTROL_EMPTY) | match_group(control + start, IPCKV_CONTROL_DELETED);
+
+		if (free_entries)
+		{
+			auto& free_entry = table[start + ipckv_trailing_zeros(free_entries)];
+
+			if (free_entry.m_state == Deleted)
+				m_header->m_tombstones--;
+
+			free_entry = entry;
+
+			set_state(&free_entry, Occupied);
+			set_state(&entry, Deleted);
+
+			bump_version(&entry);
+
+			return;
+		}
+
+		group = get_next_group(group, step, groups);
+	}
+
+	throw std::runtime_error("could not find a free entry.");
+}
+
+/**
+ * Starts moving to a new table, growing it when our table is more than half
+ * full and otherwise only leaving behind the tombstones that have piled up.
+ * The entries are moved over a few at a time by every write after this.
+ */
+void IPC_KV::start_resize()
+{
+	auto capacity = m_header->m_size * 2 > m_header->m_capacity * IPCKV_MAX_LOAD_FACTOR ?
+		m_header->m_capacity * 2 :
+		m_header->m_capacity;
+
+	m_header->m_old_table = m_header->m_table;
+	m_header->m_old_capacity = m_header->m_capacity;
+	m_header->m_migrate_cursor = 0;
+
+	m_header->m_table = allocate_table(capacity);
+	m_header->m_capacity = capacity;
+	m_header->m_tombstones = 0;
+}
+
+/**
+ * Moves up to count buckets of our old table into our table,
+ * and lets go of the old table once all of them have been moved.
+ */
+void IPC_KV::migrate(size_t count)
+{
+	if (!m_header->m_old_table)
+		return;
+
+	auto old_table = get_old_table();
+	auto old_capacity = m_header->m_old_capacity;
+
+	auto end = m_header->m_migrate_cursor + count;
+
+	if (end > old_capacity)
+		end = old_capacity;
+
+	for (auto i = m_header->m_migrate_cursor; i < end; i++)
+	{
+		if (old_table[i].m_state == Occupied)
+			insert_entry(old_table[i]);
+	}
+
+	m_header->m_migrate_cursor = end;
+
+	if (end == old_capacity)
+	{
+		ipckv_store(&m_header->m_generation, m_header->m_generation + 1);
+
+		free(m_header->m_old_table, table_size(old_capacity));
+
+		m_header->m_old_table = 0;
+		m_header->m_old_capacity = 0;
+		m_header->m_migrate_cursor = 0;
+	}
+}
+
+////////////////////////////////////////////////////
+
+uint64_t IPC_KV::get_time()
+{
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::system_clock::now().time_since_epoch()
+	).count();
+}
+
+bool IPC_KV::is_expired(const IPC_KV_Entry& entry, uint64_t time)
+{
+	return entry.m_expires && entry.m_expires <= time;
+}
+
+size_t IPC_KV::get_block_size(const IPC_KV_Entry& entry)
+{
+	return class_size(size_class(entry.m_key_length + entry.m_value_length));
+}
+
+/**
+ * Removes an entry from whichever table it's in, tombstones left in
+ * our old table don't count since it's thrown away once it's moved over.
+ */
+void IPC_KV::erase(IPC_KV_Entry* entry)
+{
+	auto table = get_table();
+
+	if (entry >= table && entry < table + m_header->m_capacity)
+		m_header->m_tombstones++;
+
+	m_header->m_data_used -= get_block_size(*entry);
+
+	free(entry->m_block, entry->m_key_length + entry->m_value_length);
+
+	set_state(entry, Deleted);
+	bump_version(entry);
+	notify(entry->m_hash);
+
+	m_header->m_size--;
+}
+
+/**
+ * Hands our entry the next version, versions are never reused so a slot which is taken again
+ * never looks unchanged. Numbers are bumped under the read lock, so this is done atomically.
+ */
+void IPC_KV::bump_version(IPC_KV_Entry* entry)
+{
+	ipckv_store(&entry->m_version, ipckv_fetch_add(&m_header->m_version, 1) + 1);
+}
+
+/**
+ * Evicts entries until we're back under our memory limit. Our clock hand passes over the
+ * entries of our table, giving a second chance to any entry which was read since it last came by.
+ */
+void IPC_KV::evict(IPC_KV_Entry* keep)
+{
+	auto time = get_time();
+
+	// Two laps clear every bit and get us under our limit if that's possible at all, but on large tables
+	// that's more than we want to hold the write lock for, so the writes after us carry on where we left off.
+	auto count = (m_header->m_old_capacity + m_header->m_capacity) * 2;
+
+	if (count > IPCKV_EVICT_BUCKETS)
+		count = IPCKV_EVICT_BUCKETS;
+
+	for (size_t i = 0; i < count && m_header->m_data_used > m_header->m_max_memory; i++)
+	{
+		auto& entry = *advance_clock();
+
+		if (entry.m_state != Occupied || &entry == keep)
+			continue;
+
+		if (is_expired(entry, time))
+		{
+			erase(&entry);
+			m_header->m_expirations++;
+
+			continue;
+		}
+
+		if (entry.m_referenced)
+		{
+			entry.m_referenced = 0;
+			continue;
+		}
+
+		erase(&entry);
+		m_header->m_evictions++;
+	}
+}
+
+/**
+ * Moves our clock hand along and returns the entry it passed. While we're being resized our hand
+ * goes over whatever is still waiting in our old table before our table, which is where most of
+ * our entries are until they're moved over.
+ */
+IPC_KV_Entry* IPC_KV::advance_clock()
+{
+	auto old_capacity = m_header->m_old_capacity;
+	auto hand = m_header->m_clock_hand % (old_capacity + m_header->m_capacity);
+
+	// The buckets of our old table before our cursor were already moved over.
+	if (hand < m_header->m_migrate_cursor)
+		hand = m_header->m_migrate_cursor;
+
+	m_header->m_clock_hand = (hand + 1) % (old_capacity + m_header->m_capacity);
+
+	if (hand < old_capacity)
+		return &get_old_table()[hand];
+
+	return &get_table()[hand - old_capacity];
+}
+
+/**
+ * Removes the expired entries among the next count buckets of our table. While we're being resized
+ * the next count buckets of our old table are moved over first, where we'll come across them later on.
+ */
+void IPC_KV::sweep(size_t count)
+{
+	migrate(count);
+
+	auto table = get_table();
+	auto capacity = m_header->m_capacity;
+	auto time = get_time();
+
+	for (size_t i = 0; i < count && i < capacity; i++)
+	{
+		auto& entry = table[m_header->m_sweep_cursor % capacity];
+		m_header->m_sweep_cursor = (m_header->m_sweep_cursor + 1) % capacity;
+
+		if (entry.m_state == Occupied && is_expired(entry, time))
+		{
+			erase(&entry);
+			m_header->m_expirations++;
+		}
+	}
+}
+
+/**
+ * Starts sweeping our table in the background once this process has set an entry which expires,
+ * every pass only holds the write lock for a bounded number of buckets.
+ */
+void IPC_KV::start_sweeper()
+{
+	std::lock_guard<std::mutex> background_lock(m_background_lock);
+
+	if (m_sweeper.joinable() || m_background_stopped)
+		return;
+
+	m_sweeper = std::thread([this]() {
+		std::unique_lock<std::mutex> background_lock(m_background_lock);
+
+		while (
+			!m_background_condition.wait_for(
+				background_lock,
+				std::chrono::milliseconds(IPCKV_SWEEP_INTERVAL),
+				[this]() { return m_background_stopped; }
+			)
+		)
+		{
+			background_lock.unlock();
+
+			try
+			{
+				auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+				sweep(IPCKV_SWEEP_BUCKETS);
+			}
+			catch (...) {}
+
+			background_lock.lock();
+		}
+	});
+}
+
+////////////////////////////////////////////////////
+
+/**
+ * Writes a snapshot of our entries to path. We only hold the read lock while copying
+ * a bounded number of buckets at a time, so writes made during the dump may or may not be in it.
+ * Entries that aren't written during the dump are always in it, even if our table is resized.
+ */
+void IPC_KV::save(const std::string& path)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	// We write to a temporary file first so that a crash never leaves a torn snapshot behind.
+	auto temporary_path = path + ".tmp";
+	std::unique_ptr<FILE, decltype(&fclose)> file(nullptr, &fclose);
+
+	std::vector<unsigned char> buffer;
+	uint32_t checksum = 0;
+	uint64_t count = 0;
+
+	auto append = [&](const void* data, size_t size) {
+		buffer.insert(buffer.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+	};
+
+	auto flush = [&]() {
+		checksum = crc32(checksum, buffer.data(), buffer.size());
+
+		if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), file.get()) != buffer.size())
+			throw std::runtime_error("could not write snapshot file.");
+
+		buffer.clear();
+	};
+
+	// Starting over truncates whatever we wrote so far.
+	auto start = [&]() {
+		// Our previous file is closed before we truncate it.
+		file.reset();
+		file.reset(fopen(temporary_path.c_str(), "wb"));
+
+		if (file == nullptr)
+			throw std::runtime_error("could not open snapshot file.");
+
+		buffer.clear();
+		checksum = 0;
+		count = 0;
+
+		uint32_t magic = IPCKV_SNAPSHOT_MAGIC;
+		uint32_t version = IPCKV_SNAPSHOT_VERSION;
+
+		append(&magic, sizeof(magic));
+		append(&version, sizeof(version));
+	};
+
+	// Whatever goes wrong, we don't leave our temporary file behind.
+	try
+	{
+		start();
+
+		size_t position = 0;
+		bool done = false;
+		uint32_t restarts = 0;
+
+		// Where our tables were when we started, which is what our position counts through.
+		uint64_t table_offset = 0;
+		uint64_t old_table_offset = 0;
+		int64_t generation = 0;
+
+		while (!done)
+		{
+			auto resized = false;
+
+			{
+				auto lock = get_lock(IPCKV_READ_LOCK);
+				auto time = get_time();
+
+				// A resize that started or finished in between our chunks moves entries from behind our
+				// position to ahead of it and back, so the entries we haven't reached yet could be skipped.
+				if (
+					position > 0 && (
+						m_header->m_table != table_offset ||
+						m_header->m_old_table != old_table_offset ||
+						m_header->m_generation != generation
+					)
+				)
+				{
+					resized = true;
+				}
+				else
+				{
+					table_offset = m_header->m_table;
+					old_table_offset = m_header->m_old_table;
+					generation = m_header->m_generation;
+
+					// Entries which haven't been moved over yet are in our old table, which we go through first.
+					// Moving them only ever moves them ahead of our position, so at worst we copy them twice.
+					auto old_table = get_old_table();
+					auto old_capacity = old_table ? m_header->m_old_capacity : 0;
+					auto table = get_table();
+					auto total = old_capacity + m_header->m_capacity;
+
+					// Once we've started over often enough, we copy the rest of our entries under this lock.
+					auto chunk = restarts < IPCKV_SNAPSHOT_RESTARTS ? IPCKV_SNAPSHOT_BUCKETS : total;
+
+					for (auto end = position + chunk; position < end && position < total; position++)
+					{
+						auto& entry = position < old_capacity ? old_table[position] : table[position - old_capacity];
+
+						if (entry.m_state != Occupied || is_expired(entry, time))
+							continue;
+
+						auto block = resolve(entry.m_block);
+						auto is_number = entry.m_kind != (uint8_t)IPC_KV_Kind::Bytes;
+						auto bits = load_slot(&entry.m_number);
+
+						uint32_t value_length = is_number ? sizeof(bits) : entry.m_value_length;
+
+						append(&entry.m_key_length, sizeof(entry.m_key_length));
+						append(&value_length, sizeof(value_length));
+						append(&entry.m_kind, sizeof(entry.m_kind));
+						append(&entry.m_expires, sizeof(entry.m_expires));
+						append(block, entry.m_key_length);
+						append(is_number ? (const char*)&bits : block + entry.m_key_length, value_length);
+
+						count++;
+					}
+
+					done = position >= total;
+				}
+			}
+
+			if (resized)
+			{
+				start();
+
+				position = 0;
+				restarts++;
+
+				continue;
+			}
+
+			flush();
+		}
+
+		uint32_t end = IPCKV_SNAPSHOT_END;
+
+		append(&end, sizeof(end));
+		append(&count, sizeof(count));
+		flush();
+
+		// Our checksum covers everything before it.
+		append(&checksum, sizeof(checksum));
+		flush();
+
+		if (fclose(file.release()) != 0)
+			throw std::runtime_error("could not write snapshot file.");
+
+		if (!ipckv_replace_file(temporary_path, path))
+			throw std::runtime_error("could not replace snapshot file.");
+	}
+	catch (...)
+	{
+		file.reset();
+		std::remove(temporary_path.c_str());
+
+		throw;
+	}
+}
+
+/**
+ * Restores our entries from the snapshot at path while we're holding the write lock,
+ * a snapshot which doesn't exist yet or fails its checksum is ignored.
+ */
+void IPC_KV::restore(const std::string& path)
+{
+	IPC_File_View file;
+
+	// The smallest snapshot is its magic, version, end marker, count and checksum.
+	if (!file.open(path) || file.size() < 24)
+		return;
+
+	auto view = file.data();
+	auto size = file.size();
+
+	uint32_t magic, version, checksum;
+
+	memcpy(&magic, view, sizeof(magic));
+	memcpy(&version, view + 4, sizeof(version));
+	memcpy(&checksum, view + size - sizeof(checksum), sizeof(checksum));
+
+	if (
+		magic != IPCKV_SNAPSHOT_MAGIC ||
+		version != IPCKV_SNAPSHOT_VERSION ||
+		crc32(0, view, size - sizeof(checksum)) != checksum
+	)
+	{
+		LOG("ignoring invalid snapshot %s\n", path.c_str());
+	}
+	else
+	{
+		auto time = get_time();
+		auto end = size - sizeof(checksum);
+
+		// Each entry is its key length, value length, kind and expiry followed by its key and value.
+		for (size_t position = 8; position + 4 <= end;)
+		{
+			uint32_t key_length, value_length;
+			uint8_t kind;
+			uint64_t expires;
+
+			memcpy(&key_length, view + position, sizeof(key_length));
+
+			if (key_length == IPCKV_SNAPSHOT_END || position + 17 > end)
+				break;
+
+			memcpy(&value_length, view + position + 4, sizeof(value_length));
+			memcpy(&kind, view + position + 8, sizeof(kind));
+			memcpy(&expires, view + position + 9, sizeof(expires));
+
+			position += 17;
+
+			if ((uint64_t)key_length + value_length > end - position)
+				break;
+
+			std::string key((const char*)view + position, key_length);
+			auto value = view + position + key_length;
+
+			position += (size_t)key_length + value_length;
+
+			if ((expires && expires <= time) || value_length > m_header->m_max_value_size)
+				continue;
+
+			if (kind == (uint8_t)IPC_KV_Kind::Bytes)
+			{
+				write_value(key, value, value_length, expires ? expires - time : 0);
+			}
+			else if (value_length == sizeof(int64_t))
+			{
+				int64_t bits;
+				memcpy(&bits, value, sizeof(bits));
+
+				IPC_KV_Number number;
+				number.kind = (IPC_KV_Kind)kind;
+				number.integer = bits;
+				number.real = to_double(bits);
+
+				auto entry = insert(key, hash(key.data(), key.length()), 0);
+
+				write_number(entry, number);
+				enforce_limit(entry);
+			}
+		}
+	}
+}
+
+/**
+ * Writes our snapshot every persist interval. Every process with the same
+ * path runs one of these, but only the first to claim an interval writes it.
+ */
+void IPC_KV::start_persister()
+{
+	std::lock_guard<std::mutex> background_lock(m_background_lock);
+
+	if (m_persister.joinable() || m_background_stopped)
+		return;
+
+	m_persister = std::thread([this]() {
+		std::unique_lock<std::mutex> background_lock(m_background_lock);
+
+		while (
+			!m_background_condition.wait_for(
+				background_lock,
+				std::chrono::milliseconds(m_persist_interval),
+				[this]() { return m_background_stopped; }
+			)
+		)
+		{
+			background_lock.unlock();
+
+			auto time = get_time();
+			auto snapshot_time = m_header->m_snapshot_time.load();
+
+			if (
+				time - snapshot_time >= m_persist_interval &&
+				m_header->m_snapshot_time.compare_exchange_strong(snapshot_time, time)
+			)
+			{
+				try
+				{
+					save(m_persist_path);
+				}
+				catch (std::exception& exception)
+				{
+					LOG("could not write snapshot %s: %s\n", m_persist_path.c_str(), exception.what());
+				}
+			}
+
+			background_lock.lock();
+		}
+	});
+}
+
+////////////////////////////////////////////////////
+
+/**
+ * Finds or makes the entry for our key with a block large enough for
+ * a value of size bytes, which is left for the caller to write.
+ */
+IPC_KV_Entry* IPC_KV::insert(const std::string& key, uint32_t key_hash, size_t size)
+{
+	migrate(IPCKV_MIGRATE_BUCKETS);
+
+	if (
+		!m_header->m_old_table &&
+		m_header->m_size + m_header->m_tombstones + 1 > m_header->m_capacity * IPCKV_MAX_LOAD_FACTOR
+	)
+		start_resize();
+
+	auto entry = find_slot(get_table(), m_header->m_capacity, key, key_hash);
+
+	// Our table only ever runs out of free entries while it's still filling up during a resize,
+	// which is the only time we move everything over at once.
+	if (entry == nullptr)
+	{
+		migrate(m_header->m_old_capacity);
+		start_resize();
+
+		entry = find_slot(get_table(), m_header->m_capacity, key, key_hash);
+
+		if (entry == nullptr)
+			throw std::runtime_error("could not find a free entry.");
+	}
+
+	// Our key might not have been moved over from our old table yet.
+	if (entry->m_state != Occupied && m_header->m_old_table)
+	{
+		auto old_entry = find_entry(get_old_table(), m_header->m_old_capacity, key, key_hash);
+
+		if (old_entry)
+		{
+			if (entry->m_state == Deleted)
+				m_header->m_tombstones--;
+
+			*entry = *old_entry;
+
+			set_state(entry, Occupied);
+			set_state(old_entry, Deleted);
+
+			bump_version(old_entry);
+		}
+	}
+
+	auto block_size = key.length() + size;
+
+	if (entry->m_state == Occupied)
+	{
+		// A value which stays in the same size class is overwritten in place.
+		if (size_class(entry->m_key_length + entry->m_value_length) != size_class(block_size))
+		{
+			auto block = allocate(block_size);
+
+			m_header->m_data_used -= get_block_size(*entry);
+			m_header->m_data_used += class_size(size_class(block_size));
+
+			free(entry->m_block, entry->m_key_length + entry->m_value_length);
+			entry->m_block = block;
+
+			memcpy(resolve(block), key.data(), key.length());
+		}
+	}
+	else
+	{
+		auto block = allocate(block_size);
+
+		m_header->m_data_used += class_size(size_class(block_size));
+
+		memcpy(resolve(block), key.data(), key.length());
+
+		if (entry->m_state == Deleted)
+			m_header->m_tombstones--;
+
+		entry->m_block = block;
+		entry->m_hash = key_hash;
+		entry->m_key_length = (uint32_t)key.length();
+
+		set_state(entry, Occupied);
+
+		m_header->m_size++;
+	}
+
+	entry->m_value_length = (uint32_t)size;
+
+	bump_version(entry);
+	notify(key_hash);
+
+	return entry;
+}
+
+/**
+ * Evicts other entries if we've gone over our memory limit.
+ */
+void IPC_KV::enforce_limit(IPC_KV_Entry* keep)
+{
+	if (m_header->m_max_memory && m_header->m_data_used > m_header->m_max_memory)
+		evict(keep);
+}
+
+////////////////////////////////////////////////////
+
+/**
+ * Writes our value while we're holding the write lock.
+ */
+void IPC_KV::write_value(const std::string& key, const unsigned char* data, size_t size, uint64_t ttl)
+{
+	if (size > m_header->m_max_value_size)
+	{
+		throw std::runtime_error("value is too large.");
+	}
+
+	auto key_hash = hash(key.data(), key.length());
+	auto entry = insert(key, key_hash, size);
+
+	if (size) memcpy(resolve(entry->m_block) + key.length(), data, size);
+
+	entry->m_kind = (uint8_t)IPC_KV_Kind::Bytes;
+	entry->m_expires = ttl ? get_time() + ttl : 0;
+	entry->m_referenced = 1;
+
+	if (ttl)
+		start_sweeper();
+
+	enforce_limit(entry);
+}
+
+/**
+ * Copies the value of our key into data while we're holding the read lock, numbers are
+ * given to us through number if we ask for them that way and otherwise as the eight bytes of their slot.
+ */
+bool IPC_KV::read_value(const std::string& key, std::vector<unsigned char>& data, IPC_KV_Number* number, uint64_t time, IPC_KV_Version* version)
+{
+	auto key_hash = hash(key.data(), key.length());
+	auto entry = find(key, key_hash);
+
+	// Expired entries are left for the next write or our sweeper to remove.
+	if (entry == nullptr || is_expired(*entry, time))
+	{
+		m_header->m_misses++;
+		return false;
+	}
+
+	// Many readers can set this at once, which is fine since it's only a hint for eviction.
+	entry->m_referenced = 1;
+
+	if (entry->m_kind != (uint8_t)IPC_KV_Kind::Bytes)
+	{
+		if (number)
+		{
+			*number = read_number(entry);
+			data.clear();
+		}
+		else
+		{
+			auto bits = load_slot(&entry->m_number);
+			data.assign((unsigned char*)&bits, (unsigned char*)&bits + sizeof(bits));
+		}
+	}
+	else
+	{
+		if (number)
+			number->kind = IPC_KV_Kind::Bytes;
+
+		auto value = (unsigned char*)resolve(entry->m_block) + entry->m_key_length;
+		data.assign(value, value + entry->m_value_length);
+	}
+
+	if (version)
+	{
+		version->entry = entry;
+		version->version = ipckv_load(&entry->m_version);
+		version->generation = ipckv_load(&m_header->m_generation);
+		version->expires = entry->m_expires;
+	}
+
+	m_header->m_hits++;
+
+	return true;
+}
+
+/**
+ * Removes our key while we're holding the write lock.
+ */
+bool IPC_KV::remove_value(const std::string& key, uint64_t time)
+{
+	auto key_hash = hash(key.data(), key.length());
+	auto entry = find(key, key_hash);
+
+	if (entry == nullptr)
+		return false;
+
+	auto expired = is_expired(*entry, time);
+
+	erase(entry);
+
+	if (expired)
+		m_header->m_expirations++;
+
+	return !expired;
+}
+
+////////////////////////////////////////////////////
+
+void IPC_KV::set(const std::string& key, const unsigned char* data, size_t size, uint64_t ttl)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+	write_value(key, data, size, ttl);
+}
+
+bool IPC_KV::get(const std::string& key, std::vector<unsigned char>& data, IPC_KV_Number* number, IPC_KV_Version* version)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+
+	return read_value(key, data, number, get_time(), version);
+}
+
+bool IPC_KV::read(const std::string& key, const std::function<unsigned char*(const unsigned char*, size_t)>& allocate)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+	auto entry = find(key, hash(key.data(), key.length()));
+
+	if (entry == nullptr || is_expired(*entry, get_time()) || entry->m_kind != (uint8_t)IPC_KV_Kind::Bytes)
+	{
+		m_header->m_misses++;
+		return false;
+	}
+
+	entry->m_referenced = 1;
+
+	auto value = (unsigned char*)resolve(entry->m_block) + entry->m_key_length;
+	auto destination = allocate(value, entry->m_value_length);
+
+	memcpy(destination, value, entry->m_value_length);
+
+	m_header->m_hits++;
+
+	return true;
+}
+
+/**
+ * Runs without our lock, so the entry we look at could be in a table that was let go of and
+ * reused in the meantime, which we'd notice by our generation having moved on once we're done.
+ */
+bool IPC_KV::is_current(const IPC_KV_Version& version)
+{
+	if (m_header == nullptr || version.entry == nullptr)
+		return false;
+
+	if (version.expires && version.expires <= get_time())
+		return false;
+
+	auto generation = ipckv_load(&m_header->m_generation);
+
+	if (generation != version.generation)
+		return false;
+
+	auto entry_version = ipckv_load((volatile int64_t*)&version.entry->m_version);
+
+	return entry_version == version.version && ipckv_load(&m_header->m_generation) == generation;
+}
+
+bool IPC_KV::remove(const std::string& key)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+	migrate(IPCKV_MIGRATE_BUCKETS);
+
+	return remove_value(key, get_time());
+}
+
+////////////////////////////////////////////////////
+
+/**
+ * Our batches take their lock only once for all of their keys.
+ */
+void IPC_KV::set_many(const std::vector<IPC_KV_Write>& writes, uint64_t ttl)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+	for (auto & write : writes)
+	{
+		write_value(write.key, write.data, write.size, ttl);
+	}
+}
+
+void IPC_KV::get_many(const std::vector<std::string>& keys, std::vector<IPC_KV_Value>& values)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	values.resize(keys.size());
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+	auto time = get_time();
+
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		values[i].found = read_value(keys[i], values[i].data, &values[i].number, time);
+	}
+}
+
+size_t IPC_KV::remove_many(const std::vector<std::string>& keys)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+	auto time = get_time();
+
+	size_t removed = 0;
+
+	for (auto & key : keys)
+	{
+		migrate(IPCKV_MIGRATE_BUCKETS);
+
+		if (remove_value(key, time))
+			removed++;
+	}
+
+	return removed;
+}
+
+////////////////////////////////////////////////////
+
+int64_t IPC_KV::version(const std::string& key)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+	auto entry = find(key, hash(key.data(), key.length()));
+
+	if (entry == nullptr || is_expired(*entry, get_time()))
+		return 0;
+
+	return ipckv_load(&entry->m_version);
+}
+
+/**
+ * We watch our key before looking at its version, so a write
+ * in between the two still ends our next wait for changes.
+ */
+int64_t IPC_KV::wait(const std::string& key, int64_t version, uint64_t timeout)
+{
+	auto deadline = get_time() + timeout;
+	int64_t current = 0;
+
+	watch(key);
+
+	try
+	{
+		for (;;)
+		{
+			current = this->version(key);
+
+			auto time = get_time();
+
+			if (current != version || time >= deadline)
+				break;
+
+			auto remaining = deadline - time;
+
+			wait_for_changes(remaining < IPCKV_WAIT_INTERVAL ? (uint32_t)remaining : IPCKV_WAIT_INTERVAL);
+		}
+	}
+	catch (...)
+	{
+		unwatch(key);
+		throw;
+	}
+
+	unwatch(key);
+
+	return current;
+}
+
+void IPC_KV::watch(const std::string& key)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto bucket = hash(key.data(), key.length()) % IPCKV_WATCH_BUCKETS;
+
+	std::lock_guard<std::mutex> watch_lock(m_watch_lock);
+
+	if (m_watch_counts[bucket]++)
+		return;
+
+	// Only taking our watcher needs the write lock, our own bits are only ever changed by us.
+	if (m_watcher < 0)
+	{
+		try
+		{
+			auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+			claim_watcher();
+		}
+		catch (...)
+		{
+			m_watch_counts[bucket]--;
+			throw;
+		}
+	}
+
+	auto& watcher = m_header->m_watchers[m_watcher];
+
+	ipckv_fetch_or(&watcher.m_buckets[bucket / 64], 1ll << (bucket % 64));
+	ipckv_fetch_add(&m_header->m_watched[bucket], 1);
+}
+
+void IPC_KV::unwatch(const std::string& key)
+{
+	if (m_header == nullptr)
+		return;
+
+	auto bucket = hash(key.data(), key.length()) % IPCKV_WATCH_BUCKETS;
+
+	std::lock_guard<std::mutex> watch_lock(m_watch_lock);
+
+	if (m_watch_counts[bucket] == 0 || --m_watch_counts[bucket])
+		return;
+
+	if (m_watcher < 0)
+		return;
+
+	auto& watcher = m_header->m_watchers[m_watcher];
+
+	ipckv_fetch_and(&watcher.m_buckets[bucket / 64], ~(1ll << (bucket % 64)));
+	ipckv_fetch_add(&m_header->m_watched[bucket], -1);
+}
+
+void IPC_KV::wait_for_changes(uint32_t timeout)
+{
+	if (m_watcher < 0)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+		return;
+	}
+
+	m_watcher_signal.wait(timeout);
+}
+
+void IPC_KV::wake()
+{
+	if (m_watcher >= 0)
+		m_watcher_signal.notify();
+}
+
+/**
+ * Takes one of our header's watchers for our process while we're holding the write lock,
+ * those of processes which have exited without letting go of theirs are taken back first.
+ */
+void IPC_KV::claim_watcher()
+{
+	if (m_watcher >= 0)
+		return;
+
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		for (uint32_t i = 0; i < IPCKV_MAX_WATCHERS; i++)
+		{
+			auto& watcher = m_header->m_watchers[i];
+
+			if (watcher.m_token)
+				continue;
+
+			auto token = ++m_header->m_watcher_token;
+
+			if (!m_watcher_signal.open(m_name + "_watcher_" + std::to_string(token), &watcher.m_signal, true))
+				throw std::runtime_error("could not create watcher signal.");
+
+			watcher.m_signal = 0;
+			watcher.m_process = ipckv_process_id();
+			ipckv_store(&watcher.m_token, token);
+
+			m_watcher = (int32_t)i;
+
+			return;
+		}
+
+		for (uint32_t i = 0; i < IPCKV_MAX_WATCHERS; i++)
+		{
+			auto& watcher = m_header->m_watchers[i];
+
+			if (!watcher.m_token || ipckv_process_alive(watcher.m_process))
+				continue;
+
+			for (uint32_t bucket = 0; bucket < IPCKV_WATCH_BUCKETS; bucket++)
+			{
+				if (watcher.m_buckets[bucket / 64] & (1ll << (bucket % 64)))
+					ipckv_fetch_add(&m_header->m_watched[bucket], -1);
+			}
+
+			memset((void*)&watcher, 0, sizeof(watcher));
+		}
+	}
+
+	throw std::runtime_error("too many watchers.");
+}
+
+/**
+ * Lets go of our watcher while we're holding our watch lock and the write lock.
+ */
+void IPC_KV::release_watcher()
+{
+	if (m_watcher < 0)
+		return;
+
+	auto& watcher = m_header->m_watchers[m_watcher];
+
+	for (uint32_t bucket = 0; bucket < IPCKV_WATCH_BUCKETS; bucket++)
+	{
+		if (watcher.m_buckets[bucket / 64] & (1ll << (bucket % 64)))
+			ipckv_fetch_add(&m_header->m_watched[bucket], -1);
+	}
+
+	memset((void*)&watcher, 0, sizeof(watcher));
+
+	m_watcher_signal.close();
+	m_watcher = -1;
+
+	memset(m_watch_counts, 0, sizeof(m_watch_counts));
+}
+
+/**
+ * Wakes the watchers of the bucket of a key we've changed, which most of the time
+ * is nobody and only costs us a look at how many watchers the bucket has.
+ */
+void IPC_KV::notify(uint32_t key_hash)
+{
+	auto bucket = key_hash % IPCKV_WATCH_BUCKETS;
+
+	if (ipckv_load(&m_header->m_watched[bucket]) <= 0)
+		return;
+
+	for (uint32_t i = 0; i < IPCKV_MAX_WATCHERS; i++)
+	{
+		auto& watcher = m_header->m_watchers[i];
+		auto token = ipckv_load(&watcher.m_token);
+
+		if (token && (ipckv_load(&watcher.m_buckets[bucket / 64]) & (1ll << (bucket % 64))))
+			signal_watcher(i, token);
+	}
+}
+
+void IPC_KV::notify_all()
+{
+	for (uint32_t i = 0; i < IPCKV_MAX_WATCHERS; i++)
+	{
+		auto token = ipckv_load(&m_header->m_watchers[i].m_token);
+
+		if (token)
+			signal_watcher(i, token);
+	}
+}
+
+void IPC_KV::signal_watcher(uint32_t index, int64_t token)
+{
+	std::lock_guard<std::mutex> signals_lock(m_signals_lock);
+
+	// Our cached signal belongs to a previous watcher.
+	if (m_watcher_tokens[index] != token)
+	{
+		m_watcher_signals[index].close();
+		m_watcher_tokens[index] = 0;
+
+		if (!m_watcher_signals[index].open(m_name + "_watcher_" + std::to_string(token), &m_header->m_watchers[index].m_signal, false))
+			return;
+
+		m_watcher_tokens[index] = token;
+	}
+
+	m_watcher_signals[index].notify();
+}
+
+////////////////////////////////////////////////////
+
+/**
+ * Appends the keys of a table whose home is group, which are in it or somewhere
+ * along its probe sequence up to the first group with an empty entry.
+ */
+void IPC_KV::scan_group(IPC_KV_Entry* table, size_t capacity, size_t group, const std::string& prefix, uint64_t time, std::vector<std::string>& keys)
+{
+	auto control = get_control(table, capacity);
+	auto tags = get_tags(table, capacity);
+
+	auto groups = capacity / IPCKV_GROUP_SIZE;
+	auto home = group;
+
+	for (size_t step = 1; step <= groups; step++)
+	{
+		auto start = group * IPCKV_GROUP_SIZE;
+
+		for (auto matches = match_occupied(control + start); matches; matches &= matches - 1)
+		{
+			auto index = start + ipckv_trailing_zeros(matches);
+			auto& entry = table[index];
+
+			if (get_first_group(tags[index], groups) != home || is_expired(entry, time))
+				continue;
+
+			auto key = resolve(entry.m_block);
+
+			if (entry.m_key_length >= prefix.length() && memcmp(key, prefix.data(), prefix.length()) == 0)
+				keys.emplace_back(key, entry.m_key_length);
+		}
+
+		if (match_group(control + start, IPCKV_CONTROL_EMPTY))
+			return;
+
+		group = get_next_group(group, step, groups);
+	}
+}
+
+/**
+ * Appends the keys of about count groups starting at cursor and returns where the next call picks up,
+ * which is zero once we're done. We only hold the read lock for the groups of one call. Every key that's
+ * there for the whole scan is returned at least once even if our table is resized in between, and
+ * a key could be returned more than once if it was.
+ */
+uint64_t IPC_KV::scan(uint64_t cursor, size_t count, std::vector<std::string>& keys, const std::string& prefix)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+	auto time = get_time();
+
+	auto table = get_table();
+	size_t capacity = m_header->m_capacity;
+	uint64_t mask = capacity / IPCKV_GROUP_SIZE - 1;
+
+	// Our old table is never larger than ours, so each of its groups covers one or more of ours.
+	auto old_table = get_old_table();
+	size_t old_capacity = m_header->m_old_capacity;
+	uint64_t old_mask = old_table ? old_capacity / IPCKV_GROUP_SIZE - 1 : 0;
+
+	auto start = keys.size();
+
+	for (size_t visited = 0; visited < count && keys.size() - start < count; visited++)
+	{
+		if (old_table)
+			scan_group(old_table, old_capacity, (size_t)(cursor & old_mask), prefix, time, keys);
+
+		do
+		{
+			scan_group(table, capacity, (size_t)(cursor & mask), prefix, time, keys);
+			cursor = get_next_cursor(cursor, mask);
+		}
+		while (old_table && (cursor & (old_mask ^ mask)));
+
+		if (cursor == 0)
+			break;
+	}
+
+	return cursor;
+}
+
+/**
+ * Returns up to limit keys starting with prefix, or all of them if limit is zero, by
+ * scanning a chunk of our table at a time so that writers get their turn in between.
+ */
+std::vector<std::string> IPC_KV::keys(const std::string& prefix, size_t limit)
+{
+	std::vector<std::string> keys;
+	std::vector<std::string> chunk;
+	std::unordered_set<std::string> seen;
+
+	uint64_t cursor = 0;
+
+	do
+	{
+		chunk.clear();
+		cursor = scan(cursor, IPCKV_SCAN_COUNT, chunk, prefix);
+
+		for (auto & key : chunk)
+		{
+			if (limit && keys.size() >= limit)
+				return keys;
+
+			// A resize in between our chunks can hand us the same key twice.
+			if (seen.insert(key).second)
+				keys.push_back(std::move(key));
+		}
+	}
+	while (cursor != 0);
+
+	return keys;
+}
+
+////////////////////////////////////////////////////
+
+/**
+ * Turns an entry into a number, this is only ever done while holding the write lock.
+ */
+void IPC_KV::write_number(IPC_KV_Entry* entry, const IPC_KV_Number& number)
+{
+	entry->m_kind = (uint8_t)number.kind;
+	entry->m_number = number.kind == IPC_KV_Kind::Integer ? number.integer : to_bits(number.real);
+	entry->m_expires = 0;
+	entry->m_referenced = 1;
+}
+
+IPC_KV_Number IPC_KV::read_number(IPC_KV_Entry* entry)
+{
+	IPC_KV_Number number;
+	number.kind = (IPC_KV_Kind)entry->m_kind;
+
+	auto bits = load_slot(&entry->m_number);
+
+	if (number.kind == IPC_KV_Kind::Integer)
+		number.integer = bits;
+	else if (number.kind == IPC_KV_Kind::Double)
+		number.real = to_double(bits);
+	else
+		throw std::runtime_error("value is not a number.");
+
+	return number;
+}
+
+/**
+ * Adds to the number of an entry, any number of processes can do so
+ * at once while holding the read lock since the slot is updated atomically.
+ */
+IPC_KV_Number IPC_KV::add_number(IPC_KV_Entry* entry, const IPC_KV_Number& delta)
+{
+	IPC_KV_Number result;
+	result.kind = (IPC_KV_Kind)entry->m_kind;
+
+	if (result.kind == IPC_KV_Kind::Integer)
+	{
+		if (delta.kind != IPC_KV_Kind::Integer)
+			throw std::runtime_error("value is an integer.");
+
+		result.integer = ipckv_fetch_add(&entry->m_number, delta.integer) + delta.integer;
+	}
+	else if (result.kind == IPC_KV_Kind::Double)
+	{
+		auto current = load_slot(&entry->m_number);
+
+		for (;;)
+		{
+			auto next = to_bits(to_double(current) + as_double(delta));
+
+			if (exchange_slot(&entry->m_number, current, next))
+			{
+				result.real = to_double(next);
+				break;
+			}
+		}
+	}
+	else
+	{
+		throw std::runtime_error("value is not a number.");
+	}
+
+	return result;
+}
+
+/**
+ * Replaces the number of an entry with next if it's still equal to expected.
+ */
+bool IPC_KV::compare_number(IPC_KV_Entry* entry, const IPC_KV_Number& expected, const IPC_KV_Number& next)
+{
+	auto kind = (IPC_KV_Kind)entry->m_kind;
+
+	if (kind == IPC_KV_Kind::Integer)
+	{
+		if (next.kind != IPC_KV_Kind::Integer)
+			throw std::runtime_error("value is an integer.");
+
+		if (expected.kind != IPC_KV_Kind::Integer)
+			return false;
+
+		auto current = expected.integer;
+
+		return exchange_slot(&entry->m_number, current, next.integer);
+	}
+
+	if (kind == IPC_KV_Kind::Double)
+	{
+		auto current = load_slot(&entry->m_number);
+		auto desired = to_bits(as_double(next));
+
+		// We compare values rather than bits, otherwise 0 and -0 would differ.
+		while (to_double(current) == as_double(expected))
+		{
+			if (exchange_slot(&entry->m_number, current, desired))
+				return true;
+		}
+
+		return false;
+	}
+
+	throw std::runtime_error("value is not a number.");
+}
+
+IPC_KV_Number IPC_KV::increment(const std::string& key, const IPC_KV_Number& delta)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto key_hash = hash(key.data(), key.length());
+
+	// Numbers which already exist only need the read lock.
+	{
+		auto lock = get_lock(IPCKV_READ_LOCK);
+		auto entry = find(key, key_hash);
+
+		if (entry && !is_expired(*entry, get_time()))
+		{
+			entry->m_referenced = 1;
+
+			auto number = add_number(entry, delta);
+
+			bump_version(entry);
+			notify(key_hash);
+
+			return number;
+		}
+	}
+
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+	auto entry = find(key, key_hash);
+
+	// Someone else might have made our number while we were waiting for the write lock.
+	if (entry && !is_expired(*entry, get_time()))
+	{
+		auto number = add_number(entry, delta);
+
+		bump_version(entry);
+		notify(key_hash);
+
+		return number;
+	}
+
+	entry = insert(key, key_hash, 0);
+
+	write_number(entry, delta);
+	enforce_limit(entry);
+
+	return delta;
+}
+
+bool IPC_KV::compare_and_set(const std::string& key, const IPC_KV_Number* expected, const IPC_KV_Number& next)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto key_hash = hash(key.data(), key.length());
+
+	{
+		auto lock = get_lock(IPCKV_READ_LOCK);
+		auto entry = find(key, key_hash);
+
+		if (entry && !is_expired(*entry, get_time()))
+		{
+			if (!expected || !compare_number(entry, *expected, next))
+				return false;
+
+			bump_version(entry);
+			notify(key_hash);
+
+			return true;
+		}
+
+		if (expected)
+			return false;
+	}
+
+	// Without an expected number we only set our key if it doesn't exist.
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+	auto entry = find(key, key_hash);
+
+	if (entry && !is_expired(*entry, get_time()))
+		return false;
+
+	entry = insert(key, key_hash, 0);
+
+	write_number(entry, next);
+	enforce_limit(entry);
+
+	return true;
+}
+
+bool IPC_KV::get_number(const std::string& key, IPC_KV_Number& number)
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto key_hash = hash(key.data(), key.length());
+	auto lock = get_lock(IPCKV_READ_LOCK);
+
+	auto entry = find(key, key_hash);
+
+	if (entry == nullptr || is_expired(*entry, get_time()))
+	{
+		m_header->m_misses++;
+		return false;
+	}
+
+	number = read_number(entry);
+	entry->m_referenced = 1;
+
+	m_header->m_hits++;
+
+	return true;
+}
+
+////////////////////////////////////////////////////
+
+void IPC_KV::clear()
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+	// Moving everything over first leaves us with only one table to clear.
+	migrate(m_header->m_old_capacity);
+
+	auto table = get_table();
+
+	for (size_t i = 0; i < m_header->m_capacity; i++)
+	{
+		if (table[i].m_state == Occupied)
+			free(table[i].m_block, table[i].m_key_length + table[i].m_value_length);
+	}
+
+	memset(get_control(table, m_header->m_capacity), 0, table_size(m_header->m_capacity));
+
+	ipckv_store(&m_header->m_generation, m_header->m_generation + 1);
+	notify_all();
+
+	m_header->m_size = 0;
+	m_header->m_tombstones = 0;
+	m_header->m_data_used = 0;
+}
+
+void IPC_KV::print()
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+	auto table = get_table();
+
+	auto old_table = get_old_table();
+
+	LOG(
+		"size: %llu, capacity: %llu, memory: %llu\n",
+		(unsigned long long)m_header->m_size,
+		(unsigned long long)m_header->m_capacity,
+		(unsigned long long)m_header->m_memory_used
+	);
+
+	for (size_t i = 0; i < m_header->m_capacity; i++)
+	{
+		if (table[i].m_state != Occupied)
+			continue;
+
+		std::string key(resolve(table[i].m_block), table[i].m_key_length);
+
+		LOG("%zu: %s (%u bytes)\n", i, key.c_str(), table[i].m_value_length);
+	}
+
+	for (size_t i = 0; old_table && i < m_header->m_old_capacity; i++)
+	{
+		if (old_table[i].m_state != Occupied)
+			continue;
+
+		std::string key(resolve(old_table[i].m_block), old_table[i].m_key_length);
+
+		LOG("old %zu: %s (%u bytes)\n", i, key.c_str(), old_table[i].m_value_length);
+	}
+}
+
+size_t IPC_KV::size()
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+
+	return (size_t)m_header->m_size;
+}
+
+size_t IPC_KV::memory_usage()
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+
+	return (size_t)m_header->m_memory_used;
+}
+
+IPC_KV_Stats IPC_KV::stats()
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	auto lock = get_lock(IPCKV_READ_LOCK);
+
+	IPC_KV_Stats stats;
+
+	stats.hits = m_header->m_hits;
+	stats.misses = m_header->m_misses;
+	stats.evictions = m_header->m_evictions;
+	stats.expirations = m_header->m_expirations;
+	stats.size = m_header->m_size;
+	stats.memory = m_header->m_data_used;
+	stats.reserved = m_header->m_segment_used;
+
+	for (uint32_t i = 0; i + 1 < m_header->m_segment_count; i++)
+		stats.reserved += m_header->m_segment_sizes[i];
+
+	return stats;
+}
+
+size_t IPC_KV::max_value_size()
+{
+	if (m_header == nullptr)
+	{
+		throw std::runtime_error("class is in an invalid state.");
+	}
+
+	return (size_t)m_header->m_max_value_size;
+}
+
+void IPC_KV::close()
+{
+	// Our sweeper and persister have to be gone before we unmap anything they could be looking at.
+	{
+		std::lock_guard<std::mutex> background_lock(m_background_lock);
+		m_background_stopped = true;
+	}
+
+	m_background_condition.notify_all();
+
+	if (m_sweeper.joinable())
+		m_sweeper.join();
+
+	if (m_persister.joinable())
+		m_persister.join();
+
+	// The last of us to close the store removes its names, where they'd otherwise outlive every process.
+	// Anyone who opens the store from then on starts a new one.
+	if (m_attached)
+	{
+		m_attached = false;
+
+		try
+		{
+			// Our watcher's bits are changed under our watch lock, which is always taken before the write lock.
+			std::lock_guard<std::mutex> watch_lock(m_watch_lock);
+			auto lock = get_lock(IPCKV_WRITE_LOCK);
+
+			release_watcher();
+
+			if (--m_header->m_references == 0)
+			{
+				for (uint32_t i = 0; i < m_header->m_segment_count; i++)
+					IPC_Shared_Memory::unlink(m_name + "_segment_" + std::to_string(i));
+
+				IPC_Shared_Memory::unlink(m_name + "_header");
+				IPC_RW_Lock::unlink(m_name);
+			}
+		}
+		catch (std::exception& exception)
+		{
+			LOG("could not close %s: %s\n", m_name.c_str(), exception.what());
+		}
+	}
+
+	std::lock_guard<std::mutex> segments_lock(m_segments_lock);
+
+	for (size_t i = 0; i < IPCKV_MAX_SEGMENTS; i++)
+	{
+		m_segments[i].store(nullptr);
+		m_segment_memory[i].close();
+	}
+
+	{
+		std::lock_guard<std::mutex> signals_lock(m_signals_lock);
+
+		for (uint32_t i = 0; i < IPCKV_MAX_WATCHERS; i++)
+		{
+			m_watcher_signals[i].close();
+			m_watcher_tokens[i] = 0;
+		}
+	}
+
+	m_header = nullptr;
+	m_header_memory.close();
+	m_lock.close();
+}
+
+////////////////////////////////////////////////////
+
+/**
+ * FNV-1a
+ */
+uint32_t IPC_KV::hash(const char* key, size_t count)
+{
+	uint32_t hash = 2166136261u;
+
+	for (size_t i = 0; i < count; i++)
+	{
+		hash ^= (unsigned char)key[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+IPC_Lock IPC_KV::get_lock(bool is_writing)
+{
+	return IPC_Lock(is_writing, &m_lock);
+}
@@ -1,529 +1,465 @@
 #pragma once
-#include <Windows.h>
+#include "ipckv_platform.h"
 #include <string>
+#include <cstring>
+#include <cstdio>
+#include <memory>
+#include <utility>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <iostream>
-#include <tuple> 
+#include <tuple>
+#include <unordered_set>
+#include <stdexcept>
 
 #define LOG(...) printf(__VA_ARGS__)
-#define IPCKV_MAX_LOCKS 24 
 
-#define IPCKV_MAX_LOAD_FACTOR 0.6f  
-#define IPCKV_INITIAL_CAPACITY 101
-#define IPCKV_DATA_SIZE 2048 
-#define IPCKV_KEY_SIZE 260
+#define IPCKV_MAX_LOAD_FACTOR 0.6f
+#define IPCKV_INITIAL_CAPACITY 128
+#define IPCKV_MAX_VALUE_SIZE (1024 * 1024)
 
-#define IPCKV_LOAD_FACTOR (float)m_controller->getSize() / (float)m_controller->getCapacity()
+// How often and how many buckets of our table are swept for expired entries.
+#define IPCKV_SWEEP_INTERVAL 100
+#define IPCKV_SWEEP_BUCKETS 4096
 
-#define IPCKV_C1_CONSTANT 3
-#define IPCKV_C2_CONSTANT 5
+// The number of buckets of our old table which every write moves over while resizing.
+#define IPCKV_MIGRATE_BUCKETS 64
+
+// The most entries our clock hand passes over to evict for a single write, what's left is evicted by the next ones.
+#define IPCKV_EVICT_BUCKETS 4096
+
+// How often a snapshot is written, and how many buckets are copied per read lock while writing it.
+#define IPCKV_PERSIST_INTERVAL 60000
+#define IPCKV_SNAPSHOT_BUCKETS 4096
+
+// How many times a snapshot starts over because our table was resized under it, before it copies everything under one read lock.
+#define IPCKV_SNAPSHOT_RESTARTS 4
+
+// How many keys are asked for per scan while listing our keys.
+#define IPCKV_SCAN_COUNT 1024
+
+#define IPCKV_SNAPSHOT_MAGIC 0x534B4350
+#define IPCKV_SNAPSHOT_VERSION 1
+#define IPCKV_SNAPSHOT_END 0xFFFFFFFF
+
+// Our table is probed a group of control bytes at a time, which is a multiple of its capacity. A control
+// byte is zero for an empty entry so that a fresh table is already cleared, and otherwise holds 7 bits of its hash.
+#define IPCKV_GROUP_SIZE 16
+#define IPCKV_CONTROL_EMPTY 0x00
+#define IPCKV_CONTROL_DELETED 0x01
+#define IPCKV_CONTROL_OCCUPIED 0x80
+
+// Processes waiting for keys to change register as one of our watchers, and are only woken by
+// writes to the buckets of keys they're waiting on. They look again at least every interval regardless.
+#define IPCKV_MAX_WATCHERS 64
+#define IPCKV_WATCH_BUCKETS 256
+#define IPCKV_WAIT_INTERVAL 1000
 
 #define IPCKV_READ_LOCK false
 #define IPCKV_WRITE_LOCK true
 
-#define IPCKV_BIT_HIGH 0b00000001
+#define IPCKV_MAGIC 0x564B4350
 
-class IPC_Lock;
-class IPC_KV_Controller;
-struct IPC_KV_Data;
-struct IPC_KV_Info;
+// Our shared memory is split into segments which double in size, an offset
+// into it holds the segment in its upper bits and the position in its lower bits.
+#define IPCKV_MAX_SEGMENTS 32
+#define IPCKV_SEGMENT_SIZE (1024 * 1024)
+#define IPCKV_SEGMENT_SHIFT 40
+#define IPCKV_SEGMENT_MASK ((1ull << IPCKV_SEGMENT_SHIFT) - 1)
+#define IPCKV_SEGMENT_RESERVED 64
 
-class IPC_KV
-{
-public:
-	/**
-	* Constructors and destructors
-	*/
-	IPC_KV(const std::string& name);
-	~IPC_KV();
+// Blocks are allocated from size classes, which are 16 bytes apart up to
+// 256 bytes and four steps per power of two apart after that.
+#define IPCKV_SIZE_CLASSES 128
+#define IPCKV_SMALL_CLASSES 16
+#define IPCKV_MIN_BLOCK_SIZE 16
+#define IPCKV_SMALL_BLOCK_SIZE (IPCKV_MIN_BLOCK_SIZE * IPCKV_SMALL_CLASSES)
 
-	/**
-	* Public Methods
-	*/
-	void set(const std::string& key, unsigned char* data, size_t size);
-	bool get(const std::string& key, unsigned char* data, size_t& size);
-	bool remove(const std::string& key);
-	void clear();
-	void print();
-	size_t size();
-	void close();
-private:
-	/**
-	* Private Methods
-	*/
-	void initialize_info(const std::string& name);
-	std::tuple<IPC_KV_Data*, HANDLE> initialize_data(const std::string& name, size_t capacity, size_t resize_count);
+class IPC_Lock;
+struct IPC_KV_Entry;
+struct IPC_KV_Header;
 
-	void resize();
-	bool is_prime(size_t input);
+struct IPC_KV_Options
+{
+	size_t max_value_size = IPCKV_MAX_VALUE_SIZE;
 
-	size_t find_nearest_prime(size_t input);
-	uint32_t hash(const char* key, size_t count);
-	IPC_Lock get_lock(bool is_writing);
+	// The most memory in bytes for our keys and values before entries
+	// are evicted, zero means we never evict anything.
+	uint64_t max_memory = 0;
 
-	/**
-	* Private Members
-	*/
-	IPC_KV_Controller* m_controller = nullptr;
-	std::string m_name;
-	size_t m_resize_count;
+	// Where our snapshot is written to and restored from, an empty path means we're never persisted.
+	std::string persist_path;
+	uint64_t persist_interval = IPCKV_PERSIST_INTERVAL;
 };
 
-enum IPC_KV_Data_State
+// Numbers are kept right in their entry, where they're updated atomically without the write lock.
+enum class IPC_KV_Kind : uint8_t
 {
-	Empty = 0,
-	Deleted = 1,
-	Occupied = 2,
+	Bytes = 0,
+	Integer = 1,
+	Double = 2,
 };
 
-struct IPC_KV_Data
+struct IPC_KV_Number
 {
-	IPC_KV_Data_State m_state[2];
+	IPC_KV_Kind kind = IPC_KV_Kind::Integer;
+	int64_t integer = 0;
+	double real = 0;
+};
 
-	char m_key[2][IPCKV_KEY_SIZE];
-	unsigned char m_value[2][IPCKV_DATA_SIZE];
+struct IPC_KV_Value
+{
+	bool found = false;
+	IPC_KV_Number number;
+	std::vector<unsigned char> data;
+};
 
-	size_t m_size[2];
+/**
+ * Where a value was read from and which write it was, so that a process caching the
+ * value can tell whether it's still current without taking the lock.
+ */
+struct IPC_KV_Version
+{
+	const IPC_KV_Entry* entry = nullptr;
+	int64_t version = 0;
+	int64_t generation = 0;
+	uint64_t expires = 0;
+};
 
-	char m_buffer_state;
+struct IPC_KV_Write
+{
+	std::string key;
+	const unsigned char* data;
+	size_t size;
 };
 
-struct IPC_KV_Info
+struct IPC_KV_Stats
 {
-	char m_buffer_state;
-	size_t m_capacity[2];
-	size_t m_size[2];
-	size_t m_resize_count[2];
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t expirations;
+	uint64_t size;
+	uint64_t memory;
+	// What has been carved out of our segments so far, freed blocks included.
+	uint64_t reserved;
 };
 
-class IPC_KV_Controller
+class IPC_KV
 {
 public:
-	IPC_KV_Controller() {}
-
-	~IPC_KV_Controller()
-	{
-		if (m_data)
-			UnmapViewOfFile(m_data);
-
-		if (m_info)
-			UnmapViewOfFile(m_info);
-
-		if (m_data_handle)
-			CloseHandle(m_data_handle);
-
-		if (m_info_handle)
-			CloseHandle(m_info_handle);
-	}
-
-	// Disallow copying and moving.
-	IPC_KV_Controller(const IPC_KV_Controller&) = delete;
-	IPC_KV_Controller(IPC_KV_Controller&&) = delete;
-	IPC_KV_Controller& operator=(const IPC_KV_Controller&) = delete;
-	IPC_KV_Controller& operator=(IPC_KV_Controller&&) = delete;
-
-
 	/**
-	* m_info Setters
+	* Constructors and destructors
 	*/
+	IPC_KV(const std::string& name, const IPC_KV_Options& options = IPC_KV_Options());
+	~IPC_KV();
 
-	enum InfoTransaction
-	{
-		InfoNone = 0,
-		InfoResizeCount = (1 << 0),
-		InfoCapacity = (1 << 1),
-		InfoSize = (1 << 2),
-	};
+	IPC_KV(const IPC_KV&) = delete;
+	IPC_KV& operator=(const IPC_KV&) = delete;
 
 	/**
-	* Commit Info
+	* Public Methods
 	*/
-	void commitInfo()
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		if (!m_has_started_info_transaction)
-			throw std::runtime_error("a info transaction has not been started.");
-
-		/////////////////////////////////////////////////
-
-		if (!(m_info_transaction_flags & InfoTransaction::InfoResizeCount))
-			setResizeCount(getResizeCount());
-
-		if (!(m_info_transaction_flags & InfoTransaction::InfoCapacity))
-			setCapacity(getCapacity());
-
-		if (!(m_info_transaction_flags & InfoTransaction::InfoSize))
-			setSize(getSize());
-
-		/////////////////////////////////////////////////
-
-		InterlockedXor8(&m_info->m_buffer_state, IPCKV_BIT_HIGH);
-
-		m_has_started_info_transaction = false;
-	}
-
-	void startInfoTransaction()
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		if (m_has_started_info_transaction)
-			throw std::runtime_error("a info transaction has already been started.");
-
-		m_has_started_info_transaction = true;
-		m_info_transaction_flags = InfoTransaction::InfoNone;
-	}
-
-	void setResizeCount(size_t resize_count)
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		if (!m_has_started_info_transaction)
-			throw std::runtime_error("a info transaction has not been started.");
-
-		bool buffer_state = !InterlockedAnd8(&m_info->m_buffer_state, IPCKV_BIT_HIGH);
-
-		m_info->m_resize_count[buffer_state] = resize_count;
-		m_info_transaction_flags = (InfoTransaction)(m_info_transaction_flags | InfoTransaction::InfoResizeCount);
-	}
-
-	void setCapacity(size_t capacity)
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		if (!m_has_started_info_transaction)
-			throw std::runtime_error("a info transaction has not been started.");
-
-		bool buffer_state = !InterlockedAnd8(&m_info->m_buffer_state, IPCKV_BIT_HIGH);
-
-		m_info->m_capacity[buffer_state] = capacity;
-		m_info_transaction_flags = (InfoTransaction)(m_info_transaction_flags | InfoTransaction::InfoCapacity);
-	}
-
-	void setSize(size_t size)
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		if (!m_has_started_info_transaction)
-			throw std::runtime_error("a info transaction has not been started.");
-
-		bool buffer_state = !InterlockedAnd8(&m_info->m_buffer_state, IPCKV_BIT_HIGH);
-
-		m_info->m_size[buffer_state] = size;
-		m_info_transaction_flags = (InfoTransaction)(m_info_transaction_flags | InfoTransaction::InfoSize);
-	}
+	void set(const std::string& key, const unsigned char* data, size_t size, uint64_t ttl = 0);
+	bool get(const std::string& key, std::vector<unsigned char>& data, IPC_KV_Number* number = nullptr, IPC_KV_Version* version = nullptr);
+	bool remove(const std::string& key);
 
 	/**
-	* m_Data Setters
-	*/
-
-	enum DataTransaction
-	{
-		DataNone = 0,
-		DataState = (1 << 0),
-		DataKey = (1 << 1),
-		DataValue = (1 << 2),
-		DataSize = (1 << 3),
-	};
+	 * Copies the bytes of our key straight into the memory allocate hands us for them, so a caller
+	 * with memory of its own skips our vector. allocate sees the bytes first, and can throw to refuse
+	 * them before asking for any memory. Returns false for keys which don't exist or hold numbers.
+	 */
+	bool read(const std::string& key, const std::function<unsigned char*(const unsigned char*, size_t)>& allocate);
 
 	/**
-	* Commit Data
-	*/
-	void commitData(size_t index)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
-
-		if (!m_has_started_data_transaction)
-			throw std::runtime_error("a data transaction has not been started.");
-
-		/////////////////////////////////////////////////
-
-		if (!(m_data_transaction_flags & DataTransaction::DataSize))
-			setDataSize(index, getDataSize(index));
-
-		if (!(m_data_transaction_flags & DataTransaction::DataState))
-			setDataState(index, getDataState(index));
-
-		if (!(m_data_transaction_flags & DataTransaction::DataValue))
-			setData(index, getData(index), getDataSize(index));
-
-		if (!(m_data_transaction_flags & DataTransaction::DataKey))
-			setDataKey(index, getDataKey(index), strlen(getDataKey(index)));
-
-		///////////////////////////////////////////////// 
-
-		InterlockedXor8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
-
-		m_has_started_data_transaction = false;
-	}
-
-	void startDataTransaction(size_t index)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
-
-		if (m_has_started_data_transaction)
-			throw std::runtime_error("a data transaction has already been started.");
-
-		m_has_started_data_transaction = true;
-		m_data_transaction_flags = DataTransaction::DataNone;
-	}
-
-	void setDataSize(size_t index, size_t size)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
+	 * Returns whether the value a version was read with hasn't been written, removed or
+	 * moved since, which only looks at a couple of counters in our shared memory.
+	 */
+	bool is_current(const IPC_KV_Version& version);
 
-		bool buffer_state = !InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
+	void set_many(const std::vector<IPC_KV_Write>& writes, uint64_t ttl = 0);
+	void get_many(const std::vector<std::string>& keys, std::vector<IPC_KV_Value>& values);
+	size_t remove_many(const std::vector<std::string>& keys);
 
-		m_data[index].m_size[buffer_state] = size;
-		m_data_transaction_flags = (DataTransaction)(m_data_transaction_flags | DataTransaction::DataSize);
-	}
-
-	void setDataState(size_t index, IPC_KV_Data_State state)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
-
-		bool buffer_state = !InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
-
-		m_data[index].m_state[buffer_state] = state;
-		m_data_transaction_flags = (DataTransaction)(m_data_transaction_flags | DataTransaction::DataState);
-	}
-
-	void setData(size_t index, unsigned char* data, size_t size)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
-
-		bool buffer_state = !InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
-
-		memcpy_s(m_data[index].m_value[buffer_state], IPCKV_DATA_SIZE, data, size);
-		m_data[index].m_size[buffer_state] = size;
-
-		m_data_transaction_flags = (DataTransaction)(m_data_transaction_flags | DataTransaction::DataValue);
-		m_data_transaction_flags = (DataTransaction)(m_data_transaction_flags | DataTransaction::DataSize);
-	}
-
-	void setDataKey(size_t index, const char* key, size_t size)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
+	/**
+	 * Returns the version of our key, which changes every time it's written or removed and is zero if
+	 * it doesn't exist. wait returns its version once it's no longer version or timeout milliseconds have passed.
+	 */
+	int64_t version(const std::string& key);
+	int64_t wait(const std::string& key, int64_t version, uint64_t timeout);
 
-		bool buffer_state = !InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
+	/**
+	 * Waiting on many keys from one thread is done by watching them, after which every change to
+	 * a key in one of their buckets ends wait_for_changes. wake ends it from another thread.
+	 */
+	void watch(const std::string& key);
+	void unwatch(const std::string& key);
+	void wait_for_changes(uint32_t timeout);
+	void wake();
 
-		strncpy_s(m_data[index].m_key[buffer_state], key, size);
+	uint64_t scan(uint64_t cursor, size_t count, std::vector<std::string>& keys, const std::string& prefix = "");
+	std::vector<std::string> keys(const std::string& prefix = "", size_t limit = 0);
 
-		m_data_transaction_flags = (DataTransaction)(m_data_transaction_flags | DataTransaction::DataKey);
-	}
+	IPC_KV_Number increment(const std::string& key, const IPC_KV_Number& delta);
+	bool compare_and_set(const std::string& key, const IPC_KV_Number* expected, const IPC_KV_Number& next);
+	bool get_number(const std::string& key, IPC_KV_Number& number);
 
+	void clear();
+	void print();
+	size_t size();
+	size_t memory_usage();
+	IPC_KV_Stats stats();
+	size_t max_value_size();
+	void save(const std::string& path);
+	void close();
+private:
 	/**
-	* m_info Getters
+	* Private Methods
 	*/
+	void initialize_header(const IPC_KV_Options& options);
+
+	void write_value(const std::string& key, const unsigned char* data, size_t size, uint64_t ttl);
+	bool read_value(const std::string& key, std::vector<unsigned char>& data, IPC_KV_Number* number, uint64_t time, IPC_KV_Version* version = nullptr);
+	bool remove_value(const std::string& key, uint64_t time);
+	void initialize_segment(uint32_t index, uint64_t size);
+
+	char* map_segment(uint32_t index);
+	char* resolve(uint64_t offset);
+
+	uint64_t allocate(size_t size);
+	void free(uint64_t offset, size_t size);
+
+	uint64_t allocate_table(size_t capacity);
+	IPC_KV_Entry* get_table();
+	IPC_KV_Entry* get_old_table();
+	void set_state(IPC_KV_Entry* entry, uint8_t state);
+
+	static size_t table_size(size_t capacity);
+	static uint8_t* get_control(IPC_KV_Entry* table, size_t capacity);
+	static uint32_t* get_tags(IPC_KV_Entry* table, size_t capacity);
+	bool is_match(const IPC_KV_Entry& entry, const std::string& key);
+
+	IPC_KV_Entry* find(const std::string& key, uint32_t hash);
+	IPC_KV_Entry* find_entry(IPC_KV_Entry* table, size_t capacity, const std::string& key, uint32_t hash);
+	IPC_KV_Entry* find_slot(IPC_KV_Entry* table, size_t capacity, const std::string& key, uint32_t hash);
+	void insert_entry(IPC_KV_Entry& entry);
+	void scan_group(IPC_KV_Entry* table, size_t capacity, size_t group, const std::string& prefix, uint64_t time, std::vector<std::string>& keys);
+	IPC_KV_Entry* insert(const std::string& key, uint32_t key_hash, size_t size);
+	void enforce_limit(IPC_KV_Entry* keep);
+
+	void start_resize();
+	void migrate(size_t count);
+
+	void erase(IPC_KV_Entry* entry);
+	void bump_version(IPC_KV_Entry* entry);
+
+	void claim_watcher();
+	void release_watcher();
+	void notify(uint32_t key_hash);
+	void notify_all();
+	void signal_watcher(uint32_t index, int64_t token);
+
+	void evict(IPC_KV_Entry* keep);
+	IPC_KV_Entry* advance_clock();
+	void sweep(size_t count);
+	void start_sweeper();
+
+	void restore(const std::string& path);
+	void start_persister();
+
+	static void write_number(IPC_KV_Entry* entry, const IPC_KV_Number& number);
+	static IPC_KV_Number read_number(IPC_KV_Entry* entry);
+	static IPC_KV_Number add_number(IPC_KV_Entry* entry, const IPC_KV_Number& delta);
+	static bool compare_number(IPC_KV_Entry* entry, const IPC_KV_Number& expected, const IPC_KV_Number& next);
+	uint32_t hash(const char* key, size_t count);
+	IPC_Lock get_lock(bool is_writing);
 
-	size_t getCapacity()
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		bool buffer_state = InterlockedAnd8(&m_info->m_buffer_state, IPCKV_BIT_HIGH);
-
-		return m_info->m_capacity[buffer_state];
-	}
-
-	size_t getSize()
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		bool buffer_state = InterlockedAnd8(&m_info->m_buffer_state, IPCKV_BIT_HIGH);
-
-		return m_info->m_size[buffer_state];
-	}
-
-	size_t getResizeCount()
-	{
-		if (!m_info)
-			throw std::runtime_error("class is in an invalid state.");
-
-		bool buffer_state = InterlockedAnd8(&m_info->m_buffer_state, IPCKV_BIT_HIGH);
+	static size_t size_class(size_t size);
+	static size_t class_size(size_t size_class);
+	static size_t get_block_size(const IPC_KV_Entry& entry);
 
-		return m_info->m_resize_count[buffer_state];
-	}
+	static uint64_t get_time();
+	static bool is_expired(const IPC_KV_Entry& entry, uint64_t time);
 
 	/**
-	* m_data Getters
+	* Private Members
 	*/
+	std::string m_name;
 
-	unsigned char* getData(size_t index)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
-
-		bool buffer_state = InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
-
-		return m_data[index].m_value[buffer_state];
-	}
-
-	size_t getDataSize(size_t index)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
-
-		bool buffer_state = InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
+	IPC_RW_Lock m_lock;
 
-		return m_data[index].m_size[buffer_state];
-	}
+	IPC_Shared_Memory m_header_memory;
+	IPC_KV_Header* m_header = nullptr;
 
-	IPC_KV_Data_State getDataState(size_t index)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
+	// Whether we're counted among the processes which have our store open.
+	bool m_attached = false;
 
-		bool buffer_state = InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
+	IPC_Shared_Memory m_segment_memory[IPCKV_MAX_SEGMENTS];
+	std::atomic<char*> m_segments[IPCKV_MAX_SEGMENTS] = {};
+	std::mutex m_segments_lock;
 
-		return m_data[index].m_state[buffer_state];
-	}
+	std::string m_persist_path;
+	uint64_t m_persist_interval = IPCKV_PERSIST_INTERVAL;
 
-	char* getDataKey(size_t index)
-	{
-		if (!m_data)
-			throw std::runtime_error("class is in an invalid state.");
+	// Which of our header's watchers is ours, and how many of the keys we're watching are in every bucket.
+	int32_t m_watcher = -1;
+	IPC_Signal m_watcher_signal;
+	uint32_t m_watch_counts[IPCKV_WATCH_BUCKETS] = {};
+	std::mutex m_watch_lock;
 
-		bool buffer_state = InterlockedAnd8(&m_data[index].m_buffer_state, IPCKV_BIT_HIGH);
+	// The signals of other watchers we've woken before, along with whose they were.
+	IPC_Signal m_watcher_signals[IPCKV_MAX_WATCHERS];
+	int64_t m_watcher_tokens[IPCKV_MAX_WATCHERS] = {};
+	std::mutex m_signals_lock;
 
-		return m_data[index].m_key[buffer_state];
-	}
+	// Our sweeper and persister share a lock, which tells them when to stop.
+	std::thread m_sweeper;
+	std::thread m_persister;
+	std::mutex m_background_lock;
+	std::condition_variable m_background_condition;
+	bool m_background_stopped = false;
+};
 
-	bool m_has_started_info_transaction = false;
-	InfoTransaction m_info_transaction_flags = InfoTransaction::InfoNone;
+enum IPC_KV_Entry_State
+{
+	Empty = 0,
+	Deleted = 1,
+	Occupied = 2,
+};
 
-	bool m_has_started_data_transaction = false;
-	DataTransaction m_data_transaction_flags = DataTransaction::DataNone;
+/**
+ * A slot of our hash table, the key and value live out of line in a block right
+ * after one another. Our entries are preceded by a control byte and the hash of each of
+ * them, which is all a probe looks at until it comes across a hash that matches its key.
+ */
+struct IPC_KV_Entry
+{
+	uint64_t m_block;
+	uint64_t m_expires;
+	int64_t m_number;
+	uint32_t m_hash;
+	uint32_t m_key_length;
+	uint32_t m_value_length;
+	uint8_t m_state;
+	uint8_t m_referenced;
+	uint8_t m_kind;
+
+	// Taken from our header's version every time the entry is written, removed or moved away.
+	int64_t m_version;
+};
 
-	IPC_KV_Info* m_info = nullptr;
-	IPC_KV_Data* m_data = nullptr;
+/**
+ * A process waiting on some of our keys, which is woken through its signal
+ * whenever a key in one of the buckets it has set is written or removed.
+ */
+struct IPC_KV_Watcher
+{
+	int64_t m_token;
+	int64_t m_process;
+	int64_t m_buckets[IPCKV_WATCH_BUCKETS / 64];
+	volatile int32_t m_signal;
+};
 
-	HANDLE m_info_handle = nullptr;
-	HANDLE m_data_handle = nullptr;
+/**
+ * The start of our shared memory, which is
+ * only ever modified under the write lock.
+ */
+struct IPC_KV_Header
+{
+	uint32_t m_magic;
+	uint32_t m_segment_count;
+	uint64_t m_segment_used;
+	uint64_t m_segment_sizes[IPCKV_MAX_SEGMENTS];
+
+	uint64_t m_free_lists[IPCKV_SIZE_CLASSES];
+	uint64_t m_memory_used;
+	uint64_t m_max_value_size;
+
+	uint64_t m_max_memory;
+	uint64_t m_data_used;
+	uint64_t m_clock_hand;
+	uint64_t m_sweep_cursor;
+
+	// How many of us have the store open, the last one to close it removes its names where they outlive it.
+	uint64_t m_references;
+
+	// These are bumped by readers as well, who only hold the read lock.
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_misses;
+	std::atomic<uint64_t> m_evictions;
+	std::atomic<uint64_t> m_expirations;
+
+	// When a process last took it upon itself to write our snapshot.
+	std::atomic<uint64_t> m_snapshot_time;
+
+	// The last version handed to an entry, and how many tables we've let go of,
+	// since the entries of a table that's gone can't be trusted to have kept theirs.
+	int64_t m_version;
+	int64_t m_generation;
+
+	// How many watchers are waiting on every bucket, which writers look at before going through them.
+	int64_t m_watched[IPCKV_WATCH_BUCKETS];
+	int64_t m_watcher_token;
+	IPC_KV_Watcher m_watchers[IPCKV_MAX_WATCHERS];
+
+	uint64_t m_table;
+	uint64_t m_capacity;
+	uint64_t m_size;
+	uint64_t m_tombstones;
+
+	// While resizing, the table we're still moving entries out of.
+	uint64_t m_old_table;
+	uint64_t m_old_capacity;
+	uint64_t m_migrate_cursor;
 };
 
+/**
+ * Holds the read or write lock of a store until it goes out of scope.
+ */
 class IPC_Lock {
 public:
-	IPC_Lock(bool is_write_lock, const std::string& name)
+	IPC_Lock(bool is_write_lock, IPC_RW_Lock* lock)
+		: is_write_lock(is_write_lock)
 	{
 		if (is_write_lock)
-		{
-			if (name.length() > MAX_PATH)
-			{
-				throw std::runtime_error("rwlock name too long.");
-			}
-
-			auto mutex_name = name + "_mutex";
-
-			mutex_handle = CreateMutexA(
-				nullptr,
-				FALSE,
-				mutex_name.c_str()
-			);
-
-			if (mutex_handle == nullptr)
-			{
-				throw std::runtime_error("could not create mutex.");
-			}
-
-			auto wait_result = WaitForSingleObject(mutex_handle, INFINITE);
-
-			if (wait_result != WAIT_OBJECT_0)
-				throw std::runtime_error("failed to wait for semaphore object");
-
-			//////////////////////////////////////////////
-
-			semaphore_handle = CreateSemaphoreA(
-				nullptr,
-				0,
-				IPCKV_MAX_LOCKS,
-				name.c_str()
-			);
-
-			if (semaphore_handle == nullptr)
-			{
-				throw std::runtime_error("could not create rwlock.");
-			}
-
-			if (GetLastError() == ERROR_ALREADY_EXISTS)
-			{
-				for (int i = 0; i < IPCKV_MAX_LOCKS; i++)
-				{
-					auto wait_result = WaitForSingleObject(semaphore_handle, INFINITE);
-
-					if (wait_result != WAIT_OBJECT_0)
-						throw std::runtime_error("failed to wait for semaphore object");
-				}
-			}
-		}
+			lock->lock();
 		else
-		{
-			if (name.length() > MAX_PATH)
-			{
-				throw std::runtime_error("rwlock name too long.");
-			}
-
-			semaphore_handle = CreateSemaphoreA(
-				nullptr,
-				IPCKV_MAX_LOCKS,
-				IPCKV_MAX_LOCKS,
-				name.c_str()
-			);
-
-			if (semaphore_handle == nullptr)
-			{
-				throw std::runtime_error("could not create rwlock.");
-			}
-
-			auto wait_result = WaitForSingleObject(semaphore_handle, INFINITE);
-
-			if (wait_result != WAIT_OBJECT_0)
-				throw std::runtime_error("failed to wait for single object");
-		}
+			lock->lock_shared();
 
+		rw_lock = lock;
 	}
 
 	~IPC_Lock() noexcept
 	{
-		if (semaphore_handle)
-		{
-			ReleaseSemaphore(semaphore_handle, IPCKV_MAX_LOCKS, nullptr);
-			CloseHandle(semaphore_handle);
-		}
-
-		if (mutex_handle)
-		{
-			ReleaseMutex(mutex_handle);
-			CloseHandle(mutex_handle);
-		}
+		if (rw_lock == nullptr)
+			return;
+
+		if (is_write_lock)
+			rw_lock->unlock();
+		else
+			rw_lock->unlock_shared();
 	}
 
 	IPC_Lock(const IPC_Lock&) = delete;
 	IPC_Lock& operator=(IPC_Lock const&) = delete;
 
-	IPC_Lock(IPC_Lock&& ipc_write_lock) noexcept :
-		semaphore_handle(std::exchange(ipc_write_lock.semaphore_handle, nullptr)),
-		mutex_handle(std::exchange(ipc_write_lock.mutex_handle, nullptr)) { }
+	IPC_Lock(IPC_Lock&& ipc_lock) noexcept :
+		rw_lock(std::exchange(ipc_lock.rw_lock, nullptr)),
+		is_write_lock(ipc_lock.is_write_lock) { }
 
-	IPC_Lock& operator=(IPC_Lock&& ipc_write_lock)
+	IPC_Lock& operator=(IPC_Lock&& ipc_lock)
 	{
-		semaphore_handle = std::exchange(ipc_write_lock.semaphore_handle, nullptr);
-		mutex_handle = std::exchange(ipc_write_lock.mutex_handle, nullptr);
+		rw_lock = std::exchange(ipc_lock.rw_lock, nullptr);
+		is_write_lock = ipc_lock.is_write_lock;
 
 		return *this;
 	}
 private:
-	HANDLE semaphore_handle = nullptr;
-	HANDLE mutex_handle = nullptr;
-};
\ No newline at end of file
+	IPC_RW_Lock* rw_lock = nullptr;
+	bool is_write_lock = false;
+};
@@ -0,0 +1,677 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <intrin.h>
+
+#define IPCKV_MAX_NAME MAX_PATH
+#else
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+// POSIX limits shared memory names to NAME_MAX, which has to leave room for the suffixes of our segments.
+#define IPCKV_MAX_NAME 200
+#endif
+
+#define IPCKV_MAX_LOCKS 24
+
+/**
+ * The atomics our shared memory is updated with, the slots they're
+ * given can be in another process' view of the same memory.
+ */
+inline int64_t ipckv_load(volatile int64_t* slot)
+{
+#ifdef _WIN32
+	return InterlockedCompareExchange64((volatile LONG64*)slot, 0, 0);
+#else
+	return __atomic_load_n(slot, __ATOMIC_SEQ_CST);
+#endif
+}
+
+inline void ipckv_store(volatile int64_t* slot, int64_t value)
+{
+#ifdef _WIN32
+	InterlockedExchange64((volatile LONG64*)slot, value);
+#else
+	__atomic_store_n(slot, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/**
+ * Returns what the slot held, which is expected if it was swapped.
+ */
+inline int64_t ipckv_compare_exchange(volatile int64_t* slot, int64_t desired, int64_t expected)
+{
+#ifdef _WIN32
+	return InterlockedCompareExchange64((volatile LONG64*)slot, desired, expected);
+#else
+	__atomic_compare_exchange_n(slot, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+	return expected;
+#endif
+}
+
+inline int64_t ipckv_fetch_add(volatile int64_t* slot, int64_t delta)
+{
+#ifdef _WIN32
+	return InterlockedExchangeAdd64((volatile LONG64*)slot, delta);
+#else
+	return __atomic_fetch_add(slot, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+inline int64_t ipckv_fetch_or(volatile int64_t* slot, int64_t bits)
+{
+#ifdef _WIN32
+	return InterlockedOr64((volatile LONG64*)slot, bits);
+#else
+	return __atomic_fetch_or(slot, bits, __ATOMIC_SEQ_CST);
+#endif
+}
+
+inline int64_t ipckv_fetch_and(volatile int64_t* slot, int64_t bits)
+{
+#ifdef _WIN32
+	return InterlockedAnd64((volatile LONG64*)slot, bits);
+#else
+	return __atomic_fetch_and(slot, bits, __ATOMIC_SEQ_CST);
+#endif
+}
+
+inline uint32_t ipckv_trailing_zeros(uint32_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+
+	return (uint32_t)index;
+#else
+	return (uint32_t)__builtin_ctz(value);
+#endif
+}
+
+inline void ipckv_yield()
+{
+#ifdef _WIN32
+	Sleep(0);
+#else
+	sched_yield();
+#endif
+}
+
+inline int64_t ipckv_process_id()
+{
+#ifdef _WIN32
+	return (int64_t)GetCurrentProcessId();
+#else
+	return (int64_t)getpid();
+#endif
+}
+
+/**
+ * Returns whether the process with our id is still around, a process we aren't
+ * allowed to look at is taken to be alive.
+ */
+inline bool ipckv_process_alive(int64_t process_id)
+{
+#ifdef _WIN32
+	auto process = OpenProcess(SYNCHRONIZE, FALSE, (DWORD)process_id);
+
+	if (process == nullptr)
+		return GetLastError() == ERROR_ACCESS_DENIED;
+
+	auto alive = WaitForSingleObject(process, 0) == WAIT_TIMEOUT;
+	CloseHandle(process);
+
+	return alive;
+#else
+	return kill((pid_t)process_id, 0) == 0 || errno == EPERM;
+#endif
+}
+
+/**
+ * A named piece of memory which every process that opens the same name shares,
+ * it's zeroed when it's first created.
+ */
+class IPC_Shared_Memory
+{
+public:
+	IPC_Shared_Memory() = default;
+	~IPC_Shared_Memory() { close(); }
+
+	IPC_Shared_Memory(const IPC_Shared_Memory&) = delete;
+	IPC_Shared_Memory& operator=(const IPC_Shared_Memory&) = delete;
+
+	/**
+	 * Opens the memory called name, creating it with size bytes if it doesn't exist yet.
+	 */
+	bool create(const std::string& name, uint64_t size)
+	{
+#ifdef _WIN32
+		m_handle = CreateFileMappingA(
+			INVALID_HANDLE_VALUE,
+			nullptr,
+			PAGE_READWRITE,
+			(DWORD)(size >> 32),
+			(DWORD)(size & 0xFFFFFFFF),
+			name.c_str()
+		);
+
+		if (m_handle == nullptr)
+			return false;
+
+		return map(size);
+#else
+		auto descriptor = shm_open(get_path(name).c_str(), O_RDWR | O_CREAT, 0600);
+
+		if (descriptor < 0)
+			return false;
+
+		struct stat status;
+
+		// Whoever gets here first sizes it, which zeroes it just like a fresh mapping on Windows.
+		if (fstat(descriptor, &status) != 0 || ((uint64_t)status.st_size < size && ftruncate(descriptor, (off_t)size) != 0))
+		{
+			::close(descriptor);
+			return false;
+		}
+
+		return map(descriptor, size);
+#endif
+	}
+
+	/**
+	 * Opens the memory called name, which another process has already created.
+	 */
+	bool open(const std::string& name)
+	{
+#ifdef _WIN32
+		m_handle = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+
+		if (m_handle == nullptr)
+			return false;
+
+		return map(0);
+#else
+		auto descriptor = shm_open(get_path(name).c_str(), O_RDWR, 0600);
+
+		if (descriptor < 0)
+			return false;
+
+		struct stat status;
+
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+		{
+			::close(descriptor);
+			return false;
+		}
+
+		return map(descriptor, (uint64_t)status.st_size);
+#endif
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_handle) CloseHandle(m_handle);
+
+		m_handle = nullptr;
+#else
+		if (m_data) munmap(m_data, (size_t)m_size);
+#endif
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	/**
+	 * Removes the name of the memory, those who have it open keep it until they close it.
+	 * Named mappings on Windows go away along with their last handle, so there's nothing to do.
+	 */
+	static void unlink(const std::string& name)
+	{
+#ifndef _WIN32
+		shm_unlink(get_path(name).c_str());
+#else
+		(void)name;
+#endif
+	}
+
+	char* data() const { return m_data; }
+	uint64_t size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+	bool map(uint64_t size)
+	{
+		m_data = (char*)MapViewOfFile(m_handle, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)size);
+
+		if (m_data == nullptr)
+		{
+			close();
+			return false;
+		}
+
+		m_size = size;
+
+		return true;
+	}
+
+	HANDLE m_handle = nullptr;
+#else
+	bool map(int descriptor, uint64_t size)
+	{
+		auto data = mmap(nullptr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+
+		// Our mapping keeps the memory alive, so we don't need its descriptor anymore.
+		::close(descriptor);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		m_data = (char*)data;
+		m_size = size;
+
+		return true;
+	}
+
+	static std::string get_path(const std::string& name)
+	{
+		auto path = "/" + name;
+
+		// Shared memory names are a single path component.
+		for (size_t i = 1; i < path.length(); i++)
+		{
+			if (path[i] == '/') path[i] = '_';
+		}
+
+		return path;
+	}
+#endif
+
+	char* m_data = nullptr;
+	uint64_t m_size = 0;
+};
+
+/**
+ * A read-only view of a whole file, which is empty if the file doesn't exist.
+ */
+class IPC_File_View
+{
+public:
+	IPC_File_View() = default;
+	~IPC_File_View() { close(); }
+
+	IPC_File_View(const IPC_File_View&) = delete;
+	IPC_File_View& operator=(const IPC_File_View&) = delete;
+
+	bool open(const std::string& path)
+	{
+#ifdef _WIN32
+		m_file = CreateFileA(
+			path.c_str(),
+			GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_DELETE,
+			nullptr,
+			OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+			nullptr
+		);
+
+		if (m_file == INVALID_HANDLE_VALUE)
+		{
+			m_file = nullptr;
+			return false;
+		}
+
+		LARGE_INTEGER file_size;
+
+		if (!GetFileSizeEx(m_file, &file_size) || file_size.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+
+		m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		m_data = m_mapping ? (const unsigned char*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+		if (m_data == nullptr)
+		{
+			close();
+			return false;
+		}
+
+		m_size = (size_t)file_size.QuadPart;
+#else
+		auto descriptor = ::open(path.c_str(), O_RDONLY);
+
+		if (descriptor < 0)
+			return false;
+
+		struct stat status;
+
+		if (fstat(descriptor, &status) != 0 || status.st_size == 0)
+		{
+			::close(descriptor);
+			return false;
+		}
+
+		auto data = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+
+		::close(descriptor);
+
+		if (data == MAP_FAILED)
+			return false;
+
+		m_data = (const unsigned char*)data;
+		m_size = (size_t)status.st_size;
+#endif
+
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file) CloseHandle(m_file);
+
+		m_mapping = nullptr;
+		m_file = nullptr;
+#else
+		if (m_data) munmap((void*)m_data, m_size);
+#endif
+
+		m_data = nullptr;
+		m_size = 0;
+	}
+
+	const unsigned char* data() const { return m_data; }
+	size_t size() const { return m_size; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_file = nullptr;
+	HANDLE m_mapping = nullptr;
+#endif
+
+	const unsigned char* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+/**
+ * Moves the file at from over the one at to, so that readers
+ * only ever see either of them in full.
+ */
+inline bool ipckv_replace_file(const std::string& from, const std::string& to)
+{
+#ifdef _WIN32
+	return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+#else
+	auto descriptor = ::open(from.c_str(), O_RDONLY);
+
+	// Our snapshot has to be on disk before it replaces the previous one.
+	if (descriptor >= 0)
+	{
+		fsync(descriptor);
+		::close(descriptor);
+	}
+
+	return rename(from.c_str(), to.c_str()) == 0;
+#endif
+}
+
+/**
+ * A reader-writer lock across processes. On Windows readers take one of the slots
+ * of a semaphore while a writer takes all of them, one writer at a time through a mutex.
+ * Elsewhere it's a process-shared pthread rwlock in its own piece of shared memory.
+ */
+class IPC_RW_Lock
+{
+public:
+	IPC_RW_Lock() = default;
+	~IPC_RW_Lock() { close(); }
+
+	IPC_RW_Lock(const IPC_RW_Lock&) = delete;
+	IPC_RW_Lock& operator=(const IPC_RW_Lock&) = delete;
+
+	bool open(const std::string& name)
+	{
+#ifdef _WIN32
+		m_mutex = CreateMutexA(nullptr, FALSE, (name + "_mutex").c_str());
+		m_semaphore = CreateSemaphoreA(nullptr, IPCKV_MAX_LOCKS, IPCKV_MAX_LOCKS, name.c_str());
+
+		if (m_mutex == nullptr || m_semaphore == nullptr)
+		{
+			close();
+			return false;
+		}
+#else
+		if (!m_memory.create(name + "_lock", sizeof(Shared_Lock)))
+			return false;
+
+		m_lock = (Shared_Lock*)m_memory.data();
+
+		// Whoever maps our lock first initializes it, everyone else waits on them.
+		if (__sync_val_compare_and_swap(&m_lock->m_state, 0, 1) == 0)
+		{
+			pthread_rwlockattr_t attributes;
+
+			pthread_rwlockattr_init(&attributes);
+			pthread_rwlockattr_setpshared(&attributes, PTHREAD_PROCESS_SHARED);
+			pthread_rwlock_init(&m_lock->m_lock, &attributes);
+			pthread_rwlockattr_destroy(&attributes);
+
+			__atomic_store_n(&m_lock->m_state, 2, __ATOMIC_RELEASE);
+		}
+		else
+		{
+			while (__atomic_load_n(&m_lock->m_state, __ATOMIC_ACQUIRE) != 2)
+				ipckv_yield();
+		}
+#endif
+
+		return true;
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (m_semaphore) CloseHandle(m_semaphore);
+		if (m_mutex) CloseHandle(m_mutex);
+
+		m_semaphore = nullptr;
+		m_mutex = nullptr;
+#else
+		m_memory.close();
+		m_lock = nullptr;
+#endif
+	}
+
+	static void unlink(const std::string& name)
+	{
+		IPC_Shared_Memory::unlink(name + "_lock");
+	}
+
+	void lock_shared()
+	{
+#ifdef _WIN32
+		if (WaitForSingleObject(m_semaphore, INFINITE) != WAIT_OBJECT_0)
+			throw std::runtime_error("failed to wait for single object");
+#else
+		if (pthread_rwlock_rdlock(&m_lock->m_lock) != 0)
+			throw std::runtime_error("failed to take the read lock");
+#endif
+	}
+
+	void unlock_shared()
+	{
+#ifdef _WIN32
+		ReleaseSemaphore(m_semaphore, 1, nullptr);
+#else
+		pthread_rwlock_unlock(&m_lock->m_lock);
+#endif
+	}
+
+	void lock()
+	{
+#ifdef _WIN32
+		if (WaitForSingleObject(m_mutex, INFINITE) != WAIT_OBJECT_0)
+			throw std::runtime_error("failed to wait for mutex object");
+
+		for (int i = 0; i < IPCKV_MAX_LOCKS; i++)
+		{
+			if (WaitForSingleObject(m_semaphore, INFINITE) != WAIT_OBJECT_0)
+			{
+				if (i) ReleaseSemaphore(m_semaphore, i, nullptr);
+				ReleaseMutex(m_mutex);
+
+				throw std::runtime_error("failed to wait for semaphore object");
+			}
+		}
+#else
+		if (pthread_rwlock_wrlock(&m_lock->m_lock) != 0)
+			throw std::runtime_error("failed to take the write lock");
+#endif
+	}
+
+	void unlock()
+	{
+#ifdef _WIN32
+		ReleaseSemaphore(m_semaphore, IPCKV_MAX_LOCKS, nullptr);
+		ReleaseMutex(m_mutex);
+#else
+		pthread_rwlock_unlock(&m_lock->m_lock);
+#endif
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE m_semaphore = nullptr;
+	HANDLE m_mutex = nullptr;
+#else
+	struct Shared_Lock
+	{
+		volatile int32_t m_state;
+		pthread_rwlock_t m_lock;
+	};
+
+	IPC_Shared_Memory m_memory;
+	Shared_Lock* m_lock = nullptr;
+#endif
+};
+
+/**
+ * Wakes one process waiting on it, a wake that comes before the wait isn't lost and
+ * any number of them wake the waiter only once. On Windows it's a named auto-reset
+ * event, elsewhere it's a futex on a word in shared memory which the waiter resets.
+ */
+class IPC_Signal
+{
+public:
+	IPC_Signal() = default;
+	~IPC_Signal() { close(); }
+
+	IPC_Signal(const IPC_Signal&) = delete;
+	IPC_Signal& operator=(const IPC_Signal&) = delete;
+
+	/**
+	 * Opens the signal called name whose word is at word, only its waiter creates it.
+	 */
+	bool open(const std::string& name, volatile int32_t* word, bool create)
+	{
+#ifdef _WIN32
+		(void)word;
+
+		m_event = create ?
+			CreateEventA(nullptr, FALSE, FALSE, name.c_str()) :
+			OpenEventA(EVENT_MODIFY_STATE, FALSE, name.c_str());
+
+		return m_event != nullptr;
+#else
+		(void)name;
+		(void)create;
+
+		m_word = word;
+
+		return true;
+#endif
+	}
+
+	void close()
+	{
+#ifdef _WIN32
+		if (m_event) CloseHandle(m_event);
+
+		m_event = nullptr;
+#else
+		m_word = nullptr;
+#endif
+	}
+
+	void notify()
+	{
+#ifdef _WIN32
+		SetEvent(m_event);
+#else
+		__atomic_store_n(m_word, 1, __ATOMIC_SEQ_CST);
+
+#ifdef __linux__
+		syscall(SYS_futex, (int32_t*)m_word, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+#endif
+#endif
+	}
+
+	/**
+	 * Waits until we're notified or timeout milliseconds have passed.
+	 */
+	void wait(uint32_t timeout)
+	{
+#ifdef _WIN32
+		WaitForSingleObject(m_event, timeout);
+#else
+		if (__atomic_exchange_n(m_word, 0, __ATOMIC_SEQ_CST))
+			return;
+
+#ifdef __linux__
+		struct timespec duration;
+		duration.tv_sec = timeout / 1000;
+		duration.tv_nsec = (long)(timeout % 1000) * 1000000;
+
+		syscall(SYS_futex, (int32_t*)m_word, FUTEX_WAIT, 0, &duration, nullptr, 0);
+#else
+		// Without a futex we look at our word every millisecond instead.
+		for (uint32_t waited = 0; waited < timeout && !__atomic_load_n(m_word, __ATOMIC_SEQ_CST); waited++)
+		{
+			struct timespec duration = { 0, 1000000 };
+			nanosleep(&duration, nullptr);
+		}
+#endif
+
+		__atomic_exchange_n(m_word, 0, __ATOMIC_SEQ_CST);
+#endif
+	}
+
+private:
+#ifdef _WIN32
+	HANDLE m_event = nullptr;
+#else
+	volatile int32_t* m_word = nullptr;
+#endif
+};
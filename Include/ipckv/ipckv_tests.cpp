@@ -0,0 +1,564 @@
+#include "ipckv.h"
+#include <sys/wait.h>
+#include <cstdio>
+
+/**
+ * Exercises the store across processes the way worker processes share it,
+ * each test forks its workers and checks what they left behind.
+ */
+
+#define TEST_PROCESSES 8
+#define TEST_OPERATIONS 20000
+
+static int failures = 0;
+
+#define CHECK(condition) \
+	if (!(condition)) { printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); failures++; }
+
+static std::string get_name(const char* test)
+{
+	return std::string("ipckv_tests_") + test + "_" + std::to_string(getpid());
+}
+
+/**
+ * Runs worker in count forked processes and waits for all of them,
+ * returns whether every one of them exited cleanly.
+ */
+template <typename Worker>
+static bool run_processes(int count, Worker worker)
+{
+	std::vector<pid_t> processes;
+
+	for (int i = 0; i < count; i++)
+	{
+		auto process = fork();
+
+		if (process == 0)
+		{
+			int result = 0;
+
+			try
+			{
+				worker(i);
+			}
+			catch (std::exception& exception)
+			{
+				printf("worker %d: %s\n", i, exception.what());
+				result = 1;
+			}
+
+			_exit(result);
+		}
+
+		processes.push_back(process);
+	}
+
+	auto succeeded = true;
+
+	for (auto process : processes)
+	{
+		int status = 0;
+		waitpid(process, &status, 0);
+
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			succeeded = false;
+	}
+
+	return succeeded;
+}
+
+////////////////////////////////////////////////////
+
+static void test_increments()
+{
+	auto name = get_name("increments");
+
+	// We keep the store open so that it outlives our workers.
+	IPC_KV store(name);
+
+	IPC_KV_Number delta;
+	delta.integer = 1;
+
+	auto succeeded = run_processes(TEST_PROCESSES, [&](int) {
+		IPC_KV worker_store(name);
+
+		for (int i = 0; i < TEST_OPERATIONS; i++)
+			worker_store.increment("counter", delta);
+	});
+
+	IPC_KV_Number number;
+
+	CHECK(succeeded);
+	CHECK(store.get_number("counter", number));
+	CHECK(number.integer == TEST_PROCESSES * TEST_OPERATIONS);
+}
+
+static void test_writes()
+{
+	auto name = get_name("writes");
+
+	IPC_KV store(name);
+
+	// Enough keys to make the table resize and the store grow new segments while everyone is writing.
+	auto succeeded = run_processes(TEST_PROCESSES, [&](int index) {
+		IPC_KV worker_store(name);
+		std::vector<unsigned char> value;
+
+		for (int i = 0; i < TEST_OPERATIONS / 10; i++)
+		{
+			auto key = std::to_string(index) + ":" + std::to_string(i);
+			std::vector<unsigned char> data(1 + i % 300, (unsigned char)i);
+
+			worker_store.set(key, data.data(), data.size());
+
+			if (!worker_store.get(key, value) || value != data)
+				throw std::runtime_error("read back the wrong value for " + key);
+		}
+	});
+
+	CHECK(succeeded);
+	CHECK(store.size() == TEST_PROCESSES * (TEST_OPERATIONS / 10));
+
+	std::vector<unsigned char> value;
+
+	CHECK(store.get("3:250", value));
+	CHECK(value.size() == 251 && value[0] == (unsigned char)250);
+}
+
+/**
+ * Keys coming and going leave tombstones behind, which our table is rehashed at the same capacity
+ * to get rid of. Every rehash lets go of a table and allocates another one, which has to reuse it.
+ */
+static void test_churn()
+{
+	IPC_KV store(get_name("churn"));
+
+	const unsigned char data[] = { 1, 2, 3 };
+	const int live_keys = 38;
+
+	uint64_t reserved = 0;
+
+	for (int i = 0; i < TEST_OPERATIONS * 5; i++)
+	{
+		store.set("churn:" + std::to_string(i), data, sizeof(data));
+
+		if (i >= live_keys)
+			store.remove("churn:" + std::to_string(i - live_keys));
+
+		if (i == TEST_OPERATIONS)
+			reserved = store.stats().reserved;
+	}
+
+	CHECK(store.size() == live_keys);
+	CHECK(store.stats().reserved == reserved);
+}
+
+/**
+ * Entries which haven't been moved over to our new table yet still count against our limit,
+ * so they're evicted just the same while our table is being resized.
+ */
+static void test_limits()
+{
+	IPC_KV_Options options;
+	options.max_memory = 64 * 1024;
+
+	IPC_KV store(get_name("limits"), options);
+
+	std::vector<unsigned char> data(100, 1);
+	auto over_limit = 0;
+
+	for (int i = 0; i < TEST_OPERATIONS; i++)
+	{
+		store.set("limit:" + std::to_string(i), data.data(), data.size());
+
+		if (store.stats().memory > options.max_memory)
+			over_limit++;
+	}
+
+	CHECK(over_limit == 0);
+	CHECK(store.stats().evictions > 0);
+}
+
+/**
+ * A store at its limit evicts on every write, which mustn't move over all of our old table at once
+ * while we're being resized. The memory our tables take goes up when a resize starts, and only
+ * comes down again once a later write moved over the last of our old table and let go of it.
+ * Resizes are only counted once we started evicting, since the ones before never evicted anything.
+ */
+static void test_limit_resizes()
+{
+	IPC_KV_Options options;
+	options.max_memory = 64 * 1024;
+
+	IPC_KV store(get_name("limit_resizes"), options);
+
+	std::vector<unsigned char> data(100, 1);
+
+	size_t table_memory = 0;
+	int resizes = 0;
+
+	for (int i = 0; i < TEST_OPERATIONS; i++)
+	{
+		store.set("limit:" + std::to_string(i), data.data(), data.size());
+
+		auto stats = store.stats();
+		auto memory = store.memory_usage() - stats.memory;
+
+		if (memory < table_memory && stats.evictions)
+			resizes++;
+
+		table_memory = memory;
+	}
+
+	CHECK(store.stats().evictions > 0);
+	CHECK(resizes > 0);
+}
+
+static void test_unlink()
+{
+	auto name = get_name("unlink");
+	const unsigned char data[] = { 1, 2, 3 };
+
+	{
+		IPC_KV store(name);
+		store.set("key", data, sizeof(data));
+
+		IPC_KV other_store(name);
+		other_store.close();
+
+		// Someone still has the store open, so it's still there.
+		IPC_KV reopened_store(name);
+		CHECK(reopened_store.size() == 1);
+	}
+
+	// The last one to close it took it along.
+	IPC_KV store(name);
+	CHECK(store.size() == 0);
+}
+
+static void test_snapshots()
+{
+	auto name = get_name("snapshots");
+	auto path = "/tmp/" + name + ".snapshot";
+
+	const unsigned char data[] = { 'v', 'a', 'l', 'u', 'e' };
+
+	{
+		IPC_KV store(name);
+
+		IPC_KV_Number number;
+		number.integer = 42;
+
+		store.set("bytes", data, sizeof(data));
+		store.set("expired", data, sizeof(data), 1);
+		store.increment("number", number);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+		store.save(path);
+	}
+
+	IPC_KV_Options options;
+	options.persist_path = path;
+
+	IPC_KV store(name, options);
+
+	std::vector<unsigned char> value;
+	IPC_KV_Number number;
+
+	CHECK(store.size() == 2);
+	CHECK(store.get("bytes", value) && value.size() == sizeof(data) && memcmp(value.data(), data, sizeof(data)) == 0);
+	CHECK(!store.get("expired", value));
+	CHECK(store.get_number("number", number) && number.integer == 42);
+
+	// A snapshot that can't replace what's at its path doesn't leave its temporary file behind.
+	auto directory = "/tmp/" + name + ".directory";
+	auto failed = false;
+
+	mkdir(directory.c_str(), 0700);
+
+	try
+	{
+		store.save(directory);
+	}
+	catch (std::runtime_error&)
+	{
+		failed = true;
+	}
+
+	CHECK(failed && access((directory + ".tmp").c_str(), F_OK) != 0);
+
+	store.close();
+	remove(path.c_str());
+	rmdir(directory.c_str());
+}
+
+/**
+ * Our snapshot is copied a chunk at a time, and a resize starting or finishing in between chunks
+ * mustn't cost it any of the entries nobody touched. Every round fills a store up to just before
+ * it resizes, then one worker writes enough to resize it and finish moving it over while the other saves it.
+ */
+static void test_snapshot_resizes()
+{
+	const unsigned char data[] = { 1, 2, 3 };
+
+	// Our table has 65536 buckets by now and resizes past 60% of them, which takes a write for every 64 buckets to finish.
+	const int stable_keys = 39000;
+	const int written_keys = 3000;
+
+	for (int round = 0; round < 10; round++)
+	{
+		auto name = get_name("snapshot_resizes") + "_" + std::to_string(round);
+		auto path = "/tmp/" + name + ".snapshot";
+
+		IPC_KV store(name);
+
+		for (int i = 0; i < stable_keys; i++)
+			store.set("stable:" + std::to_string(i), data, sizeof(data));
+
+		auto succeeded = run_processes(2, [&](int index) {
+			IPC_KV worker_store(name);
+			std::vector<unsigned char> value;
+
+			if (index == 0)
+			{
+				while (!worker_store.get("go", value)) {}
+
+				for (int i = 0; i < written_keys; i++)
+					worker_store.set("written:" + std::to_string(i), data, sizeof(data));
+
+				return;
+			}
+
+			worker_store.set("go", data, sizeof(data));
+			worker_store.save(path);
+
+			IPC_KV_Options options;
+			options.persist_path = path;
+
+			IPC_KV restored_store(name + "_restored", options);
+			auto restored = restored_store.keys("stable:").size();
+
+			restored_store.close();
+
+			if (restored != stable_keys)
+				throw std::runtime_error("snapshot lost " + std::to_string(stable_keys - restored) + " keys");
+		});
+
+		CHECK(succeeded);
+
+		store.close();
+		remove(path.c_str());
+	}
+}
+
+static void test_versions()
+{
+	IPC_KV store(get_name("versions"));
+
+	const unsigned char data[] = { 1, 2, 3 };
+	std::vector<unsigned char> value;
+	IPC_KV_Version version;
+
+	store.set("config", data, sizeof(data));
+
+	CHECK(store.get("config", value, nullptr, &version));
+	CHECK(store.is_current(version));
+
+	// Writing someone else's key leaves ours alone.
+	store.set("other", data, sizeof(data));
+	CHECK(store.is_current(version));
+
+	store.set("config", data, sizeof(data));
+	CHECK(!store.is_current(version));
+
+	CHECK(store.get("config", value, nullptr, &version));
+	CHECK(store.is_current(version));
+
+	// Growing our table moves every entry.
+	for (int i = 0; i < 1000; i++)
+		store.set(std::to_string(i), data, sizeof(data));
+
+	CHECK(!store.is_current(version));
+
+	CHECK(store.get("config", value, nullptr, &version));
+	CHECK(store.is_current(version));
+
+	store.remove("config");
+	CHECK(!store.is_current(version));
+}
+
+static void test_scans()
+{
+	IPC_KV store(get_name("scans"));
+
+	const unsigned char data[] = { 1, 2, 3 };
+
+	for (int i = 0; i < 1000; i++)
+		store.set("user:" + std::to_string(i), data, sizeof(data));
+
+	for (int i = 0; i < 100; i++)
+		store.set("other:" + std::to_string(i), data, sizeof(data));
+
+	CHECK(store.keys("user:").size() == 1000);
+	CHECK(store.keys("other:").size() == 100);
+	CHECK(store.keys("", 10).size() == 10);
+
+	// Our table keeps growing under our scan, which still has to come across every key that was there all along.
+	std::unordered_set<std::string> seen;
+	std::vector<std::string> keys;
+	uint64_t cursor = 0;
+	int written = 0;
+
+	do
+	{
+		keys.clear();
+		cursor = store.scan(cursor, 50, keys, "user:");
+
+		for (auto & key : keys)
+		{
+			CHECK(key.compare(0, 5, "user:") == 0);
+			seen.insert(key);
+		}
+
+		for (int i = 0; i < 200; i++, written++)
+			store.set("later:" + std::to_string(written), data, sizeof(data));
+	}
+	while (cursor != 0);
+
+	CHECK(seen.size() == 1000);
+	CHECK(store.keys("later:").size() == (size_t)written);
+}
+
+static void test_reads()
+{
+	IPC_KV store(get_name("reads"));
+
+	const unsigned char data[] = { 'r', 'a', 'w' };
+	std::vector<unsigned char> value;
+
+	store.set("bytes", data, sizeof(data));
+
+	auto allocate = [&](const unsigned char* bytes, size_t size) { value.resize(size); return value.data(); };
+
+	CHECK(store.read("bytes", allocate));
+	CHECK(value.size() == sizeof(data) && memcmp(value.data(), data, sizeof(data)) == 0);
+
+	IPC_KV_Number delta;
+	delta.integer = 1;
+
+	store.increment("number", delta);
+
+	// Neither missing keys nor numbers ask for any memory.
+	value.clear();
+
+	CHECK(!store.read("missing", allocate));
+	CHECK(!store.read("number", allocate));
+	CHECK(value.empty());
+
+	// Bytes can be refused before any memory is asked for.
+	auto refused = false;
+
+	try
+	{
+		store.read("bytes", [&](const unsigned char* bytes, size_t size) -> unsigned char* {
+			if (size && bytes[0] == 'r')
+				throw std::runtime_error("refused");
+
+			value.resize(size);
+			return value.data();
+		});
+	}
+	catch (std::runtime_error&)
+	{
+		refused = true;
+	}
+
+	CHECK(refused && value.empty());
+}
+
+static void test_waits()
+{
+	auto name = get_name("waits");
+	const unsigned char data[] = { 1, 2, 3 };
+
+	IPC_KV store(name);
+	store.set("config", data, sizeof(data));
+
+	auto version = store.version("config");
+
+	CHECK(version != 0);
+	CHECK(store.version("missing") == 0);
+
+	// Nobody changes our key, so we give up after our timeout.
+	auto start = std::chrono::steady_clock::now();
+
+	CHECK(store.wait("config", version, 100) == version);
+	CHECK(std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+
+	// Another process changes our key long before our timeout, and we're woken right away.
+	auto process = fork();
+
+	if (process == 0)
+	{
+		IPC_KV worker_store(name);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		worker_store.set("config", data, sizeof(data));
+
+		_exit(0);
+	}
+
+	start = std::chrono::steady_clock::now();
+
+	CHECK(store.wait("config", version, 5000) != version);
+	CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(IPCKV_WAIT_INTERVAL));
+
+	waitpid(process, nullptr, 0);
+
+	// Numbers are changed in place, which still wakes us.
+	IPC_KV_Number delta;
+	delta.integer = 1;
+
+	store.increment("counter", delta);
+	version = store.version("counter");
+
+	process = fork();
+
+	if (process == 0)
+	{
+		IPC_KV worker_store(name);
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		worker_store.increment("counter", delta);
+
+		_exit(0);
+	}
+
+	CHECK(store.wait("counter", version, 5000) != version);
+
+	waitpid(process, nullptr, 0);
+}
+
+int main()
+{
+	test_increments();
+	test_writes();
+	test_churn();
+	test_limits();
+	test_limit_resizes();
+	test_unlink();
+	test_snapshots();
+	test_snapshot_resizes();
+	test_versions();
+	test_scans();
+	test_reads();
+	test_waits();
+
+	if (failures)
+		printf("%d checks failed.\n", failures);
+	else
+		printf("all checks passed.\n");
+
+	return failures ? 1 : 0;
+}